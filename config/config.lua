@@ -391,3 +391,69 @@ newaction {
 function increment_project_counter()
   _G.project_count = _G.project_count + 1
 end
+
+newoption {
+  trigger = "alloc-interpose",
+  description = "Build tier_0 with malloc/free/calloc/realloc interposition for allocation profiling (glibc)"
+}
+
+newoption {
+  trigger = "clock",
+  value = "BACKEND",
+  description = "Default clock backend for the cycle stats",
+  allowed = {
+    { "rdtsc",            "rdtsc" },
+    { "rdtscp",           "rdtscp (default on x86)" },
+    { "lfence_rdtsc",     "lfence; rdtsc" },
+    { "rdtscp_lfence",    "rdtscp; lfence" },
+    { "cpuid_rdtsc",      "cpuid; rdtsc" },
+    { "monotonic",        "clock_gettime(CLOCK_MONOTONIC) (default elsewhere)" },
+    { "monotonic_coarse", "clock_gettime(CLOCK_MONOTONIC_COARSE)" }
+  }
+}
+
+-- link time malloc wrapping for allocation profiling, call inside a project that links tier_0
+function tier_0_alloc_tracking()
+  filter "system:linux"
+    linkoptions {"-Wl,--wrap=malloc,--wrap=free,--wrap=calloc,--wrap=realloc"}
+  filter {}
+end
+
+-- link time pthread lock wrapping for lock contention profiling, call inside a project that links tier_0
+function tier_0_lock_tracking()
+  filter "system:linux"
+    linkoptions {"-Wl,--wrap=pthread_mutex_lock,--wrap=pthread_mutex_unlock,--wrap=pthread_rwlock_rdlock,--wrap=pthread_rwlock_wrlock,--wrap=pthread_rwlock_unlock,--wrap=pthread_cond_wait,--wrap=pthread_cond_timedwait"}
+  filter {}
+end
+
+-- link time _exit wrapping so forked workers leaving through _exit() still write their
+-- per process dump (perf/process.h), call inside a project that links tier_0
+function tier_0_process_tracking()
+  filter "system:linux"
+    linkoptions {"-Wl,--wrap=_exit,--wrap=_Exit"}
+  filter {}
+end
+
+-- whole program instrumentation for automatic function profiling (perf/auto.h), call inside a
+-- project that links tier_0. exclude = { functions = {...}, files = {...} } keeps those out at
+-- compile time. the exclude lists are gcc only, clang instruments after inlining instead
+function tier_0_instrument_functions(exclude)
+  exclude = exclude or {}
+  local files = { "include/perf/", "include/utils/" }
+  for _, file in ipairs(exclude.files or {}) do
+    table.insert(files, file)
+  end
+
+  filter "toolset:gcc"
+    buildoptions {"-finstrument-functions", "-finstrument-functions-exclude-file-list=" .. table.concat(files, ",")}
+    if exclude.functions and #exclude.functions > 0 then
+      buildoptions {"-finstrument-functions-exclude-function-list=" .. table.concat(exclude.functions, ",")}
+    end
+
+  filter "toolset:clang"
+    buildoptions {"-finstrument-functions-after-inlining"}
+
+  filter "system:linux"
+    links {"dl"}
+  filter {}
+end
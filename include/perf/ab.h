@@ -0,0 +1,88 @@
+#pragma once
+
+#include <utils/macros.h>
+#include <utils/types.h>
+
+#include <perf/instr.h>
+#include <perf/thread.h>
+
+EXTERN_C_START
+
+// in process A/B comparison of two implementations on the same data. each variant is a
+// regular function site ("name[0]", "name[1]") with the usual stats, the comparison site
+// pairs the n-th run of variant 0 with the n-th run of variant 1. run the two
+// interleaved and let PROFILE_AB_FIRST pick the order of every round so drift in clock
+// frequency or temperature hits both sides alike:
+//
+//   for (u32 round = 0; round < rounds; round++)
+//   {
+//     u32 first = PROFILE_AB_FIRST(hash);
+//     for (u32 k = 0; k < 2; k++)
+//     {
+//       PROFILE_AB(hash, first ^ k) { h = (first ^ k) ? murmur(key) : fnv(key); }
+//     }
+//   }
+//
+// the speedup is the median of the per pair ratios cycles[0] / cycles[1] (> 1 means
+// variant 1 is faster) with a distribution free 95% confidence interval, significance
+// comes from a sign test on which variant won each pair. record a comparison from one thread.
+
+#ifndef PROFILER_AB_MAX
+#define PROFILER_AB_MAX 8
+#endif
+
+#ifndef PROFILER_AB_SAMPLES
+#define PROFILER_AB_SAMPLES 4096  // paired samples kept per comparison, later runs only go to the site stats
+#endif
+
+typedef struct prof_ab_run_t
+{
+  u64     _index;       // variant site, PROFILER_NO_INDEX once the run ended
+  u32     _slot;
+  u32     _variant;
+  u64     _begin_cycles;
+  u64     _begin_time;
+} prof_ab_run_t;
+
+typedef struct prof_ab_result_t
+{
+  u64   _pairs;
+  u64   _wins;              // pairs where variant 1 took fewer cycles
+  u64   _ties;
+  u64   _median_cycles[2];
+  f64   _speedup;           // median of cycles[0] / cycles[1]
+  f64   _speedup_low;       // 95% confidence interval of the median
+  f64   _speedup_high;
+  f64   _p_value;           // two sided sign test, ties dropped
+  bool  _significant;       // p < 0.05
+} prof_ab_result_t;
+
+typedef void (*prof_ab_fn)(void* data);
+
+// comparisons are keyed by name, both variant sites are registered with it
+_index profiler_add_ab_site(const char* file_name, const char* name, u16 line_number);
+
+prof_ab_run_t profiler_ab_begin(const char* file_name, const char* name, u16 line_number, u32 variant);
+void          profiler_ab_end(prof_ab_run_t* run);
+
+// 0 or 1, the variant to run first in the next round
+u32  profiler_ab_first(void);
+
+// runs `a` and `b` on `data` for `rounds` randomized rounds under comparison `name`
+void profiler_ab_compare(const char* name, prof_ab_fn a, prof_ab_fn b, void* data, u32 rounds);
+
+// false when the comparison does not exist or has no pairs yet
+bool profiler_ab_result(const char* name, prof_ab_result_t* out);
+
+void profiler_ab_clear(void);
+
+#define PROFILE_AB_FIRST(site) profiler_ab_first()
+
+// measures the statement or block that follows as one run of `variant` (0 or 1),
+// leaving the block with break or return drops the run
+#define PROFILE_AB(site, variant)                                                        \
+  for (prof_ab_run_t _prof_ab_run_ = profiler_ab_begin(__FILE__, #site, __LINE__, (variant)); \
+       _prof_ab_run_._index != PROFILER_NO_INDEX;                                        \
+       profiler_ab_end(&_prof_ab_run_))
+
+EXTERN_C_END
@@ -3,7 +3,30 @@
 #include <utils/macros.h>
 #include <utils/types.h>
 
+EXTERN_C_START
+
+// counters behind the selected clock backend (perf/clock.h): get_cycle_count is the
+// cheapest read, get_cycle_count_enhanced is what PROFILE_FUNCTION_START/END use
 uint64_t get_cycle_count(void);
 uint64_t get_cycle_count_enhanced(void);
 
 uint64_t get_cycle_count_serialized(void);
+
+// get_cycle_count_enhanced() plus the cpu the read ran on, taken from TSC_AUX when the
+// backend is rdtscp based (linux stores the cpu number in its low 12 bits), otherwise
+// PROFILER_CPU_UNKNOWN
+#define PROFILER_CPU_UNKNOWN 0xFFFFFFFFu
+uint64_t get_cycle_count_cpu(uint32_t* cpu);
+
+#if defined(ARCH_X86) || defined(ARCH_X86_64)
+uint64_t x86_get_rdtsc_counter(void);
+uint64_t x86_get_rdtscp_counter(void);
+uint64_t x86_get_rdtsc_counter_serialized(void);
+uint64_t x86_get_lfence_rdtsc_counter(void);
+uint64_t x86_get_rdtscp_lfence_counter(void);
+uint64_t x86_get_rdtscp_counter_aux(uint32_t* aux);
+uint64_t x86_get_rdtscp_lfence_counter_aux(uint32_t* aux);
+bool     x86_has_rdtscp(void);
+#endif
+
+EXTERN_C_END
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <utils/macros.h>
+#include <utils/types.h>
+
+#include <perf/instr.h>
+#include <perf/thread.h>
+
+EXTERN_C_START
+
+// whole program instrumentation. objects built with -finstrument-functions
+// (tier_0_instrument_functions() in config.lua) call __cyg_profile_func_enter / _exit around
+// every function, those hooks feed the registry like PROFILE_FUNCTION_START / END do.
+//
+// the hot path only hashes the function address: a new address is registered as
+// "fn@0x..." and renamed by profiler_auto_resolve(), which runs as a collector before
+// every report, snapshot and export (dladdr, the object's ELF .symtab, C++ demangling).
+// calls made before profiler_init() are not recorded.
+//
+// up to PROFILER_AUTO_MAX functions get their own site, the rest share "[other]". so do
+// functions that find the address table crowded around their hash, a lookup never probes
+// more than a handful of slots.
+// whole programs usually want MAX_FUNCTIONS and PROFILER_AUTO_MAX raised workspace wide.
+//
+// exclusions: addresses are skipped from the next call on. while name prefixes (also read
+// from TIER0_AUTO_EXCLUDE, comma separated) are set, a new function's name is looked up on
+// its first call and a match never gets a site. a prefix added later also catches functions
+// seen before it that aren't named yet, they keep what they recorded. functions that are
+// never wanted belong in the compile time lists of tier_0_instrument_functions(), they
+// don't cost a hook call or a registry slot.
+
+#ifndef PROFILER_AUTO_MAX
+#define PROFILER_AUTO_MAX (MAX_FUNCTIONS / 2)
+#endif
+
+#define PROFILER_AUTO_EXCLUDE_MAX 16
+
+// false when the exclusion list is full
+bool   profiler_auto_exclude(const char* prefix);
+void   profiler_auto_exclude_function(const void* function);
+
+// names every site registered since the last call and applies the name exclusions,
+// returns how many were resolved
+u32    profiler_auto_resolve(void);
+
+// registry site of an instrumented function, PROFILER_NO_INDEX before its first call
+_index profiler_auto_site(const void* function);
+
+// distinct functions seen by the hooks
+u32    profiler_auto_count(void);
+
+EXTERN_C_END
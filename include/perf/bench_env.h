@@ -0,0 +1,54 @@
+#pragma once
+
+#include <utils/log.h>
+#include <utils/macros.h>
+#include <utils/types.h>
+
+#include <platform/platform.h>
+
+EXTERN_C_START
+
+// benchmark environment control: pin the calling thread to a quiet cpu, raise its
+// priority and score how noisy the host is (governor, turbo, smt siblings, thp, load).
+// opt in (TIER0_BENCH_ENV=1 or profiler_bench_env_set_calibration) to run
+// profiler_calibrate_cache_latency() inside it. every report measures and prints the score.
+
+#define PROFILER_NOISE_UNFIT 50  // scores at or above this make a host unfit for benchmarks
+
+enum prof_env_policy
+{
+  pe_ignore,
+  pe_warn,      // log the score and the reasons when unfit
+  pe_refuse,    // warn, restore the thread and fail when unfit
+};
+
+typedef struct prof_bench_env_t
+{
+  platform_bench_env_t  _platform;
+  bool                  _known;           // platform data could be read
+  bool                  _pinned;
+  bool                  _priority_raised;
+  u32                   _noise_score;     // 0 quiet .. 100 noisy
+  char                  _reasons[192];    // what added to the score
+} prof_bench_env_t;
+
+// pins + raises priority + measures, false when `policy` is pe_refuse and the host is unfit
+bool profiler_bench_env_enter(enum prof_env_policy policy, prof_bench_env_t* out);
+
+// restores the affinity and priority saved by the last enter, nothing without one
+void profiler_bench_env_leave(void);
+
+// measures without touching the thread
+void profiler_bench_env_measure(prof_bench_env_t* out);
+
+// calibrate the cache latencies pinned and prioritized (pe_warn), off by default so
+// profiler_init() leaves the thread's affinity and priority alone
+void profiler_bench_env_set_calibration(bool enabled);
+bool profiler_bench_env_calibration(void);
+
+// environment of the last enter/measure, NULL before the first one
+const prof_bench_env_t* profiler_bench_env_last(void);
+
+void profiler_bench_env_print(log_buffer_t* out, const prof_bench_env_t* env);
+
+EXTERN_C_END
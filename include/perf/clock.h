@@ -0,0 +1,54 @@
+#pragma once
+
+#include <utils/macros.h>
+#include <utils/types.h>
+
+EXTERN_C_START
+
+// clock backend behind get_cycle_count_enhanced() (and with it every "cycles" stat).
+//
+// compile time: -DPROFILER_CLOCK=pc_<backend> picks the default (premake5 --clock=<name>),
+//               adding -DPROFILER_CLOCK_FIXED removes the runtime dispatch entirely
+// runtime:      profiler_clock_select() or the TIER0_CLOCK environment variable (read by profiler_init)
+//
+// the tsc backends count reference cycles, the clock_gettime ones count nanoseconds.
+
+enum prof_clock
+{
+  pc_rdtsc,             // plain rdtsc, cheapest, can be reordered around the measured code
+  pc_rdtscp,            // rdtscp, waits for earlier instructions (the previous default)
+  pc_lfence_rdtsc,      // lfence; rdtsc
+  pc_rdtscp_lfence,     // rdtscp; lfence, nothing later starts before the read
+  pc_cpuid_rdtsc,       // cpuid; rdtsc, fully serialized and expensive
+  pc_monotonic,         // clock_gettime(CLOCK_MONOTONIC)
+  pc_monotonic_coarse,  // clock_gettime(CLOCK_MONOTONIC_COARSE), tick resolution (linux)
+
+  pc_clock_count,
+};
+
+#ifndef PROFILER_CLOCK
+  #if defined(ARCH_X86) || defined(ARCH_X86_64)
+    #define PROFILER_CLOCK pc_rdtscp
+  #else
+    #define PROFILER_CLOCK pc_monotonic
+  #endif
+#endif
+
+typedef u64 (*prof_clock_fn)(void);
+
+const char*     profiler_clock_name(enum prof_clock clock);
+bool            profiler_clock_available(enum prof_clock clock);
+
+// reads `clock` directly, 0 when it isn't available
+u64             profiler_clock_read(enum prof_clock clock);
+prof_clock_fn   profiler_clock_reader(enum prof_clock clock);
+
+// false (and no change) if the backend isn't available on this host/build
+bool            profiler_clock_select(enum prof_clock clock);
+bool            profiler_clock_select_name(const char* name);
+enum prof_clock profiler_clock_current(void);
+
+// true when the selected backend counts nanoseconds instead of cycles
+bool            profiler_clock_is_nanoseconds(void);
+
+EXTERN_C_END
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <utils/log.h>
+#include <utils/macros.h>
+#include <utils/types.h>
+
+#include <perf/instr.h>
+
+EXTERN_C_START
+
+// selectable perf events counted per thread and attributed to every active site
+// (inclusive, like the cycle stats). choose the set at init with
+// TIER0_PERF_EVENTS="dtlb_misses,page_faults,raw:0x01b1" or profiler_events_select*().
+// each thread opens the set as one perf_event group on its first profiled call and
+// reads it with a single read() at START and END. linux only, elsewhere selecting fails.
+
+#ifndef PROFILER_MAX_EVENTS
+#define PROFILER_MAX_EVENTS 8
+#endif
+
+enum prof_event
+{
+  pv_cycles,
+  pv_instructions,
+  pv_branch_misses,
+  pv_stalled_frontend,
+  pv_stalled_backend,
+  pv_dtlb_misses,
+  pv_itlb_misses,
+  pv_l1d_misses,
+  pv_llc_misses,
+  pv_page_faults,
+  pv_minor_faults,
+  pv_major_faults,
+  pv_context_switches,
+  pv_cpu_migrations,
+  pv_raw,               // model specific event code in _config
+
+  pv_count,
+};
+
+typedef struct prof_event_spec_t
+{
+  u32 _event;           // enum prof_event
+  u32 _pmu;             // perf_event type of a pv_raw event, 0 for the core pmu (PERF_TYPE_RAW)
+  u64 _config;          // raw event code for pv_raw
+} prof_event_spec_t;
+
+struct prof_thread_t;
+
+// replaces the selected set, threads reopen their counters on their next profiled call
+bool profiler_events_select(const prof_event_spec_t* events, u32 count);
+
+// comma separated event names (see profiler_event_name) or raw:<hex code>
+bool profiler_events_select_names(const char* list);
+
+u32                      profiler_events_count(void);
+const prof_event_spec_t* profiler_events_spec(u32 slot);
+const char*              profiler_event_name(enum prof_event event);
+
+// false when no thread managed to open the event
+bool profiler_event_available(u32 slot);
+
+// inclusive count of the selected event `slot` in site `index`
+u64  profiler_get_event_stat(_index index, u32 slot);
+
+void profiler_events_print(log_buffer_t* out, _index index);
+void profiler_events_clear(void);
+
+// same set, every thread opens new counters on its next profiled call (used after fork)
+void profiler_events_reopen(void);
+
+// used by profiler_enter / profiler_leave: non zero while a set is selected, the
+// generation changes with every selection
+u32  profiler_events_active(void);
+void profiler_events_sample(struct prof_thread_t* thread, u64* out);
+void profiler_events_attribute(_index index, const u64* begin, const u64* end);
+
+// closes the counters of an exiting thread
+void profiler_events_release(struct prof_thread_t* thread);
+
+EXTERN_C_END
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <utils/macros.h>
+#include <utils/types.h>
+
+#include <perf/instr.h>
+#include <perf/span.h>
+
+EXTERN_C_START
+
+enum prof_weight
+{
+  pw_cycles,
+  pw_nanoseconds,
+  pw_calls,
+};
+
+// collapsed stacks ("frame;frame;frame weight" per line) for flamegraph.pl / speedscope / inferno,
+// the flat function stats have no call path so every function is a single frame stack.
+// function and span sites only, cycles and nanoseconds are self (exclusive) values
+bool profiler_export_folded(const char* path, enum prof_weight weight);
+
+// uncompressed pprof protobuf (profile.proto), carries cycles, nanoseconds and calls
+// as sample types with `weight` as the default one
+bool profiler_export_pprof(const char* path, enum prof_weight weight);
+
+// chrome trace event json (chrome://tracing, perfetto) of the retained spans: spans that end on
+// their own thread are complete events, cross thread spans are async pairs with a flow arrow
+// between the two threads, parent/child links are flow arrows to where the child began
+bool profiler_export_trace(const char* path);
+
+EXTERN_C_END
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <utils/macros.h>
+#include <utils/types.h>
+
+#include <perf/hist.h>
+#include <perf/instr.h>
+
+EXTERN_C_START
+
+// frame / tick profiling for fixed rate loops. call PROFILE_FRAME_MARK() once per
+// iteration, everything between two marks is one frame. a mark runs the collectors like a
+// report does, profiler_reset() forgets every frame.
+
+#ifndef PROFILER_WORST_FRAMES
+#define PROFILER_WORST_FRAMES 8
+#endif
+
+// per function and span totals of a single frame
+typedef struct prof_frame_breakdown_t
+{
+  u64   _frame;             // frame number, counted from the first mark
+  u64   _time;              // nanoseconds
+  u64   _cycles;
+
+  u64   _func_cycles[TOTAL_FUNCTIONS];  // self cycles, they add up to at most _cycles
+  u64   _func_calls[TOTAL_FUNCTIONS];
+} prof_frame_breakdown_t;
+
+typedef struct prof_frame_stat_t
+{
+  u64               _frames;
+  u64               _budget;          // nanoseconds, 0 = none
+  u64               _over_budget;
+  u64               _total_time;
+  u64               _min_time;
+  u64               _max_time;
+  prof_hist_stat_t  _hist;            // frame time in nanoseconds
+} prof_frame_stat_t;
+
+void profiler_frame_mark(void);
+
+void profiler_frame_set_budget(u64 nanoseconds);
+
+const prof_frame_stat_t* profiler_frame_stat(void);
+
+// worst frames by frame time, slowest first, NULL past the retained count
+const prof_frame_breakdown_t* profiler_frame_worst(u32 rank);
+
+void profiler_print_frames(void);
+
+// forgets every frame, keeps the budget
+void profiler_frame_clear(void);
+
+#define PROFILE_FRAME_MARK() profiler_frame_mark()
+
+EXTERN_C_END
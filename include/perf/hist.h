@@ -0,0 +1,43 @@
+#pragma once
+
+#include <utils/macros.h>
+#include <utils/types.h>
+
+EXTERN_C_START
+
+// log-linear histogram: 4 sub-buckets per power of two, values >= 2^33 land in the last bucket
+#define PROF_HIST_SUB_BITS  2
+#define PROF_HIST_BUCKETS   128
+
+typedef struct ALIGNAS(8) prof_hist_stat_t
+{
+  u64 _buckets[PROF_HIST_BUCKETS];
+  u64 _min;       // smallest and largest recorded value, bound the interpolation
+  u64 _max;
+} prof_hist_stat_t;
+
+u32  profiler_hist_bucket(u64 value);
+u64  profiler_hist_bucket_floor(u32 bucket);
+
+void profiler_hist_record(prof_hist_stat_t* hist, u64 value);
+
+// same for histograms shared between threads, relaxed atomics
+void profiler_hist_record_atomic(prof_hist_stat_t* hist, u64 value);
+u64  profiler_hist_count(const prof_hist_stat_t* hist);
+
+// percentile in [0, 100], linearly interpolated inside the bucket and kept within the
+// recorded min and max
+u64  profiler_hist_percentile(const prof_hist_stat_t* hist, f64 percentile);
+
+// out = end - begin (bucket wise), min and max of the interval are bounded by those of end
+void profiler_hist_delta(const prof_hist_stat_t* begin, const prof_hist_stat_t* end, prof_hist_stat_t* out);
+
+// square root for the stats code, the library does not link libm
+f64  profiler_sqrt(f64 x);
+
+// into += from (bucket wise)
+void profiler_hist_merge(prof_hist_stat_t* into, const prof_hist_stat_t* from);
+
+static_assert(sizeof(prof_hist_stat_t) == PROF_HIST_BUCKETS * 8 + 16, "prof_hist_stat_t  isnt 1040 bytes");
+
+EXTERN_C_END
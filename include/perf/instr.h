@@ -2,12 +2,16 @@
 
 #include <assert.h>
 
+#include <utils/log.h>
 #include <utils/macros.h>
 #include <utils/types.h>
 
 #include <perf/arch.h>
+#include <perf/hist.h>
 #include <perf/timer.h>
 
+EXTERN_C_START
+
 #ifndef MAX_FUNCTIONS
 #define MAX_FUNCTIONS 128
 #endif
@@ -17,6 +21,9 @@
 
 #define TOTAL_FUNCTIONS (MAX_FUNCTIONS + PROFILER_RESERVED)
 
+// no site: the registry is full, or nothing is active. stat functions ignore it
+#define PROFILER_NO_INDEX ((_index)-1)
+
 #define EST_L1_MAX_CYCLES   25
 #define EST_L2_MAX_CYCLES   35
 #define EST_L3_MAX_CYCLES   90
@@ -24,14 +31,28 @@
 typedef bool      _in_use;
 typedef uint64_t  _index;
 
+// what a registry slot measures
+enum prof_kind
+{
+  pk_function,
+  pk_lock,
+  pk_span,
+  pk_counter,
+  pk_gauge,
+  pk_ab,        // A/B comparison of two variant sites (perf/ab.h)
+
+  pk_count,
+};
+
 typedef struct ALIGNAS(8) prof_stat_head_t
 {
   _index _id;
   char  _file_name[144];
   char  _func_name[96];
   u16   _line;
+  u8    _kind;   // enum prof_kind
 
-  char padding[6];
+  char padding[5];
 } prof_stat_head_t;
 
 typedef struct ALIGNAS(8) prof_cpu_stat_t
@@ -110,18 +131,141 @@ enum prof_output
   pa_l1_misses,
   pa_l2_misses,
   pa_l3_misses,
+
+  pa_cycles_p50,
+  pa_cycles_p90,
+  pa_cycles_p99,
 };
 
+// work units reported by PROFILE_FUNCTION_END_WORK / PROFILE_LOOP / PROFILE_WORK,
+// only calls that reported work are counted here
+typedef struct ALIGNAS(8) prof_work_stat_t
+{
+  u64 _bytes;
+  u64 _items;
+  u64 _calls;
+  u64 _cycles;
+  u64 _time;
+  f64 _cycles_per_byte_min;
+  f64 _cycles_per_byte_max;
+  f64 _cycles_per_item_min;
+  f64 _cycles_per_item_max;
+
+  char padding[8];
+} prof_work_stat_t;
+
+// exclusive cost of a site: its own cycles/time minus those of the profiled calls it made
+typedef struct ALIGNAS(8) prof_self_stat_t
+{
+  u64 _cycles;
+  u64 _time;
+} prof_self_stat_t;
+
+// point in time copy of every stat array, used for phases and interval deltas
+typedef struct prof_snapshot_t
+{
+  u64               _timestamp;
+  _index            _count;
+
+  prof_cpu_stat_t   _cpu[TOTAL_FUNCTIONS];
+  prof_time_stat_t  _time[TOTAL_FUNCTIONS];
+  prof_call_stat_t  _call[TOTAL_FUNCTIONS];
+  prof_cache_stat_t _cache[TOTAL_FUNCTIONS];
+  prof_hist_stat_t  _hist[TOTAL_FUNCTIONS];
+} prof_snapshot_t;
+
 void profiler_init(void);
 void profiler_end(void);
 
+// PROFILER_NO_INDEX once the registry is full, the site then records nothing
 uint64_t profiler_add_function(const char* file_name,const char* func_name,u16 line_number);
+uint64_t profiler_add_site(const char* file_name,const char* name,u16 line_number,enum prof_kind kind);
+
+// sites other than functions and spans print their own stats in profiler_print_all(),
+// span printers are called after the function stats
+typedef void (*prof_print_fn)(log_buffer_t* out, _index index);
+void profiler_register_printer(enum prof_kind kind, prof_print_fn printer);
+
+// renames a registered site, for sites registered before their name is known (perf/auto.h)
+void profiler_set_site_name(_index index, const char* file_name, const char* func_name);
+
+// registered site with that name and kind, (_index)-1 if there is none
+_index profiler_find_site(const char* name, enum prof_kind kind);
+
+// nanoseconds at profiler_init() / the last profiler_reset()
+u64 profiler_start_time(void);
+
+// sites that keep their data elsewhere (per thread shards) fold it into the registry
+// through a collector, run before printing, snapshots and exports. profiler_reset()
+// runs it with reset = true to clear that data instead
+typedef void (*prof_collect_fn)(bool reset);
+void profiler_register_collector(enum prof_kind kind, prof_collect_fn collector);
+void profiler_collect(void);
+
+// overwrites the call count of a site whose values live elsewhere (counters, gauges), so
+// queries can filter and sort it. its cycle, time and histogram stats stay empty
+void profiler_store_calls(_index index, u64 count);
+
+// overwrites the cycle, time and self stats of a site whose calls are timed elsewhere (per
+// thread span shards), the averages follow the stored call count
+void profiler_store_timing(_index index, const prof_cpu_stat_t* cpu, const prof_time_stat_t* time,
+                           const prof_self_stat_t* self);
+
+// records one duration into a site's histogram, safe from any thread
+void profiler_hist_add(_index index, u64 cycles);
+
+// takes back the call PROFILE_FUNCTION_START counted, for samples dropped before they are recorded
+void profiler_drop_call(_index index);
 
 void profiler_add(enum prof_add type,uint64_t value,_index index);
+
+// cpu migration check of one region, see perf/migration.h
+bool profiler_region_cpu(_index index, u32 start_cpu, u32 end_cpu, u64 cycles);
+
+// per thread active function stack (see perf/thread.h), used to attribute allocations
+void profiler_enter(_index index);
+void profiler_leave(_index index);
+void profiler_leave_work(_index index, u64 cycles, u64 time, u64 bytes, u64 items);
+
+// adds work units to the innermost active function, reported when it ends
+void profiler_frame_work(u64 bytes, u64 items);
+
+// one call's worth of work, cycles/time are the duration of that call
+void profiler_add_work(_index index, u64 cycles, u64 time, u64 bytes, u64 items);
+void profiler_add_self(_index index, u64 cycles, u64 time);
 u64 profiler_output(enum prof_output type,_index index);
 
 void profiler_print_all(void);
 
+// zeroes every stat but keeps the registered functions
+void profiler_reset(void);
+
+// the registry and per thread site, span and allocation stats only: no collectors, no locks,
+// safe in a fork child. data kept by the other collectors (metrics, locks) and outliers are
+// left as they are
+void profiler_reset_stats(void);
+
+void profiler_snapshot(prof_snapshot_t* out);
+
+// out = end - begin, min/max of the interval are estimated from the cycle histogram
+void profiler_snapshot_delta(const prof_snapshot_t* begin, const prof_snapshot_t* end, prof_snapshot_t* out);
+
+const prof_stat_head_t*   profiler_get_stat_head(_index index);
+const prof_cpu_stat_t*    profiler_get_cpu_stat(_index index);
+const prof_time_stat_t*   profiler_get_time_stat(_index index);
+const prof_call_stat_t*   profiler_get_call_stat(_index index);
+const prof_cache_stat_t*  profiler_get_cache_stat(_index index);
+const prof_hist_stat_t*   profiler_get_hist_stat(_index index);
+const prof_work_stat_t*   profiler_get_work_stat(_index index);
+const prof_self_stat_t*   profiler_get_self_stat(_index index);
+_index profiler_get_function_count(void);
+
+// PROFILE_CACHE_END reads hardware counters when they opened, disabling falls back to
+// the cycle based estimation
+bool profiler_hw_counters_available(void);
+void profiler_hw_counters_set_enabled(bool enabled);
+void profiler_hw_counters_reopen(void);
+
 void profiler_calibrate_cache_latency(void);
 cache_latency_profile_t* profiler_get_cache_profile(void);
 
@@ -130,30 +274,46 @@ static_assert(sizeof(prof_cpu_stat_t) == 32,    "prof_cpu_stat_t    isnt 32 byte
 static_assert(sizeof(prof_time_stat_t) == 32,   "prof_time_stat_t   isnt 32 bytes!");
 static_assert(sizeof(prof_call_stat_t) == 32,   "prof_call_stat_t   isnt 32 bytes!");
 static_assert(sizeof(prof_cache_stat_t) == 64,  "prof_cache_stat_t  isnt 64 bytes");
+static_assert(sizeof(prof_work_stat_t) == 80,   "prof_work_stat_t   isnt 80 bytes");
+static_assert(sizeof(prof_self_stat_t) == 16,   "prof_self_stat_t   isnt 16 bytes");
 
+// registration, the thread stack and perf event reads happen before the clock is read
 #define PROFILE_FUNCTION_START                \
   static bool     _initialized_ = false;      \
   static _index   _function_index_ = 0;       \
-  uint64_t _prof_start_cycles = get_cycle_count_enhanced(); \
-  uint64_t _prof_start_time   = get_nanoseconds();          \
   if (_initialized_ == false)                               \
   {                                                         \
     _function_index_ = profiler_add_function(__FILE__, FUNCTION_NAME, __LINE__);  \
     _initialized_ = true;                                                         \
   }                                                                               \
-  profiler_add(pa_total_calls,1,_function_index_);                              
-
-#define PROFILE_FUNCTION_END                                                \
-  uint64_t _prof_end_cycles = get_cycle_count_enhanced();                   \
+  profiler_enter(_function_index_);                                               \
+  profiler_add(pa_total_calls,1,_function_index_);                                \
+  uint32_t _prof_start_cpu;                                 \
+  uint64_t _prof_start_cycles = get_cycle_count_cpu(&_prof_start_cpu); \
+  uint64_t _prof_start_time   = get_nanoseconds();
+
+#define PROFILE_FUNCTION_END_WORK(bytes, items)                             \
+  uint32_t _prof_end_cpu;                                                   \
+  uint64_t _prof_end_cycles = get_cycle_count_cpu(&_prof_end_cpu);          \
   uint64_t _prof_end_time   = get_nanoseconds();                            \
   uint64_t _prof_cycles_total   = _prof_end_cycles - _prof_start_cycles;    \
   uint64_t _prof_time_total     = _prof_end_time - _prof_start_time;        \
-  profiler_add(pa_cycles_total,_prof_cycles_total,_function_index_);        \
-  profiler_add(pa_cycles_min,_prof_cycles_total,_function_index_);          \
-  profiler_add(pa_cycles_max,_prof_cycles_total,_function_index_);          \
-  profiler_add(pa_time_total,_prof_time_total,_function_index_);            \
-  profiler_add(pa_time_min,_prof_time_total,_function_index_);              \
-  profiler_add(pa_time_max,_prof_time_total,_function_index_);              \
+  if (profiler_region_cpu(_function_index_,_prof_start_cpu,_prof_end_cpu,_prof_cycles_total)) \
+  {                                                                         \
+    profiler_add(pa_cycles_total,_prof_cycles_total,_function_index_);      \
+    profiler_add(pa_cycles_min,_prof_cycles_total,_function_index_);        \
+    profiler_add(pa_cycles_max,_prof_cycles_total,_function_index_);        \
+    profiler_add(pa_time_total,_prof_time_total,_function_index_);          \
+    profiler_add(pa_time_min,_prof_time_total,_function_index_);            \
+    profiler_add(pa_time_max,_prof_time_total,_function_index_);            \
+  }                                                                         \
+  profiler_leave_work(_function_index_,_prof_cycles_total,_prof_time_total,(bytes),(items)); \
+
+#define PROFILE_FUNCTION_END PROFILE_FUNCTION_END_WORK(0, 0)
+
+// work done inside the current profiled function, summed until its END
+#define PROFILE_LOOP(n)             profiler_frame_work(0, (n));
+#define PROFILE_WORK(bytes, items)  profiler_frame_work((bytes), (items));
 
 #define PROFILE_HINT_SUCCESSFUL_RETURN                      \
   profiler_add(pa_successful_return,1,_function_index_);    \
@@ -165,3 +325,5 @@ static_assert(sizeof(prof_cache_stat_t) == 64,  "prof_cache_stat_t  isnt 64 byte
   uint64_t name##_cache_end = get_cycle_count_enhanced();           \
   uint64_t name##_cache_delta = name##_cache_end - name##_cache_start;    \
   profiler_add(pa_cache_access,name##_cache_delta,_function_index_)   \
+
+EXTERN_C_END
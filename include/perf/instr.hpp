@@ -0,0 +1,150 @@
+#pragma once
+
+#include <perf/arch.h>
+#include <perf/instr.h>
+#include <perf/thread.h>
+#include <perf/timer.h>
+
+// C++11 front-end of PROFILE_FUNCTION_START / END.
+//
+// a site descriptor is a type with static file(), name(), line(), kind() and a constexpr
+// id(), a compile time FNV-1a hash. tier_0::site<Descriptor>::index registers it during static
+// initialization, so a guard only loads its index: no registration branch at START.
+// tier_0::scope<Descriptor> records on every way out of the block, exceptions included.
+//
+//   void parse(buffer_t& in)
+//   {
+//     PROFILE_FUNCTION_SCOPE;          // this function, like START / END around its body
+//     {
+//       PROFILE_SCOPE(tokenize);       // a site of its own, named "tokenize"
+//       ...
+//     }
+//   }
+//
+// sites register before main(), profiler_init() keeps them.
+
+namespace tier_0
+{
+
+// FNV-1a, folded by the compiler for literals
+constexpr u64 hash(const char* text, u64 value = 14695981039346656037ull)
+{
+  return *text ? hash(text + 1, (value ^ (u64)(u8)*text) * 1099511628211ull) : value;
+}
+
+constexpr u64 hash_line(const char* file, u32 line)
+{
+  return (hash(file) ^ line) * 1099511628211ull;
+}
+
+template <typename Descriptor>
+struct site
+{
+  static const _index index;
+};
+
+template <typename Descriptor>
+const _index site<Descriptor>::index =
+  profiler_add_site(Descriptor::file(), Descriptor::name(), Descriptor::line(), Descriptor::kind());
+
+// same reads in the same order as the C macros
+template <typename Descriptor>
+class scope
+{
+public:
+  FORCE_INLINE scope()
+  {
+    profiler_enter(site<Descriptor>::index);
+    profiler_add(pa_total_calls, 1, site<Descriptor>::index);
+    _start_cycles = get_cycle_count_cpu(&_start_cpu);
+    _start_time   = get_nanoseconds();
+  }
+
+  FORCE_INLINE ~scope()
+  {
+    u32    end_cpu;
+    u64    end_cycles = get_cycle_count_cpu(&end_cpu);
+    u64    end_time   = get_nanoseconds();
+    u64    cycles     = end_cycles - _start_cycles;
+    u64    time       = end_time - _start_time;
+    _index index      = site<Descriptor>::index;
+    if (profiler_region_cpu(index, _start_cpu, end_cpu, cycles))
+    {
+      profiler_add(pa_cycles_total, cycles, index);
+      profiler_add(pa_cycles_min, cycles, index);
+      profiler_add(pa_cycles_max, cycles, index);
+      profiler_add(pa_time_total, time, index);
+      profiler_add(pa_time_min, time, index);
+      profiler_add(pa_time_max, time, index);
+    }
+    profiler_leave_work(index, cycles, time, 0, 0);
+  }
+
+  scope(const scope&)            = delete;
+  scope& operator=(const scope&) = delete;
+
+  // work done inside the scope, PROFILE_WORK
+  void work(u64 bytes, u64 items) { profiler_frame_work(bytes, items); }
+
+  static _index        index() { return site<Descriptor>::index; }
+  static constexpr u64 id()    { return Descriptor::id(); }
+
+private:
+  u32 _start_cpu;
+  u64 _start_cycles;
+  u64 _start_time;
+};
+
+// profiler_output() with the unit in the type
+struct cycles      { u64 count; };
+struct nanoseconds { u64 count; };
+struct misses      { u64 count; };
+
+template <enum prof_output Output> struct output_unit;
+template <> struct output_unit<pa_cycles_avg> { typedef cycles type; };
+template <> struct output_unit<pa_cycles_p50> { typedef cycles type; };
+template <> struct output_unit<pa_cycles_p90> { typedef cycles type; };
+template <> struct output_unit<pa_cycles_p99> { typedef cycles type; };
+template <> struct output_unit<pa_time_avg>   { typedef nanoseconds type; };
+template <> struct output_unit<pa_l1_misses>  { typedef misses type; };
+template <> struct output_unit<pa_l2_misses>  { typedef misses type; };
+template <> struct output_unit<pa_l3_misses>  { typedef misses type; };
+
+template <enum prof_output Output>
+typename output_unit<Output>::type output(_index index)
+{
+  typedef typename output_unit<Output>::type unit;
+  return unit{ profiler_output(Output, index) };
+}
+
+template <enum prof_output Output, typename Descriptor>
+typename output_unit<Output>::type output()
+{
+  return output<Output>(site<Descriptor>::index);
+}
+
+} // namespace tier_0
+
+#define PROFILE_SITE_DESCRIPTOR_(type, name_expr, id_expr)                  \
+  struct type                                                               \
+  {                                                                         \
+    static const char*    file() { return __FILE__; }                       \
+    static const char*    name() { return (name_expr); }                    \
+    static u16            line() { return __LINE__; }                       \
+    static enum prof_kind kind() { return pk_function; }                    \
+    static constexpr u64  id()   { return (id_expr); }                      \
+  }
+
+// the enclosing function, one per function. its name is taken outside the descriptor,
+// inside it FUNCTION_NAME would name the descriptor's member
+#define PROFILE_FUNCTION_SCOPE                                              \
+  static const char* const _prof_scope_function_ = FUNCTION_NAME;           \
+  PROFILE_SITE_DESCRIPTOR_(_prof_scope_site_, _prof_scope_function_,        \
+                           ::tier_0::hash_line(__FILE__, __LINE__));        \
+  ::tier_0::scope<_prof_scope_site_> _prof_scope_
+
+// a named block, the name is an identifier like PROFILE_LOCK's
+#define PROFILE_SCOPE(name)                                                 \
+  PROFILE_SITE_DESCRIPTOR_(_prof_scope_##name##_site_, #name,               \
+                           ::tier_0::hash(#name));                          \
+  ::tier_0::scope<_prof_scope_##name##_site_> _prof_scope_##name##_
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <utils/macros.h>
+#include <utils/types.h>
+
+#include <perf/hist.h>
+#include <perf/instr.h>
+
+#if !PLATFORM_WINDOWS
+#include <pthread.h>
+#endif
+
+EXTERN_C_START
+
+typedef struct ALIGNAS(8) prof_lock_stat_t
+{
+  u64 _acquires;
+  u64 _contended;         // acquires that had to wait
+  u64 _wait_cycles;
+  u64 _wait_cycles_max;
+  u64 _hold_cycles;
+  u64 _hold_cycles_max;
+  u64 _releases;
+
+  char padding[8];
+} prof_lock_stat_t;
+
+// registers a lock site, shows up as "<function>:<name>" in the report
+_index profiler_add_lock_site(const char* file_name, const char* func_name, const char* lock_name, u16 line_number);
+
+const prof_lock_stat_t* profiler_get_lock_stat(_index index);
+const prof_hist_stat_t* profiler_get_lock_wait_hist(_index index);
+
+// zeroes every lock stat, plain stores so a fork child can call it. profiler_reset() does it
+// through the lock collector, which also hands acquires (calls) and wait plus hold cycles to
+// the registry for queries, snapshots and exports
+void profiler_lock_clear(void);
+
+// raw recording, for locks that aren't pthread based
+void profiler_lock_acquired(_index index, u64 wait_cycles, bool contended);
+void profiler_lock_released(_index index, u64 hold_cycles);
+
+#if !PLATFORM_WINDOWS
+// return the cycle count at acquisition, pass it back on release for the hold time. a
+// pthread_cond_wait() in between counts as held, only the link time wrap (lock_wrap.c)
+// splits the hold at condition variable waits
+u64  profiler_lock_mutex(_index index, pthread_mutex_t* mutex);
+void profiler_unlock_mutex(_index index, pthread_mutex_t* mutex, u64 acquired);
+#endif
+
+// rwlocks need POSIX 2001, define _POSIX_C_SOURCE before including when building as strict c11
+#if !PLATFORM_WINDOWS && defined(PTHREAD_RWLOCK_INITIALIZER)
+
+u64  profiler_lock_rdlock(_index index, pthread_rwlock_t* lock);
+u64  profiler_lock_wrlock(_index index, pthread_rwlock_t* lock);
+void profiler_lock_rwunlock(_index index, pthread_rwlock_t* lock, u64 acquired);
+#endif
+
+static_assert(sizeof(prof_lock_stat_t) == 64, "prof_lock_stat_t   isnt 64 bytes");
+
+#define _PROFILE_LOCK_SITE(name)                                                                    \
+  static bool   _lock_##name##_initialized_ = false;                                                \
+  static _index _lock_##name##_index_ = 0;                                                          \
+  if (_lock_##name##_initialized_ == false)                                                         \
+  {                                                                                                 \
+    _lock_##name##_index_ = profiler_add_lock_site(__FILE__, FUNCTION_NAME, #name, __LINE__);       \
+    _lock_##name##_initialized_ = true;                                                             \
+  }
+
+#define PROFILE_LOCK(name, mutex)                                                   \
+  _PROFILE_LOCK_SITE(name)                                                          \
+  uint64_t name##_lock_acquired = profiler_lock_mutex(_lock_##name##_index_, (mutex));
+
+#define PROFILE_UNLOCK(name, mutex)                                                 \
+  profiler_unlock_mutex(_lock_##name##_index_, (mutex), name##_lock_acquired);
+
+#define PROFILE_RDLOCK(name, rwlock)                                                \
+  _PROFILE_LOCK_SITE(name)                                                          \
+  uint64_t name##_lock_acquired = profiler_lock_rdlock(_lock_##name##_index_, (rwlock));
+
+#define PROFILE_WRLOCK(name, rwlock)                                                \
+  _PROFILE_LOCK_SITE(name)                                                          \
+  uint64_t name##_lock_acquired = profiler_lock_wrlock(_lock_##name##_index_, (rwlock));
+
+#define PROFILE_RWUNLOCK(name, rwlock)                                              \
+  profiler_lock_rwunlock(_lock_##name##_index_, (rwlock), name##_lock_acquired);
+
+EXTERN_C_END
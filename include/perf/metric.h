@@ -0,0 +1,63 @@
+#pragma once
+
+#include <utils/macros.h>
+#include <utils/types.h>
+
+#include <perf/hist.h>
+#include <perf/instr.h>
+
+EXTERN_C_START
+
+// named counters (monotonic, e.g. bytes parsed) and gauges (sampled values, e.g. queue
+// depth) living in the function registry. updates go to per thread shards, the collector
+// folds them into the registry before printing/snapshots so phases, series and exports
+// carry them too: calls = updates, cycles total/min/max/hist = the values.
+
+typedef struct prof_metric_t
+{
+  u64 _count;     // updates (counter) or samples (gauge)
+  u64 _sum;
+  u64 _min;
+  u64 _max;
+  u64 _last;      // gauges only
+  f64 _avg;
+  f64 _rate;      // sum per second since profiler_init()/profiler_reset()
+} prof_metric_t;
+
+// same name = same metric, wherever it is registered
+_index profiler_add_counter(const char* file_name, const char* name, u16 line_number);
+_index profiler_add_gauge(const char* file_name, const char* name, u16 line_number);
+
+void profiler_counter_add(_index index, u64 delta);
+void profiler_gauge_sample(_index index, u64 value);
+
+// sums the shards of every thread
+void profiler_metric_read(_index index, prof_metric_t* out);
+
+// zeroes the shards and gauge histograms, plain stores so a fork child can call it
+void profiler_metric_clear(void);
+
+#define _PROFILE_METRIC_SITE(kind, name)                                             \
+  static bool   _##kind##_##name##_initialized_ = false;                             \
+  static _index _##kind##_##name##_index_ = 0;                                       \
+  if (_##kind##_##name##_initialized_ == false)                                      \
+  {                                                                                  \
+    _##kind##_##name##_index_ = profiler_add_##kind(__FILE__, #name, __LINE__);      \
+    _##kind##_##name##_initialized_ = true;                                          \
+  }
+
+#define PROFILE_COUNTER_ADD(name, delta)                                             \
+  do                                                                                 \
+  {                                                                                  \
+    _PROFILE_METRIC_SITE(counter, name)                                              \
+    profiler_counter_add(_counter_##name##_index_, (delta));                         \
+  } while (0)
+
+#define PROFILE_GAUGE(name, value)                                                   \
+  do                                                                                 \
+  {                                                                                  \
+    _PROFILE_METRIC_SITE(gauge, name)                                                \
+    profiler_gauge_sample(_gauge_##name##_index_, (value));                          \
+  } while (0)
+
+EXTERN_C_END
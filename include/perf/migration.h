@@ -0,0 +1,59 @@
+#pragma once
+
+#include <utils/macros.h>
+#include <utils/types.h>
+
+#include <perf/arch.h>
+#include <perf/instr.h>
+
+EXTERN_C_START
+
+// cpu migration tracking for profiled regions. the cpu is read from TSC_AUX at
+// PROFILE_FUNCTION_START and END (rdtscp based clock backends only, see perf/clock.h),
+// a region that ended on another cpu migrated and its cycles may include cross socket
+// tsc skew.
+
+#ifndef PROFILER_MAX_CPUS
+#define PROFILER_MAX_CPUS 64
+#endif
+
+enum prof_migration_mode
+{
+  pm_keep,        // migrated samples stay in the stats, also summed in the migration stats
+  pm_discard,     // migrated samples are dropped everywhere, call count included, only _migrations counts them
+  pm_separate,    // migrated samples only go to the migration stats
+};
+
+typedef struct ALIGNAS(8) prof_migration_stat_t
+{
+  u64 _migrations;
+  u64 _unknown;               // regions without a cpu id (non rdtscp backend)
+  u64 _migrated_cycles;
+  u64 _migrated_cycles_max;
+} prof_migration_stat_t;
+
+// non migrated samples by cpu
+typedef struct ALIGNAS(8) prof_cpu_breakdown_t
+{
+  u64 _calls;
+  u64 _cycles;
+} prof_cpu_breakdown_t;
+
+void                     profiler_migration_set_mode(enum prof_migration_mode mode);
+enum prof_migration_mode profiler_migration_mode(void);
+
+// called by PROFILE_FUNCTION_END before profiler_leave_work, false when the sample must stay
+// out of the cycle/time stats. a dropped sample is taken out of the call count and marked so
+// the following profiler_leave_work of `index` on this thread only pops its frame
+bool profiler_region_cpu(_index index, u32 start_cpu, u32 end_cpu, u64 cycles);
+
+const prof_migration_stat_t* profiler_get_migration_stat(_index index);
+const prof_cpu_breakdown_t*  profiler_get_cpu_breakdown(_index index, u32 cpu);
+u64                          profiler_migrations_total(void);
+
+void profiler_migration_clear(void);
+
+static_assert(sizeof(prof_migration_stat_t) == 32, "prof_migration_stat_t isnt 32 bytes");
+static_assert(sizeof(prof_cpu_breakdown_t) == 16,  "prof_cpu_breakdown_t isnt 16 bytes");
+
+EXTERN_C_END
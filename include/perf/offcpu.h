@@ -0,0 +1,50 @@
+#pragma once
+
+#include <utils/log.h>
+#include <utils/macros.h>
+#include <utils/types.h>
+
+#include <perf/instr.h>
+
+EXTERN_C_START
+
+// on-cpu vs off-cpu split per site. when enabled (TIER0_OFFCPU=1 or profiler_offcpu_enable)
+// profiler_enter / profiler_leave also read the thread's cpu time (CLOCK_THREAD_CPUTIME_ID)
+// and context switch counts (getrusage RUSAGE_THREAD). off-cpu time is the wall time of a
+// call minus its cpu time: blocking io, locks, sleeps and waiting to be scheduled. costs two
+// syscalls at START and END, so it is off by default. inclusive, like the cycle stats.
+
+typedef struct ALIGNAS(8) prof_offcpu_stat_t
+{
+  u64 _calls;
+  u64 _wall_time;     // ns, of the sampled calls
+  u64 _cpu_time;      // ns
+  u64 _voluntary;     // context switches inside the site: blocked or yielded
+  u64 _involuntary;   // preempted
+
+  char padding[24];
+} prof_offcpu_stat_t;
+
+typedef struct prof_cpu_sample_t
+{
+  u64 _cpu_time;
+  u64 _voluntary;
+  u64 _involuntary;
+} prof_cpu_sample_t;
+
+// false when the platform can't read thread cpu time
+bool profiler_offcpu_enable(bool enable);
+bool profiler_offcpu_enabled(void);
+
+// used by profiler_enter / profiler_leave
+bool profiler_offcpu_sample(prof_cpu_sample_t* out);
+void profiler_offcpu_attribute(_index index, const prof_cpu_sample_t* begin, u64 wall_time);
+
+const prof_offcpu_stat_t* profiler_get_offcpu_stat(_index index);
+
+void profiler_offcpu_print(log_buffer_t* out, _index index);
+void profiler_offcpu_clear(void);
+
+static_assert(sizeof(prof_offcpu_stat_t) == 64, "prof_offcpu_stat_t isnt 64 bytes");
+
+EXTERN_C_END
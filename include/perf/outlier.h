@@ -0,0 +1,74 @@
+#pragma once
+
+#include <utils/log.h>
+#include <utils/macros.h>
+#include <utils/types.h>
+
+#include <perf/events.h>
+#include <perf/instr.h>
+
+EXTERN_C_START
+
+// latency budgets. a site with a budget counts every call slower than it and records the
+// call into a ring of the calling thread: when it ended, how long it took, on which cpu,
+// the selected perf event deltas (perf/events.h) and a backtrace. the ring keeps the
+// newest PROFILER_OUTLIERS records per thread. sites without a budget pay one load at END.
+
+#ifndef PROFILER_OUTLIERS
+#define PROFILER_OUTLIERS 32
+#endif
+
+#define PROFILER_OUTLIER_FRAMES 15
+
+typedef struct ALIGNAS(8) prof_outlier_t
+{
+  u64    _sequence;          // even when the record is complete, 0 if never written
+  u64    _timestamp;         // ns, get_nanoseconds() when the call ended
+  u64    _duration;          // ns
+  u64    _cycles;
+  u64    _budget;            // ns, the budget at that time
+  u64    _index;
+  u64    _tid;
+  u32    _cpu;
+  u32    _event_generation;  // 0 when no perf events were counted for the call
+  u64    _events[PROFILER_MAX_EVENTS];
+  u32    _frame_count;
+  char   padding[4];
+  void*  _frames[PROFILER_OUTLIER_FRAMES];  // innermost first, starting at the profiled function
+} prof_outlier_t;
+
+struct prof_thread_t;
+
+// 0 removes the budget
+void profiler_set_budget(_index index, u64 ns);
+u64  profiler_get_budget(_index index);
+u64  profiler_budget_violations(_index index);
+
+// used by profiler_leave_work, `begin`/`end` are the frame's event reads or NULL
+void profiler_outlier_check(struct prof_thread_t* thread, _index index, u64 cycles, u64 time,
+                            const u64* begin, const u64* end);
+
+// copies the recorded outliers of every thread, oldest first per thread. returns how many were copied
+u32  profiler_outliers(prof_outlier_t* out, u32 capacity);
+
+// every recorded outlier with its perf event deltas and symbolized backtrace
+void profiler_outliers_dump(void);
+
+void profiler_outlier_print(log_buffer_t* out, _index index);
+
+// violation counts and recorded outliers, the budgets stay
+void profiler_outlier_clear(void);
+
+// latency budget of the enclosing profiled function, goes after PROFILE_FUNCTION_START.
+// set once, profiler_set_budget() changes it later
+#define PROFILE_FUNCTION_BUDGET_NS(ns)                        \
+  static bool _budget_initialized_ = false;                   \
+  if (_budget_initialized_ == false)                          \
+  {                                                           \
+    profiler_set_budget(_function_index_, (ns));              \
+    _budget_initialized_ = true;                              \
+  }
+
+static_assert(sizeof(prof_outlier_t) == 256, "prof_outlier_t isnt 256 bytes");
+
+EXTERN_C_END
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <utils/macros.h>
+#include <utils/types.h>
+
+#include <perf/instr.h>
+
+EXTERN_C_START
+
+#ifndef PROFILER_MAX_PHASES
+#define PROFILER_MAX_PHASES 32
+#endif
+
+#define PROFILER_PHASE_NAME_LEN 64
+
+typedef struct prof_phase_t
+{
+  char              _name[PROFILER_PHASE_NAME_LEN];
+  u64               _start_time;
+  u64               _end_time;
+  bool              _closed;
+
+  // snapshot at begin, replaced in place by the phase delta on end
+  prof_snapshot_t*  _stats;
+} prof_phase_t;
+
+// closes the running phase (if any) and opens a new one
+void profiler_phase_begin(const char* name);
+void profiler_phase_end(void);
+
+// name of the running phase, NULL outside of phases
+const char* profiler_phase_current(void);
+
+u32 profiler_phase_count(void);
+const prof_phase_t* profiler_get_phase(u32 phase);
+
+void profiler_print_phases(void);
+
+// frees every recorded phase
+void profiler_phase_clear(void);
+
+EXTERN_C_END
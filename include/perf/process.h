@@ -0,0 +1,91 @@
+#pragma once
+
+#include <utils/macros.h>
+#include <utils/types.h>
+
+#include <perf/hist.h>
+#include <perf/instr.h>
+
+EXTERN_C_START
+
+// stats of a process tree that forks workers. once enabled every process writes its own
+// stats to <dir>/tier0.<run>.<pid>.prof at exit (or on profiler_process_dump), and a forked
+// child starts from zero so nothing from before the fork is counted twice. the run id is
+// picked by the process that enables dumping and inherited by its children, so dumps left
+// in `dir` by earlier runs aren't merged into this one. the files are read back per pid or
+// merged by site (file, name, line, kind).
+//
+// exit() and returning from main dump through atexit. workers that leave through _exit()
+// dump too when linked with tier_0_process_tracking() (config.lua), otherwise they have
+// to call profiler_process_dump() themselves. a child that forks while a trace runs ends
+// its copy of the trace, the parent's keeps going.
+//
+// perf counters follow fork() whether or not this is enabled: the child closes the
+// inherited ones, which still count the parent's thread, and opens its own.
+
+#define PROFILER_PROCESS_MAGIC   "tier0pr"
+#define PROFILER_PROCESS_VERSION 2
+#define PROFILER_PROCESS_PREFIX  "tier0."
+
+typedef struct prof_process_header_t
+{
+  char  _magic[8];
+  u32   _version;
+  u32   _pid;           // 0 for a merge
+  u32   _parent;
+  u32   _sites;
+  u32   _processes;     // dumps folded into this one
+  u32   _run;           // profiler_process_run() of the process tree
+  u64   _timestamp;     // nanoseconds since the process' profiler_init
+} prof_process_header_t;
+
+typedef struct prof_process_site_t
+{
+  prof_stat_head_t  _head;
+  prof_cpu_stat_t   _cpu;
+  prof_time_stat_t  _time;
+  prof_call_stat_t  _call;
+  prof_self_stat_t  _self;
+  prof_hist_stat_t  _hist;
+} prof_process_site_t;
+
+typedef struct prof_process_dump_t
+{
+  prof_process_header_t _header;
+  prof_process_site_t   _sites[TOTAL_FUNCTIONS];
+} prof_process_dump_t;
+
+// installs the fork handler, called by profiler_init
+void profiler_process_init(void);
+
+// starts per process dumps into `dir` (TIER0_PROCESS_DIR), dumps are written at exit
+bool profiler_process_enable(const char* dir);
+bool profiler_process_enabled(void);
+
+// stops dumping, nothing is written at exit
+void profiler_process_disable(void);
+
+// writes this process' stats now
+bool profiler_process_dump(void);
+
+// id of the run this process dumps into, 0 before profiler_process_enable()
+u32  profiler_process_run(void);
+
+// <dir>/tier0.<run>.<pid>.prof of this run
+void profiler_process_path(const char* dir, u32 pid, char* out, u32 size);
+
+bool profiler_process_load(const char* path, prof_process_dump_t* out);
+
+// sums the dumps of this run in `dir` (every dump when this process has no run), false
+// when there is none
+bool profiler_process_merge(const char* dir, prof_process_dump_t* out);
+
+void profiler_process_print(const prof_process_dump_t* dump);
+
+// every process of this run in `dir` (of any run when this process has none), then the
+// merged view
+void profiler_process_print_dir(const char* dir);
+
+static_assert(sizeof(prof_process_header_t) == 40, "prof_process_header_t isnt 40 bytes");
+
+EXTERN_C_END
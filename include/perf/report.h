@@ -0,0 +1,74 @@
+#pragma once
+
+#include <utils/macros.h>
+#include <utils/types.h>
+
+#include <perf/instr.h>
+
+EXTERN_C_START
+
+// sorted / filtered / rolled up views of the registry. profiler_query fills rows for
+// dashboards, profiler_print_report renders the same rows to the report buffer.
+
+enum prof_sort
+{
+  ps_total_cycles,
+  ps_self_cycles,
+  ps_time,
+  ps_calls,
+  ps_p99_cycles,
+  ps_cache_misses,
+
+  ps_count,
+};
+
+enum prof_rollup
+{
+  pr_site,      // one row per registry slot
+  pr_file,      // sites summed by file name
+  pr_module,    // sites summed by the directory of their file
+};
+
+#define PROFILER_KIND_MASK(kind) (1u << (kind))
+
+typedef struct prof_query_t
+{
+  enum prof_sort    _sort;
+  enum prof_rollup  _rollup;
+  const char*       _file;      // substring of the file name, NULL matches every file
+  const char*       _function;  // substring of the function name, NULL matches every function
+  u32               _kinds;     // PROFILER_KIND_MASK bits, 0 for functions and spans
+  u32               _limit;     // top N rows, 0 for all of them
+} prof_query_t;
+
+typedef struct prof_report_row_t
+{
+  u64     _index;           // registry slot, PROFILER_NO_INDEX for file and module rows
+  char    _name[144];       // function, file or module name
+  char    _file[144];       // file of a site row, empty for rollups
+  u16     _line;
+  u32     _sites;           // sites folded into the row
+
+  u64     _calls;
+  u64     _total_cycles;
+  u64     _self_cycles;
+  u64     _time;            // inclusive nanoseconds
+  u64     _self_time;
+  u64     _p99_cycles;      // largest site P99 for rollups
+  u64     _cache_misses;    // L1 + L2 + L3
+
+  f64     _share;           // inclusive time in % of all profiled time, nested sites overlap
+  f64     _self_share;      // self time in % of all profiled time, sums to 100 over every site
+} prof_report_row_t;
+
+// sort by total cycles over every function and span site, no limit
+void profiler_query_init(prof_query_t* query);
+
+// rows matching `query`, best first, returns how many were written (at most `capacity`)
+u32  profiler_query(const prof_query_t* query, prof_report_row_t* rows, u32 capacity);
+
+void profiler_print_report(const prof_query_t* query);
+
+const char* profiler_sort_name(enum prof_sort sort);
+
+EXTERN_C_END
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <utils/macros.h>
+#include <utils/types.h>
+
+#include <perf/instr.h>
+#include <perf/phase.h>
+
+EXTERN_C_START
+
+#define PROFILER_SERIES_DEFAULT_CAPACITY 3600
+
+typedef struct ALIGNAS(8) prof_series_point_t
+{
+  u64 _calls;
+  u64 _cycles;
+  u64 _cycles_p50;
+  u64 _cycles_p99;
+} prof_series_point_t;
+
+typedef struct prof_series_interval_t
+{
+  u64                 _start_time;
+  u64                 _end_time;
+  char                _phase[PROFILER_PHASE_NAME_LEN];
+  _index              _count;
+  prof_series_point_t _points[TOTAL_FUNCTIONS];
+} prof_series_interval_t;
+
+// starts the background collector, one interval every interval_ms from now on,
+// keeps the newest `capacity` intervals (0 = PROFILER_SERIES_DEFAULT_CAPACITY). a
+// different capacity than the last start resizes the ring, the newest intervals stay
+bool profiler_series_start(u64 interval_ms, u32 capacity);
+void profiler_series_stop(void);
+
+// closes the current interval right now (works with or without the background thread).
+// the first interval starts at profiler_init(), an interval spanning a profiler_reset()
+// starts at the reset
+void profiler_series_sample(void);
+
+u32 profiler_series_count(void);
+
+// 0 is the oldest retained interval, returns false when out of range
+bool profiler_series_get(u32 interval, prof_series_interval_t* out);
+
+// one csv row per (interval, function) with calls in that interval
+bool profiler_series_export_csv(const char* path);
+
+static_assert(sizeof(prof_series_point_t) == 32, "prof_series_point_t isnt 32 bytes!");
+
+EXTERN_C_END
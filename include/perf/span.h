@@ -0,0 +1,87 @@
+#pragma once
+
+#include <utils/macros.h>
+#include <utils/types.h>
+
+#include <perf/instr.h>
+
+EXTERN_C_START
+
+// spans measure work that starts on one thread and finishes on another (task queues,
+// callbacks, io completion). begin returns a handle by value, hand it to whichever thread
+// ends the span. completed spans are aggregated per name with the function stats and
+// the last PROFILER_SPAN_CAPACITY of them are kept for profiler_export_trace().
+
+#ifndef PROFILER_SPAN_CAPACITY
+#define PROFILER_SPAN_CAPACITY 4096  // power of two
+#endif
+
+typedef struct prof_span_t
+{
+  u64     _id;            // 0 = no span
+  u64     _parent;
+  u64     _index;
+  u64     _begin_tid;
+  u64     _begin_cycles;
+  u64     _begin_time;
+} prof_span_t;
+
+// completed span as kept for trace exports
+typedef struct prof_span_record_t
+{
+  u64     _id;
+  u64     _parent;
+  u64     _index;
+  u64     _begin_time;
+  u64     _end_time;
+  u64     _begin_tid;
+  u64     _end_tid;
+} prof_span_record_t;
+
+typedef struct ALIGNAS(8) prof_span_stat_t
+{
+  u64 _ended;
+  u64 _cross_thread;      // ended on a different thread than they began
+  u64 _children;          // begun with a parent
+
+  char padding[8];
+} prof_span_stat_t;
+
+#define PROFILER_NO_SPAN ((prof_span_t){0})
+
+// spans with the same name share one registry site no matter where they begin
+_index profiler_add_span_site(const char* file_name, const char* name, u16 line_number);
+
+prof_span_t profiler_span_begin(_index site, prof_span_t parent);
+void        profiler_span_end(prof_span_t span);
+
+const prof_span_stat_t* profiler_get_span_stat(_index index);
+
+// copies completed spans, oldest first, returns how many were written
+u32  profiler_span_records(prof_span_record_t* out, u32 capacity);
+void profiler_span_clear(void);
+
+static_assert(sizeof(prof_span_stat_t) == 32, "prof_span_stat_t   isnt 32 bytes");
+
+#define _PROFILE_SPAN_SITE(handle, name)                                           \
+  static bool   _span_##handle##_initialized_ = false;                             \
+  static _index _span_##handle##_index_ = 0;                                       \
+  if (_span_##handle##_initialized_ == false)                                      \
+  {                                                                                \
+    _span_##handle##_index_ = profiler_add_span_site(__FILE__, name, __LINE__);    \
+    _span_##handle##_initialized_ = true;                                          \
+  }
+
+// declares `prof_span_t handle`
+#define PROFILE_SPAN_BEGIN(handle, name)                                           \
+  _PROFILE_SPAN_SITE(handle, name)                                                 \
+  prof_span_t handle = profiler_span_begin(_span_##handle##_index_, PROFILER_NO_SPAN);
+
+#define PROFILE_SPAN_BEGIN_CHILD(handle, name, parent)                             \
+  _PROFILE_SPAN_SITE(handle, name)                                                 \
+  prof_span_t handle = profiler_span_begin(_span_##handle##_index_, (parent));
+
+#define PROFILE_SPAN_END(handle)                                                   \
+  profiler_span_end(handle);
+
+EXTERN_C_END
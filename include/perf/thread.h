@@ -0,0 +1,160 @@
+#pragma once
+
+#include <utils/macros.h>
+#include <utils/types.h>
+
+#include <perf/events.h>
+#include <perf/instr.h>
+#include <perf/offcpu.h>
+#include <perf/outlier.h>
+
+EXTERN_C_START
+
+#ifndef PROFILER_MAX_DEPTH
+#define PROFILER_MAX_DEPTH 128
+#endif
+
+// allocation stats slot for allocations outside of any profiled function
+#define PROFILER_UNATTRIBUTED TOTAL_FUNCTIONS
+
+typedef struct prof_frame_t
+{
+  u64    _index;
+  u64    _bytes;    // work reported with PROFILE_LOOP / PROFILE_WORK while the frame is active
+  u64    _items;
+  u64    _child_cycles; // inclusive cycles/time of profiled calls that ended inside this frame
+  u64    _child_time;
+  u32    _event_generation;               // perf event set the values below were read with, 0 for none
+  bool   _offcpu;                         // _cpu below was sampled
+  u64    _events[PROFILER_MAX_EVENTS];
+  prof_cpu_sample_t _cpu;
+} prof_frame_t;
+
+typedef struct ALIGNAS(8) prof_alloc_stat_t
+{
+  u64 _allocs;
+  u64 _frees;
+  u64 _reallocs;
+  u64 _bytes_allocated;
+  u64 _bytes_freed;
+  u64 _alloc_cycles;
+  u64 _free_cycles;
+
+  char padding[8];
+} prof_alloc_stat_t;
+
+// this thread's share of a counter or gauge (perf/metric.h), only the owning thread writes
+typedef struct ALIGNAS(8) prof_metric_shard_t
+{
+  u64 _count;
+  u64 _sum;
+  u64 _min;
+  u64 _max;
+} prof_metric_shard_t;
+
+// a site's calls on one thread, only the owning thread writes
+typedef struct ALIGNAS(8) prof_thread_site_t
+{
+  u64 _calls;
+  u64 _cycles;
+} prof_thread_site_t;
+
+// spans this thread ended (perf/span.h), only the owning thread writes
+typedef struct ALIGNAS(8) prof_span_shard_t
+{
+  u64 _ended;
+  u64 _cross_thread;
+  u64 _children;
+  u64 _cycles;
+  u64 _cycles_min;
+  u64 _cycles_max;
+  u64 _time;
+  u64 _time_min;
+  u64 _time_max;
+} prof_span_shard_t;
+
+// how evenly a site's cycles were spread over the threads that called it
+typedef struct prof_imbalance_t
+{
+  u32 _threads;           // threads with at least one call
+  u64 _total_cycles;
+  u64 _max_cycles;
+  u64 _slowest_tid;
+  f64 _mean_cycles;
+  f64 _max_over_mean;     // 1.0 is perfectly balanced
+  f64 _cv;                // coefficient of variation, stddev / mean
+  f64 _slowest_share;     // slowest thread's cycles over all of them
+} prof_imbalance_t;
+
+#define PROFILER_THREAD_NAME 32
+
+// per thread profiler state, mapped straight from the OS. when a thread exits its call stack
+// is unmapped, so is the outlier ring unless it holds records, and its perf event fds are
+// closed. the site, span, allocation and metric stats stay readable for the reports. the main
+// thread keeps everything
+#define PROFILER_THREAD_PAGE 4096
+
+typedef struct prof_thread_t
+{
+  u64                     _tid;
+  u32                     _slot;
+  u32                     _depth;
+  bool                    _in_allocator;
+  bool                    _outlier_released;  // the thread exited with an empty ring, set under profiler_thread_lock()
+  _index                  _drop_index;        // site whose ending call profiler_region_cpu dropped
+
+  u32                     _event_generation;  // selected event set the fds belong to, 0 when none are open
+  s32                     _event_fd[PROFILER_MAX_EVENTS];
+
+  struct prof_thread_t*   _next;
+  char                    _name[PROFILER_THREAD_NAME];  // "" unless named
+
+  struct prof_trace_buffer_t* _trace;         // events not handed to the trace writer yet (perf/trace.h)
+  u32                     _trace_busy;        // set while the thread records into _trace
+  u64                     _outlier_count;     // recorded so far, the ring slot is count % PROFILER_OUTLIERS
+
+  prof_alloc_stat_t       _alloc[TOTAL_FUNCTIONS + 1];
+  prof_metric_shard_t     _metric[TOTAL_FUNCTIONS];
+  prof_thread_site_t      _site[TOTAL_FUNCTIONS];
+  prof_span_shard_t       _span[TOTAL_FUNCTIONS];
+
+  // released on thread exit
+  ALIGNAS(PROFILER_THREAD_PAGE) prof_outlier_t _outlier[PROFILER_OUTLIERS];
+  ALIGNAS(PROFILER_THREAD_PAGE) prof_frame_t   _stack[PROFILER_MAX_DEPTH];
+} prof_thread_t;
+
+// state of the calling thread, created on first use (NULL if the OS refuses memory)
+prof_thread_t* profiler_thread(void);
+
+// every thread that ever touched the profiler, newest first
+prof_thread_t* profiler_thread_first(void);
+u32            profiler_thread_count(void);
+
+// held while another thread's _outlier is read, exiting threads wait for it
+void           profiler_thread_lock(void);
+void           profiler_thread_unlock(void);
+
+// innermost active function on the calling thread or PROFILER_NO_INDEX
+_index profiler_active_index(void);
+
+// names the calling thread in the per thread reports
+void   profiler_thread_set_name(const char* name);
+
+// false when no thread called `index`
+bool   profiler_thread_imbalance(_index index, prof_imbalance_t* out);
+
+// every site broken down by thread, with the imbalance of sites that ran on several
+void   profiler_print_threads(void);
+
+// zeroes the per thread site, span and allocation stats of every thread
+void   profiler_thread_clear(void);
+
+// allocation stats of `index` (or PROFILER_UNATTRIBUTED) summed over all threads
+void   profiler_alloc_stat(_index index, prof_alloc_stat_t* out);
+
+static_assert(sizeof(prof_alloc_stat_t) == 64, "prof_alloc_stat_t  isnt 64 bytes");
+static_assert(sizeof(prof_metric_shard_t) == 32, "prof_metric_shard_t isnt 32 bytes");
+static_assert(sizeof(prof_thread_site_t) == 16, "prof_thread_site_t isnt 16 bytes");
+static_assert(sizeof(prof_span_shard_t) == 72, "prof_span_shard_t isnt 72 bytes");
+
+EXTERN_C_END
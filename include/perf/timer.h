@@ -6,4 +6,8 @@
 #include <utils/macros.h>
 #include <utils/types.h>
 
+EXTERN_C_START
+
 uint64_t get_nanoseconds(void);
+
+EXTERN_C_END
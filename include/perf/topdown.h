@@ -0,0 +1,61 @@
+#pragma once
+
+#include <utils/log.h>
+#include <utils/macros.h>
+#include <utils/types.h>
+
+#include <perf/events.h>
+#include <perf/instr.h>
+
+EXTERN_C_START
+
+// level 1 top-down breakdown per site: frontend bound, bad speculation, backend bound and
+// retiring as fractions of the pipeline slots the site used. the events come from the core
+// pmu in sysfs, either the perf metrics of newer cores (slots + topdown-*) or the classic
+// slot counters (topdown-total-slots, -slots-issued, -slots-retired, -fetch-bubbles,
+// -recovery-bubbles). they are put in front of the perf event set (perf/events.h), enable
+// with TIER0_TOPDOWN=1 or profiler_topdown_enable(). without them (most VMs) the report
+// says unavailable.
+
+#define PROFILER_TOPDOWN_EVENTS 5
+
+enum prof_topdown_method
+{
+  pt_unavailable,
+  pt_metrics,     // slots + topdown-retiring/-bad-spec/-fe-bound/-be-bound
+  pt_classic,     // total/issued/retired slots, fetch and recovery bubbles
+};
+
+// resolved sysfs events, in the order listed for each method above
+typedef struct prof_topdown_events_t
+{
+  u32               _method;    // enum prof_topdown_method
+  prof_event_spec_t _events[PROFILER_TOPDOWN_EVENTS];
+  f64               _scale[PROFILER_TOPDOWN_EVENTS];
+} prof_topdown_events_t;
+
+typedef struct prof_topdown_t
+{
+  f64 _frontend_bound;
+  f64 _bad_speculation;
+  f64 _backend_bound;
+  f64 _retiring;
+  f64 _slots;
+} prof_topdown_t;
+
+// reads the topdown events of the pmu at `pmu_dir` (e.g. /sys/bus/event_source/devices/cpu)
+enum prof_topdown_method profiler_topdown_resolve(const char* pmu_dir, prof_topdown_events_t* out);
+
+// resolves the core pmu and puts its topdown events in front of the selected perf events
+enum prof_topdown_method profiler_topdown_enable(void);
+enum prof_topdown_method profiler_topdown_method(void);
+
+// fractions from scaled counts ordered like prof_topdown_events_t, false without slots
+bool profiler_topdown_compute(enum prof_topdown_method method, const f64* counts, prof_topdown_t* out);
+
+// breakdown of site `index`, false when unavailable or the site used no slots
+bool profiler_topdown_site(_index index, prof_topdown_t* out);
+
+void profiler_topdown_print(log_buffer_t* out, _index index);
+
+EXTERN_C_END
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <utils/macros.h>
+#include <utils/types.h>
+
+#include <perf/instr.h>
+
+EXTERN_C_START
+
+// streaming traces: every START and END of every thread, written to disk while the
+// program runs. a site begin costs a cycle counter read and two varints (tick delta,
+// site index), an end only the delta, typically 2-4 bytes per event. each thread fills
+// its own PROFILER_TRACE_CHUNK buffer without locks, full buffers go to a background
+// thread that writes them out whole. when the writer falls PROFILER_TRACE_BUFFERS
+// behind, events are dropped and counted instead of blocking the traced threads.
+//
+// file layout, little endian:
+//   prof_trace_header_t
+//   records: prof_trace_record_t followed by _size bytes
+//     tt_chunk    prof_trace_chunk_t, then its events. per event varint((delta << 1) | end),
+//                 begins add varint(site index). delta is in ticks since the previous event
+//                 of the chunk, the first event is at _base
+//     tt_strings  per site varint(index), varint(length), the name and a '\0'
+//     tt_threads  per named thread u64 tid, varint(length), the name and a '\0'
+//     tt_end      prof_trace_end_t
+// a trace cut short (crash, kill) still reads up to its last complete chunk.
+//
+// profiler_trace_open() maps a trace for reading, profiler_trace_to_chrome() converts one
+// to the chrome trace event format (chrome://tracing, perfetto).
+
+#ifndef PROFILER_TRACE_CHUNK
+#define PROFILER_TRACE_CHUNK (64 * 1024)
+#endif
+
+// buffers in use at once (per thread ones plus those waiting for the writer)
+#ifndef PROFILER_TRACE_BUFFERS
+#define PROFILER_TRACE_BUFFERS 256
+#endif
+
+#define PROFILER_TRACE_MAGIC   "T0TRACE"
+#define PROFILER_TRACE_VERSION 1
+
+typedef struct prof_trace_header_t
+{
+  char _magic[8];       // PROFILER_TRACE_MAGIC
+  u32  _version;
+  u32  _pid;
+  u64  _start_ticks;    // get_cycle_count() when tracing started
+  u64  _start_ns;       // get_nanoseconds() at the same time
+  f64  _ticks_per_ns;   // measured over the whole trace, a short calibration until it stopped
+  u32  _chunk_size;
+  u32  _clock;          // enum prof_clock the ticks were read with (get_cycle_count())
+} prof_trace_header_t;
+
+enum prof_trace_tag
+{
+  tt_chunk   = 1,
+  tt_strings = 2,
+  tt_threads = 3,
+  tt_end     = 4,
+};
+
+typedef struct prof_trace_record_t
+{
+  u32 _tag;             // enum prof_trace_tag
+  u32 _size;            // bytes that follow
+} prof_trace_record_t;
+
+typedef struct prof_trace_chunk_t
+{
+  u64 _tid;
+  u64 _base;            // ticks of the first event
+  u32 _events;
+  u32 _bytes;           // encoded events that follow
+} prof_trace_chunk_t;
+
+typedef struct prof_trace_end_t
+{
+  u64 _end_ticks;
+  u64 _end_ns;
+  u64 _events;          // written
+  u64 _dropped;         // lost while the writer was behind
+} prof_trace_end_t;
+
+struct prof_thread_t;
+
+// false when a trace is running already or `path` can't be created
+bool profiler_trace_start(const char* path);
+
+// waits for events being recorded, flushes every thread's buffer and completes the file.
+// threads still inside a traced call keep their open begins
+bool profiler_trace_stop(void);
+
+// used by profiler_enter / profiler_leave: non zero while tracing
+u32  profiler_trace_active(void);
+void profiler_trace_enter(struct prof_thread_t* thread, _index index);
+void profiler_trace_leave(struct prof_thread_t* thread, u32 frames);
+
+// hands an exiting thread's buffer to the writer (or back to the pool)
+void profiler_trace_release(struct prof_thread_t* thread);
+
+// ends the inherited trace in the child of a fork, nothing of it reaches the parent's file
+void profiler_trace_forked(void);
+
+// events written and dropped by the current or last trace
+u64  profiler_trace_events(void);
+u64  profiler_trace_dropped(void);
+
+// reading
+
+typedef struct prof_trace_event_t
+{
+  u64  _time;           // ns since the trace started
+  u64  _tid;
+  u64  _index;          // site of a begin, PROFILER_TRACE_NO_SITE for an end
+  bool _end;
+} prof_trace_event_t;
+
+#define PROFILER_TRACE_NO_SITE ((u64)-1)
+
+typedef struct prof_trace_file_t
+{
+  const u8*            _data;       // the whole file, mapped
+  u64                  _size;
+  prof_trace_header_t  _header;
+  prof_trace_end_t     _end;        // zero when the trace was cut short
+  bool                 _complete;
+  u64                  _site_count;
+  const char**         _names;      // by site index, NULL when unnamed
+  const u8*            _threads;    // tt_threads payload
+  u32                  _threads_size;
+} prof_trace_file_t;
+
+typedef struct prof_trace_cursor_t
+{
+  const prof_trace_file_t* _file;
+  u64                      _offset;   // next record
+  const u8*                _at;       // next event of the current chunk
+  const u8*                _stop;
+  u64                      _tid;
+  u64                      _ticks;
+} prof_trace_cursor_t;
+
+// false when the file can't be mapped or isn't a trace
+bool        profiler_trace_open(const char* path, prof_trace_file_t* out);
+void        profiler_trace_close(prof_trace_file_t* file);
+
+// events come chunk by chunk: in order per thread, threads interleaved in chunk sized runs
+void        profiler_trace_cursor(const prof_trace_file_t* file, prof_trace_cursor_t* out);
+bool        profiler_trace_next(prof_trace_cursor_t* cursor, prof_trace_event_t* out);
+
+// "?" for sites without a name
+const char* profiler_trace_site_name(const prof_trace_file_t* file, u64 index);
+
+// "" for threads without a name
+const char* profiler_trace_thread_name(const prof_trace_file_t* file, u64 tid);
+
+// B/E events per thread plus thread names. ends without a begin (calls that were
+// running when the trace started) are left out
+bool        profiler_trace_to_chrome(const char* trace_path, const char* json_path);
+
+static_assert(sizeof(prof_trace_header_t) == 48, "prof_trace_header_t isnt 48 bytes");
+static_assert(sizeof(prof_trace_record_t) == 8, "prof_trace_record_t isnt 8 bytes");
+static_assert(sizeof(prof_trace_chunk_t) == 24, "prof_trace_chunk_t isnt 24 bytes");
+static_assert(sizeof(prof_trace_end_t) == 32, "prof_trace_end_t isnt 32 bytes");
+
+EXTERN_C_END
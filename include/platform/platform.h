@@ -3,6 +3,8 @@
 #include <utils/macros.h>
 #include <utils/types.h>
 
+EXTERN_C_START
+
 typedef uint32_t  _cpu_cores;
 typedef uint32_t  _cpu_threads;
 
@@ -28,6 +30,92 @@ _mem_size      impl_hw_get_total_memory(void);
 _mem_size      impl_hw_get_free_memory(void);
 _mem_size      impl_hw_get_used_memory(void);
 
+// zeroed, page granular memory straight from the OS (never goes through malloc)
+void*          impl_mem_map(_mem_size size);
+void           impl_mem_unmap(void* ptr, _mem_size size);
+
+// OS id of the calling thread
+uint64_t       impl_thread_id(void);
+
+// cpu time and context switches of the calling thread so far
+typedef struct platform_cpu_sample_t
+{
+  u64    cpu_ns;
+  u64    voluntary_switches;     // blocked or yielded
+  u64    involuntary_switches;   // preempted
+} platform_cpu_sample_t;
+
+bool           impl_thread_cpu_sample(platform_cpu_sample_t* out);
+
+u32            impl_process_id(void);
+u32            impl_process_parent_id(void);
+
+// a full memory barrier on every running thread of the process (membarrier on linux), lets a
+// rare caller pair with plain compiler barriers on hot paths. false where that isn't available
+bool           impl_process_barrier(void);
+
+// `child` runs in the child process right after fork(), false where processes don't fork
+bool           impl_process_on_fork(void (*child)(void));
+
+// calls `visit` with the path of every regular file in `dir` whose name starts with `prefix`,
+// returns how many were visited
+u32            impl_dir_list(const char* dir, const char* prefix, void (*visit)(const char* path, void* user), void* user);
+
+// read only view of a whole file, NULL if it can't be mapped or is empty
+const void*    impl_file_map(const char* path, u64* size);
+void           impl_file_unmap(const void* data, u64 size);
+
+// return addresses of the calling thread's stack, innermost first, after skipping `skip` frames
+u32            impl_backtrace(void** frames, u32 capacity, u32 skip);
+
+// "module(symbol+offset)" of a return address, exported symbols only. no libdl needed
+bool           impl_backtrace_symbol(const void* address, char* out, size_t size);
+
+// name of the function that contains `address` and the path of the object it was loaded from.
+// dladdr first, then the object's ELF .symtab for symbols that aren't exported, C++ names are
+// demangled when the C++ runtime is linked in. without a .symtab, an address past the nearest
+// exported symbol comes back as "symbol+0xoffset". false if the address can't be named
+bool           impl_symbol_name(const void* address, char* name, size_t name_size, char* module, size_t module_size);
+
+// benchmark environment, read from sysfs/procfs on linux
+#define PLATFORM_CPU_NONE 0xFFFFFFFFu
+
+typedef struct platform_bench_env_t
+{
+  char   governor[32];     // scaling governor of the checked cpu, "" if unknown
+  s8     turbo;            // 1 on, 0 off, -1 unknown
+  s8     thp;              // transparent huge pages: 2 always, 1 madvise, 0 never, -1 unknown
+  u32    cpu;              // cpu the checks refer to
+  u32    online_cpus;
+  u32    smt_siblings;     // other hardware threads on the same core
+  f64    smt_sibling_busy; // 0..1, busy fraction of those siblings over a short window
+  f64    load_1m;          // /proc/loadavg
+  bool   isolated;         // cpu is listed in /sys/devices/system/cpu/isolated
+} platform_bench_env_t;
+
+// saved scheduling state of the calling thread
+typedef struct platform_thread_state_t
+{
+  u8     affinity[128];
+  s32    policy;
+  s32    priority;
+  s32    nice;
+  bool   saved;
+} platform_thread_state_t;
+
+bool           impl_bench_env_read(u32 cpu, platform_bench_env_t* out);
+
+// an isolated cpu if there is one, otherwise the last cpu the thread may run on
+u32            impl_bench_pick_cpu(void);
+u32            impl_thread_current_cpu(void);
+
+bool           impl_thread_save(platform_thread_state_t* out);
+void           impl_thread_restore(const platform_thread_state_t* state);
+bool           impl_thread_pin(u32 cpu);
+
+// lowest SCHED_FIFO priority when permitted, otherwise the lowest nice value allowed
+bool           impl_thread_raise_priority(void);
+
 // shared helpers:
 // calculate and update percentage inside the struct
 _percentage    shared_calc_mem_usage_s(Hardware_Specifications *hw_specs);
@@ -37,3 +125,5 @@ _percentage    shared_calc_mem_usage_v(_mem_size total,_mem_size free);
 
 // getter to the static struct
 Hardware_Specifications *shared_get_hw_specs(void);
+
+EXTERN_C_END
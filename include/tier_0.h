@@ -1,12 +1,34 @@
 #pragma once
 
 
+#include <perf/ab.h>
 #include <perf/arch.h>
+#include <perf/auto.h>
+#include <perf/bench_env.h>
+#include <perf/clock.h>
+#include <perf/events.h>
+#include <perf/export.h>
+#include <perf/frame.h>
+#include <perf/hist.h>
 #include <perf/instr.h>
+#include <perf/lock.h>
+#include <perf/metric.h>
+#include <perf/migration.h>
+#include <perf/offcpu.h>
+#include <perf/outlier.h>
+#include <perf/phase.h>
+#include <perf/process.h>
+#include <perf/report.h>
+#include <perf/series.h>
+#include <perf/span.h>
+#include <perf/thread.h>
 #include <perf/timer.h>
+#include <perf/topdown.h>
+#include <perf/trace.h>
 
 #include <platform/platform.h>
 
 #include <utils/log.h>
+#include <utils/log_async.h>
 #include <utils/macros.h>
 #include <utils/types.h>
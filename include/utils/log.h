@@ -7,9 +7,51 @@
 
 EXTERN_C_START
 
+#define LOG_LINE_CAPACITY    1024
+#define LOG_REPORT_CAPACITY  (64 * 1024)
+
+// raw argument encoding used by log_buffer_print_raw: every argument takes one 8 byte slot
+// (integers widened to 64 bit, floats as f64 bits), {str} is a length slot followed by
+// the bytes padded up to the next slot
+#define LOG_RAW_SLOT  8
+
+#define LOG_FD_STDOUT 1
+#define LOG_FD_NONE   -1
+
+// output buffer for the formatter, flushed with a single write() when full,
+// a buffer without a file descriptor (LOG_FD_NONE) truncates instead
+typedef struct log_buffer_t
+{
+  char*   _data;
+  size_t  _size;
+  size_t  _capacity;
+  int     _fd;
+  bool    _truncated;
+} log_buffer_t;
+
+// formatted into a thread local line, then handed to stdio (buffered like printf). reports
+// that print many lines render into log_report_buffer() and write once instead
 void log_print(const char* fmt, ...);
 void log_println(const char* fmt, ...);
 
+// formats into buf (always NUL terminated), returns the formatted length without the NUL
+size_t log_format(char* buf, size_t capacity, const char* fmt, ...);
+size_t log_vformat(char* buf, size_t capacity, const char* fmt, va_list args);
+
+void log_buffer_init(log_buffer_t* buffer, char* storage, size_t capacity, int fd);
+void log_buffer_print(log_buffer_t* buffer, const char* fmt, ...);
+void log_buffer_println(log_buffer_t* buffer, const char* fmt, ...);
+void log_buffer_vprint(log_buffer_t* buffer, const char* fmt, va_list args);
+void log_buffer_print_raw(log_buffer_t* buffer, const char* fmt, const void* args, size_t size);
+void log_buffer_write(log_buffer_t* buffer, const char* data, size_t size);
+void log_buffer_flush(log_buffer_t* buffer);
+
+// thread local LOG_REPORT_CAPACITY buffer bound to stdout, used to emit whole reports at once
+log_buffer_t* log_report_buffer(void);
+
+// write() to fd, stdout is fflush()ed first so printf based logging stays ordered
+void log_write_fd(int fd, const char* data, size_t size);
+
 // skips the formating
 #define log_u8(val)    printf("%u", (u8)(val))
 #define log_u16(val)   printf("%u", (u16)(val))
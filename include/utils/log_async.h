@@ -0,0 +1,58 @@
+#pragma once
+
+#include <utils/macros.h>
+#include <utils/types.h>
+#include <utils/log.h>
+
+EXTERN_C_START
+
+#define LOG_ASYNC_MAX_ARGS      16
+#define LOG_ASYNC_MAX_STR       256
+#define LOG_ASYNC_RING_DEFAULT  (256 * 1024)
+
+enum log_arg_kind
+{
+  lak_int,    // {u8} {u16} {u32} {s8} {s16} {s32} {}
+  lak_int64,  // {u64} {s64}
+  lak_f64,    // {f32} {f64}
+  lak_str,    // {str}, copied (truncated to LOG_ASYNC_MAX_STR)
+};
+
+// one per call site, parsed from the format string on the first call
+typedef struct log_async_site_t
+{
+  const char* _fmt;
+  u8          _parsed;    // 0 until the first call, 1 while it parses, 2 once _args are set
+  u8          _arg_count;
+  u8          _args[LOG_ASYNC_MAX_ARGS];
+  u32         _max_size;
+} log_async_site_t;
+
+// starts the formatting thread, every logging thread gets its own ring of ring_bytes (power of two).
+// the ring of an exited thread goes to the next thread that logs once it is drained, the
+// unclaimed ones are freed by log_async_shutdown()
+bool log_async_init(size_t ring_bytes);
+
+// drains every ring and stops the formatting thread, LOG_ASYNC falls back to synchronous output afterwards
+void log_async_shutdown(void);
+
+// blocks until everything logged so far has been written
+void log_async_flush(void);
+
+// records lost because a ring was full
+u64  log_async_dropped(void);
+
+// rings allocated, in use or waiting for the next thread
+u32  log_async_rings(void);
+
+void log_async_write(log_async_site_t* site, ...);
+
+// the call site only copies the format pointer and the raw argument bytes, the
+// format string must be a literal (or otherwise outlive the formatting thread)
+#define LOG_ASYNC(fmt, ...)                                                   \
+  do {                                                                        \
+    static log_async_site_t _log_async_site_ = { fmt, 0, 0, {0}, 0 };         \
+    log_async_write(&_log_async_site_, ##__VA_ARGS__);                        \
+  } while (0)
+
+EXTERN_C_END
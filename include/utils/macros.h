@@ -76,6 +76,15 @@
   #define UNREACHABLE()
 #endif
 
+// Thread local storage
+#if defined(__cplusplus)
+  #define THREAD_LOCAL thread_local
+#elif defined(_MSC_VER)
+  #define THREAD_LOCAL __declspec(thread)
+#else
+  #define THREAD_LOCAL _Thread_local
+#endif
+
 #if defined(__GNUC__) || defined(__clang__)
     #define FUNCTION_NAME __PRETTY_FUNCTION__  // Full signature on GCC/Clang
 #elif defined(_MSC_VER)
@@ -0,0 +1,187 @@
+// allocation tracking, attributes malloc/calloc/realloc/free to the innermost
+// PROFILE_FUNCTION_START site of the calling thread.
+//
+// opt in, two ways:
+//  - link time wrapping: link with -Wl,--wrap=malloc,--wrap=free,--wrap=calloc,--wrap=realloc
+//    (tier_0_alloc_tracking() in config.lua), covers calls made from the wrapped objects
+//  - interposition: build tier_0 with PROFILER_ALLOC_INTERPOSE (premake5 --alloc-interpose),
+//    the executable then exports malloc & co. itself and catches every call in the
+//    process, shared libraries included (glibc only, forwards to __libc_malloc & co.)
+//
+// bookkeeping lives in the per thread state mapped by perf/thread.c, nothing here allocates.
+// byte counts use malloc_usable_size() on both sides so live bytes = allocated - freed.
+
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif
+
+#include <perf/arch.h>
+#include <perf/thread.h>
+
+#if defined(__linux__)
+
+#include <malloc.h>
+#include <stddef.h>
+
+#if defined(PROFILER_ALLOC_INTERPOSE)
+  extern void* __libc_malloc(size_t size);
+  extern void* __libc_calloc(size_t count, size_t size);
+  extern void* __libc_realloc(void* ptr, size_t size);
+  extern void  __libc_free(void* ptr);
+
+  #define REAL_MALLOC   __libc_malloc
+  #define REAL_CALLOC   __libc_calloc
+  #define REAL_REALLOC  __libc_realloc
+  #define REAL_FREE     __libc_free
+
+  #define ALLOC_HOOK(name) name
+#else
+  void* __real_malloc(size_t size);
+  void* __real_calloc(size_t count, size_t size);
+  void* __real_realloc(void* ptr, size_t size);
+  void  __real_free(void* ptr);
+
+  #define REAL_MALLOC   __real_malloc
+  #define REAL_CALLOC   __real_calloc
+  #define REAL_REALLOC  __real_realloc
+  #define REAL_FREE     __real_free
+
+  #define ALLOC_HOOK(name) __wrap_##name
+#endif
+
+void* ALLOC_HOOK(malloc)(size_t size);
+void* ALLOC_HOOK(calloc)(size_t count, size_t size);
+void* ALLOC_HOOK(realloc)(void* ptr, size_t size);
+void  ALLOC_HOOK(free)(void* ptr);
+
+// NULL while the thread is already inside the tracker (or has no profiler state)
+static FORCE_INLINE prof_thread_t* _alloc_enter(void)
+{
+  prof_thread_t* thread = profiler_thread();
+  if (UNLIKELY(!thread || thread->_in_allocator))
+  {
+    return NULL;
+  }
+  thread->_in_allocator = true;
+  return thread;
+}
+
+static FORCE_INLINE prof_alloc_stat_t* _alloc_slot(prof_thread_t* thread)
+{
+  if (thread->_depth == 0)
+  {
+    return &thread->_alloc[PROFILER_UNATTRIBUTED];
+  }
+
+  u32    top   = thread->_depth < PROFILER_MAX_DEPTH ? thread->_depth - 1 : PROFILER_MAX_DEPTH - 1;
+  _index index = thread->_stack[top]._index;
+  return &thread->_alloc[index < TOTAL_FUNCTIONS ? index : PROFILER_UNATTRIBUTED];
+}
+
+void* ALLOC_HOOK(malloc)(size_t size)
+{
+  prof_thread_t* thread = _alloc_enter();
+  if (!thread)
+  {
+    return REAL_MALLOC(size);
+  }
+
+  u64   start  = get_cycle_count();
+  void* result = REAL_MALLOC(size);
+  u64   cycles = get_cycle_count() - start;
+
+  prof_alloc_stat_t* stat = _alloc_slot(thread);
+  stat->_allocs++;
+  stat->_bytes_allocated += result ? malloc_usable_size(result) : 0;
+  stat->_alloc_cycles    += cycles;
+
+  thread->_in_allocator = false;
+  return result;
+}
+
+void* ALLOC_HOOK(calloc)(size_t count, size_t size)
+{
+  prof_thread_t* thread = _alloc_enter();
+  if (!thread)
+  {
+    return REAL_CALLOC(count, size);
+  }
+
+  u64   start  = get_cycle_count();
+  void* result = REAL_CALLOC(count, size);
+  u64   cycles = get_cycle_count() - start;
+
+  prof_alloc_stat_t* stat = _alloc_slot(thread);
+  stat->_allocs++;
+  stat->_bytes_allocated += result ? malloc_usable_size(result) : 0;
+  stat->_alloc_cycles    += cycles;
+
+  thread->_in_allocator = false;
+  return result;
+}
+
+void* ALLOC_HOOK(realloc)(void* ptr, size_t size)
+{
+  prof_thread_t* thread = _alloc_enter();
+  if (!thread)
+  {
+    return REAL_REALLOC(ptr, size);
+  }
+
+  size_t old_size = ptr ? malloc_usable_size(ptr) : 0;
+
+  u64   start  = get_cycle_count();
+  void* result = REAL_REALLOC(ptr, size);
+  u64   cycles = get_cycle_count() - start;
+
+  // counted as a free of the old block plus an allocation of the new one
+  prof_alloc_stat_t* stat = _alloc_slot(thread);
+  stat->_reallocs++;
+  if (result || size == 0)
+  {
+    if (ptr)
+    {
+      stat->_frees++;
+      stat->_bytes_freed += old_size;
+    }
+    if (result)
+    {
+      stat->_allocs++;
+      stat->_bytes_allocated += malloc_usable_size(result);
+    }
+  }
+  stat->_alloc_cycles += cycles;
+
+  thread->_in_allocator = false;
+  return result;
+}
+
+void ALLOC_HOOK(free)(void* ptr)
+{
+  if (!ptr)
+  {
+    return;
+  }
+
+  prof_thread_t* thread = _alloc_enter();
+  if (!thread)
+  {
+    REAL_FREE(ptr);
+    return;
+  }
+
+  size_t size = malloc_usable_size(ptr);
+
+  u64 start = get_cycle_count();
+  REAL_FREE(ptr);
+  u64 cycles = get_cycle_count() - start;
+
+  prof_alloc_stat_t* stat = _alloc_slot(thread);
+  stat->_frees++;
+  stat->_bytes_freed += size;
+  stat->_free_cycles += cycles;
+
+  thread->_in_allocator = false;
+}
+
+#endif // __linux__
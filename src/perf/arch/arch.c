@@ -1,6 +1,8 @@
 #include <perf/arch.h>
 #include <utils/types.h>
 
+#if defined(ARCH_X86) || defined(ARCH_X86_64)
+
 uint64_t x86_get_rdtsc_counter(void) {
     uint32_t lo, hi;
     __asm__ __volatile__ (
@@ -33,31 +35,69 @@ uint64_t x86_get_rdtsc_counter_serialized(void) {
     return ((uint64_t)hi << 32) | lo;
 }
 
-#define x86_64_get_rdtsc_counter            x86_get_rdtsc_counter
-#define x86_64_get_rdtscp_counter           x86_get_rdtscp_counter
-#define x86_64_get_rdtsc_counter_serialized x86_get_rdtsc_counter_serialized
+uint64_t x86_get_lfence_rdtsc_counter(void) {
+    uint32_t lo, hi;
+    __asm__ __volatile__ (
+        "lfence\n\t"      /* earlier instructions finish before the read */
+        "rdtsc\n"
+        : "=a"(lo), "=d"(hi)
+        : /* no inputs */
+        : "memory"
+    );
+    return ((uint64_t)hi << 32) | lo;
+}
 
-uint64_t get_cycle_count(void) {
-#if defined(ARCH_X86) || defined(ARCH_X86_64)
-    return x86_get_rdtsc_counter();
-#else
-# error "Unsupported architecture"
-#endif
+uint64_t x86_get_rdtscp_lfence_counter(void) {
+    uint32_t lo, hi;
+    __asm__ __volatile__ (
+        "rdtscp\n\t"
+        "lfence\n"        /* later instructions start after the read */
+        : "=a"(lo), "=d"(hi)
+        : /* no inputs */
+        : "rcx", "memory"
+    );
+    return ((uint64_t)hi << 32) | lo;
 }
 
-uint64_t get_cycle_count_enhanced(void) {
-#if defined(ARCH_X86) || defined(ARCH_X86_64)
-    return x86_get_rdtscp_counter();
-#else
-# error "Unsupported architecture"
-#endif
+uint64_t x86_get_rdtscp_counter_aux(uint32_t* aux) {
+    uint32_t lo, hi, c;
+    __asm__ __volatile__ (
+        "rdtscp\n"
+        : "=a"(lo), "=d"(hi), "=c"(c)
+    );
+    *aux = c;
+    return ((uint64_t)hi << 32) | lo;
 }
 
-uint64_t get_cycle_count_serialized(void) {
-#if defined(ARCH_X86) || defined(ARCH_X86_64)
-    return x86_get_rdtsc_counter_serialized();
-#else
-# error "Unsupported architecture"
-#endif
+uint64_t x86_get_rdtscp_lfence_counter_aux(uint32_t* aux) {
+    uint32_t lo, hi, c;
+    __asm__ __volatile__ (
+        "rdtscp\n\t"
+        "lfence\n"
+        : "=a"(lo), "=d"(hi), "=c"(c)
+        : /* no inputs */
+        : "memory"
+    );
+    *aux = c;
+    return ((uint64_t)hi << 32) | lo;
 }
 
+bool x86_has_rdtscp(void) {
+    uint32_t eax, ebx, ecx, edx;
+    __asm__ __volatile__ (
+        "cpuid\n"
+        : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx)
+        : "a"(0x80000000u)
+    );
+    if (eax < 0x80000001u) {
+        return false;
+    }
+    __asm__ __volatile__ (
+        "cpuid\n"
+        : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx)
+        : "a"(0x80000001u)
+    );
+    return (edx >> 27) & 1;
+}
+
+#endif
@@ -0,0 +1,218 @@
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <perf/arch.h>
+#include <perf/clock.h>
+
+#include <string.h>
+#include <time.h>
+
+static u64 _clock_gettime_ns(clockid_t id)
+{
+  struct timespec ts;
+  clock_gettime(id, &ts);
+  return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+}
+
+static u64 _clock_monotonic(void)
+{
+  return _clock_gettime_ns(CLOCK_MONOTONIC);
+}
+
+static u64 _clock_monotonic_coarse(void)
+{
+#if defined(CLOCK_MONOTONIC_COARSE)
+  return _clock_gettime_ns(CLOCK_MONOTONIC_COARSE);
+#else
+  return _clock_gettime_ns(CLOCK_MONOTONIC);
+#endif
+}
+
+static const char* g_prof_clock_names[pc_clock_count] =
+{
+  "rdtsc",
+  "rdtscp",
+  "lfence_rdtsc",
+  "rdtscp_lfence",
+  "cpuid_rdtsc",
+  "monotonic",
+  "monotonic_coarse",
+};
+
+static const prof_clock_fn g_prof_clock_readers[pc_clock_count] =
+{
+#if defined(ARCH_X86) || defined(ARCH_X86_64)
+  x86_get_rdtsc_counter,
+  x86_get_rdtscp_counter,
+  x86_get_lfence_rdtsc_counter,
+  x86_get_rdtscp_lfence_counter,
+  x86_get_rdtsc_counter_serialized,
+#else
+  NULL, NULL, NULL, NULL, NULL,
+#endif
+  _clock_monotonic,
+  _clock_monotonic_coarse,
+};
+
+static prof_clock_fn   g_prof_clock_selected = NULL;
+static enum prof_clock g_prof_clock_current  = PROFILER_CLOCK;
+
+const char* profiler_clock_name(enum prof_clock clock)
+{
+  return clock < pc_clock_count ? g_prof_clock_names[clock] : "unknown";
+}
+
+bool profiler_clock_available(enum prof_clock clock)
+{
+  switch (clock)
+  {
+#if defined(ARCH_X86) || defined(ARCH_X86_64)
+    case pc_rdtsc:
+    case pc_lfence_rdtsc:
+    case pc_cpuid_rdtsc:
+      return true;
+
+    case pc_rdtscp:
+    case pc_rdtscp_lfence:
+      return x86_has_rdtscp();
+#endif
+
+    case pc_monotonic:
+      return true;
+
+    case pc_monotonic_coarse:
+#if defined(CLOCK_MONOTONIC_COARSE)
+      return true;
+#else
+      return false;
+#endif
+
+    default:
+      return false;
+  }
+}
+
+prof_clock_fn profiler_clock_reader(enum prof_clock clock)
+{
+  return profiler_clock_available(clock) ? g_prof_clock_readers[clock] : NULL;
+}
+
+u64 profiler_clock_read(enum prof_clock clock)
+{
+  prof_clock_fn reader = profiler_clock_reader(clock);
+  return reader ? reader() : 0;
+}
+
+bool profiler_clock_select(enum prof_clock clock)
+{
+#if defined(PROFILER_CLOCK_FIXED)
+  return clock == PROFILER_CLOCK;
+#else
+  prof_clock_fn reader = profiler_clock_reader(clock);
+  if (!reader)
+  {
+    return false;
+  }
+  g_prof_clock_current  = clock;
+  g_prof_clock_selected = reader;
+  return true;
+#endif
+}
+
+bool profiler_clock_select_name(const char* name)
+{
+  for (u32 clock = 0; clock < pc_clock_count; clock++)
+  {
+    if (strcmp(name, g_prof_clock_names[clock]) == 0)
+    {
+      return profiler_clock_select((enum prof_clock)clock);
+    }
+  }
+  return false;
+}
+
+enum prof_clock profiler_clock_current(void)
+{
+  return g_prof_clock_current;
+}
+
+bool profiler_clock_is_nanoseconds(void)
+{
+  return g_prof_clock_current >= pc_monotonic;
+}
+
+uint64_t get_cycle_count(void)
+{
+#if defined(ARCH_X86) || defined(ARCH_X86_64)
+  return x86_get_rdtsc_counter();
+#else
+  return _clock_monotonic();
+#endif
+}
+
+uint64_t get_cycle_count_enhanced(void)
+{
+#if defined(PROFILER_CLOCK_FIXED)
+  return g_prof_clock_readers[PROFILER_CLOCK]();
+#else
+  prof_clock_fn reader = g_prof_clock_selected;
+  if (UNLIKELY(!reader))
+  {
+    // first read, fall back to a portable clock if the default isn't usable here
+    if (!profiler_clock_select(PROFILER_CLOCK))
+    {
+      profiler_clock_select(pc_monotonic);
+    }
+    reader = g_prof_clock_selected;
+  }
+  return reader();
+#endif
+}
+
+uint64_t get_cycle_count_cpu(uint32_t* cpu)
+{
+#if defined(ARCH_X86) || defined(ARCH_X86_64)
+#if defined(PROFILER_CLOCK_FIXED)
+  enum prof_clock clock = PROFILER_CLOCK;
+#else
+  if (UNLIKELY(!g_prof_clock_selected))
+  {
+    get_cycle_count_enhanced();  // resolves the default backend
+  }
+  enum prof_clock clock = g_prof_clock_current;
+#endif
+
+  u32 aux;
+  switch (clock)
+  {
+    case pc_rdtscp:
+    {
+      u64 cycles = x86_get_rdtscp_counter_aux(&aux);
+      *cpu = aux & 0xFFFu;
+      return cycles;
+    }
+
+    case pc_rdtscp_lfence:
+    {
+      u64 cycles = x86_get_rdtscp_lfence_counter_aux(&aux);
+      *cpu = aux & 0xFFFu;
+      return cycles;
+    }
+
+    default:
+      break;
+  }
+#endif
+  *cpu = PROFILER_CPU_UNKNOWN;
+  return get_cycle_count_enhanced();
+}
+
+uint64_t get_cycle_count_serialized(void)
+{
+#if defined(ARCH_X86) || defined(ARCH_X86_64)
+  return x86_get_rdtsc_counter_serialized();
+#else
+  return _clock_monotonic();
+#endif
+}
@@ -0,0 +1,435 @@
+// -finstrument-functions hooks, every instrumented function becomes a registry site
+// keyed by its address. see perf/auto.h.
+//
+// only objects built with -finstrument-functions reference the hooks, so this object is
+// only pulled out of the archive when tier_0_instrument_functions() is in effect.
+
+#include <perf/auto.h>
+#include <platform/platform.h>
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define AUTO_NO_INSTRUMENT __attribute__((no_instrument_function))
+#else
+#define AUTO_NO_INSTRUMENT
+#endif
+
+#define AUTO_TABLE_SIZE 4096  // open addressing, power of two
+#define AUTO_PROBE_MAX  64    // a function sits at most this far from its home slot
+#define AUTO_PREFIX_MAX 64
+
+void __cyg_profile_func_enter(void* function, void* call_site) AUTO_NO_INSTRUMENT;
+void __cyg_profile_func_exit(void* function, void* call_site) AUTO_NO_INSTRUMENT;
+
+enum auto_state
+{
+  as_claiming,  // slot taken, site not registered yet
+  as_pending,   // registered under its address
+  as_named,
+  as_excluded,
+};
+
+typedef struct auto_entry_t
+{
+  _Atomic(uintptr_t) _address;
+  _Atomic(_index)    _index;
+  _Atomic(u8)        _state;  // enum auto_state
+} auto_entry_t;
+
+// one instrumented call in flight on this thread
+typedef struct auto_frame_t
+{
+  uintptr_t _function;
+  uintptr_t _call_site;
+  _index    _index;
+  u32       _cpu;
+  u64       _cycles;
+  u64       _time;
+} auto_frame_t;
+
+static auto_entry_t g_auto_table[AUTO_TABLE_SIZE];
+static atomic_uint  g_auto_registered = 0;
+static _Atomic(_index) g_auto_other   = 0;  // index + 1, PROFILER_NO_INDEX when the registry was full
+static auto_entry_t g_auto_other_entry;       // stands in for functions that found no table slot
+static atomic_bool  g_auto_full    = false;   // a function found no slot within AUTO_PROBE_MAX
+
+static atomic_bool  g_auto_claimed = false;
+static atomic_bool  g_auto_ready   = false;
+
+// guards the exclusion list and renaming
+static atomic_flag  g_auto_lock = ATOMIC_FLAG_INIT;
+static char         g_auto_exclude[PROFILER_AUTO_EXCLUDE_MAX][AUTO_PREFIX_MAX];
+static u32          g_auto_exclude_count = 0;
+
+static THREAD_LOCAL auto_frame_t t_auto_stack[PROFILER_MAX_DEPTH];
+static THREAD_LOCAL u32          t_auto_depth    = 0;
+static THREAD_LOCAL u32          t_auto_overflow = 0;  // calls past PROFILER_MAX_DEPTH
+static THREAD_LOCAL bool         t_auto_busy     = false;
+
+static void _auto_lock(void)
+{
+  while (atomic_flag_test_and_set_explicit(&g_auto_lock, memory_order_acquire))
+  {
+  }
+}
+
+static void _auto_unlock(void)
+{
+  atomic_flag_clear_explicit(&g_auto_lock, memory_order_release);
+}
+
+static bool _auto_exclude_locked(const char* prefix, size_t length)
+{
+  if (length == 0 || g_auto_exclude_count >= PROFILER_AUTO_EXCLUDE_MAX)
+  {
+    return length == 0;
+  }
+
+  length = length < AUTO_PREFIX_MAX - 1 ? length : AUTO_PREFIX_MAX - 1;
+  memcpy(g_auto_exclude[g_auto_exclude_count], prefix, length);
+  g_auto_exclude[g_auto_exclude_count][length] = '\0';
+  g_auto_exclude_count++;
+  return true;
+}
+
+static bool _auto_name_excluded(const char* name)
+{
+  for (u32 i = 0; i < g_auto_exclude_count; i++)
+  {
+    if (strncmp(name, g_auto_exclude[i], strlen(g_auto_exclude[i])) == 0)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+// first sight of a function while name prefixes are excluded: look the name up right away
+// so an excluded function never gets a site. the name is only checked, the site is still
+// named by profiler_auto_resolve()
+static bool _auto_excluded_on_sight(uintptr_t address)
+{
+  _auto_lock();
+  u32 count = g_auto_exclude_count;
+  _auto_unlock();
+  if (count == 0)
+  {
+    return false;
+  }
+
+  char name[96];
+  char module[144];
+  if (!impl_symbol_name((const void*)address, name, sizeof(name), module, sizeof(module)))
+  {
+    return false;
+  }
+
+  _auto_lock();
+  bool excluded = _auto_name_excluded(name);
+  _auto_unlock();
+  return excluded;
+}
+
+static void _auto_collect(bool reset)
+{
+  if (!reset)
+  {
+    profiler_auto_resolve();
+  }
+}
+
+// profiler_init() clears the stats, nothing is recorded before it ran
+static bool _auto_ready(void)
+{
+  if (LIKELY(atomic_load_explicit(&g_auto_ready, memory_order_acquire)))
+  {
+    return true;
+  }
+  if (profiler_start_time() == 0)
+  {
+    return false;
+  }
+
+  bool expected = false;
+  if (!atomic_compare_exchange_strong(&g_auto_claimed, &expected, true))
+  {
+    return false;  // another thread is setting up, skip this call
+  }
+
+  const char* exclude = getenv("TIER0_AUTO_EXCLUDE");
+  _auto_lock();
+  while (exclude && *exclude)
+  {
+    const char* end = strchr(exclude, ',');
+    size_t length   = end ? (size_t)(end - exclude) : strlen(exclude);
+    _auto_exclude_locked(exclude, length);
+    exclude += length + (end ? 1 : 0);
+  }
+  _auto_unlock();
+
+  profiler_register_collector(pk_function, _auto_collect);
+  atomic_store_explicit(&g_auto_ready, true, memory_order_release);
+  return true;
+}
+
+// the shared "[other]" site, registered on first use
+static _index _auto_other(void)
+{
+  _index other = atomic_load_explicit(&g_auto_other, memory_order_acquire);
+  if (other == 0)
+  {
+    _index expected = 0;
+    other = profiler_add_function(__FILE__, "[other]", __LINE__);
+    other = other != PROFILER_NO_INDEX ? other + 1 : PROFILER_NO_INDEX;
+    atomic_compare_exchange_strong(&g_auto_other, &expected, other);
+    other = atomic_load_explicit(&g_auto_other, memory_order_acquire);
+  }
+  return other != PROFILER_NO_INDEX ? other - 1 : PROFILER_NO_INDEX;
+}
+
+static _index _auto_register(uintptr_t address)
+{
+  char name[48];
+  if (atomic_fetch_add_explicit(&g_auto_registered, 1, memory_order_relaxed) >= PROFILER_AUTO_MAX)
+  {
+    return _auto_other();
+  }
+
+  snprintf(name, sizeof(name), "fn@%p", (void*)address);
+  return profiler_add_function("", name, 0);
+}
+
+// functions that found no slot share one entry for "[other]", NULL without that site
+static auto_entry_t* _auto_overflow(void)
+{
+  if (!atomic_exchange_explicit(&g_auto_full, true, memory_order_relaxed))
+  {
+    log_println("instrumented function table is full, new functions go to [other]");
+  }
+  if (atomic_load_explicit(&g_auto_other_entry._state, memory_order_acquire) != as_named)
+  {
+    _index other = _auto_other();
+    if (other == PROFILER_NO_INDEX)
+    {
+      return NULL;
+    }
+    atomic_store_explicit(&g_auto_other_entry._index, other, memory_order_relaxed);
+    atomic_store_explicit(&g_auto_other_entry._state, (u8)as_named, memory_order_release);
+  }
+  return &g_auto_other_entry;
+}
+
+// table slot of `address`, registering the function on first sight when `insert` is set.
+// NULL when the address is unknown. probes are bounded, a function that finds no slot
+// near its home is counted under "[other]" without touching the table
+static auto_entry_t* _auto_entry(uintptr_t address, bool insert)
+{
+  u32 slot = (u32)((address >> 4) * 0x9E3779B1u) & (AUTO_TABLE_SIZE - 1);
+
+  for (u32 probe = 0; probe < AUTO_PROBE_MAX; ++probe)
+  {
+    auto_entry_t* entry   = &g_auto_table[(slot + probe) & (AUTO_TABLE_SIZE - 1)];
+    uintptr_t     current = atomic_load_explicit(&entry->_address, memory_order_acquire);
+
+    if (current == 0)
+    {
+      if (!insert)
+      {
+        return NULL;
+      }
+      if (!atomic_compare_exchange_strong(&entry->_address, &current, address) && current != address)
+      {
+        continue;  // another function took the slot
+      }
+      if (current == 0)
+      {
+        // without a site (registry full, excluded by name) the function isn't timed at all
+        _index index = _auto_excluded_on_sight(address) ? PROFILER_NO_INDEX : _auto_register(address);
+        atomic_store_explicit(&entry->_index, index, memory_order_relaxed);
+        atomic_store_explicit(&entry->_state, (u8)(index != PROFILER_NO_INDEX ? as_pending : as_excluded),
+                              memory_order_release);
+      }
+    }
+    else if (current != address)
+    {
+      continue;
+    }
+
+    // the claiming thread may still be registering
+    while (atomic_load_explicit(&entry->_state, memory_order_acquire) == as_claiming)
+    {
+    }
+    return entry;
+  }
+
+  return insert ? _auto_overflow() : NULL;
+}
+
+void __cyg_profile_func_enter(void* function, void* call_site)
+{
+  if (t_auto_busy || !_auto_ready())
+  {
+    return;
+  }
+  if (t_auto_depth >= PROFILER_MAX_DEPTH)
+  {
+    t_auto_overflow++;
+    return;
+  }
+
+  t_auto_busy = true;
+  auto_entry_t* entry = _auto_entry((uintptr_t)function, true);
+  if (entry && atomic_load_explicit(&entry->_state, memory_order_acquire) != as_excluded)
+  {
+    _index index = atomic_load_explicit(&entry->_index, memory_order_relaxed);
+    profiler_enter(index);
+    profiler_add(pa_total_calls, 1, index);
+
+    auto_frame_t* frame = &t_auto_stack[t_auto_depth++];
+    frame->_function    = (uintptr_t)function;
+    frame->_call_site   = (uintptr_t)call_site;
+    frame->_index       = index;
+    frame->_cycles      = get_cycle_count_cpu(&frame->_cpu);
+    frame->_time        = get_nanoseconds();
+  }
+  t_auto_busy = false;
+}
+
+void __cyg_profile_func_exit(void* function, void* call_site)
+{
+  if (t_auto_busy)
+  {
+    return;
+  }
+  if (t_auto_overflow > 0)
+  {
+    t_auto_overflow--;
+    return;
+  }
+
+  u32 end_cpu;
+  u64 end_cycles = get_cycle_count_cpu(&end_cpu);
+  u64 end_time   = get_nanoseconds();
+
+  // excluded, skipped or entered before profiler_init(): there is no frame of ours on top
+  if (t_auto_depth == 0)
+  {
+    return;
+  }
+  auto_frame_t* frame = &t_auto_stack[t_auto_depth - 1];
+  if (frame->_function != (uintptr_t)function || frame->_call_site != (uintptr_t)call_site)
+  {
+    return;
+  }
+
+  t_auto_busy = true;
+  t_auto_depth--;
+
+  _index index  = frame->_index;
+  u64    cycles = end_cycles - frame->_cycles;
+  u64    time   = end_time - frame->_time;
+  if (profiler_region_cpu(index, frame->_cpu, end_cpu, cycles))
+  {
+    profiler_add(pa_cycles_total, cycles, index);
+    profiler_add(pa_cycles_min, cycles, index);
+    profiler_add(pa_cycles_max, cycles, index);
+    profiler_add(pa_time_total, time, index);
+    profiler_add(pa_time_min, time, index);
+    profiler_add(pa_time_max, time, index);
+  }
+  profiler_leave_work(index, cycles, time, 0, 0);
+  t_auto_busy = false;
+}
+
+bool profiler_auto_exclude(const char* prefix)
+{
+  _auto_lock();
+  bool added = _auto_exclude_locked(prefix, strlen(prefix));
+  _auto_unlock();
+  return added;
+}
+
+void profiler_auto_exclude_function(const void* function)
+{
+  uintptr_t address = (uintptr_t)function;
+  u32       slot    = (u32)((address >> 4) * 0x9E3779B1u) & (AUTO_TABLE_SIZE - 1);
+
+  for (u32 probe = 0; probe < AUTO_PROBE_MAX; ++probe)
+  {
+    auto_entry_t* entry   = &g_auto_table[(slot + probe) & (AUTO_TABLE_SIZE - 1)];
+    uintptr_t     current = atomic_load_explicit(&entry->_address, memory_order_acquire);
+
+    if (current == 0 && !atomic_compare_exchange_strong(&entry->_address, &current, address) && current != address)
+    {
+      continue;
+    }
+    if (current != 0 && current != address)
+    {
+      continue;
+    }
+
+    // seen already: the site keeps what it recorded so far
+    atomic_store_explicit(&entry->_state, (u8)as_excluded, memory_order_release);
+    return;
+  }
+}
+
+u32 profiler_auto_resolve(void)
+{
+  u32    resolved = 0;
+  _index other    = atomic_load_explicit(&g_auto_other, memory_order_acquire);
+
+  _auto_lock();
+  for (u32 i = 0; i < AUTO_TABLE_SIZE; i++)
+  {
+    auto_entry_t* entry = &g_auto_table[i];
+    u8 expected = as_pending;
+    if (atomic_load_explicit(&entry->_state, memory_order_acquire) != as_pending)
+    {
+      continue;
+    }
+
+    _index index = atomic_load_explicit(&entry->_index, memory_order_relaxed);
+    if (index + 1 == other)
+    {
+      atomic_compare_exchange_strong(&entry->_state, &expected, (u8)as_named);
+      continue;
+    }
+
+    // unnamed functions keep their address, they are not looked up again
+    char name[96];
+    char module[144];
+    uintptr_t address = atomic_load_explicit(&entry->_address, memory_order_relaxed);
+    if (!impl_symbol_name((const void*)address, name, sizeof(name), module, sizeof(module)))
+    {
+      atomic_compare_exchange_strong(&entry->_state, &expected, (u8)as_named);
+      continue;
+    }
+
+    profiler_set_site_name(index, module, name);
+    atomic_compare_exchange_strong(&entry->_state, &expected, (u8)(_auto_name_excluded(name) ? as_excluded : as_named));
+    resolved++;
+  }
+  _auto_unlock();
+
+  return resolved;
+}
+
+_index profiler_auto_site(const void* function)
+{
+  auto_entry_t* entry = _auto_entry((uintptr_t)function, false);
+  if (!entry || atomic_load_explicit(&entry->_state, memory_order_acquire) == as_excluded)
+  {
+    return PROFILER_NO_INDEX;
+  }
+  return atomic_load_explicit(&entry->_index, memory_order_relaxed);
+}
+
+u32 profiler_auto_count(void)
+{
+  return atomic_load_explicit(&g_auto_registered, memory_order_relaxed);
+}
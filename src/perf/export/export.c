@@ -0,0 +1,459 @@
+#include <perf/export.h>
+#include <utils/log.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// only code that ran: lock, counter, gauge and a/b sites would count their time twice
+static bool _exported(_index index)
+{
+  u8 kind = profiler_get_stat_head(index)->_kind;
+  return (kind == pk_function || kind == pk_span) && profiler_get_call_stat(index)->_total_calls != 0;
+}
+
+// self weights, a site's callees carry their own share so the stacks sum to the run
+static u64 _weight_value(enum prof_weight weight, _index index)
+{
+  switch (weight)
+  {
+    case pw_cycles:
+      return profiler_get_self_stat(index)->_cycles;
+
+    case pw_nanoseconds:
+      return profiler_get_self_stat(index)->_time;
+
+    case pw_calls:
+      return profiler_get_call_stat(index)->_total_calls;
+
+    default:
+      log_println("unknown weight passed! {u64}", (u64)weight);
+      return 0;
+  }
+}
+
+// folded frames are separated by ';' and the weight by the last ' '
+static void _write_folded_frame(FILE* file, const char* name)
+{
+  for (const char* p = name; *p; p++)
+  {
+    char c = *p;
+    if (c == ';')
+    {
+      c = ':';
+    }
+    else if (c == '\n' || c == '\r')
+    {
+      c = ' ';
+    }
+    fputc(c, file);
+  }
+}
+
+bool profiler_export_folded(const char* path, enum prof_weight weight)
+{
+  profiler_collect();
+
+  FILE* file = fopen(path, "w");
+  if (!file)
+  {
+    log_println("Failed to open {str} for writing", path);
+    return false;
+  }
+
+  _index count = profiler_get_function_count();
+  for (_index i = 0; i < count; i++)
+  {
+    u64 value = _exported(i) ? _weight_value(weight, i) : 0;
+    if (value == 0)
+    {
+      continue;
+    }
+
+    _write_folded_frame(file, profiler_get_stat_head(i)->_func_name);
+    fprintf(file, " %llu\n", (unsigned long long)value);
+  }
+
+  fclose(file);
+  return true;
+}
+
+// minimal protobuf writer
+
+typedef struct pb_buffer_t
+{
+  u8*     _data;
+  size_t  _size;
+  size_t  _capacity;
+  bool    _failed;
+} pb_buffer_t;
+
+static void _pb_reserve(pb_buffer_t* pb, size_t extra)
+{
+  if (pb->_failed || pb->_size + extra <= pb->_capacity)
+  {
+    return;
+  }
+
+  size_t capacity = pb->_capacity ? pb->_capacity : 256;
+  while (capacity < pb->_size + extra)
+  {
+    capacity *= 2;
+  }
+
+  u8* data = realloc(pb->_data, capacity);
+  if (!data)
+  {
+    pb->_failed = true;
+    return;
+  }
+  pb->_data     = data;
+  pb->_capacity = capacity;
+}
+
+static void _pb_raw(pb_buffer_t* pb, const void* data, size_t size)
+{
+  _pb_reserve(pb, size);
+  if (pb->_failed)
+  {
+    return;
+  }
+  memcpy(pb->_data + pb->_size, data, size);
+  pb->_size += size;
+}
+
+static void _pb_varint(pb_buffer_t* pb, u64 value)
+{
+  u8  bytes[10];
+  u32 count = 0;
+
+  do
+  {
+    u8 byte = value & 0x7f;
+    value >>= 7;
+    bytes[count++] = byte | (value ? 0x80 : 0);
+  } while (value);
+
+  _pb_raw(pb, bytes, count);
+}
+
+// wire types: 0 varint, 2 length delimited
+static void _pb_field_varint(pb_buffer_t* pb, u32 field, u64 value)
+{
+  _pb_varint(pb, ((u64)field << 3) | 0);
+  _pb_varint(pb, value);
+}
+
+static void _pb_field_bytes(pb_buffer_t* pb, u32 field, const void* data, size_t size)
+{
+  _pb_varint(pb, ((u64)field << 3) | 2);
+  _pb_varint(pb, size);
+  _pb_raw(pb, data, size);
+}
+
+static void _pb_field_message(pb_buffer_t* pb, u32 field, pb_buffer_t* message)
+{
+  if (message->_failed)
+  {
+    pb->_failed = true;
+  }
+  _pb_field_bytes(pb, field, message->_data, message->_size);
+  message->_size = 0;
+}
+
+static void _pb_free(pb_buffer_t* pb)
+{
+  free(pb->_data);
+  memset(pb, 0, sizeof(*pb));
+}
+
+// string table with index 0 = "" as required by profile.proto
+
+typedef struct pb_strings_t
+{
+  const char**  _strings;
+  u64           _count;
+  u64           _capacity;
+} pb_strings_t;
+
+static u64 _pb_string(pb_strings_t* table, const char* str)
+{
+  for (u64 i = 0; i < table->_count; i++)
+  {
+    if (strcmp(table->_strings[i], str) == 0)
+    {
+      return i;
+    }
+  }
+
+  if (table->_count == table->_capacity)
+  {
+    u64 capacity = table->_capacity ? table->_capacity * 2 : 64;
+    const char** strings = realloc((void*)table->_strings, capacity * sizeof(*strings));
+    if (!strings)
+    {
+      return 0;
+    }
+    table->_strings  = strings;
+    table->_capacity = capacity;
+  }
+
+  table->_strings[table->_count] = str;
+  return table->_count++;
+}
+
+enum pprof_field
+{
+  // Profile
+  pf_profile_sample_type         = 1,
+  pf_profile_sample              = 2,
+  pf_profile_location            = 4,
+  pf_profile_function            = 5,
+  pf_profile_string_table        = 6,
+  pf_profile_time_nanos          = 9,
+  pf_profile_default_sample_type = 14,
+
+  // ValueType
+  pf_value_type_type = 1,
+  pf_value_type_unit = 2,
+
+  // Sample
+  pf_sample_location_id = 1,
+  pf_sample_value       = 2,
+
+  // Location
+  pf_location_id   = 1,
+  pf_location_line = 4,
+
+  // Line
+  pf_line_function_id = 1,
+  pf_line_line        = 2,
+
+  // Function
+  pf_function_id          = 1,
+  pf_function_name        = 2,
+  pf_function_system_name = 3,
+  pf_function_filename    = 4,
+  pf_function_start_line  = 5,
+};
+
+bool profiler_export_pprof(const char* path, enum prof_weight weight)
+{
+  profiler_collect();
+
+  static const char* type_names[] = { "cycles", "wall", "calls" };
+  static const char* type_units[] = { "count", "nanoseconds", "count" };
+  static const enum prof_weight types[] = { pw_cycles, pw_nanoseconds, pw_calls };
+
+  pb_buffer_t  profile = {0};
+  pb_buffer_t  message = {0};
+  pb_buffer_t  nested  = {0};
+  pb_strings_t strings = {0};
+
+  _pb_string(&strings, "");
+
+  for (u32 t = 0; t < 3; t++)
+  {
+    _pb_field_varint(&message, pf_value_type_type, _pb_string(&strings, type_names[t]));
+    _pb_field_varint(&message, pf_value_type_unit, _pb_string(&strings, type_units[t]));
+    _pb_field_message(&profile, pf_profile_sample_type, &message);
+  }
+
+  _index count = profiler_get_function_count();
+  for (_index i = 0; i < count; i++)
+  {
+    const prof_stat_head_t* head = profiler_get_stat_head(i);
+    if (!_exported(i))
+    {
+      continue;
+    }
+
+    // ids must be non zero, function i and its location share id i + 1
+    u64 id = i + 1;
+
+    _pb_field_varint(&message, pf_function_id, id);
+    _pb_field_varint(&message, pf_function_name, _pb_string(&strings, head->_func_name));
+    _pb_field_varint(&message, pf_function_system_name, _pb_string(&strings, head->_func_name));
+    _pb_field_varint(&message, pf_function_filename, _pb_string(&strings, head->_file_name));
+    _pb_field_varint(&message, pf_function_start_line, head->_line);
+    _pb_field_message(&profile, pf_profile_function, &message);
+
+    _pb_field_varint(&nested, pf_line_function_id, id);
+    _pb_field_varint(&nested, pf_line_line, head->_line);
+    _pb_field_varint(&message, pf_location_id, id);
+    _pb_field_message(&message, pf_location_line, &nested);
+    _pb_field_message(&profile, pf_profile_location, &message);
+
+    // packed repeated fields
+    _pb_varint(&nested, id);
+    _pb_field_message(&message, pf_sample_location_id, &nested);
+    for (u32 t = 0; t < 3; t++)
+    {
+      _pb_varint(&nested, _weight_value(types[t], i));
+    }
+    _pb_field_message(&message, pf_sample_value, &nested);
+    _pb_field_message(&profile, pf_profile_sample, &message);
+  }
+
+  _pb_field_varint(&profile, pf_profile_time_nanos, (u64)time(NULL) * 1000000000ull);
+  _pb_field_varint(&profile, pf_profile_default_sample_type, _pb_string(&strings, type_names[weight]));
+
+  for (u64 s = 0; s < strings._count; s++)
+  {
+    _pb_field_bytes(&profile, pf_profile_string_table, strings._strings[s], strlen(strings._strings[s]));
+  }
+
+  bool ok = !profile._failed;
+  if (ok)
+  {
+    FILE* file = fopen(path, "wb");
+    if (file)
+    {
+      ok = fwrite(profile._data, 1, profile._size, file) == profile._size;
+      fclose(file);
+    }
+    else
+    {
+      log_println("Failed to open {str} for writing", path);
+      ok = false;
+    }
+  }
+
+  _pb_free(&profile);
+  _pb_free(&message);
+  _pb_free(&nested);
+  free((void*)strings._strings);
+  return ok;
+}
+
+// chrome trace event format
+
+static void _write_json_string(FILE* file, const char* text)
+{
+  fputc('"', file);
+  for (const char* p = text; *p; p++)
+  {
+    unsigned char c = (unsigned char)*p;
+    if (c == '"' || c == '\\')
+    {
+      fputc('\\', file);
+      fputc(c, file);
+    }
+    else if (c < 0x20)
+    {
+      fprintf(file, "\\u%04x", c);
+    }
+    else
+    {
+      fputc(c, file);
+    }
+  }
+  fputc('"', file);
+}
+
+// begins an event object up to and including "ph", the caller adds the rest
+static void _write_trace_event(FILE* file, bool* first, const char* name, const char* category,
+                               char phase, u64 time, u64 tid)
+{
+  fputs(*first ? "\n" : ",\n", file);
+  *first = false;
+
+  fputs("{\"name\":", file);
+  _write_json_string(file, name);
+  fprintf(file, ",\"cat\":\"%s\",\"ph\":\"%c\",\"ts\":%llu.%03llu,\"pid\":1,\"tid\":%llu",
+          category, phase, (unsigned long long)(time / 1000), (unsigned long long)(time % 1000),
+          (unsigned long long)tid);
+}
+
+// span id -> record, open addressing over twice the record count
+static const prof_span_record_t* _find_span(const prof_span_record_t* records, const u32* table, u32 mask, u64 id)
+{
+  for (u32 slot = (u32)(id * 0x9E3779B97F4A7C15ull >> 32) & mask;; slot = (slot + 1) & mask)
+  {
+    if (table[slot] == 0)
+    {
+      return NULL;
+    }
+    if (records[table[slot] - 1]._id == id)
+    {
+      return &records[table[slot] - 1];
+    }
+  }
+}
+
+bool profiler_export_trace(const char* path)
+{
+  prof_span_record_t* records = malloc(sizeof(prof_span_record_t) * PROFILER_SPAN_CAPACITY);
+  u32*                table   = calloc(PROFILER_SPAN_CAPACITY * 2, sizeof(u32));
+  FILE*               file    = (records && table) ? fopen(path, "w") : NULL;
+  if (!file)
+  {
+    log_println("Failed to open {str} for writing", path);
+    free(records);
+    free(table);
+    return false;
+  }
+
+  u32 count = profiler_span_records(records, PROFILER_SPAN_CAPACITY);
+  u32 mask  = PROFILER_SPAN_CAPACITY * 2 - 1;
+  for (u32 i = 0; i < count; i++)
+  {
+    u32 slot = (u32)(records[i]._id * 0x9E3779B97F4A7C15ull >> 32) & mask;
+    while (table[slot] != 0)
+    {
+      slot = (slot + 1) & mask;
+    }
+    table[slot] = i + 1;
+  }
+
+  bool first = true;
+  fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", file);
+
+  for (u32 i = 0; i < count; i++)
+  {
+    const prof_span_record_t* span = &records[i];
+    const char*               name = profiler_get_stat_head(span->_index)->_func_name;
+    unsigned long long        id   = (unsigned long long)span->_id;
+
+    if (span->_begin_tid == span->_end_tid)
+    {
+      u64 duration = span->_end_time - span->_begin_time;
+      _write_trace_event(file, &first, name, "span", 'X', span->_begin_time, span->_begin_tid);
+      fprintf(file, ",\"dur\":%llu.%03llu,\"args\":{\"span\":%llu,\"parent\":%llu}}",
+              (unsigned long long)(duration / 1000), (unsigned long long)(duration % 1000),
+              id, (unsigned long long)span->_parent);
+    }
+    else
+    {
+      // async pair for the whole span plus a flow arrow from the thread that began it
+      _write_trace_event(file, &first, name, "span", 'b', span->_begin_time, span->_begin_tid);
+      fprintf(file, ",\"id\":\"0x%llx\",\"args\":{\"span\":%llu,\"parent\":%llu}}", id, id, (unsigned long long)span->_parent);
+      _write_trace_event(file, &first, name, "span", 'e', span->_end_time, span->_end_tid);
+      fprintf(file, ",\"id\":\"0x%llx\"}", id);
+
+      _write_trace_event(file, &first, name, "span_flow", 's', span->_begin_time, span->_begin_tid);
+      fprintf(file, ",\"id\":\"0x%llx\"}", id);
+      _write_trace_event(file, &first, name, "span_flow", 'f', span->_end_time, span->_end_tid);
+      fprintf(file, ",\"id\":\"0x%llx\",\"bp\":\"e\"}", id);
+    }
+
+    // parent -> child link, drawn where the child began
+    const prof_span_record_t* parent = span->_parent ? _find_span(records, table, mask, span->_parent) : NULL;
+    if (parent)
+    {
+      _write_trace_event(file, &first, name, "span_link", 's', span->_begin_time, parent->_begin_tid);
+      fprintf(file, ",\"id\":\"0x%llx\"}", id);
+      _write_trace_event(file, &first, name, "span_link", 'f', span->_begin_time, span->_begin_tid);
+      fprintf(file, ",\"id\":\"0x%llx\",\"bp\":\"e\"}", id);
+    }
+  }
+
+  fputs("\n]}\n", file);
+
+  bool ok = !ferror(file);
+  fclose(file);
+  free(records);
+  free(table);
+  return ok;
+}
@@ -0,0 +1,338 @@
+#include <perf/ab.h>
+#include <perf/arch.h>
+#include <perf/timer.h>
+#include <utils/log.h>
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct prof_ab_slot_t
+{
+  _index  _site;
+  _index  _variant[2];
+  u32     _count[2];
+  u64     _cycles[2][PROFILER_AB_SAMPLES];
+} prof_ab_slot_t;
+
+static prof_ab_slot_t g_prof_ab[PROFILER_AB_MAX];
+static u32            g_prof_ab_used = 0;
+static u64            g_prof_ab_rng = 0;
+static atomic_flag    g_prof_ab_lock = ATOMIC_FLAG_INIT;
+
+// scratch for the sorted pair ratios
+static f64            g_prof_ab_ratios[PROFILER_AB_SAMPLES];
+
+static FORCE_INLINE void _ab_lock(void)
+{
+  while (atomic_flag_test_and_set_explicit(&g_prof_ab_lock, memory_order_acquire))
+  {
+  }
+}
+
+static FORCE_INLINE void _ab_unlock(void)
+{
+  atomic_flag_clear_explicit(&g_prof_ab_lock, memory_order_release);
+}
+
+// the library does not link libm, a few digits are enough here
+static f64 _ab_exp_neg(f64 x)
+{
+  // e^-x for x >= 0: halve into the range of a short series, square back up
+  u32 halvings = 0;
+  while (x > 0.5)
+  {
+    x *= 0.5;
+    halvings++;
+  }
+  f64 term = 1.0;
+  f64 sum  = 1.0;
+  for (u32 n = 1; n < 12; n++)
+  {
+    term *= -x / n;
+    sum  += term;
+  }
+  while (halvings--)
+  {
+    sum *= sum;
+  }
+  return sum;
+}
+
+// two sided normal tail, Abramowitz & Stegun 7.1.26 for erfc
+static f64 _ab_normal_p(f64 z)
+{
+  f64 x = (z < 0.0 ? -z : z) / 1.4142135623730951;
+  f64 t = 1.0 / (1.0 + 0.3275911 * x);
+  f64 poly = t * (0.254829592 + t * (-0.284496736 + t * (1.421413741 + t * (-1.453152027 + t * 1.061405429))));
+  return poly * _ab_exp_neg(x * x);
+}
+
+static int _ab_compare_f64(const void* a, const void* b)
+{
+  f64 x = *(const f64*)a;
+  f64 y = *(const f64*)b;
+  return (x > y) - (x < y);
+}
+
+static int _ab_compare_u64(const void* a, const void* b)
+{
+  u64 x = *(const u64*)a;
+  u64 y = *(const u64*)b;
+  return (x > y) - (x < y);
+}
+
+static prof_ab_slot_t* _ab_find(const char* name)
+{
+  for (u32 i = 0; i < g_prof_ab_used; i++)
+  {
+    const prof_stat_head_t* head = profiler_get_stat_head(g_prof_ab[i]._site);
+    if (head && strcmp(head->_func_name, name) == 0)
+    {
+      return &g_prof_ab[i];
+    }
+  }
+  return NULL;
+}
+
+static prof_ab_slot_t* _ab_slot_of(_index site)
+{
+  for (u32 i = 0; i < g_prof_ab_used; i++)
+  {
+    if (g_prof_ab[i]._site == site)
+    {
+      return &g_prof_ab[i];
+    }
+  }
+  return NULL;
+}
+
+static bool _ab_result(const prof_ab_slot_t* slot, prof_ab_result_t* out)
+{
+  memset(out, 0, sizeof(*out));
+
+  u32 pairs = slot->_count[0] < slot->_count[1] ? slot->_count[0] : slot->_count[1];
+  if (pairs == 0)
+  {
+    return false;
+  }
+
+  u64 wins = 0;
+  u64 ties = 0;
+  for (u32 i = 0; i < pairs; i++)
+  {
+    u64 a = slot->_cycles[0][i];
+    u64 b = slot->_cycles[1][i];
+    wins += b < a;
+    ties += b == a;
+    g_prof_ab_ratios[i] = (f64)(a ? a : 1) / (f64)(b ? b : 1);
+  }
+  qsort(g_prof_ab_ratios, pairs, sizeof(f64), _ab_compare_f64);
+
+  // ranks of the median's 95% interval from the binomial(n, 1/2) normal approximation
+  f64 spread = 0.98 * profiler_sqrt((f64)pairs);
+  s64 low    = (s64)((f64)pairs * 0.5 - spread);
+  s64 high   = (s64)((f64)pairs * 0.5 + spread + 0.999);
+  low  = low < 0 ? 0 : low;
+  high = high > (s64)pairs - 1 ? (s64)pairs - 1 : high;
+
+  out->_pairs        = pairs;
+  out->_wins         = wins;
+  out->_ties         = ties;
+  out->_speedup      = pairs & 1 ? g_prof_ab_ratios[pairs / 2]
+                                 : 0.5 * (g_prof_ab_ratios[pairs / 2 - 1] + g_prof_ab_ratios[pairs / 2]);
+  out->_speedup_low  = g_prof_ab_ratios[low];
+  out->_speedup_high = g_prof_ab_ratios[high];
+
+  // sign test: without a difference either variant wins half of the untied pairs
+  u64 decided = pairs - ties;
+  if (decided > 0)
+  {
+    f64 z = ((f64)wins - 0.5 * (f64)decided) / (0.5 * profiler_sqrt((f64)decided));
+    out->_p_value = _ab_normal_p(z);
+  }
+  else
+  {
+    out->_p_value = 1.0;
+  }
+  out->_significant = out->_p_value < 0.05;
+
+  for (u32 v = 0; v < 2; v++)
+  {
+    static u64 sorted[PROFILER_AB_SAMPLES];
+    memcpy(sorted, slot->_cycles[v], pairs * sizeof(u64));
+    qsort(sorted, pairs, sizeof(u64), _ab_compare_u64);
+    out->_median_cycles[v] = sorted[pairs / 2];
+  }
+  return true;
+}
+
+static void _ab_print(log_buffer_t* out, _index index)
+{
+  prof_ab_slot_t*  slot = _ab_slot_of(index);
+  prof_ab_result_t result;
+  if (!slot || !_ab_result(slot, &result))
+  {
+    log_buffer_println(out, "A/B pairs: 0");
+    return;
+  }
+
+  log_buffer_println(out, "A/B pairs: {u64}", result._pairs);
+  log_buffer_println(out, "Variant 0 median cycles: {u64}", result._median_cycles[0]);
+  log_buffer_println(out, "Variant 1 median cycles: {u64}", result._median_cycles[1]);
+  log_buffer_println(out, "Speedup of variant 1: {f64}x (95% CI {f64} .. {f64})",
+                     result._speedup, result._speedup_low, result._speedup_high);
+  log_buffer_println(out, "Variant 1 faster in {u64} pairs, {u64} ties", result._wins, result._ties);
+  log_buffer_println(out, "Sign test p: {f64} ({str})", result._p_value,
+                     result._significant ? "significant" : "not significant");
+}
+
+static void _ab_collect(bool reset)
+{
+  if (reset)
+  {
+    profiler_ab_clear();
+  }
+}
+
+_index profiler_add_ab_site(const char* file_name, const char* name, u16 line_number)
+{
+  profiler_register_printer(pk_ab, _ab_print);
+  profiler_register_collector(pk_ab, _ab_collect);
+
+  _ab_lock();
+
+  prof_ab_slot_t* slot = _ab_find(name);
+  if (slot)
+  {
+    _ab_unlock();
+    return slot->_site;
+  }
+  if (g_prof_ab_used == PROFILER_AB_MAX)
+  {
+    _ab_unlock();
+    log_println("PROFILER_AB_MAX comparisons in use, dropping {str}", name);
+    return PROFILER_NO_INDEX;
+  }
+
+  _index site = profiler_add_site(file_name, name, line_number, pk_ab);
+  if (site == PROFILER_NO_INDEX)
+  {
+    _ab_unlock();
+    return PROFILER_NO_INDEX;
+  }
+  slot = &g_prof_ab[g_prof_ab_used];
+  memset(slot->_count, 0, sizeof(slot->_count));
+  slot->_site = site;
+  for (u32 v = 0; v < 2; v++)
+  {
+    char variant[96];
+    snprintf(variant, sizeof(variant), "%.90s[%u]", name, v);
+    slot->_variant[v] = profiler_add_site(file_name, variant, line_number, pk_function);
+  }
+  g_prof_ab_used++;
+
+  _ab_unlock();
+  return site;
+}
+
+prof_ab_run_t profiler_ab_begin(const char* file_name, const char* name, u16 line_number, u32 variant)
+{
+  prof_ab_run_t run = { PROFILER_NO_INDEX, 0, variant & 1, 0, 0 };
+
+  prof_ab_slot_t* slot = _ab_find(name);
+  if (!slot && profiler_add_ab_site(file_name, name, line_number) != PROFILER_NO_INDEX)
+  {
+    slot = _ab_find(name);
+  }
+  if (!slot)
+  {
+    return run;
+  }
+
+  run._index = slot->_variant[run._variant];
+  run._slot  = (u32)(slot - g_prof_ab);
+  profiler_enter(run._index);
+  profiler_add(pa_total_calls, 1, run._index);
+
+  run._begin_time   = get_nanoseconds();
+  run._begin_cycles = get_cycle_count();
+  return run;
+}
+
+void profiler_ab_end(prof_ab_run_t* run)
+{
+  u64 cycles = get_cycle_count() - run->_begin_cycles;
+  u64 time   = get_nanoseconds() - run->_begin_time;
+
+  profiler_add(pa_cycles_total, cycles, run->_index);
+  profiler_add(pa_cycles_min, cycles, run->_index);
+  profiler_add(pa_cycles_max, cycles, run->_index);
+  profiler_add(pa_time_total, time, run->_index);
+  profiler_add(pa_time_min, time, run->_index);
+  profiler_add(pa_time_max, time, run->_index);
+  profiler_leave_work(run->_index, cycles, time, 0, 0);
+
+  prof_ab_slot_t* slot = &g_prof_ab[run->_slot];
+  u32 count = slot->_count[run->_variant];
+  if (count < PROFILER_AB_SAMPLES)
+  {
+    slot->_cycles[run->_variant][count] = cycles;
+    slot->_count[run->_variant] = count + 1;
+  }
+
+  run->_index = PROFILER_NO_INDEX;
+}
+
+u32 profiler_ab_first(void)
+{
+  // xorshift64, seeded from the clock on first use
+  if (g_prof_ab_rng == 0)
+  {
+    g_prof_ab_rng = get_cycle_count() | 1;
+  }
+  g_prof_ab_rng ^= g_prof_ab_rng << 13;
+  g_prof_ab_rng ^= g_prof_ab_rng >> 7;
+  g_prof_ab_rng ^= g_prof_ab_rng << 17;
+  return (u32)(g_prof_ab_rng >> 63);
+}
+
+void profiler_ab_compare(const char* name, prof_ab_fn a, prof_ab_fn b, void* data, u32 rounds)
+{
+  prof_ab_fn variants[2] = { a, b };
+  for (u32 round = 0; round < rounds; round++)
+  {
+    u32 first = profiler_ab_first();
+    for (u32 k = 0; k < 2; k++)
+    {
+      u32 variant = first ^ k;
+      prof_ab_run_t run = profiler_ab_begin(__FILE__, name, __LINE__, variant);
+      if (run._index == PROFILER_NO_INDEX)
+      {
+        return;
+      }
+      variants[variant](data);
+      profiler_ab_end(&run);
+    }
+  }
+}
+
+bool profiler_ab_result(const char* name, prof_ab_result_t* out)
+{
+  prof_ab_slot_t* slot = _ab_find(name);
+  if (!slot)
+  {
+    memset(out, 0, sizeof(*out));
+    return false;
+  }
+  return _ab_result(slot, out);
+}
+
+void profiler_ab_clear(void)
+{
+  for (u32 i = 0; i < g_prof_ab_used; i++)
+  {
+    memset(g_prof_ab[i]._count, 0, sizeof(g_prof_ab[i]._count));
+  }
+}
@@ -0,0 +1,146 @@
+#include <perf/bench_env.h>
+
+#include <stdio.h>
+#include <string.h>
+
+static prof_bench_env_t        g_prof_env;
+static bool                    g_prof_env_valid = false;
+static platform_thread_state_t g_prof_env_saved;
+static bool                    g_prof_env_calibration = false;
+
+static void _env_penalty(prof_bench_env_t* env, u32 points, const char* reason)
+{
+  if (points == 0)
+  {
+    return;
+  }
+
+  env->_noise_score += points;
+
+  size_t used = strlen(env->_reasons);
+  snprintf(env->_reasons + used, sizeof(env->_reasons) - used, "%s%s", used ? ", " : "", reason);
+}
+
+static void _env_score(prof_bench_env_t* env)
+{
+  const platform_bench_env_t* platform = &env->_platform;
+
+  env->_noise_score = 0;
+  env->_reasons[0]  = '\0';
+
+  if (!env->_known)
+  {
+    _env_penalty(env, 25, "environment unknown");
+    return;
+  }
+
+  _env_penalty(env, env->_pinned ? 0 : 15, "not pinned");
+  _env_penalty(env, platform->isolated ? 0 : 5, "cpu not isolated");
+  _env_penalty(env, env->_priority_raised ? 0 : 5, "normal priority");
+  _env_penalty(env, platform->governor[0] && strcmp(platform->governor, "performance") != 0 ? 20 : 0, "governor not performance");
+  _env_penalty(env, platform->turbo == 1 ? 15 : 0, "turbo on");
+  _env_penalty(env, platform->thp == 2 ? 5 : 0, "thp always");
+  _env_penalty(env, platform->smt_siblings ? 5 + (u32)(platform->smt_sibling_busy * 20.0) : 0, "smt siblings online");
+
+  f64 load = platform->online_cpus ? platform->load_1m / (f64)platform->online_cpus : platform->load_1m;
+  _env_penalty(env, load > 0.05 ? (u32)(load > 1.0 ? 30.0 : load * 30.0) : 0, "system load");
+
+  if (env->_noise_score > 100)
+  {
+    env->_noise_score = 100;
+  }
+}
+
+static void _env_read(prof_bench_env_t* env, u32 cpu)
+{
+  env->_known = cpu != PLATFORM_CPU_NONE && impl_bench_env_read(cpu, &env->_platform);
+  _env_score(env);
+
+  g_prof_env       = *env;
+  g_prof_env_valid = true;
+}
+
+bool profiler_bench_env_enter(enum prof_env_policy policy, prof_bench_env_t* out)
+{
+  prof_bench_env_t env = {0};
+
+  impl_thread_save(&g_prof_env_saved);
+
+  u32 cpu = impl_bench_pick_cpu();
+  env._pinned          = cpu != PLATFORM_CPU_NONE && impl_thread_pin(cpu);
+  env._priority_raised = impl_thread_raise_priority();
+
+  _env_read(&env, env._pinned ? cpu : impl_thread_current_cpu());
+  if (out)
+  {
+    *out = env;
+  }
+
+  if (policy == pe_ignore || env._noise_score < PROFILER_NOISE_UNFIT)
+  {
+    return true;
+  }
+
+  log_println("benchmark environment is noisy: score {u32}/100 ({str})", env._noise_score, env._reasons);
+  if (policy == pe_refuse)
+  {
+    profiler_bench_env_leave();
+    return false;
+  }
+  return true;
+}
+
+void profiler_bench_env_leave(void)
+{
+  impl_thread_restore(&g_prof_env_saved);
+  g_prof_env_saved.saved = false;
+}
+
+void profiler_bench_env_measure(prof_bench_env_t* out)
+{
+  prof_bench_env_t env = {0};
+  _env_read(&env, impl_thread_current_cpu());
+  if (out)
+  {
+    *out = env;
+  }
+}
+
+void profiler_bench_env_set_calibration(bool enabled)
+{
+  g_prof_env_calibration = enabled;
+}
+
+bool profiler_bench_env_calibration(void)
+{
+  return g_prof_env_calibration;
+}
+
+const prof_bench_env_t* profiler_bench_env_last(void)
+{
+  return g_prof_env_valid ? &g_prof_env : NULL;
+}
+
+void profiler_bench_env_print(log_buffer_t* out, const prof_bench_env_t* env)
+{
+  log_buffer_println(out, "Environment noise score: {u32}/100{str}{str}", env->_noise_score,
+                     env->_reasons[0] ? " - " : "", env->_reasons);
+  if (!env->_known)
+  {
+    return;
+  }
+
+  static const char* thp_modes[] = { "never", "madvise", "always" };
+  const platform_bench_env_t* platform = &env->_platform;
+
+  log_buffer_println(out, "Environment: cpu {u32}{str}{str}, governor {str}, turbo {str}, thp {str}",
+                     platform->cpu,
+                     env->_pinned ? " pinned" : "",
+                     platform->isolated ? " isolated" : "",
+                     platform->governor[0] ? platform->governor : "unknown",
+                     platform->turbo < 0 ? "unknown" : platform->turbo ? "on" : "off",
+                     platform->thp < 0 ? "unknown" : thp_modes[platform->thp]);
+  log_buffer_println(out, "Environment: load {f64} on {u32} cpus, {u32} smt siblings {f64}% busy, priority {str}",
+                     platform->load_1m, platform->online_cpus, platform->smt_siblings,
+                     platform->smt_sibling_busy * 100.0, env->_priority_raised ? "raised" : "normal");
+}
@@ -0,0 +1,381 @@
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif
+
+#include <perf/events.h>
+#include <perf/thread.h>
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+enum prof_event_state
+{
+  pes_unknown,
+  pes_open,       // opened on at least one thread
+  pes_failed,
+};
+
+static const char* g_prof_event_names[pv_count] =
+{
+  "cycles",
+  "instructions",
+  "branch_misses",
+  "stalled_frontend",
+  "stalled_backend",
+  "dtlb_misses",
+  "itlb_misses",
+  "l1d_misses",
+  "llc_misses",
+  "page_faults",
+  "minor_faults",
+  "major_faults",
+  "context_switches",
+  "cpu_migrations",
+  "raw",
+};
+
+static prof_event_spec_t    g_prof_events[PROFILER_MAX_EVENTS];
+static u32                  g_prof_event_count = 0;
+static atomic_uint          g_prof_event_generation = 0;
+static atomic_uint          g_prof_event_state[PROFILER_MAX_EVENTS];
+static atomic_uint_fast64_t g_prof_event_stat[TOTAL_FUNCTIONS][PROFILER_MAX_EVENTS];
+
+const char* profiler_event_name(enum prof_event event)
+{
+  return event < pv_count ? g_prof_event_names[event] : "unknown";
+}
+
+u32 profiler_events_count(void)
+{
+  return g_prof_event_count;
+}
+
+const prof_event_spec_t* profiler_events_spec(u32 slot)
+{
+  return slot < g_prof_event_count ? &g_prof_events[slot] : NULL;
+}
+
+u32 profiler_events_active(void)
+{
+  return atomic_load_explicit(&g_prof_event_generation, memory_order_relaxed);
+}
+
+bool profiler_event_available(u32 slot)
+{
+  return slot < g_prof_event_count &&
+         atomic_load_explicit(&g_prof_event_state[slot], memory_order_relaxed) == pes_open;
+}
+
+u64 profiler_get_event_stat(_index index, u32 slot)
+{
+  if (index >= TOTAL_FUNCTIONS || slot >= PROFILER_MAX_EVENTS)
+  {
+    return 0;
+  }
+  return atomic_load_explicit(&g_prof_event_stat[index][slot], memory_order_relaxed);
+}
+
+void profiler_events_clear(void)
+{
+  for (u32 i = 0; i < TOTAL_FUNCTIONS; i++)
+  {
+    for (u32 e = 0; e < PROFILER_MAX_EVENTS; e++)
+    {
+      atomic_store_explicit(&g_prof_event_stat[i][e], 0, memory_order_relaxed);
+    }
+  }
+}
+
+#ifdef __linux__
+
+static bool _event_attr(const prof_event_spec_t* spec, struct perf_event_attr* attr)
+{
+  static const u64 cache_miss = (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+
+  memset(attr, 0, sizeof(*attr));
+  attr->size           = sizeof(*attr);
+  attr->exclude_kernel = 1;
+  attr->exclude_hv     = 1;
+
+  switch (spec->_event)
+  {
+    case pv_cycles:           attr->type = PERF_TYPE_HARDWARE; attr->config = PERF_COUNT_HW_CPU_CYCLES; break;
+    case pv_instructions:     attr->type = PERF_TYPE_HARDWARE; attr->config = PERF_COUNT_HW_INSTRUCTIONS; break;
+    case pv_branch_misses:    attr->type = PERF_TYPE_HARDWARE; attr->config = PERF_COUNT_HW_BRANCH_MISSES; break;
+    case pv_stalled_frontend: attr->type = PERF_TYPE_HARDWARE; attr->config = PERF_COUNT_HW_STALLED_CYCLES_FRONTEND; break;
+    case pv_stalled_backend:  attr->type = PERF_TYPE_HARDWARE; attr->config = PERF_COUNT_HW_STALLED_CYCLES_BACKEND; break;
+    case pv_dtlb_misses:      attr->type = PERF_TYPE_HW_CACHE; attr->config = PERF_COUNT_HW_CACHE_DTLB | cache_miss; break;
+    case pv_itlb_misses:      attr->type = PERF_TYPE_HW_CACHE; attr->config = PERF_COUNT_HW_CACHE_ITLB | cache_miss; break;
+    case pv_l1d_misses:       attr->type = PERF_TYPE_HW_CACHE; attr->config = PERF_COUNT_HW_CACHE_L1D | cache_miss; break;
+    case pv_llc_misses:       attr->type = PERF_TYPE_HW_CACHE; attr->config = PERF_COUNT_HW_CACHE_LL | cache_miss; break;
+    case pv_raw:              attr->type = spec->_pmu ? spec->_pmu : PERF_TYPE_RAW; attr->config = spec->_config; break;
+
+    // faults and switches happen in the kernel on behalf of the thread
+    case pv_page_faults:      attr->type = PERF_TYPE_SOFTWARE; attr->config = PERF_COUNT_SW_PAGE_FAULTS; attr->exclude_kernel = 0; break;
+    case pv_minor_faults:     attr->type = PERF_TYPE_SOFTWARE; attr->config = PERF_COUNT_SW_PAGE_FAULTS_MIN; attr->exclude_kernel = 0; break;
+    case pv_major_faults:     attr->type = PERF_TYPE_SOFTWARE; attr->config = PERF_COUNT_SW_PAGE_FAULTS_MAJ; attr->exclude_kernel = 0; break;
+    case pv_context_switches: attr->type = PERF_TYPE_SOFTWARE; attr->config = PERF_COUNT_SW_CONTEXT_SWITCHES; attr->exclude_kernel = 0; break;
+    case pv_cpu_migrations:   attr->type = PERF_TYPE_SOFTWARE; attr->config = PERF_COUNT_SW_CPU_MIGRATIONS; attr->exclude_kernel = 0; break;
+
+    default:
+      return false;
+  }
+  return true;
+}
+
+static s32 _event_open(struct perf_event_attr* attr, s32 group)
+{
+  attr->read_format = PERF_FORMAT_GROUP;
+  s32 fd = (s32)syscall(__NR_perf_event_open, attr, 0, -1, group, 0);
+  if (fd == -1 && !attr->exclude_kernel)
+  {
+    // perf_event_paranoid > 1 only allows user space counting
+    attr->exclude_kernel = 1;
+    fd = (s32)syscall(__NR_perf_event_open, attr, 0, -1, group, 0);
+  }
+  return fd;
+}
+
+static void _events_close(prof_thread_t* thread)
+{
+  for (u32 e = 0; e < PROFILER_MAX_EVENTS; e++)
+  {
+    if (thread->_event_fd[e] >= 0)
+    {
+      close(thread->_event_fd[e]);
+    }
+    thread->_event_fd[e] = -1;
+  }
+}
+
+static void _events_open(prof_thread_t* thread, u32 generation)
+{
+  if (thread->_event_generation != 0)
+  {
+    _events_close(thread);
+  }
+
+  s32 group = -1;
+  for (u32 e = 0; e < PROFILER_MAX_EVENTS; e++)
+  {
+    thread->_event_fd[e] = -1;
+    if (e >= g_prof_event_count)
+    {
+      continue;
+    }
+
+    struct perf_event_attr attr;
+    if (_event_attr(&g_prof_events[e], &attr))
+    {
+      thread->_event_fd[e] = _event_open(&attr, group);
+    }
+
+    u32 expected = pes_unknown;
+    if (thread->_event_fd[e] >= 0)
+    {
+      group = group == -1 ? thread->_event_fd[e] : group;
+      atomic_store_explicit(&g_prof_event_state[e], pes_open, memory_order_relaxed);
+    }
+    else
+    {
+      atomic_compare_exchange_strong(&g_prof_event_state[e], &expected, pes_failed);
+    }
+  }
+  thread->_event_generation = generation;
+}
+
+void profiler_events_sample(prof_thread_t* thread, u64* out)
+{
+  u32 generation = profiler_events_active();
+  if (UNLIKELY(thread->_event_generation != generation))
+  {
+    _events_open(thread, generation);
+  }
+
+  // group read: { nr, value per member in open order }
+  u64 values[PROFILER_MAX_EVENTS + 1] = {0};
+  s32 group = -1;
+  for (u32 e = 0; e < g_prof_event_count && group == -1; e++)
+  {
+    group = thread->_event_fd[e];
+  }
+  if (group == -1 || read(group, values, sizeof(values)) <= 0)
+  {
+    memset(out, 0, sizeof(u64) * PROFILER_MAX_EVENTS);
+    return;
+  }
+
+  u32 member = 1;
+  for (u32 e = 0; e < PROFILER_MAX_EVENTS; e++)
+  {
+    out[e] = e < g_prof_event_count && thread->_event_fd[e] >= 0 ? values[member++] : 0;
+  }
+}
+
+static void _events_next_generation(void)
+{
+  static u32 s_generation = 0;
+  s_generation = s_generation + 1 ? s_generation + 1 : 1;
+  atomic_store_explicit(&g_prof_event_generation, s_generation, memory_order_release);
+}
+
+bool profiler_events_select(const prof_event_spec_t* events, u32 count)
+{
+  if (count > PROFILER_MAX_EVENTS)
+  {
+    log_println("only {u32} perf events can be selected, got {u32}", (u32)PROFILER_MAX_EVENTS, count);
+    return false;
+  }
+  for (u32 e = 0; e < count; e++)
+  {
+    if (events[e]._event >= pv_count)
+    {
+      return false;
+    }
+  }
+
+  // stops the current set first so no thread samples a half written one
+  atomic_store_explicit(&g_prof_event_generation, 0, memory_order_release);
+  memcpy(g_prof_events, events, sizeof(prof_event_spec_t) * count);
+  g_prof_event_count = count;
+  for (u32 e = 0; e < PROFILER_MAX_EVENTS; e++)
+  {
+    atomic_store_explicit(&g_prof_event_state[e], pes_unknown, memory_order_relaxed);
+  }
+  profiler_events_clear();
+
+  if (count > 0)
+  {
+    _events_next_generation();
+  }
+  return true;
+}
+
+void profiler_events_reopen(void)
+{
+  if (profiler_events_active())
+  {
+    _events_next_generation();
+  }
+}
+
+void profiler_events_release(prof_thread_t* thread)
+{
+  if (thread->_event_generation != 0)
+  {
+    _events_close(thread);
+    thread->_event_generation = 0;
+  }
+}
+
+#else
+
+void profiler_events_sample(prof_thread_t* thread, u64* out)
+{
+  (void)thread;
+  memset(out, 0, sizeof(u64) * PROFILER_MAX_EVENTS);
+}
+
+bool profiler_events_select(const prof_event_spec_t* events, u32 count)
+{
+  (void)events;
+  return count == 0;
+}
+
+void profiler_events_reopen(void)
+{
+}
+
+void profiler_events_release(prof_thread_t* thread)
+{
+  (void)thread;
+}
+
+#endif // __linux__
+
+bool profiler_events_select_names(const char* list)
+{
+  prof_event_spec_t events[PROFILER_MAX_EVENTS];
+  u32 count = 0;
+
+  while (list && *list)
+  {
+    const char* end    = strchr(list, ',');
+    size_t      length = end ? (size_t)(end - list) : strlen(list);
+
+    if (length > 0)
+    {
+      if (count == PROFILER_MAX_EVENTS)
+      {
+        log_println("only {u32} perf events can be selected", (u32)PROFILER_MAX_EVENTS);
+        return false;
+      }
+
+      prof_event_spec_t spec = { pv_count, 0, 0 };
+      if (length > 4 && strncmp(list, "raw:", 4) == 0)
+      {
+        spec._event  = pv_raw;
+        spec._config = strtoull(list + 4, NULL, 16);
+      }
+      for (u32 e = 0; e < pv_raw && spec._event == pv_count; e++)
+      {
+        if (strlen(g_prof_event_names[e]) == length && strncmp(list, g_prof_event_names[e], length) == 0)
+        {
+          spec._event = e;
+        }
+      }
+      if (spec._event == pv_count)
+      {
+        log_println("unknown perf event in {str}", list);
+        return false;
+      }
+      events[count++] = spec;
+    }
+    list = end ? end + 1 : NULL;
+  }
+
+  return profiler_events_select(events, count);
+}
+
+void profiler_events_attribute(_index index, const u64* begin, const u64* end)
+{
+  if (index >= TOTAL_FUNCTIONS)
+  {
+    return;
+  }
+
+  for (u32 e = 0; e < g_prof_event_count; e++)
+  {
+    if (end[e] > begin[e])
+    {
+      atomic_fetch_add_explicit(&g_prof_event_stat[index][e], end[e] - begin[e], memory_order_relaxed);
+    }
+  }
+}
+
+void profiler_events_print(log_buffer_t* out, _index index)
+{
+  for (u32 e = 0; e < g_prof_event_count; e++)
+  {
+    const prof_event_spec_t* spec = &g_prof_events[e];
+    if (!profiler_event_available(e))
+    {
+      log_buffer_println(out, "Event {str}: unavailable", profiler_event_name(spec->_event));
+    }
+    else if (spec->_event == pv_raw)
+    {
+      log_buffer_println(out, "Event raw {u64}: {u64}", spec->_config, profiler_get_event_stat(index, e));
+    }
+    else
+    {
+      log_buffer_println(out, "Event {str}: {u64}", profiler_event_name(spec->_event), profiler_get_event_stat(index, e));
+    }
+  }
+}
@@ -0,0 +1,198 @@
+#include <perf/frame.h>
+#include <utils/log.h>
+
+#include <string.h>
+
+static prof_frame_stat_t      g_prof_frame_stat;
+static prof_frame_breakdown_t g_prof_frame_worst[PROFILER_WORST_FRAMES];
+static u32                    g_prof_frame_worst_count = 0;
+
+// self cycles and calls at the last mark, a frame is the difference. nested calls would
+// count twice with inclusive cycles
+static u64  g_prof_frame_last_cycles[TOTAL_FUNCTIONS];
+static u64  g_prof_frame_last_calls[TOTAL_FUNCTIONS];
+static u64  g_prof_frame_last_time   = 0;
+static u64  g_prof_frame_last_tsc    = 0;
+static bool g_prof_frame_started     = false;
+
+// functions and spans, the other kinds don't count cycles
+static bool _frame_tracked(_index index)
+{
+  u8 kind = profiler_get_stat_head(index)->_kind;
+  return kind == pk_function || kind == pk_span;
+}
+
+static void _frame_take_totals(void)
+{
+  _index count = profiler_get_function_count();
+  for (_index i = 0; i < count; i++)
+  {
+    g_prof_frame_last_cycles[i] = profiler_get_self_stat(i)->_cycles;
+    g_prof_frame_last_calls[i]  = profiler_get_call_stat(i)->_total_calls;
+  }
+}
+
+// slot the new frame would take in the worst list or PROFILER_WORST_FRAMES if it doesn't make it
+static u32 _frame_worst_slot(u64 time)
+{
+  if (g_prof_frame_worst_count < PROFILER_WORST_FRAMES)
+  {
+    return g_prof_frame_worst_count++;
+  }
+
+  u32 best = 0;
+  for (u32 i = 1; i < PROFILER_WORST_FRAMES; i++)
+  {
+    if (g_prof_frame_worst[i]._time < g_prof_frame_worst[best]._time)
+    {
+      best = i;
+    }
+  }
+  return g_prof_frame_worst[best]._time < time ? best : PROFILER_WORST_FRAMES;
+}
+
+void profiler_frame_mark(void)
+{
+  u64 now = get_nanoseconds();
+  u64 tsc = get_cycle_count_enhanced();
+
+  // spans keep their totals in per thread shards until collected
+  profiler_collect();
+
+  if (!g_prof_frame_started)
+  {
+    _frame_take_totals();
+    g_prof_frame_last_time = now;
+    g_prof_frame_last_tsc  = tsc;
+    g_prof_frame_started   = true;
+    return;
+  }
+
+  u64 time = now - g_prof_frame_last_time;
+  prof_frame_stat_t* stat = &g_prof_frame_stat;
+
+  stat->_total_time += time;
+  stat->_over_budget += stat->_budget && time > stat->_budget;
+  if (stat->_frames == 0 || time < stat->_min_time)
+  {
+    stat->_min_time = time;
+  }
+  if (time > stat->_max_time)
+  {
+    stat->_max_time = time;
+  }
+  profiler_hist_record(&stat->_hist, time);
+
+  u32 slot = _frame_worst_slot(time);
+  if (slot < PROFILER_WORST_FRAMES)
+  {
+    prof_frame_breakdown_t* frame = &g_prof_frame_worst[slot];
+    frame->_frame  = stat->_frames;
+    frame->_time   = time;
+    frame->_cycles = tsc - g_prof_frame_last_tsc;
+
+    memset(frame->_func_cycles, 0, sizeof(frame->_func_cycles));
+    memset(frame->_func_calls, 0, sizeof(frame->_func_calls));
+
+    _index count = profiler_get_function_count();
+    for (_index i = 0; i < count; i++)
+    {
+      if (_frame_tracked(i))
+      {
+        frame->_func_cycles[i] = profiler_get_self_stat(i)->_cycles - g_prof_frame_last_cycles[i];
+        frame->_func_calls[i]  = profiler_get_call_stat(i)->_total_calls - g_prof_frame_last_calls[i];
+      }
+    }
+  }
+
+  stat->_frames++;
+  _frame_take_totals();
+  g_prof_frame_last_time = now;
+  g_prof_frame_last_tsc  = tsc;
+}
+
+void profiler_frame_set_budget(u64 nanoseconds)
+{
+  g_prof_frame_stat._budget = nanoseconds;
+}
+
+const prof_frame_stat_t* profiler_frame_stat(void)
+{
+  return &g_prof_frame_stat;
+}
+
+const prof_frame_breakdown_t* profiler_frame_worst(u32 rank)
+{
+  if (rank >= g_prof_frame_worst_count)
+  {
+    return NULL;
+  }
+
+  // the list is unordered, pick the rank-th slowest
+  bool taken[PROFILER_WORST_FRAMES] = {0};
+  u32  pick = 0;
+  for (u32 r = 0; r <= rank; r++)
+  {
+    pick = PROFILER_WORST_FRAMES;
+    for (u32 i = 0; i < g_prof_frame_worst_count; i++)
+    {
+      if (!taken[i] && (pick == PROFILER_WORST_FRAMES || g_prof_frame_worst[i]._time > g_prof_frame_worst[pick]._time))
+      {
+        pick = i;
+      }
+    }
+    taken[pick] = true;
+  }
+  return &g_prof_frame_worst[pick];
+}
+
+void profiler_print_frames(void)
+{
+  log_buffer_t* out = log_report_buffer();
+  const prof_frame_stat_t* stat = &g_prof_frame_stat;
+
+  log_buffer_println(out, "Frames: {u64}", stat->_frames);
+  if (stat->_frames)
+  {
+    log_buffer_println(out, "Frame time ms: avg {f64}, min {f64}, max {f64}",
+                       (f64)stat->_total_time / (f64)stat->_frames / 1e6,
+                       (f64)stat->_min_time / 1e6, (f64)stat->_max_time / 1e6);
+    log_buffer_println(out, "Frame time ms: p50 {f64}, p90 {f64}, p99 {f64}",
+                       (f64)profiler_hist_percentile(&stat->_hist, 50.0) / 1e6,
+                       (f64)profiler_hist_percentile(&stat->_hist, 90.0) / 1e6,
+                       (f64)profiler_hist_percentile(&stat->_hist, 99.0) / 1e6);
+  }
+  if (stat->_budget)
+  {
+    log_buffer_println(out, "Budget {f64} ms, over budget: {u64}", (f64)stat->_budget / 1e6, stat->_over_budget);
+  }
+
+  for (u32 rank = 0; rank < g_prof_frame_worst_count; rank++)
+  {
+    const prof_frame_breakdown_t* frame = profiler_frame_worst(rank);
+    log_buffer_println(out, "Worst frame #{u32}: frame {u64}, {f64} ms, {u64} cycles",
+                       rank + 1, frame->_frame, (f64)frame->_time / 1e6, frame->_cycles);
+
+    for (_index i = 0; i < profiler_get_function_count(); i++)
+    {
+      if (frame->_func_calls[i] == 0)
+      {
+        continue;
+      }
+      log_buffer_println(out, "  {str}: calls {u64}, self cycles {u64} ({f64}%)",
+                         profiler_get_stat_head(i)->_func_name, frame->_func_calls[i], frame->_func_cycles[i],
+                         frame->_cycles ? 100.0 * (f64)frame->_func_cycles[i] / (f64)frame->_cycles : 0.0);
+    }
+  }
+  log_buffer_println(out, "------------------------------------------------------------");
+  log_buffer_flush(out);
+}
+
+void profiler_frame_clear(void)
+{
+  u64 budget = g_prof_frame_stat._budget;
+  memset(&g_prof_frame_stat, 0, sizeof(g_prof_frame_stat));
+  g_prof_frame_stat._budget = budget;
+  g_prof_frame_worst_count  = 0;
+  g_prof_frame_started      = false;
+}
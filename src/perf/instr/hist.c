@@ -0,0 +1,163 @@
+#include <perf/hist.h>
+
+static u32 _highest_bit(u64 value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  return 63u - (u32)__builtin_clzll(value);
+#else
+  u32 bit = 0;
+  while (value >>= 1)
+  {
+    bit++;
+  }
+  return bit;
+#endif
+}
+
+u32 profiler_hist_bucket(u64 value)
+{
+  if (value < (1u << PROF_HIST_SUB_BITS))
+  {
+    return (u32)value;
+  }
+
+  u32 exponent = _highest_bit(value);
+  u32 sub      = (u32)(value >> (exponent - PROF_HIST_SUB_BITS)) & ((1u << PROF_HIST_SUB_BITS) - 1);
+  u32 bucket   = ((exponent - 1) << PROF_HIST_SUB_BITS) + sub;
+
+  return bucket < PROF_HIST_BUCKETS ? bucket : PROF_HIST_BUCKETS - 1;
+}
+
+u64 profiler_hist_bucket_floor(u32 bucket)
+{
+  if (bucket < (1u << PROF_HIST_SUB_BITS))
+  {
+    return bucket;
+  }
+
+  u32 exponent = (bucket >> PROF_HIST_SUB_BITS) + 1;
+  u64 sub      = bucket & ((1u << PROF_HIST_SUB_BITS) - 1);
+
+  return ((1ull << PROF_HIST_SUB_BITS) + sub) << (exponent - PROF_HIST_SUB_BITS);
+}
+
+// _min is 0 before the first value, a recorded 0 shows in bucket 0 instead
+void profiler_hist_record(prof_hist_stat_t* hist, u64 value)
+{
+  hist->_buckets[profiler_hist_bucket(value)]++;
+  if (hist->_min == 0 || value < hist->_min)
+  {
+    hist->_min = value;
+  }
+  if (value > hist->_max)
+  {
+    hist->_max = value;
+  }
+}
+
+void profiler_hist_record_atomic(prof_hist_stat_t* hist, u64 value)
+{
+  __atomic_fetch_add(&hist->_buckets[profiler_hist_bucket(value)], 1, __ATOMIC_RELAXED);
+
+  u64 current = __atomic_load_n(&hist->_min, __ATOMIC_RELAXED);
+  while ((current == 0 || value < current) &&
+         !__atomic_compare_exchange_n(&hist->_min, &current, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+  {
+  }
+  current = __atomic_load_n(&hist->_max, __ATOMIC_RELAXED);
+  while (value > current &&
+         !__atomic_compare_exchange_n(&hist->_max, &current, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+  {
+  }
+}
+
+u64 profiler_hist_count(const prof_hist_stat_t* hist)
+{
+  u64 count = 0;
+  for (u32 i = 0; i < PROF_HIST_BUCKETS; i++)
+  {
+    count += hist->_buckets[i];
+  }
+  return count;
+}
+
+u64 profiler_hist_percentile(const prof_hist_stat_t* hist, f64 percentile)
+{
+  u64 count = profiler_hist_count(hist);
+  if (count == 0)
+  {
+    return 0;
+  }
+
+  if (percentile < 0.0)   percentile = 0.0;
+  if (percentile > 100.0) percentile = 100.0;
+
+  f64 target = (percentile / 100.0) * (f64)count;
+  u64 seen   = 0;
+
+  for (u32 i = 0; i < PROF_HIST_BUCKETS; i++)
+  {
+    u64 in_bucket = hist->_buckets[i];
+    if (in_bucket == 0)
+    {
+      continue;
+    }
+
+    if ((f64)(seen + in_bucket) >= target)
+    {
+      u64 low  = profiler_hist_bucket_floor(i);
+      u64 high = (i + 1 < PROF_HIST_BUCKETS) ? profiler_hist_bucket_floor(i + 1) : low * 2;
+      f64 frac = (target - (f64)seen) / (f64)in_bucket;
+
+      // the bucket can reach past the recorded values on either side
+      u64 value = low + (u64)(frac * (f64)(high - low));
+      u64 min   = hist->_buckets[0] ? 0 : hist->_min;
+      value     = value < min ? min : value;
+      return hist->_max && value > hist->_max ? hist->_max : value;
+    }
+    seen += in_bucket;
+  }
+
+  return hist->_max ? hist->_max : profiler_hist_bucket_floor(PROF_HIST_BUCKETS - 1);
+}
+
+void profiler_hist_delta(const prof_hist_stat_t* begin, const prof_hist_stat_t* end, prof_hist_stat_t* out)
+{
+  for (u32 i = 0; i < PROF_HIST_BUCKETS; i++)
+  {
+    u64 b = begin ? begin->_buckets[i] : 0;
+    out->_buckets[i] = end->_buckets[i] >= b ? end->_buckets[i] - b : 0;
+  }
+  out->_min = end->_min;
+  out->_max = end->_max;
+}
+
+void profiler_hist_merge(prof_hist_stat_t* into, const prof_hist_stat_t* from)
+{
+  for (u32 i = 0; i < PROF_HIST_BUCKETS; i++)
+  {
+    into->_buckets[i] += from->_buckets[i];
+  }
+  if (from->_min && (into->_min == 0 || from->_min < into->_min))
+  {
+    into->_min = from->_min;
+  }
+  if (from->_max > into->_max)
+  {
+    into->_max = from->_max;
+  }
+}
+
+f64 profiler_sqrt(f64 x)
+{
+  if (x <= 0.0)
+  {
+    return 0.0;
+  }
+  f64 r = x > 1.0 ? x : 1.0;
+  for (u32 i = 0; i < 64; i++)
+  {
+    r = 0.5 * (r + x / r);
+  }
+  return r;
+}
@@ -2,9 +2,20 @@
 #define _GNU_SOURCE
 #endif
 
+#include <perf/bench_env.h>
+#include <perf/clock.h>
+#include <perf/events.h>
+#include <perf/frame.h>
 #include <perf/instr.h>
+#include <perf/migration.h>
+#include <perf/offcpu.h>
+#include <perf/outlier.h>
+#include <perf/process.h>
+#include <perf/thread.h>
+#include <perf/topdown.h>
 #include <utils/log.h>
 
+#include <stdatomic.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -21,9 +32,16 @@ static prof_cpu_stat_t      g_prof_cpu_stat[TOTAL_FUNCTIONS];
 static prof_time_stat_t     g_prof_time_stat[TOTAL_FUNCTIONS];
 static prof_call_stat_t     g_prof_call_stat[TOTAL_FUNCTIONS];
 static prof_cache_stat_t    g_prof_cache_stat[TOTAL_FUNCTIONS];
+static prof_hist_stat_t     g_prof_hist_stat[TOTAL_FUNCTIONS];
+static prof_work_stat_t     g_prof_work_stat[TOTAL_FUNCTIONS];
+static prof_self_stat_t     g_prof_self_stat[TOTAL_FUNCTIONS];
 static _in_use              g_prof_in_use[TOTAL_FUNCTIONS];
 
 static _index               g_current_free_index = 0;
+static atomic_flag          g_prof_register_lock = ATOMIC_FLAG_INIT;
+static prof_print_fn        g_prof_printers[pk_count];
+static prof_collect_fn      g_prof_collectors[pk_count];
+static u64                  g_prof_start_time = 0;
 static cache_latency_profile_t g_cache_profile = {0};
 
 #ifdef __linux__
@@ -44,6 +62,7 @@ typedef struct
 
 
 static hw_perf_context_t g_hw_perf = {0};
+static bool              g_hw_perf_enabled = true;
 
 // Linux perf_event_open syscall wrapper
 static long perf_event_open(struct perf_event_attr *hw_event, pid_t pid,
@@ -54,6 +73,12 @@ static long perf_event_open(struct perf_event_attr *hw_event, pid_t pid,
 static bool init_hardware_performance_counters(void)
 {
     struct perf_event_attr pe = {0};
+
+    // counters this context has but never opens
+    g_hw_perf.l2_miss_fd   = -1;
+    g_hw_perf.l2_access_fd = -1;
+    g_hw_perf.l3_miss_fd   = -1;
+    g_hw_perf.l3_access_fd = -1;
     
     pe.type = PERF_TYPE_HW_CACHE;
     pe.size = sizeof(struct perf_event_attr);
@@ -191,6 +216,7 @@ static void disable_hw_counters(void)
 
 static void cleanup_hw_counters(void) {
     if (g_hw_perf.l1_miss_fd != -1) close(g_hw_perf.l1_miss_fd);
+    if (g_hw_perf.l1_access_fd != -1) close(g_hw_perf.l1_access_fd);
     if (g_hw_perf.l2_miss_fd != -1) close(g_hw_perf.l2_miss_fd);
     if (g_hw_perf.l3_miss_fd != -1) close(g_hw_perf.l3_miss_fd);
     if (g_hw_perf.llc_miss_fd != -1) close(g_hw_perf.llc_miss_fd);
@@ -271,6 +297,12 @@ void profiler_calibrate_cache_latency(void)
     }
     
     log_println("Starting cache latency calibration...");
+
+    // pinned, prioritized and scored so runs are comparable when asked for, restored at the end
+    if (profiler_bench_env_calibration())
+    {
+        profiler_bench_env_enter(pe_warn, NULL);
+    }
     
     // L1 cache test (typically 32KB)
     size_t l1_size = 16 * 1024;  // Conservative estimate
@@ -278,6 +310,7 @@ void profiler_calibrate_cache_latency(void)
     if (!l1_buffer) 
     {
         log_println("Failed to allocate L1 test buffer");
+        profiler_bench_env_leave();
         return;
     }
     
@@ -290,6 +323,7 @@ void profiler_calibrate_cache_latency(void)
     if (!l2_buffer)
     {
         log_println("Failed to allocate L2 test buffer");
+        profiler_bench_env_leave();
         return;
     }
     
@@ -302,6 +336,7 @@ void profiler_calibrate_cache_latency(void)
     if (!l3_buffer)
     {
         log_println("Failed to allocate L3 test buffer");
+        profiler_bench_env_leave();
         return;
     }
     
@@ -313,11 +348,14 @@ void profiler_calibrate_cache_latency(void)
     void* dram_buffer = malloc(dram_size);
     if (!dram_buffer) {
         log_println("Failed to allocate DRAM test buffer");
+        profiler_bench_env_leave();
         return;
     }
     
     g_cache_profile.dram_latency_cycles = measure_pointer_chase_latency(dram_buffer, dram_size, 1000);
     free(dram_buffer);
+
+    profiler_bench_env_leave();
     
     g_cache_profile.calibrated = true;
     
@@ -423,6 +461,7 @@ static void _handle_prof_add_event(enum prof_add type,_index index,uint64_t valu
   {
     case pa_cycles_total:
       g_prof_cpu_stat[index]._total_cycles += value;
+      profiler_hist_record(&g_prof_hist_stat[index], value);
       break;
 
     case pa_cycles_min:
@@ -475,7 +514,7 @@ static void _handle_prof_add_event(enum prof_add type,_index index,uint64_t valu
 
     case pa_cache_access:
 #ifdef __linux__
-      if (g_hw_perf.hw_counters_available) {
+      if (g_hw_perf.hw_counters_available && g_hw_perf_enabled) {
         _cache_hw_measurement(index);
       } else {
         _cache_cycle_estimation(index, value);
@@ -515,54 +554,224 @@ static uint64_t _handle_prof_output_event(enum prof_output type, _index index)
       g_prof_time_stat[index]._avg_time = ((f64) g_prof_time_stat[index]._total_time / (f64) g_prof_call_stat[index]._total_calls);
       return g_prof_time_stat[index]._avg_time;
 
+    case pa_cycles_p50:
+      return profiler_hist_percentile(&g_prof_hist_stat[index], 50.0);
+
+    case pa_cycles_p90:
+      return profiler_hist_percentile(&g_prof_hist_stat[index], 90.0);
+
+    case pa_cycles_p99:
+      return profiler_hist_percentile(&g_prof_hist_stat[index], 99.0);
+
     default: 
       log_println("unknown enum passed! {u64}", (uint64_t)type);
       return 0;
   }
 }
 
-static void _prof_print(_index index)
+static void _prof_print_alloc(log_buffer_t* out, _index index)
+{
+  prof_alloc_stat_t alloc;
+  profiler_alloc_stat(index, &alloc);
+
+  // only present when allocation tracking is linked in
+  if (alloc._allocs == 0 && alloc._frees == 0)
+  {
+    return;
+  }
+
+  log_buffer_println(out, "Allocations: {u64} ({u64} bytes)", alloc._allocs, alloc._bytes_allocated);
+  log_buffer_println(out, "Frees: {u64} ({u64} bytes)", alloc._frees, alloc._bytes_freed);
+  log_buffer_println(out, "Reallocs: {u64}", alloc._reallocs);
+  log_buffer_println(out, "Allocator cycles: {u64} alloc, {u64} free", alloc._alloc_cycles, alloc._free_cycles);
+}
+
+static void _prof_print_migration(log_buffer_t* out, _index index)
+{
+  static const char* modes[] = { "kept", "discarded", "separate" };
+
+  const prof_migration_stat_t* migration = profiler_get_migration_stat(index);
+  if (migration->_migrations)
+  {
+    log_buffer_println(out, "CPU migrations: {u64} ({str})", migration->_migrations, modes[profiler_migration_mode()]);
+    log_buffer_println(out, "Migrated cycles: {u64} (max {u64})", migration->_migrated_cycles, migration->_migrated_cycles_max);
+  }
+
+  // per cpu lines only once the function ran on more than one cpu
+  u32 cpus = 0;
+  for (u32 cpu = 0; cpu < PROFILER_MAX_CPUS && cpus < 2; cpu++)
+  {
+    cpus += profiler_get_cpu_breakdown(index, cpu)->_calls != 0;
+  }
+  if (cpus < 2)
+  {
+    return;
+  }
+
+  for (u32 cpu = 0; cpu < PROFILER_MAX_CPUS; cpu++)
+  {
+    const prof_cpu_breakdown_t* breakdown = profiler_get_cpu_breakdown(index, cpu);
+    if (breakdown->_calls)
+    {
+      log_buffer_println(out, "CPU {u32}: calls {u64}, average cycles {f64}",
+                         cpu, breakdown->_calls, (f64)breakdown->_cycles / (f64)breakdown->_calls);
+    }
+  }
+}
+
+static void _prof_print_imbalance(log_buffer_t* out, _index index)
+{
+  prof_imbalance_t imbalance;
+  if (!profiler_thread_imbalance(index, &imbalance) || imbalance._threads < 2)
+  {
+    return;
+  }
+
+  log_buffer_println(out, "Threads: {u32}", imbalance._threads);
+  log_buffer_println(out, "Thread imbalance max/mean: {f64}", imbalance._max_over_mean);
+  log_buffer_println(out, "Thread imbalance cv: {f64}", imbalance._cv);
+  log_buffer_println(out, "Slowest thread share: {f64}%", 100.0 * imbalance._slowest_share);
+}
+
+static void _prof_print_work(log_buffer_t* out, _index index)
 {
-  log_println("Index {u64}", g_prof_stat_head[index]._id);
-  log_println("File name: {str}",g_prof_stat_head[index]._file_name);
-  log_println("Function Name: {str}" , g_prof_stat_head[index]._func_name);
-  log_println("Line number: {u16}", g_prof_stat_head[index]._line);
+  const prof_work_stat_t* work = &g_prof_work_stat[index];
+  if (work->_calls == 0)
+  {
+    return;
+  }
 
-  log_println("Total Cycles: {u64} ", g_prof_cpu_stat[index]._total_cycles);
-  log_println("Minimum Cycles: {u64}", g_prof_cpu_stat[index]._cycles_min);
-  log_println("Maximum Cycles: {u64}", g_prof_cpu_stat[index]._cycles_max);
-  log_println("Average Cycles: {f64}", g_prof_cpu_stat[index]._avg_cycles);
+  f64 seconds = (f64)work->_time / 1e9;
+  log_buffer_println(out, "Calls with work: {u64}", work->_calls);
+  if (work->_bytes)
+  {
+    log_buffer_println(out, "Bytes processed: {u64}", work->_bytes);
+    log_buffer_println(out, "Cycles per byte: {f64} (min {f64}, max {f64})",
+                       (f64)work->_cycles / (f64)work->_bytes, work->_cycles_per_byte_min, work->_cycles_per_byte_max);
+    log_buffer_println(out, "Throughput GB/s: {f64}", seconds > 0.0 ? (f64)work->_bytes / seconds / 1e9 : 0.0);
+  }
+  if (work->_items)
+  {
+    log_buffer_println(out, "Items processed: {u64}", work->_items);
+    log_buffer_println(out, "Cycles per item: {f64} (min {f64}, max {f64})",
+                       (f64)work->_cycles / (f64)work->_items, work->_cycles_per_item_min, work->_cycles_per_item_max);
+    log_buffer_println(out, "Items per second: {f64}", seconds > 0.0 ? (f64)work->_items / seconds : 0.0);
+  }
+}
+
+static void _prof_print(log_buffer_t* out, _index index)
+{
+  log_buffer_println(out, "Index {u64}", g_prof_stat_head[index]._id);
+  log_buffer_println(out, "File name: {str}",g_prof_stat_head[index]._file_name);
+  log_buffer_println(out, "Function Name: {str}" , g_prof_stat_head[index]._func_name);
+  log_buffer_println(out, "Line number: {u16}", g_prof_stat_head[index]._line);
 
-  log_println("Total time: {f64}", g_prof_time_stat[index]._total_time);
-  log_println("Minimum time: {f64}", g_prof_time_stat[index]._min_time);
-  log_println("Maximum time: {f64}", g_prof_time_stat[index]._max_time);
-  log_println("Average time: {f64}", g_prof_time_stat[index]._avg_time);
+  u8 kind = g_prof_stat_head[index]._kind;
+  if (kind != pk_function && kind != pk_span)
+  {
+    if (kind < pk_count && g_prof_printers[kind])
+    {
+      g_prof_printers[kind](out, index);
+    }
+    log_buffer_println(out, "------------------------------------------------------------");
+    return;
+  }
 
-  log_println("Total calls: {u64}",g_prof_call_stat[index]._total_calls);
-  log_println("Total early condition exits: {u64}",g_prof_call_stat[index]._early_condition_return);
-  log_println("Failed returns: {u64}",g_prof_call_stat[index]._failed_return);
-  log_println("Successful returns {u64}",g_prof_call_stat[index]._successful_return);
+  log_buffer_println(out, "Total Cycles: {u64} ", g_prof_cpu_stat[index]._total_cycles);
+  log_buffer_println(out, "Minimum Cycles: {u64}", g_prof_cpu_stat[index]._cycles_min);
+  log_buffer_println(out, "Maximum Cycles: {u64}", g_prof_cpu_stat[index]._cycles_max);
+  log_buffer_println(out, "Average Cycles: {f64}", g_prof_cpu_stat[index]._avg_cycles);
+  log_buffer_println(out, "P50 Cycles: {u64}", profiler_hist_percentile(&g_prof_hist_stat[index], 50.0));
+  log_buffer_println(out, "P90 Cycles: {u64}", profiler_hist_percentile(&g_prof_hist_stat[index], 90.0));
+  log_buffer_println(out, "P99 Cycles: {u64}", profiler_hist_percentile(&g_prof_hist_stat[index], 99.0));
 
-  log_println("Total L1 Accesses: {u64}",g_prof_cache_stat[index]._l1_access_total);
-  log_println("Total L2 Accesses: {u64}",g_prof_cache_stat[index]._l2_access_total);
-  log_println("Total L3 Accesses: {u64}",g_prof_cache_stat[index]._l3_access_total);
-  log_println("Total DRAM Accesses: {u64}",g_prof_cache_stat[index]._dram_access_total);
+  log_buffer_println(out, "Total time: {f64}", g_prof_time_stat[index]._total_time);
+  log_buffer_println(out, "Minimum time: {f64}", g_prof_time_stat[index]._min_time);
+  log_buffer_println(out, "Maximum time: {f64}", g_prof_time_stat[index]._max_time);
+  log_buffer_println(out, "Average time: {f64}", g_prof_time_stat[index]._avg_time);
+  log_buffer_println(out, "Self cycles: {u64}", g_prof_self_stat[index]._cycles);
+  log_buffer_println(out, "Self time: {u64}", g_prof_self_stat[index]._time);
 
-  log_println("Total L1 Misses: {u64}",g_prof_cache_stat[index]._l1_misses);
-  log_println("Total L2 Misses: {u64}",g_prof_cache_stat[index]._l2_misses);
-  log_println("Total L3 Misses: {u64}",g_prof_cache_stat[index]._l3_misses);
+  log_buffer_println(out, "Total calls: {u64}",g_prof_call_stat[index]._total_calls);
+  log_buffer_println(out, "Total early condition exits: {u64}",g_prof_call_stat[index]._early_condition_return);
+  log_buffer_println(out, "Failed returns: {u64}",g_prof_call_stat[index]._failed_return);
+  log_buffer_println(out, "Successful returns {u64}",g_prof_call_stat[index]._successful_return);
 
-  log_println("------------------------------------------------------------");
+  log_buffer_println(out, "Total L1 Accesses: {u64}",g_prof_cache_stat[index]._l1_access_total);
+  log_buffer_println(out, "Total L2 Accesses: {u64}",g_prof_cache_stat[index]._l2_access_total);
+  log_buffer_println(out, "Total L3 Accesses: {u64}",g_prof_cache_stat[index]._l3_access_total);
+  log_buffer_println(out, "Total DRAM Accesses: {u64}",g_prof_cache_stat[index]._dram_access_total);
+
+  log_buffer_println(out, "Total L1 Misses: {u64}",g_prof_cache_stat[index]._l1_misses);
+  log_buffer_println(out, "Total L2 Misses: {u64}",g_prof_cache_stat[index]._l2_misses);
+  log_buffer_println(out, "Total L3 Misses: {u64}",g_prof_cache_stat[index]._l3_misses);
+
+  _prof_print_work(out, index);
+  _prof_print_migration(out, index);
+  _prof_print_alloc(out, index);
+  _prof_print_imbalance(out, index);
+  profiler_offcpu_print(out, index);
+  profiler_outlier_print(out, index);
+  profiler_events_print(out, index);
+  profiler_topdown_print(out, index);
+
+  if (kind == pk_span && g_prof_printers[pk_span])
+  {
+    g_prof_printers[pk_span](out, index);
+  }
+
+  log_buffer_println(out, "------------------------------------------------------------");
 }
 
 void profiler_init(void)
 {
-    memset(g_prof_stat_head, 0, sizeof(g_prof_stat_head));
+    // sites registered before init (C++ site descriptors, perf/instr.hpp) stay registered
     memset(g_prof_cpu_stat, 0, sizeof(g_prof_cpu_stat));
     memset(g_prof_time_stat, 0, sizeof(g_prof_time_stat));
     memset(g_prof_call_stat, 0, sizeof(g_prof_call_stat));
     memset(g_prof_cache_stat, 0, sizeof(g_prof_cache_stat));
-    memset(g_prof_in_use, 0, sizeof(g_prof_in_use));
+    memset(g_prof_hist_stat, 0, sizeof(g_prof_hist_stat));
+    memset(g_prof_work_stat, 0, sizeof(g_prof_work_stat));
+    memset(g_prof_self_stat, 0, sizeof(g_prof_self_stat));
+    profiler_migration_clear();
+    g_prof_start_time = get_nanoseconds();
+
+    const char* clock = getenv("TIER0_CLOCK");
+    if (clock && !profiler_clock_select_name(clock))
+    {
+        log_println("TIER0_CLOCK={str} is not available, keeping {str}", clock, profiler_clock_name(profiler_clock_current()));
+    }
+
+    const char* events = getenv("TIER0_PERF_EVENTS");
+    if (events && !profiler_events_select_names(events))
+    {
+        log_println("TIER0_PERF_EVENTS={str} could not be selected", events);
+    }
+
+    const char* offcpu = getenv("TIER0_OFFCPU");
+    if (offcpu && offcpu[0] == '1' && !profiler_offcpu_enable(true))
+    {
+        log_println("TIER0_OFFCPU=1 but thread cpu time can not be read here");
+    }
+
+    profiler_process_init();
+    const char* process_dir = getenv("TIER0_PROCESS_DIR");
+    if (process_dir && !profiler_process_enable(process_dir))
+    {
+        log_println("TIER0_PROCESS_DIR={str} can not be used", process_dir);
+    }
+
+    const char* bench_env = getenv("TIER0_BENCH_ENV");
+    if (bench_env && bench_env[0] == '1')
+    {
+        profiler_bench_env_set_calibration(true);
+    }
+
+    const char* topdown = getenv("TIER0_TOPDOWN");
+    if (topdown && topdown[0] == '1' && profiler_topdown_enable() == pt_unavailable)
+    {
+        log_println("top-down breakdown unavailable on this machine");
+    }
     
     // Initialize hardware performance counters if available
 #ifdef __linux__
@@ -597,15 +806,376 @@ void profiler_end(void)
 
 void profiler_print_all(void)
 {
+  profiler_collect();
+
+  log_buffer_t* out = log_report_buffer();
   for (_index i = 0; i < g_current_free_index; i++)
   {
-    _prof_print(i);
+    _prof_print(out, i);
+  }
+
+  prof_alloc_stat_t outside;
+  profiler_alloc_stat(PROFILER_UNATTRIBUTED, &outside);
+  if (outside._allocs != 0 || outside._frees != 0)
+  {
+    log_buffer_println(out, "Outside of profiled functions:");
+    _prof_print_alloc(out, PROFILER_UNATTRIBUTED);
+    log_buffer_println(out, "------------------------------------------------------------");
+  }
+
+  // the host now, not as it was at calibration
+  prof_bench_env_t env;
+  profiler_bench_env_measure(&env);
+  profiler_bench_env_print(out, &env);
+  log_buffer_flush(out);
+}
+
+void profiler_reset_stats(void)
+{
+  memset(g_prof_cpu_stat, 0, sizeof(g_prof_cpu_stat));
+  memset(g_prof_time_stat, 0, sizeof(g_prof_time_stat));
+  memset(g_prof_call_stat, 0, sizeof(g_prof_call_stat));
+  memset(g_prof_cache_stat, 0, sizeof(g_prof_cache_stat));
+  memset(g_prof_hist_stat, 0, sizeof(g_prof_hist_stat));
+  memset(g_prof_work_stat, 0, sizeof(g_prof_work_stat));
+  memset(g_prof_self_stat, 0, sizeof(g_prof_self_stat));
+  profiler_migration_clear();
+  profiler_events_clear();
+  profiler_thread_clear();
+  profiler_offcpu_clear();
+  profiler_frame_clear();
+  g_prof_start_time = get_nanoseconds();
+}
+
+void profiler_reset(void)
+{
+  profiler_reset_stats();
+  profiler_outlier_clear();
+
+  for (u32 kind = 0; kind < pk_count; kind++)
+  {
+    if (g_prof_collectors[kind])
+    {
+      g_prof_collectors[kind](true);
+    }
+  }
+}
+
+void profiler_snapshot(prof_snapshot_t* out)
+{
+  profiler_collect();
+
+  out->_timestamp = get_nanoseconds();
+  out->_count     = g_current_free_index;
+
+  memcpy(out->_cpu, g_prof_cpu_stat, sizeof(g_prof_cpu_stat));
+  memcpy(out->_time, g_prof_time_stat, sizeof(g_prof_time_stat));
+  memcpy(out->_call, g_prof_call_stat, sizeof(g_prof_call_stat));
+  memcpy(out->_cache, g_prof_cache_stat, sizeof(g_prof_cache_stat));
+  memcpy(out->_hist, g_prof_hist_stat, sizeof(g_prof_hist_stat));
+}
+
+static u64 _delta_u64(u64 begin, u64 end)
+{
+  return end >= begin ? end - begin : 0;
+}
+
+void profiler_snapshot_delta(const prof_snapshot_t* begin, const prof_snapshot_t* end, prof_snapshot_t* out)
+{
+  out->_timestamp = end->_timestamp;
+  out->_count     = end->_count;
+
+  for (_index i = 0; i < end->_count; i++)
+  {
+    // a function registered after `begin` has no baseline, count everything
+    bool has_begin = begin != NULL && i < begin->_count;
+
+    const prof_cpu_stat_t*   cpu_b   = has_begin ? &begin->_cpu[i]   : NULL;
+    const prof_time_stat_t*  time_b  = has_begin ? &begin->_time[i]  : NULL;
+    const prof_call_stat_t*  call_b  = has_begin ? &begin->_call[i]  : NULL;
+    const prof_cache_stat_t* cache_b = has_begin ? &begin->_cache[i] : NULL;
+
+    prof_cpu_stat_t*   cpu   = &out->_cpu[i];
+    prof_time_stat_t*  time  = &out->_time[i];
+    prof_call_stat_t*  call  = &out->_call[i];
+    prof_cache_stat_t* cache = &out->_cache[i];
+
+    profiler_hist_delta(has_begin ? &begin->_hist[i] : NULL, &end->_hist[i], &out->_hist[i]);
+
+    call->_total_calls            = _delta_u64(call_b ? call_b->_total_calls : 0, end->_call[i]._total_calls);
+    call->_early_condition_return = _delta_u64(call_b ? call_b->_early_condition_return : 0, end->_call[i]._early_condition_return);
+    call->_successful_return      = _delta_u64(call_b ? call_b->_successful_return : 0, end->_call[i]._successful_return);
+    call->_failed_return          = _delta_u64(call_b ? call_b->_failed_return : 0, end->_call[i]._failed_return);
+
+    cpu->_total_cycles = _delta_u64(cpu_b ? cpu_b->_total_cycles : 0, end->_cpu[i]._total_cycles);
+    time->_total_time  = end->_time[i]._total_time - (time_b ? time_b->_total_time : 0.0);
+
+    // cumulative min/max can't be subtracted, take them from the interval histogram
+    cpu->_cycles_min = profiler_hist_percentile(&out->_hist[i], 0.0);
+    cpu->_cycles_max = profiler_hist_percentile(&out->_hist[i], 100.0);
+
+    cpu->_avg_cycles = call->_total_calls ? (f64)cpu->_total_cycles / (f64)call->_total_calls : 0.0;
+    time->_avg_time  = call->_total_calls ? time->_total_time / (f64)call->_total_calls : 0.0;
+
+    f64 ns_per_cycle = cpu->_total_cycles ? time->_total_time / (f64)cpu->_total_cycles : 0.0;
+    time->_min_time  = (f64)cpu->_cycles_min * ns_per_cycle;
+    time->_max_time  = (f64)cpu->_cycles_max * ns_per_cycle;
+
+    cache->_l1_access_total   = _delta_u64(cache_b ? cache_b->_l1_access_total : 0, end->_cache[i]._l1_access_total);
+    cache->_l2_access_total   = _delta_u64(cache_b ? cache_b->_l2_access_total : 0, end->_cache[i]._l2_access_total);
+    cache->_l3_access_total   = _delta_u64(cache_b ? cache_b->_l3_access_total : 0, end->_cache[i]._l3_access_total);
+    cache->_dram_access_total = _delta_u64(cache_b ? cache_b->_dram_access_total : 0, end->_cache[i]._dram_access_total);
+    cache->_l1_misses         = _delta_u64(cache_b ? cache_b->_l1_misses : 0, end->_cache[i]._l1_misses);
+    cache->_l2_misses         = _delta_u64(cache_b ? cache_b->_l2_misses : 0, end->_cache[i]._l2_misses);
+    cache->_l3_misses         = _delta_u64(cache_b ? cache_b->_l3_misses : 0, end->_cache[i]._l3_misses);
+  }
+}
+
+const prof_stat_head_t* profiler_get_stat_head(_index index)
+{
+  if (index >= g_current_free_index)
+  {
+    return NULL;
+  }
+  return &g_prof_stat_head[index];
+}
+
+const prof_cpu_stat_t* profiler_get_cpu_stat(_index index)
+{
+  return index < TOTAL_FUNCTIONS ? &g_prof_cpu_stat[index] : NULL;
+}
+
+const prof_time_stat_t* profiler_get_time_stat(_index index)
+{
+  return index < TOTAL_FUNCTIONS ? &g_prof_time_stat[index] : NULL;
+}
+
+const prof_call_stat_t* profiler_get_call_stat(_index index)
+{
+  return index < TOTAL_FUNCTIONS ? &g_prof_call_stat[index] : NULL;
+}
+
+const prof_cache_stat_t* profiler_get_cache_stat(_index index)
+{
+  return index < TOTAL_FUNCTIONS ? &g_prof_cache_stat[index] : NULL;
+}
+
+const prof_hist_stat_t* profiler_get_hist_stat(_index index)
+{
+  return index < TOTAL_FUNCTIONS ? &g_prof_hist_stat[index] : NULL;
+}
+
+_index profiler_get_function_count(void)
+{
+  return g_current_free_index;
+}
+
+void profiler_add_work(_index index, u64 cycles, u64 time, u64 bytes, u64 items)
+{
+  if (index >= TOTAL_FUNCTIONS)
+  {
+    return;
+  }
+
+  prof_work_stat_t* work = &g_prof_work_stat[index];
+  bool first = work->_calls == 0;
+
+  if (bytes)
+  {
+    f64 per_byte = (f64)cycles / (f64)bytes;
+    if (first || work->_bytes == 0 || per_byte < work->_cycles_per_byte_min)
+    {
+      work->_cycles_per_byte_min = per_byte;
+    }
+    if (per_byte > work->_cycles_per_byte_max)
+    {
+      work->_cycles_per_byte_max = per_byte;
+    }
+  }
+  if (items)
+  {
+    f64 per_item = (f64)cycles / (f64)items;
+    if (first || work->_items == 0 || per_item < work->_cycles_per_item_min)
+    {
+      work->_cycles_per_item_min = per_item;
+    }
+    if (per_item > work->_cycles_per_item_max)
+    {
+      work->_cycles_per_item_max = per_item;
+    }
+  }
+
+  work->_bytes  += bytes;
+  work->_items  += items;
+  work->_cycles += cycles;
+  work->_time   += time;
+  work->_calls++;
+}
+
+const prof_work_stat_t* profiler_get_work_stat(_index index)
+{
+  return index < TOTAL_FUNCTIONS ? &g_prof_work_stat[index] : NULL;
+}
+
+void profiler_add_self(_index index, u64 cycles, u64 time)
+{
+  if (index >= TOTAL_FUNCTIONS)
+  {
+    return;
+  }
+
+  g_prof_self_stat[index]._cycles += cycles;
+  g_prof_self_stat[index]._time   += time;
+}
+
+const prof_self_stat_t* profiler_get_self_stat(_index index)
+{
+  return index < TOTAL_FUNCTIONS ? &g_prof_self_stat[index] : NULL;
+}
+
+bool profiler_hw_counters_available(void)
+{
+#ifdef __linux__
+  return g_hw_perf.hw_counters_available;
+#else
+  return false;
+#endif
+}
+
+void profiler_hw_counters_reopen(void)
+{
+#ifdef __linux__
+  // counters opened for pid 0 keep counting the thread that opened them, in a forked
+  // child that is the parent's thread
+  if (g_hw_perf.hw_counters_available)
+  {
+    cleanup_hw_counters();
+    memset(&g_hw_perf, 0, sizeof(g_hw_perf));
+    if (init_hardware_performance_counters())
+    {
+      enable_hw_counters();
+    }
+  }
+#endif
+}
+
+void profiler_hw_counters_set_enabled(bool enabled)
+{
+#ifdef __linux__
+  g_hw_perf_enabled = enabled;
+#else
+  (void)enabled;
+#endif
+}
+
+_index profiler_find_site(const char* name, enum prof_kind kind)
+{
+  for (_index i = 0; i < g_current_free_index; i++)
+  {
+    if (g_prof_in_use[i] && g_prof_stat_head[i]._kind == kind &&
+        strncmp(g_prof_stat_head[i]._func_name, name, sizeof(g_prof_stat_head[i]._func_name) - 1) == 0)
+    {
+      return i;
+    }
+  }
+  return (_index)-1;
+}
+
+u64 profiler_start_time(void)
+{
+  return g_prof_start_time;
+}
+
+void profiler_register_collector(enum prof_kind kind, prof_collect_fn collector)
+{
+  if (kind < pk_count)
+  {
+    g_prof_collectors[kind] = collector;
+  }
+}
+
+void profiler_collect(void)
+{
+  for (u32 kind = 0; kind < pk_count; kind++)
+  {
+    if (g_prof_collectors[kind])
+    {
+      g_prof_collectors[kind](false);
+    }
+  }
+}
+
+void profiler_store_calls(_index index, u64 count)
+{
+  if (index >= TOTAL_FUNCTIONS)
+  {
+    return;
+  }
+
+  g_prof_call_stat[index]._total_calls = count;
+}
+
+void profiler_store_timing(_index index, const prof_cpu_stat_t* cpu, const prof_time_stat_t* time,
+                           const prof_self_stat_t* self)
+{
+  if (index >= TOTAL_FUNCTIONS)
+  {
+    return;
+  }
+
+  u64 calls = g_prof_call_stat[index]._total_calls;
+  g_prof_cpu_stat[index]             = *cpu;
+  g_prof_cpu_stat[index]._avg_cycles = calls ? (f64)cpu->_total_cycles / (f64)calls : 0.0;
+  g_prof_time_stat[index]            = *time;
+  g_prof_time_stat[index]._avg_time  = calls ? time->_total_time / (f64)calls : 0.0;
+  g_prof_self_stat[index]            = *self;
+}
+
+void profiler_hist_add(_index index, u64 cycles)
+{
+  if (index < TOTAL_FUNCTIONS)
+  {
+    profiler_hist_record_atomic(&g_prof_hist_stat[index], cycles);
+  }
+}
+
+void profiler_drop_call(_index index)
+{
+  if (index >= TOTAL_FUNCTIONS || g_prof_call_stat[index]._total_calls == 0)
+  {
+    return;
+  }
+
+  g_prof_call_stat[index]._total_calls--;
+}
+
+void profiler_register_printer(enum prof_kind kind, prof_print_fn printer)
+{
+  if (kind < pk_count)
+  {
+    g_prof_printers[kind] = printer;
   }
 }
 
 uint64_t profiler_add_function(const char* file_name,const char* func_name,u16 line_number)
 {
+  return profiler_add_site(file_name, func_name, line_number, pk_function);
+}
+
+uint64_t profiler_add_site(const char* file_name,const char* func_name,u16 line_number,enum prof_kind kind)
+{
+  // functions can register from any thread
+  while (atomic_flag_test_and_set_explicit(&g_prof_register_lock, memory_order_acquire))
+  {
+  }
+
   _index assigned = _find_free_index();
+  if (assigned == (_index)-1)
+  {
+    atomic_flag_clear_explicit(&g_prof_register_lock, memory_order_release);
+    log_println("profiler is out of function slots, raise MAX_FUNCTIONS");
+    return PROFILER_NO_INDEX;
+  }
   g_prof_in_use[assigned] = true; // we mark the index as "in use" (true)
   
   g_prof_stat_head[assigned]._id = assigned;
@@ -617,16 +1187,44 @@ uint64_t profiler_add_function(const char* file_name,const char* func_name,u16 l
   g_prof_stat_head[assigned]._func_name[sizeof(g_prof_stat_head[assigned]._func_name) - 1] = '\0';
 
   g_prof_stat_head[assigned]._line = line_number;
+  g_prof_stat_head[assigned]._kind = (u8)kind;
 
+  atomic_flag_clear_explicit(&g_prof_register_lock, memory_order_release);
   return assigned;
 }
 
+void profiler_set_site_name(_index index, const char* file_name, const char* func_name)
+{
+  if (index >= TOTAL_FUNCTIONS || !g_prof_in_use[index])
+  {
+    return;
+  }
+
+  while (atomic_flag_test_and_set_explicit(&g_prof_register_lock, memory_order_acquire))
+  {
+  }
+
+  prof_stat_head_t* head = &g_prof_stat_head[index];
+  snprintf(head->_file_name, sizeof(head->_file_name), "%s", file_name);
+  snprintf(head->_func_name, sizeof(head->_func_name), "%s", func_name);
+
+  atomic_flag_clear_explicit(&g_prof_register_lock, memory_order_release);
+}
+
 void profiler_add(enum prof_add type,uint64_t value,_index index)
 {
+  if (UNLIKELY(index >= TOTAL_FUNCTIONS))
+  {
+    return;
+  }
   _handle_prof_add_event(type,index,value);
 }
 
 u64 profiler_output(enum prof_output type,_index index)
 {
+  if (index >= TOTAL_FUNCTIONS)
+  {
+    return 0;
+  }
   return _handle_prof_output_event(type,index);
 }
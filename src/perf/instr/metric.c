@@ -0,0 +1,170 @@
+#include <perf/metric.h>
+#include <perf/thread.h>
+#include <utils/log.h>
+
+#include <stdatomic.h>
+#include <string.h>
+
+// gauge histograms and last values are shared, updated with relaxed atomics
+static prof_hist_stat_t g_prof_gauge_hist[TOTAL_FUNCTIONS];
+static u64              g_prof_gauge_last[TOTAL_FUNCTIONS];
+
+static atomic_flag g_prof_metric_lock = ATOMIC_FLAG_INIT;
+
+static void _metric_print(log_buffer_t* out, _index index)
+{
+  prof_metric_t metric;
+  profiler_metric_read(index, &metric);
+
+  if (profiler_get_stat_head(index)->_kind == pk_counter)
+  {
+    log_buffer_println(out, "Counter total: {u64}", metric._sum);
+    log_buffer_println(out, "Updates: {u64}", metric._count);
+    log_buffer_println(out, "Rate per second: {f64}", metric._rate);
+    return;
+  }
+
+  const prof_hist_stat_t* hist = &g_prof_gauge_hist[index];
+  log_buffer_println(out, "Gauge samples: {u64}", metric._count);
+  log_buffer_println(out, "Last value: {u64}", metric._last);
+  log_buffer_println(out, "Minimum value: {u64}", metric._min);
+  log_buffer_println(out, "Maximum value: {u64}", metric._max);
+  log_buffer_println(out, "Average value: {f64}", metric._avg);
+  log_buffer_println(out, "P50 value: {u64}", profiler_hist_percentile(hist, 50.0));
+  log_buffer_println(out, "P99 value: {u64}", profiler_hist_percentile(hist, 99.0));
+}
+
+static void _metric_collect(bool reset)
+{
+  if (reset)
+  {
+    profiler_metric_clear();
+    return;
+  }
+
+  _index count = profiler_get_function_count();
+  for (_index i = 0; i < count; i++)
+  {
+    u8 kind = profiler_get_stat_head(i)->_kind;
+    if (kind != pk_counter && kind != pk_gauge)
+    {
+      continue;
+    }
+
+    // values aren't cycles, only the update count goes into the registry
+    prof_metric_t metric;
+    profiler_metric_read(i, &metric);
+    profiler_store_calls(i, metric._count);
+  }
+}
+
+static _index _metric_add(const char* file_name, const char* name, u16 line_number, enum prof_kind kind)
+{
+  profiler_register_printer(kind, _metric_print);
+  profiler_register_collector(kind, _metric_collect);
+
+  while (atomic_flag_test_and_set_explicit(&g_prof_metric_lock, memory_order_acquire))
+  {
+  }
+
+  _index index = profiler_find_site(name, kind);
+  if (index == (_index)-1)
+  {
+    index = profiler_add_site(file_name, name, line_number, kind);
+  }
+
+  atomic_flag_clear_explicit(&g_prof_metric_lock, memory_order_release);
+  return index;
+}
+
+_index profiler_add_counter(const char* file_name, const char* name, u16 line_number)
+{
+  return _metric_add(file_name, name, line_number, pk_counter);
+}
+
+_index profiler_add_gauge(const char* file_name, const char* name, u16 line_number)
+{
+  return _metric_add(file_name, name, line_number, pk_gauge);
+}
+
+static FORCE_INLINE void _shard_update(prof_metric_shard_t* shard, u64 value)
+{
+  if (shard->_count == 0 || value < shard->_min)
+  {
+    shard->_min = value;
+  }
+  if (value > shard->_max)
+  {
+    shard->_max = value;
+  }
+  shard->_sum += value;
+  shard->_count++;
+}
+
+void profiler_counter_add(_index index, u64 delta)
+{
+  prof_thread_t* thread = profiler_thread();
+  if (UNLIKELY(!thread || index >= TOTAL_FUNCTIONS))
+  {
+    return;
+  }
+  _shard_update(&thread->_metric[index], delta);
+}
+
+void profiler_gauge_sample(_index index, u64 value)
+{
+  prof_thread_t* thread = profiler_thread();
+  if (UNLIKELY(!thread || index >= TOTAL_FUNCTIONS))
+  {
+    return;
+  }
+  _shard_update(&thread->_metric[index], value);
+
+  __atomic_store_n(&g_prof_gauge_last[index], value, __ATOMIC_RELAXED);
+  profiler_hist_record_atomic(&g_prof_gauge_hist[index], value);
+}
+
+void profiler_metric_clear(void)
+{
+  for (prof_thread_t* thread = profiler_thread_first(); thread; thread = thread->_next)
+  {
+    memset(thread->_metric, 0, sizeof(thread->_metric));
+  }
+  memset(g_prof_gauge_hist, 0, sizeof(g_prof_gauge_hist));
+  memset(g_prof_gauge_last, 0, sizeof(g_prof_gauge_last));
+}
+
+void profiler_metric_read(_index index, prof_metric_t* out)
+{
+  *out = (prof_metric_t){0};
+  if (index >= TOTAL_FUNCTIONS)
+  {
+    return;
+  }
+
+  for (prof_thread_t* thread = profiler_thread_first(); thread; thread = thread->_next)
+  {
+    const prof_metric_shard_t* shard = &thread->_metric[index];
+    if (shard->_count == 0)
+    {
+      continue;
+    }
+
+    if (out->_count == 0 || shard->_min < out->_min)
+    {
+      out->_min = shard->_min;
+    }
+    if (shard->_max > out->_max)
+    {
+      out->_max = shard->_max;
+    }
+    out->_sum   += shard->_sum;
+    out->_count += shard->_count;
+  }
+
+  out->_last = __atomic_load_n(&g_prof_gauge_last[index], __ATOMIC_RELAXED);
+  out->_avg  = out->_count ? (f64)out->_sum / (f64)out->_count : 0.0;
+
+  u64 elapsed = get_nanoseconds() - profiler_start_time();
+  out->_rate  = elapsed ? (f64)out->_sum * 1e9 / (f64)elapsed : 0.0;
+}
@@ -0,0 +1,93 @@
+#include <perf/migration.h>
+#include <perf/thread.h>
+
+#include <string.h>
+
+static prof_migration_stat_t    g_prof_migration_stat[TOTAL_FUNCTIONS];
+static prof_cpu_breakdown_t     g_prof_cpu_breakdown[TOTAL_FUNCTIONS][PROFILER_MAX_CPUS];
+static enum prof_migration_mode g_prof_migration_mode = pm_keep;
+
+void profiler_migration_set_mode(enum prof_migration_mode mode)
+{
+  g_prof_migration_mode = mode;
+}
+
+enum prof_migration_mode profiler_migration_mode(void)
+{
+  return g_prof_migration_mode;
+}
+
+bool profiler_region_cpu(_index index, u32 start_cpu, u32 end_cpu, u64 cycles)
+{
+  if (UNLIKELY(index >= TOTAL_FUNCTIONS))
+  {
+    return true;
+  }
+
+  if (start_cpu == PROFILER_CPU_UNKNOWN || end_cpu == PROFILER_CPU_UNKNOWN)
+  {
+    g_prof_migration_stat[index]._unknown++;
+    return true;
+  }
+
+  if (LIKELY(start_cpu == end_cpu))
+  {
+    if (end_cpu < PROFILER_MAX_CPUS)
+    {
+      g_prof_cpu_breakdown[index][end_cpu]._calls++;
+      g_prof_cpu_breakdown[index][end_cpu]._cycles += cycles;
+    }
+    return true;
+  }
+
+  prof_migration_stat_t* stat = &g_prof_migration_stat[index];
+  stat->_migrations++;
+  if (g_prof_migration_mode != pm_discard)
+  {
+    stat->_migrated_cycles += cycles;
+    if (cycles > stat->_migrated_cycles_max)
+    {
+      stat->_migrated_cycles_max = cycles;
+    }
+  }
+  if (g_prof_migration_mode == pm_keep)
+  {
+    return true;
+  }
+
+  // the call leaves every other stat: its count here, the per thread, self, work,
+  // outlier and off-cpu stats when profiler_leave_work pops its frame
+  profiler_drop_call(index);
+  prof_thread_t* thread = profiler_thread();
+  if (thread)
+  {
+    thread->_drop_index = index;
+  }
+  return false;
+}
+
+const prof_migration_stat_t* profiler_get_migration_stat(_index index)
+{
+  return index < TOTAL_FUNCTIONS ? &g_prof_migration_stat[index] : NULL;
+}
+
+const prof_cpu_breakdown_t* profiler_get_cpu_breakdown(_index index, u32 cpu)
+{
+  return index < TOTAL_FUNCTIONS && cpu < PROFILER_MAX_CPUS ? &g_prof_cpu_breakdown[index][cpu] : NULL;
+}
+
+u64 profiler_migrations_total(void)
+{
+  u64 total = 0;
+  for (_index i = 0; i < TOTAL_FUNCTIONS; i++)
+  {
+    total += g_prof_migration_stat[i]._migrations;
+  }
+  return total;
+}
+
+void profiler_migration_clear(void)
+{
+  memset(g_prof_migration_stat, 0, sizeof(g_prof_migration_stat));
+  memset(g_prof_cpu_breakdown, 0, sizeof(g_prof_cpu_breakdown));
+}
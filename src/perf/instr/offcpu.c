@@ -0,0 +1,102 @@
+#include <perf/offcpu.h>
+#include <platform/platform.h>
+
+#include <stdatomic.h>
+#include <string.h>
+
+// sites end on any thread, counts are added with relaxed atomics
+static prof_offcpu_stat_t g_prof_offcpu_stat[TOTAL_FUNCTIONS];
+static atomic_bool        g_prof_offcpu_enabled = false;
+
+bool profiler_offcpu_enable(bool enable)
+{
+  platform_cpu_sample_t probe;
+  if (enable && !impl_thread_cpu_sample(&probe))
+  {
+    return false;
+  }
+  atomic_store_explicit(&g_prof_offcpu_enabled, enable, memory_order_relaxed);
+  return true;
+}
+
+bool profiler_offcpu_enabled(void)
+{
+  return atomic_load_explicit(&g_prof_offcpu_enabled, memory_order_relaxed);
+}
+
+bool profiler_offcpu_sample(prof_cpu_sample_t* out)
+{
+  platform_cpu_sample_t sample;
+  if (!impl_thread_cpu_sample(&sample))
+  {
+    return false;
+  }
+
+  out->_cpu_time    = sample.cpu_ns;
+  out->_voluntary   = sample.voluntary_switches;
+  out->_involuntary = sample.involuntary_switches;
+  return true;
+}
+
+static FORCE_INLINE void _offcpu_add(u64* target, u64 value)
+{
+  __atomic_fetch_add(target, value, __ATOMIC_RELAXED);
+}
+
+static FORCE_INLINE u64 _offcpu_load(const u64* source)
+{
+  return __atomic_load_n(source, __ATOMIC_RELAXED);
+}
+
+void profiler_offcpu_attribute(_index index, const prof_cpu_sample_t* begin, u64 wall_time)
+{
+  prof_cpu_sample_t end;
+  if (index >= TOTAL_FUNCTIONS || !profiler_offcpu_sample(&end))
+  {
+    return;
+  }
+
+  prof_offcpu_stat_t* stat = &g_prof_offcpu_stat[index];
+  u64 cpu_time = end._cpu_time > begin->_cpu_time ? end._cpu_time - begin->_cpu_time : 0;
+
+  _offcpu_add(&stat->_calls, 1);
+  _offcpu_add(&stat->_wall_time, wall_time);
+  // thread cpu time has a coarser clock than the wall time, never report more of it
+  _offcpu_add(&stat->_cpu_time, cpu_time < wall_time ? cpu_time : wall_time);
+  _offcpu_add(&stat->_voluntary, end._voluntary - begin->_voluntary);
+  _offcpu_add(&stat->_involuntary, end._involuntary - begin->_involuntary);
+}
+
+const prof_offcpu_stat_t* profiler_get_offcpu_stat(_index index)
+{
+  return index < TOTAL_FUNCTIONS ? &g_prof_offcpu_stat[index] : NULL;
+}
+
+void profiler_offcpu_print(log_buffer_t* out, _index index)
+{
+  if (index >= TOTAL_FUNCTIONS)
+  {
+    return;
+  }
+
+  const prof_offcpu_stat_t* stat = &g_prof_offcpu_stat[index];
+  u64 calls = _offcpu_load(&stat->_calls);
+  if (calls == 0)
+  {
+    return;
+  }
+
+  u64 wall = _offcpu_load(&stat->_wall_time);
+  u64 cpu  = _offcpu_load(&stat->_cpu_time);
+  f64 off  = wall ? 100.0 * (f64)(wall - cpu) / (f64)wall : 0.0;
+
+  log_buffer_println(out, "On-CPU time: {u64}", cpu);
+  log_buffer_println(out, "Off-CPU time: {u64} ({f64}% of wall time)", wall - cpu, off);
+  log_buffer_println(out, "Voluntary context switches: {u64}", _offcpu_load(&stat->_voluntary));
+  log_buffer_println(out, "Involuntary context switches: {u64}", _offcpu_load(&stat->_involuntary));
+}
+
+void profiler_offcpu_clear(void)
+{
+  memset(g_prof_offcpu_stat, 0, sizeof(g_prof_offcpu_stat));
+}
@@ -0,0 +1,228 @@
+#include <perf/outlier.h>
+#include <perf/thread.h>
+#include <platform/platform.h>
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+// frames of the capture itself: profiler_outlier_check and profiler_leave_work
+#define OUTLIER_SKIP_FRAMES 2
+
+// budgets are read at every END, set rarely
+static u64         g_prof_budget[TOTAL_FUNCTIONS];
+static u64         g_prof_budget_violations[TOTAL_FUNCTIONS];
+static atomic_bool g_prof_backtrace_ready = false;
+
+void profiler_set_budget(_index index, u64 ns)
+{
+  if (index >= TOTAL_FUNCTIONS)
+  {
+    return;
+  }
+
+  // the first backtrace() loads the unwinder and allocates, keep that out of the slow call
+  bool expected = false;
+  if (ns && atomic_compare_exchange_strong(&g_prof_backtrace_ready, &expected, true))
+  {
+    void* frames[1];
+    impl_backtrace(frames, 1, 0);
+  }
+  __atomic_store_n(&g_prof_budget[index], ns, __ATOMIC_RELAXED);
+}
+
+u64 profiler_get_budget(_index index)
+{
+  return index < TOTAL_FUNCTIONS ? __atomic_load_n(&g_prof_budget[index], __ATOMIC_RELAXED) : 0;
+}
+
+u64 profiler_budget_violations(_index index)
+{
+  return index < TOTAL_FUNCTIONS ? __atomic_load_n(&g_prof_budget_violations[index], __ATOMIC_RELAXED) : 0;
+}
+
+NO_INLINE void profiler_outlier_check(struct prof_thread_t* thread, _index index, u64 cycles, u64 time,
+                                      const u64* begin, const u64* end)
+{
+  if (index >= TOTAL_FUNCTIONS)
+  {
+    return;
+  }
+  u64 budget = __atomic_load_n(&g_prof_budget[index], __ATOMIC_RELAXED);
+  if (LIKELY(budget == 0 || time <= budget))
+  {
+    return;
+  }
+
+  __atomic_fetch_add(&g_prof_budget_violations[index], 1, __ATOMIC_RELAXED);
+
+  // only the owning thread writes its ring, readers retry on an odd or changed sequence
+  prof_outlier_t* record   = &thread->_outlier[thread->_outlier_count % PROFILER_OUTLIERS];
+  u64             sequence = __atomic_load_n(&record->_sequence, __ATOMIC_RELAXED);
+  __atomic_store_n(&record->_sequence, sequence + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+
+  record->_timestamp        = get_nanoseconds();
+  record->_duration         = time;
+  record->_cycles           = cycles;
+  record->_budget           = budget;
+  record->_index            = index;
+  record->_tid              = thread->_tid;
+  record->_cpu              = impl_thread_current_cpu();
+  record->_event_generation = begin ? profiler_events_active() : 0;
+  for (u32 e = 0; e < PROFILER_MAX_EVENTS; e++)
+  {
+    record->_events[e] = begin && e < profiler_events_count() ? end[e] - begin[e] : 0;
+  }
+  record->_frame_count = impl_backtrace(record->_frames, PROFILER_OUTLIER_FRAMES, OUTLIER_SKIP_FRAMES);
+
+  __atomic_store_n(&record->_sequence, sequence + 2, __ATOMIC_RELEASE);
+  __atomic_store_n(&thread->_outlier_count, thread->_outlier_count + 1, __ATOMIC_RELEASE);
+}
+
+static bool _outlier_copy(const prof_outlier_t* record, prof_outlier_t* out)
+{
+  u64 before = __atomic_load_n(&record->_sequence, __ATOMIC_ACQUIRE);
+  if (before == 0 || (before & 1))
+  {
+    return false;
+  }
+  memcpy(out, record, sizeof(*out));
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  return __atomic_load_n(&record->_sequence, __ATOMIC_RELAXED) == before;
+}
+
+u32 profiler_outliers(prof_outlier_t* out, u32 capacity)
+{
+  u32 copied = 0;
+  profiler_thread_lock();
+  for (prof_thread_t* thread = profiler_thread_first(); thread && copied < capacity; thread = thread->_next)
+  {
+    if (thread->_outlier_released)
+    {
+      continue;
+    }
+
+    u64 count = __atomic_load_n(&thread->_outlier_count, __ATOMIC_ACQUIRE);
+    u64 first = count > PROFILER_OUTLIERS ? count - PROFILER_OUTLIERS : 0;
+    for (u64 i = first; i < count && copied < capacity; i++)
+    {
+      // skipped when the thread overwrote it meanwhile
+      if (_outlier_copy(&thread->_outlier[i % PROFILER_OUTLIERS], &out[copied]))
+      {
+        copied++;
+      }
+    }
+  }
+  profiler_thread_unlock();
+  return copied;
+}
+
+static void _outlier_print_events(log_buffer_t* out, const prof_outlier_t* record)
+{
+  // deltas of an older event selection can't be named anymore
+  if (record->_event_generation == 0 || record->_event_generation != profiler_events_active())
+  {
+    return;
+  }
+
+  for (u32 e = 0; e < profiler_events_count(); e++)
+  {
+    const prof_event_spec_t* spec = profiler_events_spec(e);
+    if (spec->_event == pv_raw)
+    {
+      log_buffer_println(out, "  event raw {u64}: {u64}", spec->_config, record->_events[e]);
+    }
+    else
+    {
+      log_buffer_println(out, "  event {str}: {u64}", profiler_event_name(spec->_event), record->_events[e]);
+    }
+  }
+}
+
+void profiler_outliers_dump(void)
+{
+  log_buffer_t* out   = log_report_buffer();
+  u64           start = profiler_start_time();
+  u32           total = 0;
+
+  profiler_thread_lock();
+  for (prof_thread_t* thread = profiler_thread_first(); thread; thread = thread->_next)
+  {
+    if (thread->_outlier_released)
+    {
+      continue;
+    }
+
+    u64 count = __atomic_load_n(&thread->_outlier_count, __ATOMIC_ACQUIRE);
+    u64 first = count > PROFILER_OUTLIERS ? count - PROFILER_OUTLIERS : 0;
+    for (u64 i = first; i < count; i++)
+    {
+      prof_outlier_t record;
+      if (!_outlier_copy(&thread->_outlier[i % PROFILER_OUTLIERS], &record))
+      {
+        continue;
+      }
+
+      const prof_stat_head_t* head = profiler_get_stat_head(record._index);
+      log_buffer_println(out, "Outlier in {str}: {u64} ns over a {u64} ns budget, {u64} cycles",
+                         head ? head->_func_name : "?", record._duration, record._budget, record._cycles);
+      char thread_label[PROFILER_THREAD_NAME + 4] = "";
+      if (thread->_name[0])
+      {
+        snprintf(thread_label, sizeof(thread_label), " (%s)", thread->_name);
+      }
+      log_buffer_println(out, "  thread {u64}{str} on cpu {u32}, ended at +{f64} s", record._tid, thread_label,
+                         record._cpu, record._timestamp > start ? (f64)(record._timestamp - start) / 1e9 : 0.0);
+      _outlier_print_events(out, &record);
+
+      for (u32 f = 0; f < record._frame_count; f++)
+      {
+        // "module(symbol+offset) [address]", the address alone when it can't be named
+        char symbol[256];
+        if (!impl_backtrace_symbol(record._frames[f], symbol, sizeof(symbol)))
+        {
+          snprintf(symbol, sizeof(symbol), "[%p]", record._frames[f]);
+        }
+        log_buffer_println(out, "  #{u32} {str}", f, symbol);
+      }
+      total++;
+    }
+
+    if (count > PROFILER_OUTLIERS)
+    {
+      log_buffer_println(out, "thread {u64}: {u64} older outliers were overwritten", thread->_tid, count - PROFILER_OUTLIERS);
+    }
+  }
+  profiler_thread_unlock();
+
+  if (total == 0)
+  {
+    log_buffer_println(out, "No outliers recorded");
+  }
+  log_buffer_flush(out);
+}
+
+void profiler_outlier_print(log_buffer_t* out, _index index)
+{
+  u64 budget = profiler_get_budget(index);
+  if (budget)
+  {
+    log_buffer_println(out, "Latency budget: {u64} ns, {u64} calls over it", budget, profiler_budget_violations(index));
+  }
+}
+
+void profiler_outlier_clear(void)
+{
+  memset(g_prof_budget_violations, 0, sizeof(g_prof_budget_violations));
+  profiler_thread_lock();
+  for (prof_thread_t* thread = profiler_thread_first(); thread; thread = thread->_next)
+  {
+    __atomic_store_n(&thread->_outlier_count, 0, __ATOMIC_RELEASE);
+    if (!thread->_outlier_released)
+    {
+      memset(thread->_outlier, 0, sizeof(thread->_outlier));
+    }
+  }
+  profiler_thread_unlock();
+}
@@ -0,0 +1,140 @@
+#include <perf/phase.h>
+#include <utils/log.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+static prof_phase_t g_prof_phases[PROFILER_MAX_PHASES];
+static u32          g_prof_phase_count = 0;
+static bool         g_prof_phase_open  = false;
+
+void profiler_phase_begin(const char* name)
+{
+  if (g_prof_phase_open)
+  {
+    profiler_phase_end();
+  }
+
+  if (g_prof_phase_count >= PROFILER_MAX_PHASES)
+  {
+    log_println("phase limit reached, ignoring phase {str}", name);
+    return;
+  }
+
+  prof_snapshot_t* begin = malloc(sizeof(prof_snapshot_t));
+  if (!begin)
+  {
+    log_println("Failed to allocate phase snapshot");
+    return;
+  }
+
+  prof_phase_t* phase = &g_prof_phases[g_prof_phase_count];
+  memset(phase, 0, sizeof(*phase));
+
+  strncpy(phase->_name, name, sizeof(phase->_name) - 1);
+  phase->_name[sizeof(phase->_name) - 1] = '\0';
+
+  profiler_snapshot(begin);
+  phase->_stats      = begin;
+  phase->_start_time = begin->_timestamp;
+
+  g_prof_phase_count++;
+  g_prof_phase_open = true;
+}
+
+void profiler_phase_end(void)
+{
+  if (!g_prof_phase_open)
+  {
+    return;
+  }
+
+  prof_phase_t* phase = &g_prof_phases[g_prof_phase_count - 1];
+
+  prof_snapshot_t* end = malloc(sizeof(prof_snapshot_t));
+  if (!end)
+  {
+    log_println("Failed to allocate phase snapshot");
+    return;
+  }
+
+  profiler_snapshot(end);
+  profiler_snapshot_delta(phase->_stats, end, phase->_stats);
+  free(end);
+
+  phase->_end_time = phase->_stats->_timestamp;
+  phase->_closed   = true;
+
+  g_prof_phase_open = false;
+}
+
+const char* profiler_phase_current(void)
+{
+  if (!g_prof_phase_open)
+  {
+    return NULL;
+  }
+  return g_prof_phases[g_prof_phase_count - 1]._name;
+}
+
+u32 profiler_phase_count(void)
+{
+  return g_prof_phase_count;
+}
+
+const prof_phase_t* profiler_get_phase(u32 phase)
+{
+  if (phase >= g_prof_phase_count)
+  {
+    return NULL;
+  }
+  return &g_prof_phases[phase];
+}
+
+void profiler_print_phases(void)
+{
+  log_buffer_t* out = log_report_buffer();
+
+  for (u32 p = 0; p < g_prof_phase_count; p++)
+  {
+    const prof_phase_t* phase = &g_prof_phases[p];
+    if (!phase->_closed)
+    {
+      log_buffer_println(out, "Phase {str}: still running", phase->_name);
+      continue;
+    }
+
+    log_buffer_println(out, "Phase {str}: {f64} ms", phase->_name, (f64)(phase->_end_time - phase->_start_time) / 1e6);
+
+    const prof_snapshot_t* stats = phase->_stats;
+    for (_index i = 0; i < stats->_count; i++)
+    {
+      if (stats->_call[i]._total_calls == 0)
+      {
+        continue;
+      }
+
+      const prof_stat_head_t* head = profiler_get_stat_head(i);
+      log_buffer_println(out, "  {str}: calls {u64}, avg cycles {f64}, p50 {u64}, p99 {u64}, total time {f64}",
+                  head ? head->_func_name : "?",
+                  stats->_call[i]._total_calls,
+                  stats->_cpu[i]._avg_cycles,
+                  profiler_hist_percentile(&stats->_hist[i], 50.0),
+                  profiler_hist_percentile(&stats->_hist[i], 99.0),
+                  stats->_time[i]._total_time);
+    }
+  }
+  log_buffer_println(out, "------------------------------------------------------------");
+  log_buffer_flush(out);
+}
+
+void profiler_phase_clear(void)
+{
+  for (u32 p = 0; p < g_prof_phase_count; p++)
+  {
+    free(g_prof_phases[p]._stats);
+    g_prof_phases[p]._stats = NULL;
+  }
+  g_prof_phase_count = 0;
+  g_prof_phase_open  = false;
+}
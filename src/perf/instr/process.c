@@ -0,0 +1,322 @@
+#include <perf/events.h>
+#include <perf/lock.h>
+#include <perf/metric.h>
+#include <perf/process.h>
+#include <perf/timer.h>
+#include <perf/trace.h>
+#include <platform/platform.h>
+#include <utils/log.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static char                g_prof_process_dir[256];
+static bool                g_prof_process_enabled = false;
+static u32                 g_prof_process_run     = 0;  // inherited through fork
+
+// one dump is read or written at a time, merges fold into the caller's
+static prof_process_dump_t g_prof_process_scratch;
+static prof_process_dump_t g_prof_process_merged;
+
+// runs in the child of a fork: other threads of the parent may have held any lock, so
+// nothing here takes one
+static void _process_child(void)
+{
+  profiler_hw_counters_reopen();
+  profiler_events_reopen();
+  profiler_trace_forked();
+
+  // the parent reports what happened before the fork. the site, span and allocation
+  // shards go with the registry, metrics and locks are kept apart
+  if (g_prof_process_enabled)
+  {
+    profiler_reset_stats();
+    profiler_metric_clear();
+    profiler_lock_clear();
+  }
+}
+
+static void _process_exit(void)
+{
+  profiler_process_dump();
+}
+
+void profiler_process_init(void)
+{
+  static bool s_installed = false;
+  if (!s_installed)
+  {
+    s_installed = impl_process_on_fork(_process_child);
+  }
+}
+
+bool profiler_process_enable(const char* dir)
+{
+  static bool s_at_exit = false;
+  if (!dir || strlen(dir) >= sizeof(g_prof_process_dir))
+  {
+    return false;
+  }
+
+  profiler_process_init();
+  snprintf(g_prof_process_dir, sizeof(g_prof_process_dir), "%s", dir);
+  g_prof_process_enabled = true;
+
+  // never 0, which means no run
+  if (g_prof_process_run == 0)
+  {
+    u64 seed = get_nanoseconds() ^ ((u64)impl_process_id() << 32);
+    g_prof_process_run = (u32)(seed ^ (seed >> 32)) | 1;
+  }
+
+  if (!s_at_exit)
+  {
+    s_at_exit = atexit(_process_exit) == 0;
+  }
+  return true;
+}
+
+bool profiler_process_enabled(void)
+{
+  return g_prof_process_enabled;
+}
+
+void profiler_process_disable(void)
+{
+  g_prof_process_enabled = false;
+}
+
+u32 profiler_process_run(void)
+{
+  return g_prof_process_run;
+}
+
+void profiler_process_path(const char* dir, u32 pid, char* out, u32 size)
+{
+  snprintf(out, size, "%s/" PROFILER_PROCESS_PREFIX "%08x.%u.prof", dir, g_prof_process_run, pid);
+}
+
+// file name prefix of this run's dumps, of every dump without a run
+static void _process_prefix(char* out, u32 size)
+{
+  if (g_prof_process_run)
+  {
+    snprintf(out, size, PROFILER_PROCESS_PREFIX "%08x.", g_prof_process_run);
+  }
+  else
+  {
+    snprintf(out, size, PROFILER_PROCESS_PREFIX);
+  }
+}
+
+bool profiler_process_dump(void)
+{
+  if (!g_prof_process_enabled)
+  {
+    return false;
+  }
+
+  profiler_collect();
+
+  prof_process_dump_t* dump = &g_prof_process_scratch;
+  _index count = profiler_get_function_count();
+
+  memset(&dump->_header, 0, sizeof(dump->_header));
+  memcpy(dump->_header._magic, PROFILER_PROCESS_MAGIC, sizeof(dump->_header._magic));
+  dump->_header._version   = PROFILER_PROCESS_VERSION;
+  dump->_header._pid       = impl_process_id();
+  dump->_header._parent    = impl_process_parent_id();
+  dump->_header._sites     = (u32)count;
+  dump->_header._processes = 1;
+  dump->_header._run       = g_prof_process_run;
+  dump->_header._timestamp = get_nanoseconds() - profiler_start_time();
+
+  for (_index i = 0; i < count; i++)
+  {
+    prof_process_site_t* site = &dump->_sites[i];
+    site->_head = *profiler_get_stat_head(i);
+    site->_cpu  = *profiler_get_cpu_stat(i);
+    site->_time = *profiler_get_time_stat(i);
+    site->_call = *profiler_get_call_stat(i);
+    site->_self = *profiler_get_self_stat(i);
+    site->_hist = *profiler_get_hist_stat(i);
+  }
+
+  char path[320];
+  profiler_process_path(g_prof_process_dir, dump->_header._pid, path, sizeof(path));
+
+  FILE* file = fopen(path, "wb");
+  if (!file)
+  {
+    log_println("could not write {str}", path);
+    return false;
+  }
+  bool ok = fwrite(&dump->_header, sizeof(dump->_header), 1, file) == 1 &&
+            fwrite(dump->_sites, sizeof(prof_process_site_t), count, file) == count;
+  ok = fclose(file) == 0 && ok;
+  return ok;
+}
+
+bool profiler_process_load(const char* path, prof_process_dump_t* out)
+{
+  FILE* file = fopen(path, "rb");
+  if (!file)
+  {
+    return false;
+  }
+
+  bool ok = fread(&out->_header, sizeof(out->_header), 1, file) == 1 &&
+            memcmp(out->_header._magic, PROFILER_PROCESS_MAGIC, sizeof(out->_header._magic)) == 0 &&
+            out->_header._version == PROFILER_PROCESS_VERSION &&
+            out->_header._sites <= TOTAL_FUNCTIONS &&
+            fread(out->_sites, sizeof(prof_process_site_t), out->_header._sites, file) == out->_header._sites;
+  fclose(file);
+  return ok;
+}
+
+static bool _process_same_site(const prof_stat_head_t* a, const prof_stat_head_t* b)
+{
+  return a->_kind == b->_kind && a->_line == b->_line &&
+         strcmp(a->_func_name, b->_func_name) == 0 && strcmp(a->_file_name, b->_file_name) == 0;
+}
+
+static u64 _process_min(u64 a, u64 b)
+{
+  // 0 is "no sample yet" for the min stats
+  return a == 0 ? b : (b == 0 || a < b ? a : b);
+}
+
+static void _process_fold(prof_process_dump_t* into, const prof_process_dump_t* from)
+{
+  for (u32 s = 0; s < from->_header._sites; s++)
+  {
+    const prof_process_site_t* site = &from->_sites[s];
+
+    prof_process_site_t* target = NULL;
+    for (u32 t = 0; t < into->_header._sites && !target; t++)
+    {
+      target = _process_same_site(&into->_sites[t]._head, &site->_head) ? &into->_sites[t] : NULL;
+    }
+    if (!target)
+    {
+      if (into->_header._sites == TOTAL_FUNCTIONS)
+      {
+        continue;
+      }
+      target = &into->_sites[into->_header._sites];
+      memset(target, 0, sizeof(*target));
+      target->_head     = site->_head;
+      target->_head._id = into->_header._sites++;
+    }
+
+    target->_call._total_calls            += site->_call._total_calls;
+    target->_call._early_condition_return += site->_call._early_condition_return;
+    target->_call._successful_return      += site->_call._successful_return;
+    target->_call._failed_return          += site->_call._failed_return;
+
+    target->_cpu._total_cycles += site->_cpu._total_cycles;
+    target->_cpu._cycles_min    = _process_min(target->_cpu._cycles_min, site->_cpu._cycles_min);
+    target->_cpu._cycles_max    = site->_cpu._cycles_max > target->_cpu._cycles_max ? site->_cpu._cycles_max : target->_cpu._cycles_max;
+
+    target->_time._total_time += site->_time._total_time;
+    target->_time._min_time    = (f64)_process_min((u64)target->_time._min_time, (u64)site->_time._min_time);
+    target->_time._max_time    = site->_time._max_time > target->_time._max_time ? site->_time._max_time : target->_time._max_time;
+
+    target->_self._cycles += site->_self._cycles;
+    target->_self._time   += site->_self._time;
+    profiler_hist_merge(&target->_hist, &site->_hist);
+
+    u64 calls = target->_call._total_calls;
+    target->_cpu._avg_cycles = calls ? (f64)target->_cpu._total_cycles / (f64)calls : 0.0;
+    target->_time._avg_time  = calls ? target->_time._total_time / (f64)calls : 0.0;
+  }
+}
+
+static void _process_merge_file(const char* path, void* user)
+{
+  prof_process_dump_t* into = user;
+  if (!profiler_process_load(path, &g_prof_process_scratch))
+  {
+    log_println("skipping {str}, not a profiler dump", path);
+    return;
+  }
+
+  _process_fold(into, &g_prof_process_scratch);
+  into->_header._processes++;
+  if (g_prof_process_scratch._header._timestamp > into->_header._timestamp)
+  {
+    into->_header._timestamp = g_prof_process_scratch._header._timestamp;
+  }
+}
+
+bool profiler_process_merge(const char* dir, prof_process_dump_t* out)
+{
+  memset(&out->_header, 0, sizeof(out->_header));
+  memcpy(out->_header._magic, PROFILER_PROCESS_MAGIC, sizeof(out->_header._magic));
+  out->_header._version = PROFILER_PROCESS_VERSION;
+  out->_header._run     = g_prof_process_run;
+
+  char prefix[32];
+  _process_prefix(prefix, sizeof(prefix));
+  impl_dir_list(dir, prefix, _process_merge_file, out);
+  return out->_header._processes > 0;
+}
+
+void profiler_process_print(const prof_process_dump_t* dump)
+{
+  log_buffer_t* out = log_report_buffer();
+  if (dump->_header._pid)
+  {
+    log_buffer_println(out, "Process {u32} (parent {u32})", dump->_header._pid, dump->_header._parent);
+  }
+  else
+  {
+    log_buffer_println(out, "Merged {u32} processes", dump->_header._processes);
+  }
+  log_buffer_println(out, "------------------------------------------------------------");
+
+  for (u32 s = 0; s < dump->_header._sites; s++)
+  {
+    const prof_process_site_t* site = &dump->_sites[s];
+    if (site->_call._total_calls == 0)
+    {
+      continue;
+    }
+
+    log_buffer_println(out, "File name: {str}", site->_head._file_name);
+    log_buffer_println(out, "Function Name: {str}", site->_head._func_name);
+    log_buffer_println(out, "Line number: {u16}", site->_head._line);
+    log_buffer_println(out, "Total calls: {u64}", site->_call._total_calls);
+    log_buffer_println(out, "Total Cycles: {u64}", site->_cpu._total_cycles);
+    log_buffer_println(out, "Minimum Cycles: {u64}", site->_cpu._cycles_min);
+    log_buffer_println(out, "Maximum Cycles: {u64}", site->_cpu._cycles_max);
+    log_buffer_println(out, "Average Cycles: {f64}", site->_cpu._avg_cycles);
+    log_buffer_println(out, "P50 Cycles: {u64}", profiler_hist_percentile(&site->_hist, 50.0));
+    log_buffer_println(out, "P99 Cycles: {u64}", profiler_hist_percentile(&site->_hist, 99.0));
+    log_buffer_println(out, "Total time: {f64}", site->_time._total_time);
+    log_buffer_println(out, "Self cycles: {u64}", site->_self._cycles);
+    log_buffer_println(out, "------------------------------------------------------------");
+  }
+  log_buffer_flush(out);
+}
+
+static void _process_print_file(const char* path, void* user)
+{
+  (void)user;
+  if (profiler_process_load(path, &g_prof_process_scratch))
+  {
+    profiler_process_print(&g_prof_process_scratch);
+  }
+}
+
+void profiler_process_print_dir(const char* dir)
+{
+  char prefix[32];
+  _process_prefix(prefix, sizeof(prefix));
+  impl_dir_list(dir, prefix, _process_print_file, NULL);
+  if (profiler_process_merge(dir, &g_prof_process_merged))
+  {
+    profiler_process_print(&g_prof_process_merged);
+  }
+}
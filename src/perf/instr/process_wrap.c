@@ -0,0 +1,29 @@
+// _exit interposition for per process dumps (perf/process.h): forked workers often leave
+// through _exit() to skip the parent's atexit handlers, which is where the dump is written.
+//
+// opt in by linking with -Wl,--wrap=_exit,--wrap=_Exit (tier_0_process_tracking() in
+// config.lua). this object is only pulled out of the archive when those wraps are in effect.
+
+#include <perf/process.h>
+
+#if defined(__linux__)
+
+void __real__exit(int status) __attribute__((noreturn));
+void __real__Exit(int status) __attribute__((noreturn));
+
+void __wrap__exit(int status);
+void __wrap__Exit(int status);
+
+void __wrap__exit(int status)
+{
+  profiler_process_dump();
+  __real__exit(status);
+}
+
+void __wrap__Exit(int status)
+{
+  profiler_process_dump();
+  __real__Exit(status);
+}
+
+#endif
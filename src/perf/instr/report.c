@@ -0,0 +1,268 @@
+#include <perf/report.h>
+#include <perf/thread.h>
+#include <utils/log.h>
+
+#include <string.h>
+
+static const char* g_prof_sort_names[ps_count] =
+{
+  "total cycles",
+  "self cycles",
+  "time",
+  "calls",
+  "p99 cycles",
+  "cache misses",
+};
+
+static const char* g_prof_rollup_names[] =
+{
+  "site",
+  "file",
+  "module",
+};
+
+// scratch rows, every matching site or rollup sorted before a query takes its top rows
+static prof_report_row_t g_prof_report_rows[TOTAL_FUNCTIONS];
+
+const char* profiler_sort_name(enum prof_sort sort)
+{
+  return sort < ps_count ? g_prof_sort_names[sort] : "unknown";
+}
+
+void profiler_query_init(prof_query_t* query)
+{
+  memset(query, 0, sizeof(*query));
+  query->_sort   = ps_total_cycles;
+  query->_rollup = pr_site;
+}
+
+static bool _report_match(const prof_query_t* query, const prof_stat_head_t* head)
+{
+  u32 kinds = query->_kinds ? query->_kinds : PROFILER_KIND_MASK(pk_function) | PROFILER_KIND_MASK(pk_span);
+  if (!(kinds & PROFILER_KIND_MASK(head->_kind)))
+  {
+    return false;
+  }
+  if (query->_file && !strstr(head->_file_name, query->_file))
+  {
+    return false;
+  }
+  if (query->_function && !strstr(head->_func_name, query->_function))
+  {
+    return false;
+  }
+  return true;
+}
+
+// rollup key of a site: the file itself or everything before its last path separator
+static void _report_key(enum prof_rollup rollup, const char* file, char* key, size_t capacity)
+{
+  size_t length = strlen(file);
+  if (rollup == pr_module)
+  {
+    const char* slash = strrchr(file, '/');
+    const char* back  = strrchr(file, '\\');
+    if (back > slash)
+    {
+      slash = back;
+    }
+    length = slash ? (size_t)(slash - file) : 0;
+  }
+
+  if (length == 0)
+  {
+    length = rollup == pr_module ? 1 : 0;
+    file   = ".";
+  }
+  if (length >= capacity)
+  {
+    length = capacity - 1;
+  }
+  memcpy(key, file, length);
+  key[length] = '\0';
+}
+
+static u64 _report_value(const prof_report_row_t* row, enum prof_sort sort)
+{
+  switch (sort)
+  {
+    case ps_total_cycles: return row->_total_cycles;
+    case ps_self_cycles:  return row->_self_cycles;
+    case ps_time:         return row->_time;
+    case ps_calls:        return row->_calls;
+    case ps_p99_cycles:   return row->_p99_cycles;
+    case ps_cache_misses: return row->_cache_misses;
+    default:              return 0;
+  }
+}
+
+static void _report_add(prof_report_row_t* row, _index index)
+{
+  const prof_cpu_stat_t*   cpu   = profiler_get_cpu_stat(index);
+  const prof_time_stat_t*  time  = profiler_get_time_stat(index);
+  const prof_call_stat_t*  call  = profiler_get_call_stat(index);
+  const prof_cache_stat_t* cache = profiler_get_cache_stat(index);
+  const prof_self_stat_t*  self  = profiler_get_self_stat(index);
+
+  u64 p99 = profiler_hist_percentile(profiler_get_hist_stat(index), 99.0);
+
+  row->_sites++;
+  row->_calls        += call->_total_calls;
+  row->_total_cycles += cpu->_total_cycles;
+  row->_self_cycles  += self->_cycles;
+  row->_time         += (u64)time->_total_time;
+  row->_self_time    += self->_time;
+  row->_cache_misses += cache->_l1_misses + cache->_l2_misses + cache->_l3_misses;
+  if (p99 > row->_p99_cycles)
+  {
+    row->_p99_cycles = p99;
+  }
+}
+
+// fills g_prof_report_rows with every row of `query`, sorted, returns how many there are
+static u32 _report_rows(const prof_query_t* query)
+{
+  prof_report_row_t* rows     = g_prof_report_rows;
+  u32                capacity = TOTAL_FUNCTIONS;
+
+  profiler_collect();
+
+  // every timed site counts towards the total, filters only pick rows
+  _index count       = profiler_get_function_count();
+  u64    total_self  = 0;
+  u64    total_time  = 0;
+  for (_index i = 0; i < count; i++)
+  {
+    u8 kind = profiler_get_stat_head(i)->_kind;
+    if (kind == pk_function || kind == pk_span)
+    {
+      total_self += profiler_get_self_stat(i)->_time;
+      total_time += (u64)profiler_get_time_stat(i)->_total_time;
+    }
+  }
+  // sites that never nested report self == inclusive, without self data fall back to inclusive time
+  f64 profiled = (f64)(total_self ? total_self : total_time);
+
+  u32 used = 0;
+  for (_index i = 0; i < count; i++)
+  {
+    const prof_stat_head_t* head = profiler_get_stat_head(i);
+    if (!_report_match(query, head) || profiler_get_call_stat(i)->_total_calls == 0)
+    {
+      continue;
+    }
+
+    prof_report_row_t* row = NULL;
+    if (query->_rollup == pr_site)
+    {
+      if (used < capacity)
+      {
+        row = &rows[used++];
+        memset(row, 0, sizeof(*row));
+        row->_index = i;
+        row->_line  = head->_line;
+        strncpy(row->_name, head->_func_name, sizeof(row->_name) - 1);
+        memcpy(row->_file, head->_file_name, sizeof(row->_file));
+        row->_file[sizeof(row->_file) - 1] = '\0';
+      }
+    }
+    else
+    {
+      char key[sizeof(row->_name)];
+      _report_key(query->_rollup, head->_file_name, key, sizeof(key));
+      for (u32 r = 0; r < used && !row; r++)
+      {
+        row = strcmp(rows[r]._name, key) == 0 ? &rows[r] : NULL;
+      }
+      if (!row && used < capacity)
+      {
+        row = &rows[used++];
+        memset(row, 0, sizeof(*row));
+        row->_index = PROFILER_NO_INDEX;
+        memcpy(row->_name, key, sizeof(key));
+      }
+    }
+
+    if (row)
+    {
+      _report_add(row, i);
+    }
+  }
+
+  for (u32 r = 0; r < used; r++)
+  {
+    rows[r]._share      = profiled > 0.0 ? 100.0 * (f64)rows[r]._time / profiled : 0.0;
+    rows[r]._self_share = profiled > 0.0 ? 100.0 * (f64)rows[r]._self_time / profiled : 0.0;
+  }
+
+  // insertion sort, the registry holds at most TOTAL_FUNCTIONS rows
+  for (u32 r = 1; r < used; r++)
+  {
+    prof_report_row_t row = rows[r];
+    u64 value = _report_value(&row, query->_sort);
+    u32 j = r;
+    while (j > 0 && _report_value(&rows[j - 1], query->_sort) < value)
+    {
+      rows[j] = rows[j - 1];
+      j--;
+    }
+    rows[j] = row;
+  }
+
+  return query->_limit && query->_limit < used ? query->_limit : used;
+}
+
+u32 profiler_query(const prof_query_t* query, prof_report_row_t* rows, u32 capacity)
+{
+  prof_query_t defaults;
+  if (!query)
+  {
+    profiler_query_init(&defaults);
+    query = &defaults;
+  }
+
+  u32 count = _report_rows(query);
+  count = count < capacity ? count : capacity;
+  memcpy(rows, g_prof_report_rows, count * sizeof(*rows));
+  return count;
+}
+
+void profiler_print_report(const prof_query_t* query)
+{
+  prof_query_t defaults;
+  if (!query)
+  {
+    profiler_query_init(&defaults);
+    query = &defaults;
+  }
+
+  u32 rows = _report_rows(query);
+
+  log_buffer_t* out = log_report_buffer();
+  log_buffer_println(out, "Top {u32} by {str}, {str} rollup", rows, profiler_sort_name(query->_sort),
+                     query->_rollup <= pr_module ? g_prof_rollup_names[query->_rollup] : "unknown");
+  if (query->_file || query->_function)
+  {
+    log_buffer_println(out, "Filter: file \"{str}\" function \"{str}\"",
+                       query->_file ? query->_file : "", query->_function ? query->_function : "");
+  }
+
+  for (u32 r = 0; r < rows; r++)
+  {
+    const prof_report_row_t* row = &g_prof_report_rows[r];
+    if (row->_index != PROFILER_NO_INDEX)
+    {
+      log_buffer_println(out, "#{u32} {str} ({str}:{u16})", r + 1, row->_name, row->_file, row->_line);
+    }
+    else
+    {
+      log_buffer_println(out, "#{u32} {str} ({u32} sites)", r + 1, row->_name, row->_sites);
+    }
+    log_buffer_println(out, "  Share: {f64}% (self {f64}%)", row->_share, row->_self_share);
+    log_buffer_println(out, "  Calls: {u64} Cycles: {u64} Self cycles: {u64}", row->_calls, row->_total_cycles, row->_self_cycles);
+    log_buffer_println(out, "  Time: {u64} ns Self time: {u64} ns P99 cycles: {u64} Cache misses: {u64}",
+                       row->_time, row->_self_time, row->_p99_cycles, row->_cache_misses);
+  }
+  log_buffer_println(out, "------------------------------------------------------------");
+  log_buffer_flush(out);
+}
@@ -0,0 +1,331 @@
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <perf/series.h>
+#include <utils/log.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !PLATFORM_WINDOWS
+#include <pthread.h>
+#include <time.h>
+#endif
+
+typedef struct prof_series_state_t
+{
+  prof_series_interval_t* _ring;
+  u32                     _capacity;
+  u32                     _head;      // next slot to write
+  u32                     _count;
+
+  prof_snapshot_t*        _previous;
+  prof_snapshot_t*        _current;
+
+  u64                     _interval_ms;
+  volatile bool           _running;
+
+#if !PLATFORM_WINDOWS
+  pthread_t               _thread;
+  pthread_mutex_t         _lock;
+#endif
+} prof_series_state_t;
+
+static prof_series_state_t g_series = {
+  ._ring = NULL,
+#if !PLATFORM_WINDOWS
+  ._lock = PTHREAD_MUTEX_INITIALIZER,
+#endif
+};
+
+static void _series_lock(void)
+{
+#if !PLATFORM_WINDOWS
+  pthread_mutex_lock(&g_series._lock);
+#endif
+}
+
+static void _series_unlock(void)
+{
+#if !PLATFORM_WINDOWS
+  pthread_mutex_unlock(&g_series._lock);
+#endif
+}
+
+// everything since profiler_init() / the last profiler_reset() is the next interval
+static void _series_baseline_empty(void)
+{
+  g_series._previous->_timestamp = profiler_start_time();
+  g_series._previous->_count     = 0;
+}
+
+// (re)sizes the ring, a resized ring keeps its newest intervals
+static bool _series_alloc(u32 capacity)
+{
+  if (g_series._ring && g_series._capacity == capacity)
+  {
+    return true;
+  }
+
+  prof_series_interval_t* ring = calloc(capacity, sizeof(prof_series_interval_t));
+  if (!ring)
+  {
+    log_println("Failed to allocate time series storage");
+    return false;
+  }
+
+  if (g_series._ring)
+  {
+    u32 keep   = g_series._count < capacity ? g_series._count : capacity;
+    u32 oldest = (g_series._head + g_series._capacity - keep) % g_series._capacity;
+    for (u32 n = 0; n < keep; n++)
+    {
+      memcpy(&ring[n], &g_series._ring[(oldest + n) % g_series._capacity], sizeof(*ring));
+    }
+    free(g_series._ring);
+
+    g_series._ring     = ring;
+    g_series._capacity = capacity;
+    g_series._head     = keep % capacity;
+    g_series._count    = keep;
+    return true;
+  }
+
+  g_series._previous = malloc(sizeof(prof_snapshot_t));
+  g_series._current  = malloc(sizeof(prof_snapshot_t));
+  if (!g_series._previous || !g_series._current)
+  {
+    log_println("Failed to allocate time series storage");
+    free(ring);
+    free(g_series._previous);
+    free(g_series._current);
+    g_series._previous = NULL;
+    g_series._current = NULL;
+    return false;
+  }
+
+  g_series._ring     = ring;
+  g_series._capacity = capacity;
+  g_series._head     = 0;
+  g_series._count    = 0;
+
+  _series_baseline_empty();
+  return true;
+}
+
+// same clamp as snapshot deltas, a reset racing the sample can't wrap a counter
+static u64 _series_delta(u64 begin, u64 end)
+{
+  return end >= begin ? end - begin : 0;
+}
+
+void profiler_series_sample(void)
+{
+  _series_lock();
+
+  if (!g_series._ring && !_series_alloc(PROFILER_SERIES_DEFAULT_CAPACITY))
+  {
+    _series_unlock();
+    return;
+  }
+
+  profiler_snapshot(g_series._current);
+
+  // a profiler_reset() since the baseline restarted every counter from zero
+  if (profiler_start_time() > g_series._previous->_timestamp)
+  {
+    _series_baseline_empty();
+  }
+
+  prof_series_interval_t* interval = &g_series._ring[g_series._head];
+  const prof_snapshot_t*  prev     = g_series._previous;
+  const prof_snapshot_t*  cur      = g_series._current;
+
+  interval->_start_time = prev->_timestamp;
+  interval->_end_time   = cur->_timestamp;
+  interval->_count      = cur->_count;
+
+  const char* phase = profiler_phase_current();
+  strncpy(interval->_phase, phase ? phase : "", sizeof(interval->_phase) - 1);
+  interval->_phase[sizeof(interval->_phase) - 1] = '\0';
+
+  prof_hist_stat_t hist;
+  for (_index i = 0; i < cur->_count; i++)
+  {
+    bool has_prev = i < prev->_count;
+    prof_series_point_t* point = &interval->_points[i];
+
+    point->_calls  = _series_delta(has_prev ? prev->_call[i]._total_calls : 0, cur->_call[i]._total_calls);
+    point->_cycles = _series_delta(has_prev ? prev->_cpu[i]._total_cycles : 0, cur->_cpu[i]._total_cycles);
+
+    profiler_hist_delta(has_prev ? &prev->_hist[i] : NULL, &cur->_hist[i], &hist);
+    point->_cycles_p50 = profiler_hist_percentile(&hist, 50.0);
+    point->_cycles_p99 = profiler_hist_percentile(&hist, 99.0);
+  }
+
+  g_series._head = (g_series._head + 1) % g_series._capacity;
+  if (g_series._count < g_series._capacity)
+  {
+    g_series._count++;
+  }
+
+  // the current snapshot becomes the baseline of the next interval
+  prof_snapshot_t* swap = g_series._previous;
+  g_series._previous = g_series._current;
+  g_series._current  = swap;
+
+  _series_unlock();
+}
+
+#if !PLATFORM_WINDOWS
+static void* _series_thread(void* arg)
+{
+  (void)arg;
+
+  struct timespec interval = {
+    .tv_sec  = (time_t)(g_series._interval_ms / 1000),
+    .tv_nsec = (long)(g_series._interval_ms % 1000) * 1000000L,
+  };
+
+  while (g_series._running)
+  {
+    nanosleep(&interval, NULL);
+    if (!g_series._running)
+    {
+      break;
+    }
+    profiler_series_sample();
+  }
+  return NULL;
+}
+#endif
+
+bool profiler_series_start(u64 interval_ms, u32 capacity)
+{
+#if PLATFORM_WINDOWS
+  (void)interval_ms;
+  (void)capacity;
+  NOT_IMPLEMENTED_RETURN_VAL_DETAILED(false);
+#else
+  if (g_series._running)
+  {
+    return true;
+  }
+
+  // the first interval of the collector starts now
+  _series_lock();
+  bool allocated = _series_alloc(capacity ? capacity : PROFILER_SERIES_DEFAULT_CAPACITY);
+  if (allocated)
+  {
+    profiler_snapshot(g_series._previous);
+  }
+  _series_unlock();
+
+  if (!allocated)
+  {
+    return false;
+  }
+
+  g_series._interval_ms = interval_ms ? interval_ms : 1000;
+  g_series._running     = true;
+
+  if (pthread_create(&g_series._thread, NULL, _series_thread, NULL) != 0)
+  {
+    log_println("Failed to start the time series collector");
+    g_series._running = false;
+    return false;
+  }
+  return true;
+#endif
+}
+
+void profiler_series_stop(void)
+{
+#if !PLATFORM_WINDOWS
+  if (!g_series._running)
+  {
+    return;
+  }
+  g_series._running = false;
+  pthread_join(g_series._thread, NULL);
+#endif
+}
+
+u32 profiler_series_count(void)
+{
+  return g_series._count;
+}
+
+bool profiler_series_get(u32 interval, prof_series_interval_t* out)
+{
+  _series_lock();
+
+  if (interval >= g_series._count)
+  {
+    _series_unlock();
+    return false;
+  }
+
+  u32 oldest = (g_series._head + g_series._capacity - g_series._count) % g_series._capacity;
+  memcpy(out, &g_series._ring[(oldest + interval) % g_series._capacity], sizeof(*out));
+
+  _series_unlock();
+  return true;
+}
+
+bool profiler_series_export_csv(const char* path)
+{
+  FILE* file = fopen(path, "w");
+  if (!file)
+  {
+    log_println("Failed to open {str} for writing", path);
+    return false;
+  }
+
+  prof_series_interval_t* interval = malloc(sizeof(prof_series_interval_t));
+  if (!interval)
+  {
+    fclose(file);
+    return false;
+  }
+
+  fprintf(file, "interval,start_ns,end_ns,phase,index,function,calls,cycles,avg_cycles,p50_cycles,p99_cycles\n");
+
+  u32 count = profiler_series_count();
+  for (u32 n = 0; n < count; n++)
+  {
+    if (!profiler_series_get(n, interval))
+    {
+      break;
+    }
+
+    for (_index i = 0; i < interval->_count; i++)
+    {
+      const prof_series_point_t* point = &interval->_points[i];
+      if (point->_calls == 0)
+      {
+        continue;
+      }
+
+      const prof_stat_head_t* head = profiler_get_stat_head(i);
+      fprintf(file, "%u,%llu,%llu,%s,%llu,\"%s\",%llu,%llu,%.2f,%llu,%llu\n",
+              n,
+              (unsigned long long)interval->_start_time,
+              (unsigned long long)interval->_end_time,
+              interval->_phase,
+              (unsigned long long)i,
+              head ? head->_func_name : "?",
+              (unsigned long long)point->_calls,
+              (unsigned long long)point->_cycles,
+              (f64)point->_cycles / (f64)point->_calls,
+              (unsigned long long)point->_cycles_p50,
+              (unsigned long long)point->_cycles_p99);
+    }
+  }
+
+  free(interval);
+  fclose(file);
+  return true;
+}
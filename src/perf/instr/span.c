@@ -0,0 +1,229 @@
+#include <perf/span.h>
+#include <perf/thread.h>
+#include <utils/log.h>
+
+#include <stdatomic.h>
+#include <string.h>
+
+static prof_span_stat_t   g_prof_span_stat[TOTAL_FUNCTIONS];  // folded from the per thread shards
+static prof_span_record_t g_prof_span_records[PROFILER_SPAN_CAPACITY];
+static u64                g_prof_span_sequence[PROFILER_SPAN_CAPACITY];  // 2n + 1 while record n is written, 2n + 2 after
+
+static atomic_uint_fast64_t g_prof_span_next_id = 1;
+static atomic_uint_fast64_t g_prof_span_written = 0;
+
+// registration only, ending a span takes no lock: the thread that ends it owns the shard
+// and claims a ring slot with one atomic add
+static atomic_flag g_prof_span_lock = ATOMIC_FLAG_INIT;
+
+static_assert((PROFILER_SPAN_CAPACITY & (PROFILER_SPAN_CAPACITY - 1)) == 0, "PROFILER_SPAN_CAPACITY must be a power of two");
+
+static FORCE_INLINE void _span_lock(void)
+{
+  while (atomic_flag_test_and_set_explicit(&g_prof_span_lock, memory_order_acquire))
+  {
+  }
+}
+
+static FORCE_INLINE void _span_unlock(void)
+{
+  atomic_flag_clear_explicit(&g_prof_span_lock, memory_order_release);
+}
+
+// sums the shards of `index` into its span stat, and the timing into `cpu` / `time`
+static void _span_fold(_index index, prof_cpu_stat_t* cpu, prof_time_stat_t* time)
+{
+  prof_span_stat_t* stat = &g_prof_span_stat[index];
+  memset(stat, 0, sizeof(*stat));
+  memset(cpu, 0, sizeof(*cpu));
+  memset(time, 0, sizeof(*time));
+
+  for (prof_thread_t* thread = profiler_thread_first(); thread; thread = thread->_next)
+  {
+    const prof_span_shard_t* shard = &thread->_span[index];
+    if (shard->_ended == 0)
+    {
+      continue;
+    }
+
+    stat->_ended        += shard->_ended;
+    stat->_cross_thread += shard->_cross_thread;
+    stat->_children     += shard->_children;
+
+    cpu->_total_cycles += shard->_cycles;
+    cpu->_cycles_min    = cpu->_cycles_min == 0 || shard->_cycles_min < cpu->_cycles_min ? shard->_cycles_min : cpu->_cycles_min;
+    cpu->_cycles_max    = shard->_cycles_max > cpu->_cycles_max ? shard->_cycles_max : cpu->_cycles_max;
+    time->_total_time  += (f64)shard->_time;
+    time->_min_time     = time->_min_time == 0.0 || (f64)shard->_time_min < time->_min_time ? (f64)shard->_time_min : time->_min_time;
+    time->_max_time     = (f64)shard->_time_max > time->_max_time ? (f64)shard->_time_max : time->_max_time;
+  }
+}
+
+static void _span_collect(bool reset)
+{
+  if (reset)
+  {
+    // the shards are cleared with the per thread site stats
+    memset(g_prof_span_stat, 0, sizeof(g_prof_span_stat));
+    atomic_store_explicit(&g_prof_span_written, 0, memory_order_relaxed);
+    return;
+  }
+
+  _index count = profiler_get_function_count();
+  for (_index i = 0; i < count; i++)
+  {
+    if (profiler_get_stat_head(i)->_kind != pk_span)
+    {
+      continue;
+    }
+
+    // spans aren't on the frame stack, all of their time is their own
+    prof_cpu_stat_t  cpu;
+    prof_time_stat_t time;
+    _span_fold(i, &cpu, &time);
+    prof_self_stat_t self = { ._cycles = cpu._total_cycles, ._time = (u64)time._total_time };
+    profiler_store_calls(i, g_prof_span_stat[i]._ended);
+    profiler_store_timing(i, &cpu, &time, &self);
+  }
+}
+
+static FORCE_INLINE u64 _span_tid(void)
+{
+  prof_thread_t* thread = profiler_thread();
+  return thread ? thread->_tid : 0;
+}
+
+static void _span_print(log_buffer_t* out, _index index)
+{
+  const prof_span_stat_t* stat = &g_prof_span_stat[index];
+
+  log_buffer_println(out, "Spans ended: {u64}", stat->_ended);
+  log_buffer_println(out, "Ended on another thread: {u64}", stat->_cross_thread);
+  log_buffer_println(out, "Child spans: {u64}", stat->_children);
+}
+
+_index profiler_add_span_site(const char* file_name, const char* name, u16 line_number)
+{
+  profiler_register_printer(pk_span, _span_print);
+  profiler_register_collector(pk_span, _span_collect);
+
+  _span_lock();
+
+  _index index = profiler_find_site(name, pk_span);
+  if (index != (_index)-1)
+  {
+    _span_unlock();
+    return index;
+  }
+
+  index = profiler_add_site(file_name, name, line_number, pk_span);
+  _span_unlock();
+  return index;
+}
+
+prof_span_t profiler_span_begin(_index site, prof_span_t parent)
+{
+  prof_span_t span;
+  span._id           = atomic_fetch_add_explicit(&g_prof_span_next_id, 1, memory_order_relaxed);
+  span._parent       = parent._id;
+  span._index        = site;
+  span._begin_tid    = _span_tid();
+  span._begin_time   = get_nanoseconds();
+  span._begin_cycles = get_cycle_count_enhanced();
+  return span;
+}
+
+void profiler_span_end(prof_span_t span)
+{
+  u64 end_cycles = get_cycle_count_enhanced();
+  u64 end_time   = get_nanoseconds();
+
+  prof_thread_t* thread = profiler_thread();
+  if (span._id == 0 || span._index >= TOTAL_FUNCTIONS || !thread)
+  {
+    return;
+  }
+
+  u64 end_tid = thread->_tid;
+  u64 cycles  = end_cycles - span._begin_cycles;
+  u64 time    = end_time - span._begin_time;
+
+  prof_span_shard_t* shard = &thread->_span[span._index];
+  if (shard->_ended == 0 || cycles < shard->_cycles_min)
+  {
+    shard->_cycles_min = cycles;
+  }
+  if (shard->_ended == 0 || time < shard->_time_min)
+  {
+    shard->_time_min = time;
+  }
+  shard->_cycles_max    = cycles > shard->_cycles_max ? cycles : shard->_cycles_max;
+  shard->_time_max      = time > shard->_time_max ? time : shard->_time_max;
+  shard->_cycles       += cycles;
+  shard->_time         += time;
+  shard->_cross_thread += end_tid != span._begin_tid;
+  shard->_children     += span._parent != 0;
+  shard->_ended++;
+  profiler_hist_add(span._index, cycles);
+
+  // a slot is rewritten PROFILER_SPAN_CAPACITY ends later, readers check the sequence
+  u64 n    = atomic_fetch_add_explicit(&g_prof_span_written, 1, memory_order_relaxed);
+  u64 slot = n & (PROFILER_SPAN_CAPACITY - 1);
+  __atomic_store_n(&g_prof_span_sequence[slot], 2 * n + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  g_prof_span_records[slot] = (prof_span_record_t){
+    ._id         = span._id,
+    ._parent     = span._parent,
+    ._index      = span._index,
+    ._begin_time = span._begin_time,
+    ._end_time   = end_time,
+    ._begin_tid  = span._begin_tid,
+    ._end_tid    = end_tid,
+  };
+  __atomic_store_n(&g_prof_span_sequence[slot], 2 * n + 2, __ATOMIC_RELEASE);
+}
+
+const prof_span_stat_t* profiler_get_span_stat(_index index)
+{
+  if (index >= TOTAL_FUNCTIONS)
+  {
+    return NULL;
+  }
+
+  prof_cpu_stat_t  cpu;
+  prof_time_stat_t time;
+  _span_fold(index, &cpu, &time);
+  return &g_prof_span_stat[index];
+}
+
+u32 profiler_span_records(prof_span_record_t* out, u32 capacity)
+{
+  u64 written   = atomic_load_explicit(&g_prof_span_written, memory_order_acquire);
+  u64 available = written < PROFILER_SPAN_CAPACITY ? written : PROFILER_SPAN_CAPACITY;
+  u64 count     = available < capacity ? available : capacity;
+  u64 first     = written - count;
+
+  // records still being written or already overwritten are skipped
+  u32 copied = 0;
+  for (u64 n = first; n < written; n++)
+  {
+    u64 slot = n & (PROFILER_SPAN_CAPACITY - 1);
+    if (__atomic_load_n(&g_prof_span_sequence[slot], __ATOMIC_ACQUIRE) != 2 * n + 2)
+    {
+      continue;
+    }
+    out[copied] = g_prof_span_records[slot];
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    copied += __atomic_load_n(&g_prof_span_sequence[slot], __ATOMIC_RELAXED) == 2 * n + 2;
+  }
+  return copied;
+}
+
+void profiler_span_clear(void)
+{
+  for (prof_thread_t* thread = profiler_thread_first(); thread; thread = thread->_next)
+  {
+    memset(thread->_span, 0, sizeof(thread->_span));
+  }
+  _span_collect(true);
+}
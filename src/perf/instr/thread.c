@@ -0,0 +1,394 @@
+#include <perf/thread.h>
+#include <perf/trace.h>
+#include <platform/platform.h>
+#include <utils/log.h>
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <string.h>
+
+#if !PLATFORM_WINDOWS
+#include <pthread.h>
+#endif
+
+static _Atomic(prof_thread_t*) g_prof_threads = NULL;
+static atomic_uint             g_prof_thread_count = 0;
+static atomic_flag             g_prof_thread_lock = ATOMIC_FLAG_INIT;
+
+static THREAD_LOCAL prof_thread_t* t_prof_thread = NULL;
+static THREAD_LOCAL bool           t_prof_thread_exited = false;
+
+void profiler_thread_lock(void)
+{
+  while (atomic_flag_test_and_set_explicit(&g_prof_thread_lock, memory_order_acquire))
+  {
+  }
+}
+
+void profiler_thread_unlock(void)
+{
+  atomic_flag_clear_explicit(&g_prof_thread_lock, memory_order_release);
+}
+
+#if !PLATFORM_WINDOWS
+
+static pthread_key_t  g_prof_thread_key;
+static pthread_once_t g_prof_thread_key_once = PTHREAD_ONCE_INIT;
+
+// thread exit: the stats stay in the list, the call stack, trace buffer and perf event fds
+// are released, the outlier ring too when nothing was recorded into it. later calls on this
+// thread (other key destructors) aren't recorded
+static void _thread_exit(void* data)
+{
+  prof_thread_t* thread = data;
+  t_prof_thread        = NULL;
+  t_prof_thread_exited = true;
+
+  profiler_trace_release(thread);
+  profiler_events_release(thread);
+
+  profiler_thread_lock();
+  thread->_outlier_released = __atomic_load_n(&thread->_outlier_count, __ATOMIC_RELAXED) == 0;
+  profiler_thread_unlock();
+
+  void* release = thread->_outlier_released ? (void*)thread->_outlier : (void*)thread->_stack;
+  impl_mem_unmap(release, (size_t)((u8*)thread + sizeof(prof_thread_t) - (u8*)release));
+}
+
+static void _thread_key_create(void)
+{
+  pthread_key_create(&g_prof_thread_key, _thread_exit);
+}
+
+#endif
+
+static NO_INLINE prof_thread_t* _thread_create(void)
+{
+  if (t_prof_thread_exited)
+  {
+    return NULL;
+  }
+
+  prof_thread_t* thread = impl_mem_map(sizeof(prof_thread_t));
+  if (!thread)
+  {
+    return NULL;
+  }
+
+  thread->_tid        = impl_thread_id();
+  thread->_slot       = atomic_fetch_add_explicit(&g_prof_thread_count, 1, memory_order_relaxed);
+  thread->_drop_index = PROFILER_NO_INDEX;
+
+  prof_thread_t* head = atomic_load_explicit(&g_prof_threads, memory_order_relaxed);
+  do
+  {
+    thread->_next = head;
+  } while (!atomic_compare_exchange_weak_explicit(&g_prof_threads, &head, thread,
+                                                  memory_order_release, memory_order_relaxed));
+
+  t_prof_thread = thread;
+
+#if !PLATFORM_WINDOWS
+  pthread_once(&g_prof_thread_key_once, _thread_key_create);
+  pthread_setspecific(g_prof_thread_key, thread);
+#endif
+  return thread;
+}
+
+prof_thread_t* profiler_thread(void)
+{
+  prof_thread_t* thread = t_prof_thread;
+  if (LIKELY(thread != NULL))
+  {
+    return thread;
+  }
+  return _thread_create();
+}
+
+prof_thread_t* profiler_thread_first(void)
+{
+  return atomic_load_explicit(&g_prof_threads, memory_order_acquire);
+}
+
+u32 profiler_thread_count(void)
+{
+  return atomic_load_explicit(&g_prof_thread_count, memory_order_relaxed);
+}
+
+void profiler_enter(_index index)
+{
+  prof_thread_t* thread = profiler_thread();
+  if (UNLIKELY(!thread || index >= TOTAL_FUNCTIONS))
+  {
+    return;
+  }
+
+  // frames past the max depth are only counted so enter/leave stay balanced
+  if (LIKELY(thread->_depth < PROFILER_MAX_DEPTH))
+  {
+    prof_frame_t* frame = &thread->_stack[thread->_depth];
+    frame->_index            = index;
+    frame->_bytes            = 0;
+    frame->_items            = 0;
+    frame->_child_cycles     = 0;
+    frame->_child_time       = 0;
+    frame->_event_generation = profiler_events_active();
+    if (UNLIKELY(frame->_event_generation))
+    {
+      profiler_events_sample(thread, frame->_events);
+    }
+    frame->_offcpu = UNLIKELY(profiler_offcpu_enabled()) && profiler_offcpu_sample(&frame->_cpu);
+  }
+  thread->_depth++;
+
+  if (UNLIKELY(profiler_trace_active()))
+  {
+    profiler_trace_enter(thread, index);
+  }
+}
+
+void profiler_leave(_index index)
+{
+  profiler_leave_work(index, 0, 0, 0, 0);
+}
+
+void profiler_leave_work(_index index, u64 cycles, u64 time, u64 bytes, u64 items)
+{
+  prof_thread_t* thread = profiler_thread();
+  if (UNLIKELY(!thread || thread->_depth == 0 || index >= TOTAL_FUNCTIONS))
+  {
+    return;
+  }
+
+  // a migrated call dropped by profiler_region_cpu only pops its frame
+  bool dropped = UNLIKELY(thread->_drop_index == index);
+  thread->_drop_index = PROFILER_NO_INDEX;
+
+  // unwind frames that returned without PROFILE_FUNCTION_END
+  u64        child_cycles = 0;
+  u64        child_time   = 0;
+  u64        events[PROFILER_MAX_EVENTS];
+  const u64* events_begin = NULL;
+  u32        depth        = thread->_depth;
+  while (thread->_depth > 0)
+  {
+    thread->_depth--;
+    if (thread->_depth >= PROFILER_MAX_DEPTH)
+    {
+      break;
+    }
+    if (thread->_stack[thread->_depth]._index == index)
+    {
+      bytes        += thread->_stack[thread->_depth]._bytes;
+      items        += thread->_stack[thread->_depth]._items;
+      child_cycles  = thread->_stack[thread->_depth]._child_cycles;
+      child_time    = thread->_stack[thread->_depth]._child_time;
+
+      prof_frame_t* frame = &thread->_stack[thread->_depth];
+      if (UNLIKELY(dropped))
+      {
+        break;
+      }
+      if (UNLIKELY(frame->_event_generation) && frame->_event_generation == profiler_events_active())
+      {
+        profiler_events_sample(thread, events);
+        profiler_events_attribute(index, frame->_events, events);
+        events_begin = frame->_events;
+      }
+      if (UNLIKELY(frame->_offcpu))
+      {
+        profiler_offcpu_attribute(index, &frame->_cpu, time);
+      }
+      break;
+    }
+  }
+
+  // one end per unwound frame keeps the trace nested
+  if (UNLIKELY(profiler_trace_active()))
+  {
+    profiler_trace_leave(thread, depth - thread->_depth);
+  }
+
+  if (cycles | time)
+  {
+    // the caller's self time excludes this call, dropped or not
+    if (thread->_depth > 0 && thread->_depth <= PROFILER_MAX_DEPTH)
+    {
+      thread->_stack[thread->_depth - 1]._child_cycles += cycles;
+      thread->_stack[thread->_depth - 1]._child_time   += time;
+    }
+    if (UNLIKELY(dropped))
+    {
+      return;
+    }
+
+    if (index < TOTAL_FUNCTIONS)
+    {
+      thread->_site[index]._calls++;
+      thread->_site[index]._cycles += cycles;
+    }
+
+    profiler_outlier_check(thread, index, cycles, time, events_begin, events);
+
+    profiler_add_self(index,
+                      cycles > child_cycles ? cycles - child_cycles : 0,
+                      time > child_time ? time - child_time : 0);
+  }
+
+  if ((bytes | items) && !dropped)
+  {
+    profiler_add_work(index, cycles, time, bytes, items);
+  }
+}
+
+void profiler_frame_work(u64 bytes, u64 items)
+{
+  prof_thread_t* thread = t_prof_thread;
+  if (UNLIKELY(!thread || thread->_depth == 0 || thread->_depth > PROFILER_MAX_DEPTH))
+  {
+    return;
+  }
+
+  thread->_stack[thread->_depth - 1]._bytes += bytes;
+  thread->_stack[thread->_depth - 1]._items += items;
+}
+
+_index profiler_active_index(void)
+{
+  prof_thread_t* thread = t_prof_thread;
+  if (!thread || thread->_depth == 0)
+  {
+    return PROFILER_NO_INDEX;
+  }
+
+  u32 top = thread->_depth < PROFILER_MAX_DEPTH ? thread->_depth - 1 : PROFILER_MAX_DEPTH - 1;
+  return thread->_stack[top]._index;
+}
+
+void profiler_alloc_stat(_index index, prof_alloc_stat_t* out)
+{
+  memset(out, 0, sizeof(*out));
+  if (index > PROFILER_UNATTRIBUTED)
+  {
+    return;
+  }
+
+  for (prof_thread_t* thread = profiler_thread_first(); thread; thread = thread->_next)
+  {
+    const prof_alloc_stat_t* stat = &thread->_alloc[index];
+
+    out->_allocs          += stat->_allocs;
+    out->_frees           += stat->_frees;
+    out->_reallocs        += stat->_reallocs;
+    out->_bytes_allocated += stat->_bytes_allocated;
+    out->_bytes_freed     += stat->_bytes_freed;
+    out->_alloc_cycles    += stat->_alloc_cycles;
+    out->_free_cycles     += stat->_free_cycles;
+  }
+}
+
+void profiler_thread_set_name(const char* name)
+{
+  prof_thread_t* thread = profiler_thread();
+  if (thread)
+  {
+    strncpy(thread->_name, name, sizeof(thread->_name) - 1);
+    thread->_name[sizeof(thread->_name) - 1] = '\0';
+  }
+}
+
+bool profiler_thread_imbalance(_index index, prof_imbalance_t* out)
+{
+  memset(out, 0, sizeof(*out));
+  if (index >= TOTAL_FUNCTIONS)
+  {
+    return false;
+  }
+
+  for (prof_thread_t* thread = profiler_thread_first(); thread; thread = thread->_next)
+  {
+    const prof_thread_site_t* site = &thread->_site[index];
+    if (site->_calls == 0)
+    {
+      continue;
+    }
+    out->_threads++;
+    out->_total_cycles += site->_cycles;
+    if (site->_cycles >= out->_max_cycles)
+    {
+      out->_max_cycles  = site->_cycles;
+      out->_slowest_tid = thread->_tid;
+    }
+  }
+  if (out->_threads == 0)
+  {
+    return false;
+  }
+
+  out->_mean_cycles = (f64)out->_total_cycles / (f64)out->_threads;
+
+  f64 variance = 0.0;
+  for (prof_thread_t* thread = profiler_thread_first(); thread; thread = thread->_next)
+  {
+    const prof_thread_site_t* site = &thread->_site[index];
+    if (site->_calls != 0)
+    {
+      f64 diff = (f64)site->_cycles - out->_mean_cycles;
+      variance += diff * diff;
+    }
+  }
+  variance /= (f64)out->_threads;
+
+  if (out->_mean_cycles > 0.0)
+  {
+    out->_max_over_mean = (f64)out->_max_cycles / out->_mean_cycles;
+    out->_cv            = profiler_sqrt(variance) / out->_mean_cycles;
+    out->_slowest_share = (f64)out->_max_cycles / (f64)out->_total_cycles;
+  }
+  return true;
+}
+
+void profiler_print_threads(void)
+{
+  log_buffer_t* out = log_report_buffer();
+
+  _index count = profiler_get_function_count();
+  for (_index i = 0; i < count; i++)
+  {
+    prof_imbalance_t imbalance;
+    if (!profiler_thread_imbalance(i, &imbalance))
+    {
+      continue;
+    }
+
+    log_buffer_println(out, "Function Name: {str}", profiler_get_stat_head(i)->_func_name);
+    for (prof_thread_t* thread = profiler_thread_first(); thread; thread = thread->_next)
+    {
+      const prof_thread_site_t* site = &thread->_site[i];
+      if (site->_calls == 0)
+      {
+        continue;
+      }
+      f64 share = imbalance._total_cycles ? 100.0 * (f64)site->_cycles / (f64)imbalance._total_cycles : 0.0;
+      log_buffer_println(out, "  Thread {u64} {str}: calls {u64} cycles {u64} ({f64}%)",
+                         thread->_tid, thread->_name[0] ? thread->_name : "-", site->_calls, site->_cycles, share);
+    }
+    if (imbalance._threads > 1)
+    {
+      log_buffer_println(out, "  Imbalance: max/mean {f64} cv {f64} slowest thread {u64} with {f64}%",
+                         imbalance._max_over_mean, imbalance._cv, imbalance._slowest_tid, 100.0 * imbalance._slowest_share);
+    }
+    log_buffer_println(out, "------------------------------------------------------------");
+  }
+  log_buffer_flush(out);
+}
+
+void profiler_thread_clear(void)
+{
+  for (prof_thread_t* thread = profiler_thread_first(); thread; thread = thread->_next)
+  {
+    memset(thread->_site, 0, sizeof(thread->_site));
+    memset(thread->_span, 0, sizeof(thread->_span));
+    memset(thread->_alloc, 0, sizeof(thread->_alloc));
+  }
+}
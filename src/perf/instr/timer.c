@@ -1,9 +1,18 @@
 #define _POSIX_C_SOURCE 200809L
 #include <perf/timer.h>
 
+// wall clock for the time stats, -DPROFILER_TIMER_CLOCK=CLOCK_MONOTONIC to override
+#ifndef PROFILER_TIMER_CLOCK
+  #if defined(CLOCK_MONOTONIC_RAW)
+    #define PROFILER_TIMER_CLOCK CLOCK_MONOTONIC_RAW
+  #else
+    #define PROFILER_TIMER_CLOCK CLOCK_MONOTONIC
+  #endif
+#endif
+
 uint64_t get_nanoseconds(void)
 { 
   struct timespec ts;
-  clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+  clock_gettime(PROFILER_TIMER_CLOCK, &ts);
   return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
 }
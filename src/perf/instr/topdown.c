@@ -0,0 +1,272 @@
+#include <perf/topdown.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char* g_prof_topdown_names[][PROFILER_TOPDOWN_EVENTS] =
+{
+  [pt_metrics] = { "slots", "topdown-retiring", "topdown-bad-spec", "topdown-fe-bound", "topdown-be-bound" },
+  [pt_classic] = { "topdown-total-slots", "topdown-slots-issued", "topdown-slots-retired",
+                   "topdown-fetch-bubbles", "topdown-recovery-bubbles" },
+};
+
+static prof_topdown_events_t g_prof_topdown = { pt_unavailable, {{0}}, {0} };
+static bool                  g_prof_topdown_enabled = false;
+static const char*           g_prof_topdown_reason = "not enabled";
+
+#ifdef __linux__
+
+static bool _topdown_read(const char* dir, const char* sub, const char* name, char* out, size_t capacity)
+{
+  char path[512];
+  snprintf(path, sizeof(path), "%s/%s%s", dir, sub, name);
+
+  FILE* file = fopen(path, "r");
+  if (!file)
+  {
+    return false;
+  }
+  bool ok = fgets(out, (int)capacity, file) != NULL;
+  fclose(file);
+
+  out[strcspn(out, "\n")] = '\0';
+  return ok;
+}
+
+// "event=0x3c,umask=0x01" with the bit layout from format/<term> ("config:0-7")
+static bool _topdown_config(const char* dir, const char* terms, u64* config)
+{
+  *config = 0;
+
+  char list[256];
+  snprintf(list, sizeof(list), "%s", terms);
+
+  for (char* term = strtok(list, ","); term; term = strtok(NULL, ","))
+  {
+    char* equals = strchr(term, '=');
+    u64   value  = 1;
+    if (equals)
+    {
+      *equals = '\0';
+      value   = strtoull(equals + 1, NULL, 0);
+    }
+
+    char format[64];
+    if (!_topdown_read(dir, "format/", term, format, sizeof(format)) || strncmp(format, "config:", 7) != 0)
+    {
+      return false;  // unknown term or one that lives in config1/config2
+    }
+
+    char* range = format + 7;
+    u32   low   = (u32)strtoul(range, &range, 10);
+    u32   high  = *range == '-' ? (u32)strtoul(range + 1, NULL, 10) : low;
+    if (high < low || high > 63)
+    {
+      return false;
+    }
+
+    u64 mask = high - low == 63 ? ~0ull : ((1ull << (high - low + 1)) - 1);
+    *config |= (value & mask) << low;
+  }
+  return true;
+}
+
+enum prof_topdown_method profiler_topdown_resolve(const char* pmu_dir, prof_topdown_events_t* out)
+{
+  memset(out, 0, sizeof(*out));
+
+  char text[256];
+  if (!_topdown_read(pmu_dir, "", "type", text, sizeof(text)))
+  {
+    return pt_unavailable;
+  }
+  u32 type = (u32)strtoul(text, NULL, 10);
+
+  for (u32 method = pt_metrics; method <= pt_classic; method++)
+  {
+    bool found = true;
+    for (u32 e = 0; e < PROFILER_TOPDOWN_EVENTS && found; e++)
+    {
+      const char* name = g_prof_topdown_names[method][e];
+      found = _topdown_read(pmu_dir, "events/", name, text, sizeof(text)) &&
+              _topdown_config(pmu_dir, text, &out->_events[e]._config);
+
+      out->_events[e]._event = pv_raw;
+      out->_events[e]._pmu   = type;
+      out->_scale[e]         = 1.0;
+
+      char scale_name[96];
+      snprintf(scale_name, sizeof(scale_name), "%s.scale", name);
+      if (found && _topdown_read(pmu_dir, "events/", scale_name, text, sizeof(text)))
+      {
+        out->_scale[e] = strtod(text, NULL);
+      }
+    }
+
+    if (found)
+    {
+      out->_method = method;
+      return method;
+    }
+  }
+
+  memset(out, 0, sizeof(*out));
+  return pt_unavailable;
+}
+
+#else
+
+enum prof_topdown_method profiler_topdown_resolve(const char* pmu_dir, prof_topdown_events_t* out)
+{
+  (void)pmu_dir;
+  memset(out, 0, sizeof(*out));
+  return pt_unavailable;
+}
+
+#endif // __linux__
+
+enum prof_topdown_method profiler_topdown_enable(void)
+{
+  g_prof_topdown_enabled = true;
+  g_prof_topdown_reason  = "the pmu exposes no topdown events (virtual machine or unsupported cpu)";
+
+  // hybrid cores name the big core pmu cpu_core
+  if (profiler_topdown_resolve("/sys/bus/event_source/devices/cpu_core", &g_prof_topdown) == pt_unavailable &&
+      profiler_topdown_resolve("/sys/bus/event_source/devices/cpu", &g_prof_topdown) == pt_unavailable)
+  {
+    return pt_unavailable;
+  }
+
+  // the slots event has to lead the group, the user's events follow
+  prof_event_spec_t events[PROFILER_MAX_EVENTS];
+  u32 count = profiler_events_count();
+  if (count + PROFILER_TOPDOWN_EVENTS > PROFILER_MAX_EVENTS)
+  {
+    g_prof_topdown_reason  = "the perf event set is full";
+    g_prof_topdown._method = pt_unavailable;
+    return pt_unavailable;
+  }
+  memcpy(events, g_prof_topdown._events, sizeof(g_prof_topdown._events));
+  for (u32 e = 0; e < count; e++)
+  {
+    events[PROFILER_TOPDOWN_EVENTS + e] = *profiler_events_spec(e);
+  }
+
+  if (!profiler_events_select(events, count + PROFILER_TOPDOWN_EVENTS))
+  {
+    g_prof_topdown_reason  = "perf events are not supported here";
+    g_prof_topdown._method = pt_unavailable;
+    return pt_unavailable;
+  }
+
+  return (enum prof_topdown_method)g_prof_topdown._method;
+}
+
+enum prof_topdown_method profiler_topdown_method(void)
+{
+  return (enum prof_topdown_method)g_prof_topdown._method;
+}
+
+bool profiler_topdown_compute(enum prof_topdown_method method, const f64* counts, prof_topdown_t* out)
+{
+  memset(out, 0, sizeof(*out));
+  if (method == pt_unavailable || counts[0] <= 0.0)
+  {
+    return false;
+  }
+
+  f64 slots = counts[0];
+  out->_slots = slots;
+  if (method == pt_metrics)
+  {
+    out->_retiring        = counts[1] / slots;
+    out->_bad_speculation = counts[2] / slots;
+    out->_frontend_bound  = counts[3] / slots;
+    out->_backend_bound   = counts[4] / slots;
+    return true;
+  }
+
+  // classic level 1: issued but not retired slots and recovery bubbles are bad speculation,
+  // whatever is left after frontend, bad speculation and retiring is backend bound
+  f64 issued   = counts[1];
+  f64 retired  = counts[2];
+  f64 bubbles  = counts[3];
+  f64 recovery = counts[4];
+
+  out->_frontend_bound  = bubbles / slots;
+  out->_bad_speculation = (issued - retired + recovery) / slots;
+  out->_retiring        = retired / slots;
+  out->_bad_speculation = out->_bad_speculation < 0.0 ? 0.0 : out->_bad_speculation;
+
+  f64 backend = 1.0 - out->_frontend_bound - out->_bad_speculation - out->_retiring;
+  out->_backend_bound = backend < 0.0 ? 0.0 : backend;
+  return true;
+}
+
+static const char* _topdown_unavailable(void)
+{
+  if (g_prof_topdown._method == pt_unavailable)
+  {
+    return g_prof_topdown_reason;
+  }
+  for (u32 e = 0; e < PROFILER_TOPDOWN_EVENTS; e++)
+  {
+    const prof_event_spec_t* spec = profiler_events_spec(e);
+    if (!spec || memcmp(spec, &g_prof_topdown._events[e], sizeof(*spec)) != 0)
+    {
+      return "the perf event set was replaced";
+    }
+  }
+  for (u32 e = 0; e < PROFILER_TOPDOWN_EVENTS; e++)
+  {
+    if (!profiler_event_available(e))
+    {
+      return "the kernel refused the topdown events";
+    }
+  }
+  return NULL;
+}
+
+bool profiler_topdown_site(_index index, prof_topdown_t* out)
+{
+  if (_topdown_unavailable())
+  {
+    memset(out, 0, sizeof(*out));
+    return false;
+  }
+
+  f64 counts[PROFILER_TOPDOWN_EVENTS];
+  for (u32 e = 0; e < PROFILER_TOPDOWN_EVENTS; e++)
+  {
+    counts[e] = (f64)profiler_get_event_stat(index, e) * g_prof_topdown._scale[e];
+  }
+  return profiler_topdown_compute((enum prof_topdown_method)g_prof_topdown._method, counts, out);
+}
+
+void profiler_topdown_print(log_buffer_t* out, _index index)
+{
+  if (!g_prof_topdown_enabled)
+  {
+    return;
+  }
+
+  const char* reason = _topdown_unavailable();
+  if (reason)
+  {
+    log_buffer_println(out, "Top-down: unavailable, {str}", reason);
+    return;
+  }
+
+  prof_topdown_t topdown;
+  if (!profiler_topdown_site(index, &topdown))
+  {
+    log_buffer_println(out, "Top-down: no slots counted");
+    return;
+  }
+
+  log_buffer_println(out, "Top-down frontend bound: {f64}%", 100.0 * topdown._frontend_bound);
+  log_buffer_println(out, "Top-down bad speculation: {f64}%", 100.0 * topdown._bad_speculation);
+  log_buffer_println(out, "Top-down backend bound: {f64}%", 100.0 * topdown._backend_bound);
+  log_buffer_println(out, "Top-down retiring: {f64}%", 100.0 * topdown._retiring);
+}
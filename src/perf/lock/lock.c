@@ -0,0 +1,220 @@
+// pthread rwlocks
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <perf/lock.h>
+#include <utils/log.h>
+
+#include <stdio.h>
+#include <string.h>
+
+static prof_lock_stat_t g_prof_lock_stat[TOTAL_FUNCTIONS];
+static prof_hist_stat_t g_prof_lock_wait_hist[TOTAL_FUNCTIONS];
+
+// lock stats are written by every contending thread, keep them atomic
+static FORCE_INLINE void _atomic_add(u64* target, u64 value)
+{
+  __atomic_fetch_add(target, value, __ATOMIC_RELAXED);
+}
+
+static FORCE_INLINE void _atomic_max(u64* target, u64 value)
+{
+  u64 current = __atomic_load_n(target, __ATOMIC_RELAXED);
+  while (value > current &&
+         !__atomic_compare_exchange_n(target, &current, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+  {
+  }
+}
+
+static void _lock_print(log_buffer_t* out, _index index)
+{
+  const prof_lock_stat_t* stat = &g_prof_lock_stat[index];
+  const prof_hist_stat_t* hist = &g_prof_lock_wait_hist[index];
+
+  f64 contended_pct = stat->_acquires ? 100.0 * (f64)stat->_contended / (f64)stat->_acquires : 0.0;
+
+  log_buffer_println(out, "Lock acquires: {u64}", stat->_acquires);
+  log_buffer_println(out, "Contended acquires: {u64} ({f32}%)", stat->_contended, contended_pct);
+  log_buffer_println(out, "Total wait cycles: {u64}", stat->_wait_cycles);
+  log_buffer_println(out, "Maximum wait cycles: {u64}", stat->_wait_cycles_max);
+  log_buffer_println(out, "P50 wait cycles: {u64}", profiler_hist_percentile(hist, 50.0));
+  log_buffer_println(out, "P99 wait cycles: {u64}", profiler_hist_percentile(hist, 99.0));
+  log_buffer_println(out, "Total hold cycles: {u64}", stat->_hold_cycles);
+  log_buffer_println(out, "Maximum hold cycles: {u64}", stat->_hold_cycles_max);
+  log_buffer_println(out, "Average hold cycles: {f64}", stat->_releases ? (f64)stat->_hold_cycles / (f64)stat->_releases : 0.0);
+}
+
+static void _lock_collect(bool reset)
+{
+  if (reset)
+  {
+    profiler_lock_clear();
+    return;
+  }
+
+  _index count = profiler_get_function_count();
+  for (_index i = 0; i < count; i++)
+  {
+    if (profiler_get_stat_head(i)->_kind != pk_lock)
+    {
+      continue;
+    }
+
+    // a lock costs its users the wait plus the hold, neither is on the frame stack. there
+    // are no nanoseconds, the time stats stay empty
+    const prof_lock_stat_t* stat = &g_prof_lock_stat[i];
+    u64 cycles     = stat->_wait_cycles + stat->_hold_cycles;
+    u64 cycles_max = stat->_wait_cycles_max > stat->_hold_cycles_max ? stat->_wait_cycles_max : stat->_hold_cycles_max;
+
+    prof_cpu_stat_t  cpu  = { ._total_cycles = cycles, ._cycles_max = cycles_max };
+    prof_time_stat_t time = {0};
+    prof_self_stat_t self = { ._cycles = cycles };
+    profiler_store_calls(i, stat->_acquires);
+    profiler_store_timing(i, &cpu, &time, &self);
+  }
+}
+
+_index profiler_add_lock_site(const char* file_name, const char* func_name, const char* lock_name, u16 line_number)
+{
+  char name[96];
+  snprintf(name, sizeof(name), "%s:%s", func_name, lock_name);
+
+  profiler_register_printer(pk_lock, _lock_print);
+  profiler_register_collector(pk_lock, _lock_collect);
+  return profiler_add_site(file_name, name, line_number, pk_lock);
+}
+
+const prof_lock_stat_t* profiler_get_lock_stat(_index index)
+{
+  return index < TOTAL_FUNCTIONS ? &g_prof_lock_stat[index] : NULL;
+}
+
+const prof_hist_stat_t* profiler_get_lock_wait_hist(_index index)
+{
+  return index < TOTAL_FUNCTIONS ? &g_prof_lock_wait_hist[index] : NULL;
+}
+
+void profiler_lock_clear(void)
+{
+  memset(g_prof_lock_stat, 0, sizeof(g_prof_lock_stat));
+  memset(g_prof_lock_wait_hist, 0, sizeof(g_prof_lock_wait_hist));
+}
+
+void profiler_lock_acquired(_index index, u64 wait_cycles, bool contended)
+{
+  if (index >= TOTAL_FUNCTIONS)
+  {
+    return;
+  }
+
+  prof_lock_stat_t* stat = &g_prof_lock_stat[index];
+  _atomic_add(&stat->_acquires, 1);
+  if (contended)
+  {
+    _atomic_add(&stat->_contended, 1);
+    _atomic_add(&stat->_wait_cycles, wait_cycles);
+    _atomic_max(&stat->_wait_cycles_max, wait_cycles);
+  }
+  profiler_hist_record_atomic(&g_prof_lock_wait_hist[index], wait_cycles);
+}
+
+void profiler_lock_released(_index index, u64 hold_cycles)
+{
+  if (index >= TOTAL_FUNCTIONS)
+  {
+    return;
+  }
+
+  prof_lock_stat_t* stat = &g_prof_lock_stat[index];
+  _atomic_add(&stat->_releases, 1);
+  _atomic_add(&stat->_hold_cycles, hold_cycles);
+  _atomic_max(&stat->_hold_cycles_max, hold_cycles);
+}
+
+#if !PLATFORM_WINDOWS
+
+// set while the PROFILE_LOCK wrappers call into pthread, the interposed
+// entry points (lock_wrap.c) pass those calls straight through
+THREAD_LOCAL bool t_prof_lock_passthrough = false;
+
+u64 profiler_lock_mutex(_index index, pthread_mutex_t* mutex)
+{
+  t_prof_lock_passthrough = true;
+
+  bool contended = false;
+  u64  start     = get_cycle_count();
+
+  if (pthread_mutex_trylock(mutex) != 0)
+  {
+    contended = true;
+    pthread_mutex_lock(mutex);
+  }
+
+  u64 acquired = get_cycle_count();
+  t_prof_lock_passthrough = false;
+
+  profiler_lock_acquired(index, contended ? acquired - start : 0, contended);
+  return acquired;
+}
+
+void profiler_unlock_mutex(_index index, pthread_mutex_t* mutex, u64 acquired)
+{
+  // account before unlocking, the stat cache lines are still ours
+  profiler_lock_released(index, get_cycle_count() - acquired);
+
+  t_prof_lock_passthrough = true;
+  pthread_mutex_unlock(mutex);
+  t_prof_lock_passthrough = false;
+}
+
+u64 profiler_lock_rdlock(_index index, pthread_rwlock_t* lock)
+{
+  t_prof_lock_passthrough = true;
+
+  bool contended = false;
+  u64  start     = get_cycle_count();
+
+  if (pthread_rwlock_tryrdlock(lock) != 0)
+  {
+    contended = true;
+    pthread_rwlock_rdlock(lock);
+  }
+
+  u64 acquired = get_cycle_count();
+  t_prof_lock_passthrough = false;
+
+  profiler_lock_acquired(index, contended ? acquired - start : 0, contended);
+  return acquired;
+}
+
+u64 profiler_lock_wrlock(_index index, pthread_rwlock_t* lock)
+{
+  t_prof_lock_passthrough = true;
+
+  bool contended = false;
+  u64  start     = get_cycle_count();
+
+  if (pthread_rwlock_trywrlock(lock) != 0)
+  {
+    contended = true;
+    pthread_rwlock_wrlock(lock);
+  }
+
+  u64 acquired = get_cycle_count();
+  t_prof_lock_passthrough = false;
+
+  profiler_lock_acquired(index, contended ? acquired - start : 0, contended);
+  return acquired;
+}
+
+void profiler_lock_rwunlock(_index index, pthread_rwlock_t* lock, u64 acquired)
+{
+  profiler_lock_released(index, get_cycle_count() - acquired);
+
+  t_prof_lock_passthrough = true;
+  pthread_rwlock_unlock(lock);
+  t_prof_lock_passthrough = false;
+}
+
+#endif
@@ -0,0 +1,286 @@
+// pthread lock interposition, records every pthread_mutex / pthread_rwlock acquisition
+// made from the wrapped objects without touching the call sites.
+//
+// opt in by linking with
+//   -Wl,--wrap=pthread_mutex_lock,--wrap=pthread_mutex_unlock,
+//   --wrap=pthread_rwlock_rdlock,--wrap=pthread_rwlock_wrlock,--wrap=pthread_rwlock_unlock,
+//   --wrap=pthread_cond_wait,--wrap=pthread_cond_timedwait
+// (tier_0_lock_tracking() in config.lua). this object is only pulled out of the archive
+// when those wraps are in effect.
+//
+// a condition variable wait releases and retakes its mutex inside libc. the wait ends the
+// hold and a fresh acquire starts when it returns, so the hold time doesn't include the
+// wait. whether retaking the mutex had to wait can't be told apart from the wait itself,
+// those acquires count as uncontended.
+//
+// every lock address gets its own registry site ("pthread_mutex@0x...") up to
+// PROFILER_LOCK_WRAP_MAX locks, the rest are folded into one shared site.
+
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <perf/lock.h>
+#include <perf/thread.h>
+
+#if defined(__linux__)
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdio.h>
+
+#ifndef PROFILER_LOCK_WRAP_MAX
+#define PROFILER_LOCK_WRAP_MAX 16
+#endif
+
+#define LOCK_TABLE_SIZE 256  // open addressing, power of two
+#define LOCK_PROBE_MAX  16   // a lock sits at most this far from its home slot
+#define LOCK_HELD_MAX   16   // nested locks held by one thread we can time
+
+int __real_pthread_mutex_lock(pthread_mutex_t* mutex);
+int __real_pthread_mutex_unlock(pthread_mutex_t* mutex);
+int __real_pthread_rwlock_rdlock(pthread_rwlock_t* lock);
+int __real_pthread_rwlock_wrlock(pthread_rwlock_t* lock);
+int __real_pthread_rwlock_unlock(pthread_rwlock_t* lock);
+int __real_pthread_cond_wait(pthread_cond_t* cond, pthread_mutex_t* mutex);
+int __real_pthread_cond_timedwait(pthread_cond_t* cond, pthread_mutex_t* mutex, const struct timespec* abstime);
+
+int __wrap_pthread_mutex_lock(pthread_mutex_t* mutex);
+int __wrap_pthread_mutex_unlock(pthread_mutex_t* mutex);
+int __wrap_pthread_rwlock_rdlock(pthread_rwlock_t* lock);
+int __wrap_pthread_rwlock_wrlock(pthread_rwlock_t* lock);
+int __wrap_pthread_rwlock_unlock(pthread_rwlock_t* lock);
+int __wrap_pthread_cond_wait(pthread_cond_t* cond, pthread_mutex_t* mutex);
+int __wrap_pthread_cond_timedwait(pthread_cond_t* cond, pthread_mutex_t* mutex, const struct timespec* abstime);
+
+extern THREAD_LOCAL bool t_prof_lock_passthrough;
+
+typedef struct lock_entry_t
+{
+  _Atomic(uintptr_t) _address;
+  _Atomic(_index)    _index;    // registry index + 1, 0 until registered, PROFILER_NO_INDEX when the registry was full
+} lock_entry_t;
+
+typedef struct lock_held_t
+{
+  uintptr_t _address;
+  _index    _index;
+  u64       _acquired;
+} lock_held_t;
+
+static lock_entry_t g_lock_table[LOCK_TABLE_SIZE];
+static atomic_uint  g_lock_tracked = 0;
+static _Atomic(_index) g_lock_overflow = 0;  // index + 1, as the table entries
+
+static THREAD_LOCAL lock_held_t t_lock_held[LOCK_HELD_MAX];
+static THREAD_LOCAL u32         t_lock_held_count = 0;
+
+// index + 1 of a new site, PROFILER_NO_INDEX when the registry is full
+static _index _lock_site(const char* name)
+{
+  _index index = profiler_add_lock_site(__FILE__, "pthread", name, __LINE__);
+  return index != PROFILER_NO_INDEX ? index + 1 : PROFILER_NO_INDEX;
+}
+
+// the shared "other" site, registered on first use
+static _index _lock_overflow(void)
+{
+  _index overflow = atomic_load_explicit(&g_lock_overflow, memory_order_acquire);
+  if (overflow == 0)
+  {
+    _index expected = 0;
+    overflow = _lock_site("other");
+    atomic_compare_exchange_strong(&g_lock_overflow, &expected, overflow);
+    overflow = atomic_load_explicit(&g_lock_overflow, memory_order_acquire);
+  }
+  return overflow;
+}
+
+static _index _lock_register(const char* kind, uintptr_t address)
+{
+  char name[48];
+  if (atomic_fetch_add_explicit(&g_lock_tracked, 1, memory_order_relaxed) >= PROFILER_LOCK_WRAP_MAX)
+  {
+    return _lock_overflow();
+  }
+
+  snprintf(name, sizeof(name), "%s@%p", kind, (void*)address);
+  return _lock_site(name);
+}
+
+// probes are bounded: a lock that finds no slot near its home shares the "other" site
+// instead of scanning the whole table on every lock and unlock
+static _index _lock_index(const char* kind, const void* lock)
+{
+  uintptr_t address = (uintptr_t)lock;
+  u32       slot    = (u32)((address >> 4) * 0x9E3779B1u) & (LOCK_TABLE_SIZE - 1);
+
+  for (u32 probe = 0; probe < LOCK_PROBE_MAX; ++probe)
+  {
+    lock_entry_t* entry   = &g_lock_table[(slot + probe) & (LOCK_TABLE_SIZE - 1)];
+    uintptr_t     current = atomic_load_explicit(&entry->_address, memory_order_acquire);
+
+    if (current == 0)
+    {
+      if (!atomic_compare_exchange_strong(&entry->_address, &current, address) && current != address)
+      {
+        continue;  // another lock took the slot
+      }
+      if (current == 0)
+      {
+        atomic_store_explicit(&entry->_index, _lock_register(kind, address), memory_order_release);
+      }
+    }
+    else if (current != address)
+    {
+      continue;
+    }
+
+    // the claiming thread may still be registering
+    _index index;
+    while ((index = atomic_load_explicit(&entry->_index, memory_order_acquire)) == 0)
+    {
+    }
+    return index != PROFILER_NO_INDEX ? index - 1 : PROFILER_NO_INDEX;
+  }
+
+  _index overflow = _lock_overflow();
+  return overflow != PROFILER_NO_INDEX ? overflow - 1 : PROFILER_NO_INDEX;
+}
+
+static void _lock_held_push(const void* lock, _index index, u64 acquired)
+{
+  if (t_lock_held_count < LOCK_HELD_MAX)
+  {
+    t_lock_held[t_lock_held_count++] = (lock_held_t){(uintptr_t)lock, index, acquired};
+  }
+}
+
+static void _lock_held_pop(const void* lock, u64 now)
+{
+  for (u32 i = t_lock_held_count; i-- > 0;)
+  {
+    if (t_lock_held[i]._address == (uintptr_t)lock)
+    {
+      profiler_lock_released(t_lock_held[i]._index, now - t_lock_held[i]._acquired);
+      t_lock_held[i] = t_lock_held[--t_lock_held_count];
+      return;
+    }
+  }
+}
+
+int __wrap_pthread_mutex_lock(pthread_mutex_t* mutex)
+{
+  if (t_prof_lock_passthrough)
+  {
+    return __real_pthread_mutex_lock(mutex);
+  }
+
+  _index index = _lock_index("pthread_mutex", mutex);
+
+  u64  start     = get_cycle_count();
+  bool contended = false;
+  int  result    = pthread_mutex_trylock(mutex);
+  if (result == EBUSY)
+  {
+    contended = true;
+    result    = __real_pthread_mutex_lock(mutex);
+  }
+  if (result != 0)
+  {
+    return result;
+  }
+
+  u64 acquired = get_cycle_count();
+  profiler_lock_acquired(index, contended ? acquired - start : 0, contended);
+  _lock_held_push(mutex, index, acquired);
+  return 0;
+}
+
+int __wrap_pthread_mutex_unlock(pthread_mutex_t* mutex)
+{
+  if (!t_prof_lock_passthrough)
+  {
+    _lock_held_pop(mutex, get_cycle_count());
+  }
+  return __real_pthread_mutex_unlock(mutex);
+}
+
+static int _rwlock_acquire(pthread_rwlock_t* lock, bool write)
+{
+  _index index = _lock_index("pthread_rwlock", lock);
+
+  u64  start     = get_cycle_count();
+  bool contended = false;
+  int  result    = write ? pthread_rwlock_trywrlock(lock) : pthread_rwlock_tryrdlock(lock);
+  if (result == EBUSY)
+  {
+    contended = true;
+    result    = write ? __real_pthread_rwlock_wrlock(lock) : __real_pthread_rwlock_rdlock(lock);
+  }
+  if (result != 0)
+  {
+    return result;
+  }
+
+  u64 acquired = get_cycle_count();
+  profiler_lock_acquired(index, contended ? acquired - start : 0, contended);
+  _lock_held_push(lock, index, acquired);
+  return 0;
+}
+
+int __wrap_pthread_rwlock_rdlock(pthread_rwlock_t* lock)
+{
+  return t_prof_lock_passthrough ? __real_pthread_rwlock_rdlock(lock) : _rwlock_acquire(lock, false);
+}
+
+int __wrap_pthread_rwlock_wrlock(pthread_rwlock_t* lock)
+{
+  return t_prof_lock_passthrough ? __real_pthread_rwlock_wrlock(lock) : _rwlock_acquire(lock, true);
+}
+
+int __wrap_pthread_rwlock_unlock(pthread_rwlock_t* lock)
+{
+  if (!t_prof_lock_passthrough)
+  {
+    _lock_held_pop(lock, get_cycle_count());
+  }
+  return __real_pthread_rwlock_unlock(lock);
+}
+
+// the mutex is held again when the wait returns, timed out or not
+static void _lock_retaken(pthread_mutex_t* mutex)
+{
+  _index index    = _lock_index("pthread_mutex", mutex);
+  u64    acquired = get_cycle_count();
+  profiler_lock_acquired(index, 0, false);
+  _lock_held_push(mutex, index, acquired);
+}
+
+int __wrap_pthread_cond_wait(pthread_cond_t* cond, pthread_mutex_t* mutex)
+{
+  if (t_prof_lock_passthrough)
+  {
+    return __real_pthread_cond_wait(cond, mutex);
+  }
+
+  _lock_held_pop(mutex, get_cycle_count());
+  int result = __real_pthread_cond_wait(cond, mutex);
+  _lock_retaken(mutex);
+  return result;
+}
+
+int __wrap_pthread_cond_timedwait(pthread_cond_t* cond, pthread_mutex_t* mutex, const struct timespec* abstime)
+{
+  if (t_prof_lock_passthrough)
+  {
+    return __real_pthread_cond_timedwait(cond, mutex, abstime);
+  }
+
+  _lock_held_pop(mutex, get_cycle_count());
+  int result = __real_pthread_cond_timedwait(cond, mutex, abstime);
+  _lock_retaken(mutex);
+  return result;
+}
+
+#endif
@@ -0,0 +1,361 @@
+// streaming trace reader and chrome trace converter, see perf/trace.h
+
+#include <perf/trace.h>
+#include <platform/platform.h>
+#include <utils/log.h>
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TRACE_THREADS_MAX 1024     // threads the chrome converter tracks nesting for, power of two
+#define TRACE_SITES_MAX   (1 << 24) // larger indices only come from damaged files
+
+// false on a truncated or overlong varint
+static bool _trace_read_varint(const u8** at, const u8* stop, u64* out)
+{
+  u64 value = 0;
+  for (u32 shift = 0; shift < 64 && *at < stop; shift += 7)
+  {
+    u8 byte = *(*at)++;
+    value |= (u64)(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0)
+    {
+      *out = value;
+      return true;
+    }
+  }
+  return false;
+}
+
+// payload of the record at `offset`, NULL past the last complete record
+static const u8* _trace_record_at(const prof_trace_file_t* file, u64 offset, prof_trace_record_t* out)
+{
+  if (offset + sizeof(prof_trace_record_t) > file->_size)
+  {
+    return NULL;
+  }
+  memcpy(out, file->_data + offset, sizeof(*out));
+  if (offset + sizeof(prof_trace_record_t) + out->_size > file->_size)
+  {
+    return NULL;
+  }
+  return file->_data + offset + sizeof(prof_trace_record_t);
+}
+
+static bool _trace_read_strings(prof_trace_file_t* file, const u8* at, const u8* stop)
+{
+  // two passes: the highest index sizes the table
+  u64 count = 0;
+  for (const u8* p = at; p < stop;)
+  {
+    u64 index, length;
+    if (!_trace_read_varint(&p, stop, &index) || !_trace_read_varint(&p, stop, &length) ||
+        index >= TRACE_SITES_MAX || length >= (u64)(stop - p) || p[length] != '\0')
+    {
+      return false;
+    }
+    count = index + 1 > count ? index + 1 : count;
+    p += length + 1;
+  }
+  if (count == 0)
+  {
+    return true;
+  }
+
+  file->_names = calloc(count, sizeof(const char*));
+  if (!file->_names)
+  {
+    return false;
+  }
+  file->_site_count = count;
+
+  for (const u8* p = at; p < stop;)
+  {
+    u64 index = 0, length = 0;
+    _trace_read_varint(&p, stop, &index);
+    _trace_read_varint(&p, stop, &length);
+    file->_names[index] = (const char*)p;
+    p += length + 1;
+  }
+  return true;
+}
+
+bool profiler_trace_open(const char* path, prof_trace_file_t* out)
+{
+  memset(out, 0, sizeof(*out));
+
+  out->_data = impl_file_map(path, &out->_size);
+  if (!out->_data)
+  {
+    log_println("Failed to map {str}", path);
+    return false;
+  }
+
+  if (out->_size < sizeof(prof_trace_header_t))
+  {
+    log_println("{str} is too short to be a trace", path);
+    profiler_trace_close(out);
+    return false;
+  }
+  memcpy(&out->_header, out->_data, sizeof(out->_header));
+  if (memcmp(out->_header._magic, PROFILER_TRACE_MAGIC, sizeof(out->_header._magic)) != 0 ||
+      out->_header._version != PROFILER_TRACE_VERSION)
+  {
+    log_println("{str} is not a version {u32} trace", path, (u32)PROFILER_TRACE_VERSION);
+    profiler_trace_close(out);
+    return false;
+  }
+
+  // the tables follow the chunks, a trace cut short has none of them
+  prof_trace_record_t record;
+  const u8*           payload;
+  for (u64 offset = sizeof(prof_trace_header_t); (payload = _trace_record_at(out, offset, &record));
+       offset += sizeof(record) + record._size)
+  {
+    switch (record._tag)
+    {
+      case tt_strings:
+        if (!_trace_read_strings(out, payload, payload + record._size))
+        {
+          log_println("{str} has a damaged string table", path);
+        }
+        break;
+
+      case tt_threads:
+        out->_threads      = payload;
+        out->_threads_size = record._size;
+        break;
+
+      case tt_end:
+        if (record._size >= sizeof(prof_trace_end_t))
+        {
+          memcpy(&out->_end, payload, sizeof(out->_end));
+          out->_complete = true;
+        }
+        break;
+
+      default:
+        break;
+    }
+  }
+  return true;
+}
+
+void profiler_trace_close(prof_trace_file_t* file)
+{
+  impl_file_unmap(file->_data, file->_size);
+  free(file->_names);
+  memset(file, 0, sizeof(*file));
+}
+
+void profiler_trace_cursor(const prof_trace_file_t* file, prof_trace_cursor_t* out)
+{
+  memset(out, 0, sizeof(*out));
+  out->_file   = file;
+  out->_offset = sizeof(prof_trace_header_t);
+}
+
+bool profiler_trace_next(prof_trace_cursor_t* cursor, prof_trace_event_t* out)
+{
+  const prof_trace_file_t* file = cursor->_file;
+
+  while (cursor->_at >= cursor->_stop)
+  {
+    prof_trace_record_t record;
+    const u8*           payload = _trace_record_at(file, cursor->_offset, &record);
+    if (!payload)
+    {
+      return false;
+    }
+    cursor->_offset += sizeof(record) + record._size;
+
+    prof_trace_chunk_t chunk;
+    if (record._tag != tt_chunk || record._size < sizeof(chunk))
+    {
+      continue;
+    }
+    memcpy(&chunk, payload, sizeof(chunk));
+    if (chunk._bytes > record._size - sizeof(chunk))
+    {
+      continue;
+    }
+    cursor->_at    = payload + sizeof(chunk);
+    cursor->_stop  = cursor->_at + chunk._bytes;
+    cursor->_tid   = chunk._tid;
+    cursor->_ticks = chunk._base;
+  }
+
+  u64 value;
+  u64 index = PROFILER_TRACE_NO_SITE;
+  if (!_trace_read_varint(&cursor->_at, cursor->_stop, &value) ||
+      ((value & 1) == 0 && !_trace_read_varint(&cursor->_at, cursor->_stop, &index)))
+  {
+    // damaged chunk, go on with the next one
+    cursor->_at = cursor->_stop;
+    return profiler_trace_next(cursor, out);
+  }
+
+  cursor->_ticks += value >> 1;
+
+  const prof_trace_header_t* header = &file->_header;
+  u64 ticks = cursor->_ticks > header->_start_ticks ? cursor->_ticks - header->_start_ticks : 0;
+  out->_time  = header->_ticks_per_ns > 0.0 ? (u64)((f64)ticks / header->_ticks_per_ns) : ticks;
+  out->_tid   = cursor->_tid;
+  out->_index = index;
+  out->_end   = (value & 1) != 0;
+  return true;
+}
+
+const char* profiler_trace_site_name(const prof_trace_file_t* file, u64 index)
+{
+  return index < file->_site_count && file->_names[index] ? file->_names[index] : "?";
+}
+
+const char* profiler_trace_thread_name(const prof_trace_file_t* file, u64 tid)
+{
+  const u8* p    = file->_threads;
+  const u8* stop = p + file->_threads_size;
+  while (p && stop - p > (ptrdiff_t)sizeof(u64))
+  {
+    u64 record_tid, length;
+    memcpy(&record_tid, p, sizeof(u64));
+    p += sizeof(u64);
+    if (!_trace_read_varint(&p, stop, &length) || length >= (u64)(stop - p))
+    {
+      break;
+    }
+    if (record_tid == tid)
+    {
+      return (const char*)p;
+    }
+    p += length + 1;
+  }
+  return "";
+}
+
+// chrome trace event format, same escaping and time format as perf/export.h
+
+static void _write_json_string(FILE* file, const char* text)
+{
+  fputc('"', file);
+  for (const char* p = text; *p; p++)
+  {
+    unsigned char c = (unsigned char)*p;
+    if (c == '"' || c == '\\')
+    {
+      fputc('\\', file);
+      fputc(c, file);
+    }
+    else if (c < 0x20)
+    {
+      fprintf(file, "\\u%04x", c);
+    }
+    else
+    {
+      fputc(c, file);
+    }
+  }
+  fputc('"', file);
+}
+
+// open begins of `tid`, open addressing by tid. NULL when the table is full
+static u64* _thread_depth(u64* tids, u64* depths, u64 tid)
+{
+  for (u32 probe = 0, slot = (u32)(tid * 0x9E3779B97F4A7C15ull >> 32); probe < TRACE_THREADS_MAX; probe++, slot++)
+  {
+    slot &= TRACE_THREADS_MAX - 1;
+    if (tids[slot] == tid + 1 || tids[slot] == 0)
+    {
+      tids[slot] = tid + 1;
+      return &depths[slot];
+    }
+  }
+  return NULL;
+}
+
+bool profiler_trace_to_chrome(const char* trace_path, const char* json_path)
+{
+  prof_trace_file_t trace;
+  if (!profiler_trace_open(trace_path, &trace))
+  {
+    return false;
+  }
+
+  FILE* file   = fopen(json_path, "w");
+  u64*  tids   = calloc(TRACE_THREADS_MAX, sizeof(u64));
+  u64*  depths = calloc(TRACE_THREADS_MAX, sizeof(u64));
+  if (!file || !tids || !depths)
+  {
+    log_println("Failed to open {str} for writing", json_path);
+    if (file)
+    {
+      fclose(file);
+    }
+    free(tids);
+    free(depths);
+    profiler_trace_close(&trace);
+    return false;
+  }
+
+  unsigned long long pid   = trace._header._pid;
+  bool               first = true;
+  fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", file);
+
+  const u8* p    = trace._threads;
+  const u8* stop = p + trace._threads_size;
+  while (p && stop - p > (ptrdiff_t)sizeof(u64))
+  {
+    u64 tid, length;
+    memcpy(&tid, p, sizeof(u64));
+    p += sizeof(u64);
+    if (!_trace_read_varint(&p, stop, &length) || length >= (u64)(stop - p))
+    {
+      break;
+    }
+    fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%llu,\"tid\":%llu,\"args\":{\"name\":",
+            first ? "" : ",", pid, (unsigned long long)tid);
+    _write_json_string(file, (const char*)p);
+    fputs("}}", file);
+    first = false;
+    p += length + 1;
+  }
+
+  prof_trace_cursor_t cursor;
+  prof_trace_event_t  event;
+  profiler_trace_cursor(&trace, &cursor);
+  while (profiler_trace_next(&cursor, &event))
+  {
+    u64* depth = _thread_depth(tids, depths, event._tid);
+    if (event._end && depth && *depth == 0)
+    {
+      continue;
+    }
+    if (depth)
+    {
+      *depth = event._end ? *depth - 1 : *depth + 1;
+    }
+
+    fprintf(file, "%s\n{", first ? "" : ",");
+    first = false;
+    if (!event._end)
+    {
+      fputs("\"name\":", file);
+      _write_json_string(file, profiler_trace_site_name(&trace, event._index));
+      fputs(",\"cat\":\"trace\",", file);
+    }
+    fprintf(file, "\"ph\":\"%c\",\"ts\":%llu.%03llu,\"pid\":%llu,\"tid\":%llu}", event._end ? 'E' : 'B',
+            (unsigned long long)(event._time / 1000), (unsigned long long)(event._time % 1000),
+            pid, (unsigned long long)event._tid);
+  }
+
+  fputs("\n]}\n", file);
+
+  bool ok = !ferror(file);
+  ok = fclose(file) == 0 && ok;
+  free(tids);
+  free(depths);
+  profiler_trace_close(&trace);
+  return ok;
+}
@@ -0,0 +1,620 @@
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+// streaming trace writer, see perf/trace.h.
+//
+// a traced thread owns one buffer at a time. full buffers are pushed onto a lock free
+// stack, the writer thread takes the whole stack, restores the push order and writes
+// every buffer with one write(2) of its record, chunk header and events: the in memory
+// layout is the on disk one. written buffers go back to a free list for reuse and are
+// never unmapped.
+//
+// a thread sets _trace_busy before it checks the session and clears it when it is done
+// with its buffer. profiler_trace_stop() clears the session, waits until no thread is
+// busy and only then takes the buffers. the store/load pair on the thread side is ordered
+// by a process wide membarrier issued by stop, or by a full fence where that's missing.
+
+#include <perf/arch.h>
+#include <perf/clock.h>
+#include <perf/thread.h>
+#include <perf/timer.h>
+#include <perf/trace.h>
+#include <platform/platform.h>
+#include <utils/log.h>
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <string.h>
+
+#if !PLATFORM_WINDOWS
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#define TRACE_EVENT_MAX 20  // two 10 byte varints
+
+// the counter get_cycle_count() reads
+#if defined(ARCH_X86) || defined(ARCH_X86_64)
+#define TRACE_CLOCK pc_rdtsc
+#else
+#define TRACE_CLOCK pc_monotonic
+#endif
+
+typedef struct prof_trace_buffer_t
+{
+  struct prof_trace_buffer_t* _next;     // writer queue or free list
+  u64                         _last;     // ticks of the newest event
+  u32                         _session;
+  u32                         _capacity; // bytes for events
+  prof_trace_record_t         _record;   // written as is together with _chunk and the events
+  prof_trace_chunk_t          _chunk;
+  u8                          _data[];
+} prof_trace_buffer_t;
+
+static_assert(offsetof(prof_trace_buffer_t, _chunk) == offsetof(prof_trace_buffer_t, _record) + sizeof(prof_trace_record_t),
+              "prof_trace_buffer_t record and chunk aren't contiguous");
+static_assert(offsetof(prof_trace_buffer_t, _data) == offsetof(prof_trace_buffer_t, _chunk) + sizeof(prof_trace_chunk_t),
+              "prof_trace_buffer_t chunk and events aren't contiguous");
+
+static atomic_uint                    g_prof_trace_session = 0;  // 0 while not tracing
+static u32                            g_prof_trace_generation = 0;
+static _Atomic(prof_trace_buffer_t*)  g_prof_trace_queue = NULL;
+static atomic_ullong                  g_prof_trace_events = 0;
+static atomic_ullong                  g_prof_trace_dropped = 0;
+static atomic_bool                    g_prof_trace_barrier = false;  // stop issues impl_process_barrier()
+
+// the free list is popped by every traced thread, a lock keeps that free of ABA
+static atomic_flag                    g_prof_trace_free_lock = ATOMIC_FLAG_INIT;
+static prof_trace_buffer_t*           g_prof_trace_free = NULL;
+static atomic_uint                    g_prof_trace_buffers = 0;  // mapped so far
+
+static void _trace_free_lock(void)
+{
+  while (atomic_flag_test_and_set_explicit(&g_prof_trace_free_lock, memory_order_acquire))
+  {
+  }
+}
+
+static void _trace_free_unlock(void)
+{
+  atomic_flag_clear_explicit(&g_prof_trace_free_lock, memory_order_release);
+}
+
+static void _trace_release(prof_trace_buffer_t* buffer)
+{
+  _trace_free_lock();
+  buffer->_next     = g_prof_trace_free;
+  g_prof_trace_free = buffer;
+  _trace_free_unlock();
+}
+
+static prof_trace_buffer_t* _trace_acquire(void)
+{
+  _trace_free_lock();
+  prof_trace_buffer_t* buffer = g_prof_trace_free;
+  if (buffer)
+  {
+    g_prof_trace_free = buffer->_next;
+  }
+  _trace_free_unlock();
+
+  if (!buffer)
+  {
+    if (atomic_fetch_add_explicit(&g_prof_trace_buffers, 1, memory_order_relaxed) >= PROFILER_TRACE_BUFFERS)
+    {
+      atomic_fetch_sub_explicit(&g_prof_trace_buffers, 1, memory_order_relaxed);
+      return NULL;
+    }
+    buffer = impl_mem_map(PROFILER_TRACE_CHUNK);
+    if (!buffer)
+    {
+      atomic_fetch_sub_explicit(&g_prof_trace_buffers, 1, memory_order_relaxed);
+      return NULL;
+    }
+    buffer->_capacity = PROFILER_TRACE_CHUNK - (u32)sizeof(prof_trace_buffer_t);
+  }
+  return buffer;
+}
+
+static void _trace_queue(prof_trace_buffer_t* buffer)
+{
+  buffer->_record._tag  = tt_chunk;
+  buffer->_record._size = (u32)sizeof(prof_trace_chunk_t) + buffer->_chunk._bytes;
+
+  prof_trace_buffer_t* head = atomic_load_explicit(&g_prof_trace_queue, memory_order_relaxed);
+  do
+  {
+    buffer->_next = head;
+  } while (!atomic_compare_exchange_weak_explicit(&g_prof_trace_queue, &head, buffer,
+                                                  memory_order_release, memory_order_relaxed));
+}
+
+// hands the full (or stale) buffer to the writer and starts a new one at `now`
+static NO_INLINE prof_trace_buffer_t* _trace_next_buffer(prof_thread_t* thread, u32 session, u64 now)
+{
+  prof_trace_buffer_t* full = thread->_trace;
+  prof_trace_buffer_t* next = _trace_acquire();
+  if (next)
+  {
+    next->_session       = session;
+    next->_last          = now;
+    next->_chunk._tid    = thread->_tid;
+    next->_chunk._base   = now;
+    next->_chunk._events = 0;
+    next->_chunk._bytes  = 0;
+  }
+  __atomic_store_n(&thread->_trace, next, __ATOMIC_RELAXED);
+
+  if (full)
+  {
+    if (full->_session == session && full->_chunk._events)
+    {
+      _trace_queue(full);
+    }
+    else
+    {
+      _trace_release(full);
+    }
+  }
+  if (!next)
+  {
+    atomic_fetch_add_explicit(&g_prof_trace_dropped, 1, memory_order_relaxed);
+  }
+  return next;
+}
+
+static FORCE_INLINE u8* _trace_varint(u8* out, u64 value)
+{
+  while (value >= 0x80)
+  {
+    *out++ = (u8)(value | 0x80);
+    value >>= 7;
+  }
+  *out++ = (u8)value;
+  return out;
+}
+
+static FORCE_INLINE void _trace_record(prof_thread_t* thread, u64 value, u64 index, bool begin)
+{
+  u64 now = get_cycle_count();
+
+  __atomic_store_n(&thread->_trace_busy, 1, __ATOMIC_RELAXED);
+  if (LIKELY(atomic_load_explicit(&g_prof_trace_barrier, memory_order_relaxed)))
+  {
+    atomic_signal_fence(memory_order_seq_cst);
+  }
+  else
+  {
+    atomic_thread_fence(memory_order_seq_cst);
+  }
+
+  u32 session = atomic_load_explicit(&g_prof_trace_session, memory_order_relaxed);
+  prof_trace_buffer_t* buffer = thread->_trace;
+  if (UNLIKELY(session == 0))
+  {
+    buffer = NULL;
+  }
+  else if (UNLIKELY(!buffer || buffer->_session != session || buffer->_chunk._bytes + TRACE_EVENT_MAX > buffer->_capacity))
+  {
+    buffer = _trace_next_buffer(thread, session, now);
+  }
+
+  if (LIKELY(buffer != NULL))
+  {
+    // ticks of another cpu can be slightly behind, those events keep the previous time
+    u64 delta     = now > buffer->_last ? now - buffer->_last : 0;
+    buffer->_last = now > buffer->_last ? now : buffer->_last;
+
+    u8* out = buffer->_data + buffer->_chunk._bytes;
+    out = _trace_varint(out, (delta << 1) | value);
+    if (begin)
+    {
+      out = _trace_varint(out, index);
+    }
+    buffer->_chunk._bytes = (u32)(out - buffer->_data);
+    buffer->_chunk._events++;
+  }
+
+  __atomic_store_n(&thread->_trace_busy, 0, __ATOMIC_RELEASE);
+}
+
+u32 profiler_trace_active(void)
+{
+  return atomic_load_explicit(&g_prof_trace_session, memory_order_relaxed);
+}
+
+void profiler_trace_enter(prof_thread_t* thread, _index index)
+{
+  _trace_record(thread, 0, index, true);
+}
+
+void profiler_trace_leave(prof_thread_t* thread, u32 frames)
+{
+  for (u32 i = 0; i < frames; i++)
+  {
+    _trace_record(thread, 1, 0, false);
+  }
+}
+
+// busy like a recorded event: profiler_trace_stop() either waits for this or takes the buffer itself
+void profiler_trace_release(prof_thread_t* thread)
+{
+  __atomic_store_n(&thread->_trace_busy, 1, __ATOMIC_RELAXED);
+  atomic_thread_fence(memory_order_seq_cst);
+
+  u32 session = atomic_load_explicit(&g_prof_trace_session, memory_order_relaxed);
+  prof_trace_buffer_t* buffer = __atomic_exchange_n(&thread->_trace, NULL, __ATOMIC_ACQ_REL);
+  if (buffer)
+  {
+    if (session != 0 && buffer->_session == session && buffer->_chunk._events)
+    {
+      _trace_queue(buffer);
+    }
+    else
+    {
+      _trace_release(buffer);
+    }
+  }
+
+  __atomic_store_n(&thread->_trace_busy, 0, __ATOMIC_RELEASE);
+}
+
+u64 profiler_trace_events(void)
+{
+  return atomic_load_explicit(&g_prof_trace_events, memory_order_relaxed);
+}
+
+u64 profiler_trace_dropped(void)
+{
+  return atomic_load_explicit(&g_prof_trace_dropped, memory_order_relaxed);
+}
+
+#if !PLATFORM_WINDOWS
+
+typedef struct prof_trace_writer_t
+{
+  int                  _fd;
+  pthread_t            _thread;
+  atomic_bool          _stopping;
+  atomic_bool          _failed;
+  u32                  _session;
+  prof_trace_header_t  _header;
+} prof_trace_writer_t;
+
+static prof_trace_writer_t g_prof_trace_writer = { ._fd = -1 };
+
+static bool _trace_write(int fd, const void* data, size_t size)
+{
+  const u8* p = data;
+  while (size > 0)
+  {
+    ssize_t written = write(fd, p, size);
+    if (written <= 0)
+    {
+      return false;
+    }
+    p    += written;
+    size -= (size_t)written;
+  }
+  return true;
+}
+
+// writes the queued buffers in the order they were pushed, false when there were none
+static bool _trace_drain(void)
+{
+  prof_trace_buffer_t* taken = atomic_exchange_explicit(&g_prof_trace_queue, NULL, memory_order_acquire);
+  if (!taken)
+  {
+    return false;
+  }
+
+  prof_trace_buffer_t* ordered = NULL;
+  while (taken)
+  {
+    prof_trace_buffer_t* next = taken->_next;
+    taken->_next = ordered;
+    ordered      = taken;
+    taken        = next;
+  }
+
+  while (ordered)
+  {
+    prof_trace_buffer_t* next = ordered->_next;
+    // after a failed write the buffers are only recycled, the traced threads never wait.
+    // buffers of an earlier trace (queued by an exiting thread after its stop) are dropped
+    if (ordered->_session == g_prof_trace_writer._session &&
+        !atomic_load_explicit(&g_prof_trace_writer._failed, memory_order_relaxed))
+    {
+      if (_trace_write(g_prof_trace_writer._fd, &ordered->_record, sizeof(prof_trace_record_t) + ordered->_record._size))
+      {
+        atomic_fetch_add_explicit(&g_prof_trace_events, ordered->_chunk._events, memory_order_relaxed);
+      }
+      else
+      {
+        atomic_store_explicit(&g_prof_trace_writer._failed, true, memory_order_relaxed);
+      }
+    }
+    _trace_release(ordered);
+    ordered = next;
+  }
+  return true;
+}
+
+static void* _trace_writer_thread(void* arg)
+{
+  (void)arg;
+
+  struct timespec idle_sleep = { 0, 1000 * 1000 };
+
+  for (;;)
+  {
+    if (_trace_drain())
+    {
+      continue;
+    }
+    if (atomic_load_explicit(&g_prof_trace_writer._stopping, memory_order_acquire))
+    {
+      // buffers queued before the stop flag was set
+      while (_trace_drain())
+      {
+      }
+      return NULL;
+    }
+    nanosleep(&idle_sleep, NULL);
+  }
+}
+
+// ticks per ns over `ns` of spinning
+static f64 _trace_calibrate(u64 ns)
+{
+  u64 start_ticks = get_cycle_count();
+  u64 start_ns    = get_nanoseconds();
+  u64 now_ns      = start_ns;
+  while (now_ns - start_ns < ns)
+  {
+    now_ns = get_nanoseconds();
+  }
+  u64 ticks = get_cycle_count() - start_ticks;
+  return (f64)ticks / (f64)(now_ns - start_ns);
+}
+
+// the string table into `out`, or only its size bound when `out` is NULL
+static u64 _trace_write_strings(u8* out)
+{
+  u64    size  = 0;
+  _index count = profiler_get_function_count();
+  for (_index i = 0; i < count; i++)
+  {
+    const char* name   = profiler_get_stat_head(i)->_func_name;
+    size_t      length = strlen(name);
+    if (!out)
+    {
+      size += 20 + length + 1;
+      continue;
+    }
+
+    u8* p = _trace_varint(_trace_varint(out + size, i), length);
+    memcpy(p, name, length + 1);
+    size = (u64)(p - out) + length + 1;
+  }
+  return size;
+}
+
+static u64 _trace_write_threads(u8* out)
+{
+  u64 size = 0;
+  for (prof_thread_t* thread = profiler_thread_first(); thread; thread = thread->_next)
+  {
+    size_t length = strlen(thread->_name);
+    if (length == 0)
+    {
+      continue;
+    }
+    if (!out)
+    {
+      size += sizeof(u64) + 10 + length + 1;
+      continue;
+    }
+
+    memcpy(out + size, &thread->_tid, sizeof(u64));
+    u8* p = _trace_varint(out + size + sizeof(u64), length);
+    memcpy(p, thread->_name, length + 1);
+    size = (u64)(p - out) + length + 1;
+  }
+  return size;
+}
+
+// a tagged record built by `fill`, sized with a NULL pass first
+static bool _trace_write_table(int fd, enum prof_trace_tag tag, u64 (*fill)(u8* out))
+{
+  u64 bound = sizeof(prof_trace_record_t) + fill(NULL);
+  u8* data  = impl_mem_map(bound);
+  if (!data)
+  {
+    return false;
+  }
+
+  prof_trace_record_t record = { (u32)tag, (u32)fill(data + sizeof(prof_trace_record_t)) };
+  memcpy(data, &record, sizeof(record));
+  bool ok = _trace_write(fd, data, sizeof(record) + record._size);
+  impl_mem_unmap(data, bound);
+  return ok;
+}
+
+// the child of a fork inherits the session but not the writer thread: it closes its copy of
+// the file and drops its copies of the buffers, the parent's trace goes on untouched. the
+// free list lock may have been held by a parent thread, the child starts a fresh pool
+void profiler_trace_forked(void)
+{
+  if (g_prof_trace_writer._fd < 0)
+  {
+    return;
+  }
+
+  atomic_store(&g_prof_trace_session, 0);
+  close(g_prof_trace_writer._fd);
+  g_prof_trace_writer._fd = -1;
+
+  atomic_store(&g_prof_trace_queue, NULL);
+  g_prof_trace_free = NULL;
+  atomic_store(&g_prof_trace_buffers, 0);
+  atomic_flag_clear(&g_prof_trace_free_lock);
+  for (prof_thread_t* thread = profiler_thread_first(); thread; thread = thread->_next)
+  {
+    thread->_trace      = NULL;
+    thread->_trace_busy = 0;
+  }
+}
+
+bool profiler_trace_start(const char* path)
+{
+  if (atomic_load(&g_prof_trace_session) != 0 || g_prof_trace_writer._fd >= 0)
+  {
+    log_println("A trace is running already, not starting {str}", path);
+    return false;
+  }
+
+  int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0)
+  {
+    log_println("Failed to open {str} for writing", path);
+    return false;
+  }
+
+  prof_trace_header_t* header = &g_prof_trace_writer._header;
+  memset(header, 0, sizeof(*header));
+  memcpy(header->_magic, PROFILER_TRACE_MAGIC, sizeof(header->_magic));
+  header->_version      = PROFILER_TRACE_VERSION;
+  header->_pid          = impl_process_id();
+  header->_ticks_per_ns = _trace_calibrate(1000 * 1000);
+  header->_chunk_size   = PROFILER_TRACE_CHUNK;
+  header->_clock        = (u32)TRACE_CLOCK;
+  header->_start_ticks  = get_cycle_count();
+  header->_start_ns     = get_nanoseconds();
+
+  if (!_trace_write(fd, header, sizeof(*header)))
+  {
+    log_println("Failed to write the trace header to {str}", path);
+    close(fd);
+    return false;
+  }
+
+  // never 0, which means off
+  u32 session = g_prof_trace_generation + 1 ? g_prof_trace_generation + 1 : 1;
+
+  g_prof_trace_writer._fd      = fd;
+  g_prof_trace_writer._session = session;
+  atomic_store(&g_prof_trace_writer._stopping, false);
+  atomic_store(&g_prof_trace_writer._failed, false);
+  atomic_store(&g_prof_trace_events, 0);
+  atomic_store(&g_prof_trace_dropped, 0);
+
+  if (pthread_create(&g_prof_trace_writer._thread, NULL, _trace_writer_thread, NULL) != 0)
+  {
+    log_println("Failed to start the trace writer thread");
+    close(fd);
+    g_prof_trace_writer._fd = -1;
+    return false;
+  }
+
+  // registers for the barrier stop issues, threads skip their full fence when it works
+  atomic_store(&g_prof_trace_barrier, impl_process_barrier());
+
+  g_prof_trace_generation = session;
+  atomic_store(&g_prof_trace_session, session);
+  return true;
+}
+
+bool profiler_trace_stop(void)
+{
+  int fd = g_prof_trace_writer._fd;
+  if (fd < 0)
+  {
+    return false;
+  }
+
+  atomic_store(&g_prof_trace_session, 0);
+  u64 end_ticks = get_cycle_count();
+  u64 end_ns    = get_nanoseconds();
+
+  // a thread is either seen busy here or sees the cleared session, wait for the busy ones
+  if (!atomic_load(&g_prof_trace_barrier) || !impl_process_barrier())
+  {
+    atomic_thread_fence(memory_order_seq_cst);
+  }
+  struct timespec wait = { 0, 50 * 1000 };
+  for (prof_thread_t* thread = profiler_thread_first(); thread; thread = thread->_next)
+  {
+    while (__atomic_load_n(&thread->_trace_busy, __ATOMIC_ACQUIRE))
+    {
+      nanosleep(&wait, NULL);
+    }
+  }
+
+  for (prof_thread_t* thread = profiler_thread_first(); thread; thread = thread->_next)
+  {
+    prof_trace_buffer_t* buffer = __atomic_exchange_n(&thread->_trace, NULL, __ATOMIC_ACQ_REL);
+    if (!buffer)
+    {
+      continue;
+    }
+    if (buffer->_session == g_prof_trace_generation && buffer->_chunk._events)
+    {
+      _trace_queue(buffer);
+    }
+    else
+    {
+      _trace_release(buffer);
+    }
+  }
+
+  atomic_store_explicit(&g_prof_trace_writer._stopping, true, memory_order_release);
+  pthread_join(g_prof_trace_writer._thread, NULL);
+
+  bool ok = !atomic_load(&g_prof_trace_writer._failed);
+  ok = ok && _trace_write_table(fd, tt_strings, _trace_write_strings);
+  ok = ok && _trace_write_table(fd, tt_threads, _trace_write_threads);
+
+  prof_trace_record_t record = { tt_end, sizeof(prof_trace_end_t) };
+  prof_trace_end_t    end    = { end_ticks, end_ns, profiler_trace_events(), profiler_trace_dropped() };
+  ok = ok && _trace_write(fd, &record, sizeof(record)) && _trace_write(fd, &end, sizeof(end));
+
+  // the whole trace is a better calibration than the one at start
+  prof_trace_header_t* header = &g_prof_trace_writer._header;
+  if (end_ns > header->_start_ns + 10 * 1000 * 1000 && end_ticks > header->_start_ticks)
+  {
+    header->_ticks_per_ns = (f64)(end_ticks - header->_start_ticks) / (f64)(end_ns - header->_start_ns);
+    ok = ok && pwrite(fd, header, sizeof(*header), 0) == (ssize_t)sizeof(*header);
+  }
+
+  ok = close(fd) == 0 && ok;
+  g_prof_trace_writer._fd = -1;
+
+  if (!ok)
+  {
+    log_println("Failed to write the trace");
+  }
+  return ok;
+}
+
+#else
+
+bool profiler_trace_start(const char* path)
+{
+  (void)path;
+  NOT_IMPLEMENTED_RETURN_VAL_DETAILED(false);
+}
+
+bool profiler_trace_stop(void)
+{
+  return false;
+}
+
+void profiler_trace_forked(void)
+{
+}
+
+#endif
@@ -1,7 +1,24 @@
+#define _GNU_SOURCE
 #include <platform/platform.h>
 
 #if PLATFORM_LINUX
 
+#include <dirent.h>
+#include <execinfo.h>
+#include <linux/membarrier.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
 _cpu_cores impl_hw_get_cpu_cores(void)
 {
     NOT_IMPLEMENTED_RETURN_VAL_DETAILED(0);
@@ -27,6 +44,415 @@ _mem_size impl_hw_get_used_memory(void)
     NOT_IMPLEMENTED_RETURN_VAL_DETAILED(0);
 }
 
+void* impl_mem_map(_mem_size size)
+{
+    void* ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return ptr == MAP_FAILED ? NULL : ptr;
+}
+
+void impl_mem_unmap(void* ptr, _mem_size size)
+{
+    munmap(ptr, size);
+}
+
+uint64_t impl_thread_id(void)
+{
+    return (uint64_t)syscall(SYS_gettid);
+}
+
+bool impl_thread_cpu_sample(platform_cpu_sample_t* out)
+{
+    struct timespec ts;
+    struct rusage   usage;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0 || getrusage(RUSAGE_THREAD, &usage) != 0)
+    {
+        return false;
+    }
+
+    out->cpu_ns               = (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+    out->voluntary_switches   = (u64)usage.ru_nvcsw;
+    out->involuntary_switches = (u64)usage.ru_nivcsw;
+    return true;
+}
+
+u32 impl_process_id(void)
+{
+    return (u32)getpid();
+}
+
+u32 impl_process_parent_id(void)
+{
+    return (u32)getppid();
+}
+
+bool impl_process_barrier(void)
+{
+    // registration is per process and needed once, kernels before 4.14 have neither command
+    static int registered = 0;
+    if (__atomic_load_n(&registered, __ATOMIC_ACQUIRE) == 0)
+    {
+        int ok = syscall(SYS_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0, 0) == 0 ? 1 : -1;
+        __atomic_store_n(&registered, ok, __ATOMIC_RELEASE);
+    }
+    return __atomic_load_n(&registered, __ATOMIC_ACQUIRE) > 0 &&
+           syscall(SYS_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0, 0) == 0;
+}
+
+bool impl_process_on_fork(void (*child)(void))
+{
+    return pthread_atfork(NULL, NULL, child) == 0;
+}
+
+u32 impl_dir_list(const char* dir, const char* prefix, void (*visit)(const char* path, void* user), void* user)
+{
+    DIR* handle = opendir(dir);
+    if (!handle)
+    {
+        return 0;
+    }
+
+    u32    visited = 0;
+    size_t length  = strlen(prefix);
+    for (struct dirent* entry = readdir(handle); entry; entry = readdir(handle))
+    {
+        if (entry->d_type != DT_REG && entry->d_type != DT_UNKNOWN)
+        {
+            continue;
+        }
+        if (strncmp(entry->d_name, prefix, length) != 0)
+        {
+            continue;
+        }
+
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+        visit(path, user);
+        visited++;
+    }
+
+    closedir(handle);
+    return visited;
+}
+
+const void* impl_file_map(const char* path, u64* size)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+
+    struct stat info;
+    void* data = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && info.st_size > 0)
+    {
+        data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        return NULL;
+    }
+
+    // read front to back
+    madvise(data, (size_t)info.st_size, MADV_SEQUENTIAL);
+    *size = (u64)info.st_size;
+    return data;
+}
+
+void impl_file_unmap(const void* data, u64 size)
+{
+    if (data)
+    {
+        munmap((void*)data, (size_t)size);
+    }
+}
+
+NO_INLINE u32 impl_backtrace(void** frames, u32 capacity, u32 skip)
+{
+    void* all[64];
+    int   count = backtrace(all, 64);
+
+    u32 copied = 0;
+    for (int i = (int)skip + 1; i < count && copied < capacity; i++)  // + 1 for this function
+    {
+        frames[copied++] = all[i];
+    }
+    return copied;
+}
+
+bool impl_backtrace_symbol(const void* address, char* out, size_t size)
+{
+    void*  frame   = (void*)address;
+    char** symbols = backtrace_symbols(&frame, 1);
+    if (!symbols)
+    {
+        return false;
+    }
+
+    snprintf(out, size, "%s", symbols[0]);
+    free(symbols);
+    return true;
+}
+
+// first line of a sysfs/procfs file without the newline, false if it can't be read
+static bool _read_line(const char* path, char* out, size_t size)
+{
+    FILE* file = fopen(path, "r");
+    if (!file)
+    {
+        return false;
+    }
+
+    bool ok = fgets(out, (int)size, file) != NULL;
+    fclose(file);
+    if (ok)
+    {
+        out[strcspn(out, "\n")] = '\0';
+    }
+    return ok;
+}
+
+// "0-3,8,10-11" style cpu list
+static bool _cpu_list_contains(const char* list, u32 cpu)
+{
+    const char* p = list;
+    while (*p)
+    {
+        char* end;
+        unsigned long first = strtoul(p, &end, 10);
+        if (end == p)
+        {
+            return false;
+        }
+        unsigned long last = first;
+        if (*end == '-')
+        {
+            p = end + 1;
+            last = strtoul(p, &end, 10);
+        }
+        if (cpu >= first && cpu <= last)
+        {
+            return true;
+        }
+        p = *end == ',' ? end + 1 : end;
+    }
+    return false;
+}
+
+// busy and total jiffies of one cpu from /proc/stat
+static bool _cpu_times(u32 cpu, u64* busy, u64* total)
+{
+    FILE* file = fopen("/proc/stat", "r");
+    if (!file)
+    {
+        return false;
+    }
+
+    char name[16];
+    snprintf(name, sizeof(name), "cpu%u ", cpu);
+
+    char line[256];
+    bool found = false;
+    while (fgets(line, sizeof(line), file))
+    {
+        if (strncmp(line, name, strlen(name)) != 0)
+        {
+            continue;
+        }
+
+        unsigned long long user, nice, system, idle, iowait, irq, softirq, steal;
+        if (sscanf(line + strlen(name), "%llu %llu %llu %llu %llu %llu %llu %llu",
+                   &user, &nice, &system, &idle, &iowait, &irq, &softirq, &steal) == 8)
+        {
+            *busy  = user + nice + system + irq + softirq + steal;
+            *total = *busy + idle + iowait;
+            found  = true;
+        }
+        break;
+    }
+    fclose(file);
+    return found;
+}
+
+bool impl_bench_env_read(u32 cpu, platform_bench_env_t* out)
+{
+    memset(out, 0, sizeof(*out));
+    out->turbo       = -1;
+    out->thp         = -1;
+    out->cpu         = cpu;
+    out->online_cpus = (u32)sysconf(_SC_NPROCESSORS_ONLN);
+
+    char path[128];
+    char line[256];
+
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/cpufreq/scaling_governor", cpu);
+    if (_read_line(path, line, sizeof(line)))
+    {
+        snprintf(out->governor, sizeof(out->governor), "%.31s", line);
+    }
+
+    // intel_pstate exposes no_turbo, acpi-cpufreq / amd exposes boost
+    if (_read_line("/sys/devices/system/cpu/intel_pstate/no_turbo", line, sizeof(line)))
+    {
+        out->turbo = line[0] == '0';
+    }
+    else if (_read_line("/sys/devices/system/cpu/cpufreq/boost", line, sizeof(line)))
+    {
+        out->turbo = line[0] == '1';
+    }
+
+    if (_read_line("/sys/kernel/mm/transparent_hugepage/enabled", line, sizeof(line)))
+    {
+        out->thp = strstr(line, "[always]") ? 2 : strstr(line, "[madvise]") ? 1 : strstr(line, "[never]") ? 0 : -1;
+    }
+
+    if (_read_line("/proc/loadavg", line, sizeof(line)))
+    {
+        out->load_1m = strtod(line, NULL);
+    }
+
+    if (_read_line("/sys/devices/system/cpu/isolated", line, sizeof(line)))
+    {
+        out->isolated = _cpu_list_contains(line, cpu);
+    }
+
+    // siblings: sample their /proc/stat counters over 20ms
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/topology/thread_siblings_list", cpu);
+    if (_read_line(path, line, sizeof(line)))
+    {
+        u64 busy_begin[8], total_begin[8];
+        u32 siblings[8];
+        u32 count = 0;
+
+        for (u32 other = 0; other < out->online_cpus * 2 && other < 4096 && count < 8; other++)
+        {
+            if (other != cpu && _cpu_list_contains(line, other) && _cpu_times(other, &busy_begin[count], &total_begin[count]))
+            {
+                siblings[count++] = other;
+            }
+        }
+        out->smt_siblings = count;
+
+        if (count)
+        {
+            struct timespec wait = {0, 20 * 1000 * 1000};
+            nanosleep(&wait, NULL);
+
+            u64 busy = 0, total = 0;
+            for (u32 i = 0; i < count; i++)
+            {
+                u64 busy_end, total_end;
+                if (_cpu_times(siblings[i], &busy_end, &total_end))
+                {
+                    busy  += busy_end - busy_begin[i];
+                    total += total_end - total_begin[i];
+                }
+            }
+            out->smt_sibling_busy = total ? (f64)busy / (f64)total : 0.0;
+        }
+    }
+
+    return true;
+}
+
+u32 impl_thread_current_cpu(void)
+{
+    int cpu = sched_getcpu();
+    return cpu < 0 ? PLATFORM_CPU_NONE : (u32)cpu;
+}
+
+u32 impl_bench_pick_cpu(void)
+{
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+    {
+        return impl_thread_current_cpu();
+    }
+
+    char isolated[256] = "";
+    _read_line("/sys/devices/system/cpu/isolated", isolated, sizeof(isolated));
+
+    u32 pick = PLATFORM_CPU_NONE;
+    for (u32 cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    {
+        if (!CPU_ISSET(cpu, &allowed))
+        {
+            continue;
+        }
+        if (isolated[0] && _cpu_list_contains(isolated, cpu))
+        {
+            return cpu;
+        }
+        pick = cpu;  // cpu 0 usually takes the most interrupts, prefer the last one
+    }
+    return pick;
+}
+
+bool impl_thread_save(platform_thread_state_t* out)
+{
+    memset(out, 0, sizeof(*out));
+
+    static_assert(sizeof(out->affinity) >= sizeof(cpu_set_t), "affinity storage too small for cpu_set_t");
+    if (sched_getaffinity(0, sizeof(cpu_set_t), (cpu_set_t*)out->affinity) != 0)
+    {
+        return false;
+    }
+
+    struct sched_param param;
+    out->policy   = sched_getscheduler(0);
+    out->priority = sched_getparam(0, &param) == 0 ? param.sched_priority : 0;
+    out->nice     = getpriority(PRIO_PROCESS, 0);
+    out->saved    = true;
+    return true;
+}
+
+void impl_thread_restore(const platform_thread_state_t* state)
+{
+    if (!state->saved)
+    {
+        return;
+    }
+
+    struct sched_param param = { .sched_priority = state->priority };
+    sched_setscheduler(0, state->policy, &param);
+    setpriority(PRIO_PROCESS, 0, state->nice);
+    sched_setaffinity(0, sizeof(cpu_set_t), (const cpu_set_t*)state->affinity);
+}
+
+bool impl_thread_pin(u32 cpu)
+{
+    if (cpu >= CPU_SETSIZE)
+    {
+        return false;
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+bool impl_thread_raise_priority(void)
+{
+    // lowest realtime priority: ahead of normal tasks, behind kernel realtime threads
+    struct sched_param param = { .sched_priority = sched_get_priority_min(SCHED_FIFO) };
+    if (sched_setscheduler(0, SCHED_FIFO, &param) == 0)
+    {
+        return true;
+    }
+
+    // unprivileged: lower the nice value as far as RLIMIT_NICE allows
+    for (int nice = -20; nice < 0; nice++)
+    {
+        if (setpriority(PRIO_PROCESS, 0, nice) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
 #else
 #error "linux/impl.c included in non-Linux build!"
 #endif
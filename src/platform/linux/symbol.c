@@ -0,0 +1,168 @@
+#define _GNU_SOURCE
+#include <platform/platform.h>
+
+// symbol lookup lives apart from impl.c so only programs that name addresses
+// (perf/auto.h) need libdl
+
+#if PLATFORM_LINUX
+
+#include <dlfcn.h>
+#include <elf.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <link.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// provided by libstdc++ / libc++abi when the program is C++
+extern char* __cxa_demangle(const char* mangled, char* buffer, size_t* length, int* status) __attribute__((weak));
+
+// last object whose symbol table was read, resolving a report's worth of addresses
+// usually stays inside one or two objects
+static struct
+{
+    char   path[512];
+    void*  base;
+    size_t size;
+} g_symtab_file;
+
+static const ElfW(Ehdr)* _symtab_map(const char* path)
+{
+    if (g_symtab_file.base && strcmp(g_symtab_file.path, path) == 0)
+    {
+        return (const ElfW(Ehdr)*)g_symtab_file.base;
+    }
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+
+    struct stat info;
+    void* base = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && (size_t)info.st_size >= sizeof(ElfW(Ehdr)))
+    {
+        base = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (base == MAP_FAILED)
+    {
+        return NULL;
+    }
+
+    const ElfW(Ehdr)* header = (const ElfW(Ehdr)*)base;
+    if (memcmp(header->e_ident, ELFMAG, SELFMAG) != 0 || header->e_ident[EI_CLASS] != (sizeof(void*) == 8 ? ELFCLASS64 : ELFCLASS32) ||
+        header->e_shoff == 0 || header->e_shoff + (size_t)header->e_shnum * sizeof(ElfW(Shdr)) > (size_t)info.st_size)
+    {
+        munmap(base, (size_t)info.st_size);
+        return NULL;
+    }
+
+    if (g_symtab_file.base)
+    {
+        munmap(g_symtab_file.base, g_symtab_file.size);
+    }
+    snprintf(g_symtab_file.path, sizeof(g_symtab_file.path), "%s", path);
+    g_symtab_file.base = base;
+    g_symtab_file.size = (size_t)info.st_size;
+    return header;
+}
+
+// function symbol covering `offset` in the object's .symtab, offsets are link time addresses
+static const char* _symtab_lookup(const ElfW(Ehdr)* header, uintptr_t offset)
+{
+    const u8*         file     = (const u8*)header;
+    const ElfW(Shdr)* sections = (const ElfW(Shdr)*)(file + header->e_shoff);
+
+    for (u32 i = 0; i < header->e_shnum; i++)
+    {
+        if (sections[i].sh_type != SHT_SYMTAB || sections[i].sh_link >= header->e_shnum || sections[i].sh_entsize == 0)
+        {
+            continue;
+        }
+
+        const ElfW(Shdr)* strings = &sections[sections[i].sh_link];
+        if (sections[i].sh_offset + sections[i].sh_size > g_symtab_file.size ||
+            strings->sh_offset + strings->sh_size > g_symtab_file.size)
+        {
+            return NULL;
+        }
+
+        const ElfW(Sym)* symbols = (const ElfW(Sym)*)(file + sections[i].sh_offset);
+        size_t           count   = sections[i].sh_size / sections[i].sh_entsize;
+        for (size_t s = 0; s < count; s++)
+        {
+            if (ELF64_ST_TYPE(symbols[s].st_info) != STT_FUNC || symbols[s].st_name >= strings->sh_size)
+            {
+                continue;
+            }
+            if (offset >= symbols[s].st_value && offset < symbols[s].st_value + (symbols[s].st_size ? symbols[s].st_size : 1))
+            {
+                return (const char*)(file + strings->sh_offset + symbols[s].st_name);
+            }
+        }
+    }
+    return NULL;
+}
+
+bool impl_symbol_name(const void* address, char* name, size_t name_size, char* module, size_t module_size)
+{
+    Dl_info info;
+    if (dladdr(address, &info) == 0)
+    {
+        return false;
+    }
+
+    // the main program reports argv[0] (or nothing), which is relative to the starting directory
+    bool        program = !info.dli_fname || !info.dli_fname[0] || strcmp(info.dli_fname, program_invocation_name) == 0;
+    const char* path    = program ? "/proc/self/exe" : info.dli_fname;
+    snprintf(module, module_size, "%s", program && info.dli_fname && info.dli_fname[0] ? info.dli_fname : path);
+
+    // dladdr only knows exported symbols: an address past dli_saddr may be a static function
+    // behind it, without the .symtab that stays "symbol+0xoffset"
+    const char* symbol = info.dli_sname;
+    uintptr_t   past   = symbol && info.dli_saddr ? (uintptr_t)address - (uintptr_t)info.dli_saddr : 0;
+    if (!symbol || past != 0)
+    {
+        const ElfW(Ehdr)* header = _symtab_map(path);
+        if (header)
+        {
+            // shared objects and PIE executables are linked at 0 and loaded at dli_fbase
+            uintptr_t offset = (uintptr_t)address;
+            if (header->e_type == ET_DYN)
+            {
+                offset -= (uintptr_t)info.dli_fbase;
+            }
+            const char* found = _symtab_lookup(header, offset);
+            symbol = found ? found : symbol;
+            past   = found ? 0 : past;
+        }
+    }
+
+    if (!symbol)
+    {
+        return false;
+    }
+
+    int   status    = -1;
+    char* demangled = (__cxa_demangle && symbol[0] == '_' && symbol[1] == 'Z') ? __cxa_demangle(symbol, NULL, NULL, &status) : NULL;
+    if (past != 0)
+    {
+        snprintf(name, name_size, "%s+0x%zx", status == 0 && demangled ? demangled : symbol, (size_t)past);
+    }
+    else
+    {
+        snprintf(name, name_size, "%s", status == 0 && demangled ? demangled : symbol);
+    }
+    free(demangled);
+    return true;
+}
+
+#else
+#error "linux/symbol.c included in non-Linux build!"
+#endif
@@ -2,6 +2,9 @@
 
 #if PLATFORM_MACOS
 
+#include <pthread.h>
+#include <sys/mman.h>
+
 _cpu_cores impl_hw_get_cpu_cores(void)
 {
     NOT_IMPLEMENTED_RETURN_VAL_DETAILED(0);
@@ -27,6 +30,138 @@ _mem_size impl_hw_get_used_memory(void)
     NOT_IMPLEMENTED_RETURN_VAL_DETAILED(0);
 }
 
+void* impl_mem_map(_mem_size size)
+{
+    void* ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+    return ptr == MAP_FAILED ? NULL : ptr;
+}
+
+void impl_mem_unmap(void* ptr, _mem_size size)
+{
+    munmap(ptr, size);
+}
+
+uint64_t impl_thread_id(void)
+{
+    uint64_t tid = 0;
+    pthread_threadid_np(NULL, &tid);
+    return tid;
+}
+
+bool impl_bench_env_read(u32 cpu, platform_bench_env_t* out)
+{
+    (void)cpu;
+    (void)out;
+    NOT_IMPLEMENTED_RETURN_VAL_DETAILED(false);
+}
+
+u32 impl_bench_pick_cpu(void)
+{
+    NOT_IMPLEMENTED_RETURN_VAL_DETAILED(PLATFORM_CPU_NONE);
+}
+
+u32 impl_thread_current_cpu(void)
+{
+    NOT_IMPLEMENTED_RETURN_VAL_DETAILED(PLATFORM_CPU_NONE);
+}
+
+bool impl_thread_save(platform_thread_state_t* out)
+{
+    out->saved = false;
+    NOT_IMPLEMENTED_RETURN_VAL_DETAILED(false);
+}
+
+void impl_thread_restore(const platform_thread_state_t* state)
+{
+    (void)state;
+}
+
+bool impl_thread_pin(u32 cpu)
+{
+    (void)cpu;
+    NOT_IMPLEMENTED_RETURN_VAL_DETAILED(false);
+}
+
+bool impl_thread_raise_priority(void)
+{
+    NOT_IMPLEMENTED_RETURN_VAL_DETAILED(false);
+}
+
+bool impl_thread_cpu_sample(platform_cpu_sample_t* out)
+{
+    *out = (platform_cpu_sample_t){0};
+    NOT_IMPLEMENTED_RETURN_VAL_DETAILED(false);
+}
+
+u32 impl_process_id(void)
+{
+    NOT_IMPLEMENTED_RETURN_VAL_DETAILED(0);
+}
+
+u32 impl_process_parent_id(void)
+{
+    NOT_IMPLEMENTED_RETURN_VAL_DETAILED(0);
+}
+
+// callers fall back to fences on their side
+bool impl_process_barrier(void)
+{
+    return false;
+}
+
+bool impl_process_on_fork(void (*child)(void))
+{
+    (void)child;
+    NOT_IMPLEMENTED_RETURN_VAL_DETAILED(false);
+}
+
+u32 impl_dir_list(const char* dir, const char* prefix, void (*visit)(const char* path, void* user), void* user)
+{
+    (void)dir;
+    (void)prefix;
+    (void)visit;
+    (void)user;
+    NOT_IMPLEMENTED_RETURN_VAL_DETAILED(0);
+}
+
+const void* impl_file_map(const char* path, u64* size)
+{
+    (void)path;
+    *size = 0;
+    NOT_IMPLEMENTED_RETURN_VAL_DETAILED(NULL);
+}
+
+void impl_file_unmap(const void* data, u64 size)
+{
+    (void)data;
+    (void)size;
+}
+
+u32 impl_backtrace(void** frames, u32 capacity, u32 skip)
+{
+    (void)frames;
+    (void)capacity;
+    (void)skip;
+    NOT_IMPLEMENTED_RETURN_VAL_DETAILED(0);
+}
+
+bool impl_backtrace_symbol(const void* address, char* out, size_t size)
+{
+    (void)address;
+    (void)out;
+    (void)size;
+    NOT_IMPLEMENTED_RETURN_VAL_DETAILED(false);
+}
+
+bool impl_symbol_name(const void* address, char* name, size_t name_size, char* module, size_t module_size)
+{
+    (void)address;
+    (void)name;
+    (void)name_size;
+    (void)module;
+    (void)module_size;
+    NOT_IMPLEMENTED_RETURN_VAL_DETAILED(false);
+}
 
 #else
 #error "mac/impl.c included in non-Mac build!"
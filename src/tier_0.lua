@@ -88,4 +88,12 @@ project "tier_0"
     ".",
     "%{wks.location}/include"
   }
+
+  filter "options:alloc-interpose"
+    defines {"PROFILER_ALLOC_INTERPOSE"}
+  filter {}
+
+  if _OPTIONS["clock"] then
+    defines {"PROFILER_CLOCK=pc_" .. _OPTIONS["clock"]}
+  end
 increment_project_counter()
@@ -1,132 +1,517 @@
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include <utils/log.h>
 
+#include <errno.h>
 #include <inttypes.h>
+#include <math.h>
 #include <string.h>
 
+#if PLATFORM_WINDOWS
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
 EXTERN_C_START
 
-static u16 log_parse_and_print(const char* fmt, va_list args)
+static THREAD_LOCAL char g_log_line_storage[LOG_LINE_CAPACITY];
+static THREAD_LOCAL char g_log_report_storage[LOG_REPORT_CAPACITY];
+static THREAD_LOCAL log_buffer_t g_log_report;
+
+static const char g_digit_pairs[201] =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
+
+static const u64 g_pow10[] = { 1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull };
+
+void log_write_fd(int fd, const char* data, size_t size)
+{
+  if (fd == LOG_FD_STDOUT)
+  {
+    fflush(stdout);
+  }
+
+  while (size > 0)
+  {
+#if PLATFORM_WINDOWS
+    int written = _write(fd, data, (unsigned int)size);
+#else
+    ssize_t written = write(fd, data, size);
+#endif
+    if (written < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      return;
+    }
+    data += written;
+    size -= (size_t)written;
+  }
+}
+
+void log_buffer_init(log_buffer_t* buffer, char* storage, size_t capacity, int fd)
+{
+  buffer->_data      = storage;
+  buffer->_size      = 0;
+  buffer->_capacity  = capacity;
+  buffer->_fd        = fd;
+  buffer->_truncated = false;
+}
+
+void log_buffer_flush(log_buffer_t* buffer)
+{
+  if (buffer->_fd != LOG_FD_NONE && buffer->_size > 0)
+  {
+    log_write_fd(buffer->_fd, buffer->_data, buffer->_size);
+    buffer->_size = 0;
+  }
+}
+
+static FORCE_INLINE bool _log_reserve(log_buffer_t* buffer)
+{
+  if (LIKELY(buffer->_size < buffer->_capacity))
+  {
+    return true;
+  }
+
+  if (buffer->_fd == LOG_FD_NONE)
+  {
+    buffer->_truncated = true;
+    return false;
+  }
+
+  log_buffer_flush(buffer);
+  return true;
+}
+
+static FORCE_INLINE void _log_put(log_buffer_t* buffer, char c)
+{
+  if (_log_reserve(buffer))
+  {
+    buffer->_data[buffer->_size++] = c;
+  }
+}
+
+void log_buffer_write(log_buffer_t* buffer, const char* data, size_t size)
+{
+  while (size > 0)
+  {
+    if (!_log_reserve(buffer))
+    {
+      return;
+    }
+
+    size_t room  = buffer->_capacity - buffer->_size;
+    size_t chunk = size < room ? size : room;
+
+    memcpy(buffer->_data + buffer->_size, data, chunk);
+    buffer->_size += chunk;
+    data += chunk;
+    size -= chunk;
+  }
+}
+
+static void _log_u64(log_buffer_t* buffer, u64 value)
+{
+  char  digits[24];
+  char* end = digits + sizeof(digits);
+  char* p   = end;
+
+  while (value >= 100)
+  {
+    u32 pair = (u32)(value % 100) * 2;
+    value /= 100;
+    *--p = g_digit_pairs[pair + 1];
+    *--p = g_digit_pairs[pair];
+  }
+
+  if (value >= 10)
+  {
+    u32 pair = (u32)value * 2;
+    *--p = g_digit_pairs[pair + 1];
+    *--p = g_digit_pairs[pair];
+  }
+  else
+  {
+    *--p = (char)('0' + value);
+  }
+
+  log_buffer_write(buffer, p, (size_t)(end - p));
+}
+
+static void _log_s64(log_buffer_t* buffer, s64 value)
+{
+  if (value < 0)
+  {
+    _log_put(buffer, '-');
+    _log_u64(buffer, (u64)0 - (u64)value);
+    return;
+  }
+  _log_u64(buffer, (u64)value);
+}
+
+// fixed point conversion, matches printf("%.Nf") for values below 1e15
+static void _log_f64(log_buffer_t* buffer, f64 value, u32 precision)
+{
+  if (isnan(value))
+  {
+    log_buffer_write(buffer, signbit(value) ? "-nan" : "nan", signbit(value) ? 4 : 3);
+    return;
+  }
+
+  if (signbit(value))
+  {
+    _log_put(buffer, '-');
+    value = -value;
+  }
+
+  if (isinf(value))
+  {
+    log_buffer_write(buffer, "inf", 3);
+    return;
+  }
+
+  // out of the exact u64 range, let libc deal with it
+  if (value >= 1e15)
+  {
+    char big[352];
+    int  len = snprintf(big, sizeof(big), "%.*f", (int)precision, value);
+    if (len > 0)
+    {
+      log_buffer_write(buffer, big, (size_t)len < sizeof(big) ? (size_t)len : sizeof(big) - 1);
+    }
+    return;
+  }
+
+  u64 scale  = g_pow10[precision];
+  u64 whole  = (u64)value;
+  f64 scaled = (value - (f64)whole) * (f64)scale;
+  u64 frac   = (u64)scaled;
+  f64 rest   = scaled - (f64)frac;
+
+  // round half to even like printf
+  if (rest > 0.5 || (rest == 0.5 && (frac & 1)))
+  {
+    frac++;
+  }
+
+  if (frac >= scale)
+  {
+    whole++;
+    frac -= scale;
+  }
+
+  _log_u64(buffer, whole);
+
+  if (precision == 0)
+  {
+    return;
+  }
+
+  char  digits[8];
+  char* p = digits + precision;
+  for (u32 i = 0; i < precision; i++)
+  {
+    *--p = (char)('0' + frac % 10);
+    frac /= 10;
+  }
+
+  _log_put(buffer, '.');
+  log_buffer_write(buffer, digits, precision);
+}
+
+// arguments come either from a va_list or from the raw encoding of the deferred logger
+typedef struct log_args_t
+{
+  va_list    _va;
+  const u8*  _raw;
+  const u8*  _raw_end;
+} log_args_t;
+
+static s64 _raw_slot(log_args_t* args)
+{
+  s64 value = 0;
+  if (args->_raw + LOG_RAW_SLOT <= args->_raw_end)
+  {
+    memcpy(&value, args->_raw, sizeof(value));
+    args->_raw += LOG_RAW_SLOT;
+  }
+  return value;
+}
+
+// int sized arguments ({u8} .. {u32}, {s8} .. {s32}, {})
+static s64 _arg_int(log_args_t* args)
+{
+  if (args->_raw)
+  {
+    return _raw_slot(args);
+  }
+  return va_arg(args->_va, int);
+}
+
+static s64 _arg_int64(log_args_t* args)
+{
+  if (args->_raw)
+  {
+    return _raw_slot(args);
+  }
+  return va_arg(args->_va, s64);
+}
+
+static f64 _arg_f64(log_args_t* args)
+{
+  if (args->_raw)
+  {
+    s64 bits = _raw_slot(args);
+    f64 value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+  return va_arg(args->_va, double);
+}
+
+static void _log_arg_str(log_buffer_t* buffer, log_args_t* args)
+{
+  if (args->_raw)
+  {
+    u64 length = (u64)_raw_slot(args);
+    u64 padded = (length + LOG_RAW_SLOT - 1) & ~(u64)(LOG_RAW_SLOT - 1);
+
+    if (args->_raw + padded > args->_raw_end)
+    {
+      args->_raw = args->_raw_end;
+      return;
+    }
+    log_buffer_write(buffer, (const char*)args->_raw, (size_t)length);
+    args->_raw += padded;
+    return;
+  }
+
+  const char* str = va_arg(args->_va, const char*);
+  if (!str)
+  {
+    str = "(null)";
+  }
+  log_buffer_write(buffer, str, strlen(str));
+}
+
+// renders "fmt" into buffer, same {type} syntax as before: {u8..u64} {s8..s64} {f32} {f64} {str} and {} for int
+static void log_parse_and_print(log_buffer_t* buffer, const char* fmt, log_args_t* args)
 {
     const char* p = fmt;
-    
+
     while (*p) {
-        if (*p == '{' && *(p + 1) != '\0') {
-            p++; // skip '{'
-            
-            // check for type specifiers
-            if (*p == 'u')
+        // copy the literal run in one go
+        const char* literal = p;
+        while (*p && !(*p == '{' && *(p + 1) != '\0'))
+        {
+            p++;
+        }
+        if (p != literal)
+        {
+            log_buffer_write(buffer, literal, (size_t)(p - literal));
+            continue;
+        }
+
+        p++; // skip '{'
+
+        // check for type specifiers
+        if (*p == 'u')
+        {
+            p++;
+            if (*p == '8' && *(p + 1) == '}') {
+                _log_u64(buffer, (u8)_arg_int(args));
+                p += 2;
+            }
+            else if (*p == '1' && *(p + 1) == '6' && *(p + 2) == '}')
             {
-                p++;
-                if (*p == '8' && *(p + 1) == '}') {
-                    log_u8(va_arg(args, int));
-                    p += 2;
-                }
-                else if (*p == '1' && *(p + 1) == '6' && *(p + 2) == '}')
-                {
-                    log_u16(va_arg(args, int));
-                    p += 3;
-                } 
-                else if (*p == '3' && *(p + 1) == '2' && *(p + 2) == '}') 
-                {
-                    log_u32(va_arg(args, u32));
-                    p += 3;
-                } 
-                else if (*p == '6' && *(p + 1) == '4' && *(p + 2) == '}')
-                {
-                    log_u64(va_arg(args, u64));
-                    p += 3;
-                } 
-                else 
-                {
-                    putchar('{');
-                    putchar('u');
-                }
+                _log_u64(buffer, (u16)_arg_int(args));
+                p += 3;
             }
-            else if(*p == 's')
+            else if (*p == '3' && *(p + 1) == '2' && *(p + 2) == '}')
             {
-                p++;
-                if (*p == '8' && *(p + 1) == '}') 
-                {
-                    log_s8(va_arg(args, int));
-                    p += 2;
-                } 
-                else if (*p == '1' && *(p + 1) == '6' && *(p + 2) == '}')
-                {
-                    log_s16(va_arg(args, int));
-                    p += 3;
-                } 
-                else if (*p == '3' && *(p + 1) == '2' && *(p + 2) == '}')
-                {
-                    log_s32(va_arg(args, s32));
-                    p += 3;
-                } 
-                else if (*p == '6' && *(p + 1) == '4' && *(p + 2) == '}')
-                {
-                    log_s64(va_arg(args, s64));
-                    p += 3;
-                } 
-                else if (strncmp(p, "tr}", 3) == 0)
-                {
-                    log_str(va_arg(args, const char*));
-                    p += 3;
-                } 
-                else 
-                {
-                    putchar('{');
-                    putchar('s');
-                }
+                _log_u64(buffer, (u32)_arg_int(args));
+                p += 3;
             }
-            else if (*p == 'f') 
+            else if (*p == '6' && *(p + 1) == '4' && *(p + 2) == '}')
             {
-                p++;
-                if (*p == '3' && *(p + 1) == '2' && *(p + 2) == '}') {
-                    log_f32(va_arg(args, double));
-                    p += 3;
-                } else if (*p == '6' && *(p + 1) == '4' && *(p + 2) == '}') {
-                    log_f64(va_arg(args, double));
-                    p += 3;
-                } else {
-                    putchar('{');
-                    putchar('f');
-                }
+                _log_u64(buffer, (u64)_arg_int64(args));
+                p += 3;
             }
-            else if (*p == '}') 
+            else
             {
-                // Default to int for bare {}
-                printf("%d", va_arg(args, int));
-                p++;
+                log_buffer_write(buffer, "{u", 2);
             }
-            else 
+        }
+        else if(*p == 's')
+        {
+            p++;
+            if (*p == '8' && *(p + 1) == '}')
             {
-                // Unknown format, just print it
-                putchar('{');
+                _log_s64(buffer, (s8)_arg_int(args));
+                p += 2;
+            }
+            else if (*p == '1' && *(p + 1) == '6' && *(p + 2) == '}')
+            {
+                _log_s64(buffer, (s16)_arg_int(args));
+                p += 3;
+            }
+            else if (*p == '3' && *(p + 1) == '2' && *(p + 2) == '}')
+            {
+                _log_s64(buffer, (s32)_arg_int(args));
+                p += 3;
+            }
+            else if (*p == '6' && *(p + 1) == '4' && *(p + 2) == '}')
+            {
+                _log_s64(buffer, _arg_int64(args));
+                p += 3;
+            }
+            else if (strncmp(p, "tr}", 3) == 0)
+            {
+                _log_arg_str(buffer, args);
+                p += 3;
+            }
+            else
+            {
+                log_buffer_write(buffer, "{s", 2);
             }
         }
-        else 
+        else if (*p == 'f')
         {
-            putchar(*p);
+            p++;
+            if (*p == '3' && *(p + 1) == '2' && *(p + 2) == '}') {
+                _log_f64(buffer, (f32)_arg_f64(args), 2);
+                p += 3;
+            } else if (*p == '6' && *(p + 1) == '4' && *(p + 2) == '}') {
+                _log_f64(buffer, _arg_f64(args), 4);
+                p += 3;
+            } else {
+                log_buffer_write(buffer, "{f", 2);
+            }
+        }
+        else if (*p == '}')
+        {
+            // Default to int for bare {}
+            _log_s64(buffer, (int)_arg_int(args));
             p++;
         }
+        else
+        {
+            // Unknown format, just print it
+            _log_put(buffer, '{');
+        }
     }
-    
-    return 0;
 }
 
-void log_print(const char* fmt, ...)
+void log_buffer_vprint(log_buffer_t* buffer, const char* fmt, va_list args)
+{
+    log_args_t source = { ._raw = NULL };
+    va_copy(source._va, args);
+    log_parse_and_print(buffer, fmt, &source);
+    va_end(source._va);
+}
+
+void log_buffer_print_raw(log_buffer_t* buffer, const char* fmt, const void* args, size_t size)
+{
+    log_args_t source = { ._raw = (const u8*)args, ._raw_end = (const u8*)args + size };
+    log_parse_and_print(buffer, fmt, &source);
+}
+
+void log_buffer_print(log_buffer_t* buffer, const char* fmt, ...)
+{
+    log_args_t source = { ._raw = NULL };
+    va_start(source._va, fmt);
+    log_parse_and_print(buffer, fmt, &source);
+    va_end(source._va);
+}
+
+void log_buffer_println(log_buffer_t* buffer, const char* fmt, ...)
+{
+    log_args_t source = { ._raw = NULL };
+    va_start(source._va, fmt);
+    log_parse_and_print(buffer, fmt, &source);
+    va_end(source._va);
+    _log_put(buffer, '\n');
+}
+
+size_t log_vformat(char* buf, size_t capacity, const char* fmt, va_list args)
+{
+    if (capacity == 0)
+    {
+        return 0;
+    }
+
+    log_buffer_t buffer;
+    log_buffer_init(&buffer, buf, capacity - 1, LOG_FD_NONE);
+    log_buffer_vprint(&buffer, fmt, args);
+    buf[buffer._size] = '\0';
+    return buffer._size;
+}
+
+size_t log_format(char* buf, size_t capacity, const char* fmt, ...)
 {
     va_list args;
     va_start(args, fmt);
-    log_parse_and_print(fmt, args);
+    size_t size = log_vformat(buf, capacity, fmt, args);
     va_end(args);
+    return size;
+}
+
+log_buffer_t* log_report_buffer(void)
+{
+    if (g_log_report._data == NULL)
+    {
+        log_buffer_init(&g_log_report, g_log_report_storage, sizeof(g_log_report_storage), LOG_FD_STDOUT);
+    }
+    return &g_log_report;
+}
+
+// single lines go through stdio: buffered when redirected, a write per line would cost more
+// than the formatting saves. long lines spill through log_write_fd(), which flushes first
+static void _log_emit_line(log_buffer_t* buffer)
+{
+    fwrite(buffer->_data, 1, buffer->_size, stdout);
+    buffer->_size = 0;
+}
+
+void log_print(const char* fmt, ...)
+{
+    log_buffer_t buffer;
+    log_buffer_init(&buffer, g_log_line_storage, sizeof(g_log_line_storage), LOG_FD_STDOUT);
+
+    log_args_t source = { ._raw = NULL };
+    va_start(source._va, fmt);
+    log_parse_and_print(&buffer, fmt, &source);
+    va_end(source._va);
+
+    _log_emit_line(&buffer);
 }
 
 void log_println(const char* fmt, ...)
 {
-    va_list args;
-    va_start(args, fmt);
-    log_parse_and_print(fmt, args);
-    va_end(args);
-    putchar('\n');
+    log_buffer_t buffer;
+    log_buffer_init(&buffer, g_log_line_storage, sizeof(g_log_line_storage), LOG_FD_STDOUT);
+
+    log_args_t source = { ._raw = NULL };
+    va_start(source._va, fmt);
+    log_parse_and_print(&buffer, fmt, &source);
+    va_end(source._va);
+
+    _log_put(&buffer, '\n');
+    _log_emit_line(&buffer);
 }
 
 EXTERN_C_END
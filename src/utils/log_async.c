@@ -0,0 +1,595 @@
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <utils/log_async.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#if !PLATFORM_WINDOWS
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#endif
+
+#define LOG_ASYNC_HEADER_SIZE 16
+#define LOG_ASYNC_CACHE_LINE  64
+
+#define LOG_ASYNC_PARSING 1  // log_async_site_t::_parsed
+#define LOG_ASYNC_PARSED  2
+
+#define LOG_ASYNC_RING_LIVE    0  // log_async_ring_t::_state
+#define LOG_ASYNC_RING_RETIRED 1  // its thread exited, free for the next one once drained
+
+EXTERN_C_START
+
+typedef struct log_async_header_t
+{
+  u64 _site;  // log_async_site_t*, 0 marks padding up to the end of the ring
+  u32 _size;  // whole record including this header, multiple of LOG_RAW_SLOT
+  u32 _reserved;
+} log_async_header_t;
+
+static_assert(sizeof(log_async_header_t) == LOG_ASYNC_HEADER_SIZE, "log_async_header_t isnt 16 bytes!");
+
+static void _site_parse(log_async_site_t* site)
+{
+  const char* p = site->_fmt;
+  u8  count     = 0;
+  u32 max_size  = LOG_ASYNC_HEADER_SIZE;
+
+  while (*p && count < LOG_ASYNC_MAX_ARGS)
+  {
+    if (*p != '{' || *(p + 1) == '\0')
+    {
+      p++;
+      continue;
+    }
+    p++;
+
+    u8 kind = 0xff;
+    if      (strncmp(p, "u8}", 3) == 0  || strncmp(p, "s8}", 3) == 0)  { kind = lak_int;   p += 3; }
+    else if (strncmp(p, "u16}", 4) == 0 || strncmp(p, "s16}", 4) == 0 ||
+             strncmp(p, "u32}", 4) == 0 || strncmp(p, "s32}", 4) == 0) { kind = lak_int;   p += 4; }
+    else if (strncmp(p, "u64}", 4) == 0 || strncmp(p, "s64}", 4) == 0) { kind = lak_int64; p += 4; }
+    else if (strncmp(p, "f32}", 4) == 0 || strncmp(p, "f64}", 4) == 0) { kind = lak_f64;   p += 4; }
+    else if (strncmp(p, "str}", 4) == 0)                                { kind = lak_str;   p += 4; }
+    else if (*p == '}')                                                 { kind = lak_int;   p += 1; }
+
+    if (kind == 0xff)
+    {
+      continue;
+    }
+
+    site->_args[count++] = kind;
+    max_size += LOG_RAW_SLOT;
+    if (kind == lak_str)
+    {
+      max_size += LOG_ASYNC_MAX_STR;
+    }
+  }
+
+  site->_arg_count = count;
+  site->_max_size  = max_size;
+}
+
+// writes the raw arguments after the header, returns the record size
+static u32 _encode(const log_async_site_t* site, u8* record, va_list* args)
+{
+  u8* p = record + LOG_ASYNC_HEADER_SIZE;
+
+  for (u8 i = 0; i < site->_arg_count; i++)
+  {
+    s64 slot = 0;
+    switch (site->_args[i])
+    {
+      case lak_int:
+        slot = va_arg(*args, int);
+        break;
+
+      case lak_int64:
+        slot = va_arg(*args, s64);
+        break;
+
+      case lak_f64:
+      {
+        f64 value = va_arg(*args, double);
+        memcpy(&slot, &value, sizeof(slot));
+        break;
+      }
+
+      case lak_str:
+      {
+        const char* str = va_arg(*args, const char*);
+        if (!str)
+        {
+          str = "(null)";
+        }
+
+        size_t length = 0;
+        while (length < LOG_ASYNC_MAX_STR && str[length])
+        {
+          length++;
+        }
+
+        slot = (s64)length;
+        memcpy(p, &slot, sizeof(slot));
+        memcpy(p + LOG_RAW_SLOT, str, length);
+        p += LOG_RAW_SLOT + ((length + LOG_RAW_SLOT - 1) & ~(size_t)(LOG_RAW_SLOT - 1));
+        continue;
+      }
+    }
+
+    memcpy(p, &slot, sizeof(slot));
+    p += LOG_RAW_SLOT;
+  }
+
+  log_async_header_t header = { (u64)(uintptr_t)site, (u32)(p - record), 0 };
+  memcpy(record, &header, sizeof(header));
+  return header._size;
+}
+
+static void _format_record(log_buffer_t* out, const u8* record)
+{
+  log_async_header_t header;
+  memcpy(&header, record, sizeof(header));
+
+  const log_async_site_t* site = (const log_async_site_t*)(uintptr_t)header._site;
+  log_buffer_print_raw(out, site->_fmt, record + LOG_ASYNC_HEADER_SIZE, header._size - LOG_ASYNC_HEADER_SIZE);
+  log_buffer_write(out, "\n", 1);
+}
+
+static void _write_sync(log_async_site_t* site, va_list* args)
+{
+  u8 record[LOG_ASYNC_HEADER_SIZE + LOG_ASYNC_MAX_ARGS * (LOG_RAW_SLOT * 2 + LOG_ASYNC_MAX_STR)];
+  _encode(site, record, args);
+
+  char line[LOG_LINE_CAPACITY];
+  log_buffer_t out;
+  log_buffer_init(&out, line, sizeof(line), LOG_FD_STDOUT);
+  _format_record(&out, record);
+  log_buffer_flush(&out);
+}
+
+#if !PLATFORM_WINDOWS
+
+// single producer (the owning thread) / single consumer (the formatting thread)
+typedef struct log_async_ring_t
+{
+  ALIGNAS(LOG_ASYNC_CACHE_LINE) _Atomic u64 _head;
+  u64                                       _cached_tail;
+
+  ALIGNAS(LOG_ASYNC_CACHE_LINE) _Atomic u64 _tail;
+
+  ALIGNAS(LOG_ASYNC_CACHE_LINE) _Atomic u64 _dropped;
+  _Atomic u32                               _state;
+  u8*                                       _data;
+  u64                                       _capacity;
+  struct log_async_ring_t*                  _next;
+} log_async_ring_t;
+
+typedef struct log_async_state_t
+{
+  _Atomic bool                _running;
+  _Atomic bool                _idle;
+  _Atomic(log_async_ring_t*)  _rings;
+  size_t                      _ring_bytes;
+  u64                         _freed_dropped;   // drops of rings freed at shutdown
+  pthread_t                   _thread;
+  pthread_mutex_t             _lock;
+  pthread_key_t               _key;
+  pthread_once_t              _key_once;
+  char                        _storage[LOG_REPORT_CAPACITY];
+} log_async_state_t;
+
+static log_async_state_t g_log_async = { ._lock = PTHREAD_MUTEX_INITIALIZER, ._key_once = PTHREAD_ONCE_INIT };
+static THREAD_LOCAL log_async_ring_t* t_log_ring = NULL;
+
+// thread exit, the ring stays in the list until the consumer drained it
+static void _ring_retire(void* data)
+{
+  log_async_ring_t* ring = data;
+  t_log_ring = NULL;
+  atomic_store_explicit(&ring->_state, LOG_ASYNC_RING_RETIRED, memory_order_release);
+}
+
+static void _ring_key_create(void)
+{
+  pthread_key_create(&g_log_async._key, _ring_retire);
+}
+
+// a ring left behind by an exited thread, empty and of the current size
+static log_async_ring_t* _ring_reuse(void)
+{
+  for (log_async_ring_t* ring = atomic_load_explicit(&g_log_async._rings, memory_order_acquire); ring; ring = ring->_next)
+  {
+    u32 retired = LOG_ASYNC_RING_RETIRED;
+    if (ring->_capacity != g_log_async._ring_bytes ||
+        atomic_load_explicit(&ring->_state, memory_order_acquire) != LOG_ASYNC_RING_RETIRED ||
+        atomic_load_explicit(&ring->_tail, memory_order_acquire) != atomic_load_explicit(&ring->_head, memory_order_relaxed))
+    {
+      continue;
+    }
+    if (atomic_compare_exchange_strong_explicit(&ring->_state, &retired, LOG_ASYNC_RING_LIVE, memory_order_acquire,
+                                                memory_order_relaxed))
+    {
+      ring->_cached_tail = atomic_load_explicit(&ring->_tail, memory_order_relaxed);
+      return ring;
+    }
+  }
+  return NULL;
+}
+
+static log_async_ring_t* _ring_register(void)
+{
+  pthread_once(&g_log_async._key_once, _ring_key_create);
+
+  log_async_ring_t* ring = _ring_reuse();
+  if (ring)
+  {
+    t_log_ring = ring;
+    pthread_setspecific(g_log_async._key, ring);
+    return ring;
+  }
+
+  ring = calloc(1, sizeof(log_async_ring_t));
+  if (!ring)
+  {
+    return NULL;
+  }
+
+  ring->_capacity = g_log_async._ring_bytes;
+  ring->_data     = malloc(ring->_capacity);
+  if (!ring->_data)
+  {
+    free(ring);
+    return NULL;
+  }
+
+  // fault the pages in now instead of on the logging path
+  memset(ring->_data, 0, ring->_capacity);
+
+  pthread_mutex_lock(&g_log_async._lock);
+  ring->_next = atomic_load_explicit(&g_log_async._rings, memory_order_relaxed);
+  atomic_store_explicit(&g_log_async._rings, ring, memory_order_release);
+  pthread_mutex_unlock(&g_log_async._lock);
+
+  t_log_ring = ring;
+  pthread_setspecific(g_log_async._key, ring);
+  return ring;
+}
+
+// rings of exited threads, drained by the consumer's last pass. live ones stay, their
+// threads still point at them
+static void _ring_free_retired(void)
+{
+  pthread_mutex_lock(&g_log_async._lock);
+  log_async_ring_t*  ring = atomic_load_explicit(&g_log_async._rings, memory_order_relaxed);
+  log_async_ring_t*  kept = NULL;
+  log_async_ring_t** link = &kept;
+  while (ring)
+  {
+    log_async_ring_t* next = ring->_next;
+    if (atomic_load_explicit(&ring->_state, memory_order_acquire) != LOG_ASYNC_RING_RETIRED)
+    {
+      *link = ring;
+      link  = &ring->_next;
+    }
+    else
+    {
+      g_log_async._freed_dropped += atomic_load_explicit(&ring->_dropped, memory_order_relaxed);
+      free(ring->_data);
+      free(ring);
+    }
+    ring = next;
+  }
+  *link = NULL;
+  atomic_store_explicit(&g_log_async._rings, kept, memory_order_release);
+  pthread_mutex_unlock(&g_log_async._lock);
+}
+
+static bool _ring_push(log_async_ring_t* ring, log_async_site_t* site, va_list* args)
+{
+  u64 head       = atomic_load_explicit(&ring->_head, memory_order_relaxed);
+  u64 offset     = head & (ring->_capacity - 1);
+  u64 contiguous = ring->_capacity - offset;
+  u64 needed     = contiguous < site->_max_size ? contiguous + site->_max_size : site->_max_size;
+
+  if (ring->_capacity - (head - ring->_cached_tail) < needed)
+  {
+    ring->_cached_tail = atomic_load_explicit(&ring->_tail, memory_order_acquire);
+    if (ring->_capacity - (head - ring->_cached_tail) < needed)
+    {
+      atomic_fetch_add_explicit(&ring->_dropped, 1, memory_order_relaxed);
+      return false;
+    }
+  }
+
+  // records never wrap, pad to the end of the ring instead
+  if (contiguous < site->_max_size)
+  {
+    if (contiguous >= LOG_ASYNC_HEADER_SIZE)
+    {
+      log_async_header_t pad = { 0, (u32)contiguous, 0 };
+      memcpy(ring->_data + offset, &pad, sizeof(pad));
+    }
+    head  += contiguous;
+    offset = 0;
+  }
+
+  u32 size = _encode(site, ring->_data + offset, args);
+  atomic_store_explicit(&ring->_head, head + size, memory_order_release);
+  return true;
+}
+
+static bool _ring_drain(log_async_ring_t* ring, log_buffer_t* out)
+{
+  u64 tail = atomic_load_explicit(&ring->_tail, memory_order_relaxed);
+  u64 head = atomic_load_explicit(&ring->_head, memory_order_acquire);
+
+  if (tail == head)
+  {
+    return false;
+  }
+
+  while (tail != head)
+  {
+    u64 offset     = tail & (ring->_capacity - 1);
+    u64 contiguous = ring->_capacity - offset;
+
+    if (contiguous < LOG_ASYNC_HEADER_SIZE)
+    {
+      tail += contiguous;
+      continue;
+    }
+
+    log_async_header_t header;
+    memcpy(&header, ring->_data + offset, sizeof(header));
+
+    if (header._site != 0)
+    {
+      _format_record(out, ring->_data + offset);
+    }
+    tail += header._size;
+  }
+
+  atomic_store_explicit(&ring->_tail, tail, memory_order_release);
+  return true;
+}
+
+static bool _drain_all(log_buffer_t* out)
+{
+  bool consumed = false;
+  for (log_async_ring_t* ring = atomic_load_explicit(&g_log_async._rings, memory_order_acquire); ring; ring = ring->_next)
+  {
+    consumed |= _ring_drain(ring, out);
+  }
+  return consumed;
+}
+
+static void* _log_async_thread(void* arg)
+{
+  (void)arg;
+
+  log_buffer_t out;
+  log_buffer_init(&out, g_log_async._storage, sizeof(g_log_async._storage), LOG_FD_STDOUT);
+
+  struct timespec idle_sleep = { 0, 200 * 1000 };
+
+  while (atomic_load_explicit(&g_log_async._running, memory_order_acquire))
+  {
+    if (_drain_all(&out))
+    {
+      atomic_store_explicit(&g_log_async._idle, false, memory_order_relaxed);
+      continue;
+    }
+
+    log_buffer_flush(&out);
+    atomic_store_explicit(&g_log_async._idle, true, memory_order_release);
+    nanosleep(&idle_sleep, NULL);
+  }
+
+  // take what is left, records pushed while shutting down may still be lost
+  while (_drain_all(&out))
+  {
+  }
+  log_buffer_flush(&out);
+  return NULL;
+}
+
+bool log_async_init(size_t ring_bytes)
+{
+  if (atomic_load(&g_log_async._running))
+  {
+    return true;
+  }
+
+  if (ring_bytes == 0)
+  {
+    ring_bytes = LOG_ASYNC_RING_DEFAULT;
+  }
+
+  // round up to a power of two that can hold the largest record
+  size_t capacity = 16 * 1024;
+  while (capacity < ring_bytes)
+  {
+    capacity <<= 1;
+  }
+  g_log_async._ring_bytes = capacity;
+
+  atomic_store(&g_log_async._idle, false);
+  atomic_store(&g_log_async._running, true);
+
+  if (pthread_create(&g_log_async._thread, NULL, _log_async_thread, NULL) != 0)
+  {
+    atomic_store(&g_log_async._running, false);
+    log_println("Failed to start the async log thread");
+    return false;
+  }
+  return true;
+}
+
+void log_async_shutdown(void)
+{
+  if (!atomic_load(&g_log_async._running))
+  {
+    return;
+  }
+
+  atomic_store_explicit(&g_log_async._running, false, memory_order_release);
+  pthread_join(g_log_async._thread, NULL);
+  _ring_free_retired();
+
+  u64 dropped = log_async_dropped();
+  if (dropped > 0)
+  {
+    log_println("async log dropped {u64} records", dropped);
+  }
+}
+
+void log_async_flush(void)
+{
+  struct timespec wait = { 0, 100 * 1000 };
+
+  while (atomic_load_explicit(&g_log_async._running, memory_order_acquire))
+  {
+    bool pending = false;
+    for (log_async_ring_t* ring = atomic_load_explicit(&g_log_async._rings, memory_order_acquire); ring; ring = ring->_next)
+    {
+      if (atomic_load_explicit(&ring->_tail, memory_order_acquire) != atomic_load_explicit(&ring->_head, memory_order_acquire))
+      {
+        pending = true;
+        break;
+      }
+    }
+
+    if (!pending)
+    {
+      // one more idle transition guarantees the output buffer was flushed
+      atomic_store_explicit(&g_log_async._idle, false, memory_order_release);
+      while (atomic_load_explicit(&g_log_async._running, memory_order_acquire) &&
+             !atomic_load_explicit(&g_log_async._idle, memory_order_acquire))
+      {
+        nanosleep(&wait, NULL);
+      }
+      return;
+    }
+    nanosleep(&wait, NULL);
+  }
+}
+
+u64 log_async_dropped(void)
+{
+  pthread_mutex_lock(&g_log_async._lock);
+  u64 dropped = g_log_async._freed_dropped;
+  for (log_async_ring_t* ring = atomic_load_explicit(&g_log_async._rings, memory_order_acquire); ring; ring = ring->_next)
+  {
+    dropped += atomic_load_explicit(&ring->_dropped, memory_order_relaxed);
+  }
+  pthread_mutex_unlock(&g_log_async._lock);
+  return dropped;
+}
+
+u32 log_async_rings(void)
+{
+  pthread_mutex_lock(&g_log_async._lock);
+  u32 count = 0;
+  for (log_async_ring_t* ring = atomic_load_explicit(&g_log_async._rings, memory_order_acquire); ring; ring = ring->_next)
+  {
+    count++;
+  }
+  pthread_mutex_unlock(&g_log_async._lock);
+  return count;
+}
+
+// the first caller parses, callers racing it wait. the release store publishes the arguments
+// to every thread that loads _parsed as LOG_ASYNC_PARSED
+static void _site_ready(log_async_site_t* site)
+{
+  u8 expected = 0;
+  if (__atomic_compare_exchange_n(&site->_parsed, &expected, LOG_ASYNC_PARSING, false, __ATOMIC_ACQUIRE,
+                                  __ATOMIC_ACQUIRE))
+  {
+    _site_parse(site);
+    __atomic_store_n(&site->_parsed, LOG_ASYNC_PARSED, __ATOMIC_RELEASE);
+    return;
+  }
+  while (__atomic_load_n(&site->_parsed, __ATOMIC_ACQUIRE) != LOG_ASYNC_PARSED)
+  {
+  }
+}
+
+void log_async_write(log_async_site_t* site, ...)
+{
+  if (UNLIKELY(__atomic_load_n(&site->_parsed, __ATOMIC_ACQUIRE) != LOG_ASYNC_PARSED))
+  {
+    _site_ready(site);
+  }
+
+  va_list args;
+  va_start(args, site);
+
+  log_async_ring_t* ring = t_log_ring;
+  if (LIKELY(atomic_load_explicit(&g_log_async._running, memory_order_relaxed)))
+  {
+    if (UNLIKELY(!ring))
+    {
+      ring = _ring_register();
+    }
+
+    if (LIKELY(ring != NULL))
+    {
+      _ring_push(ring, site, &args);
+      va_end(args);
+      return;
+    }
+  }
+
+  _write_sync(site, &args);
+  va_end(args);
+}
+
+#else
+
+bool log_async_init(size_t ring_bytes)
+{
+  (void)ring_bytes;
+  NOT_IMPLEMENTED_RETURN_VAL_DETAILED(false);
+}
+
+void log_async_shutdown(void)
+{
+}
+
+void log_async_flush(void)
+{
+}
+
+u64 log_async_dropped(void)
+{
+  return 0;
+}
+
+u32 log_async_rings(void)
+{
+  return 0;
+}
+
+void log_async_write(log_async_site_t* site, ...)
+{
+  if (site->_parsed != LOG_ASYNC_PARSED)
+  {
+    _site_parse(site);
+    site->_parsed = LOG_ASYNC_PARSED;
+  }
+
+  va_list args;
+  va_start(args, site);
+  _write_sync(site, &args);
+  va_end(args);
+}
+
+#endif
+
+EXTERN_C_END
@@ -0,0 +1,100 @@
+#include <tier_0.h>
+
+#include <string.h>
+
+#define KEY_SIZE 4096
+
+static uint8_t           g_key[KEY_SIZE];
+static volatile uint64_t g_sink = 0;
+
+// byte at a time fnv-1a
+static void hash_bytes(void* data)
+{
+  const uint8_t* key = data;
+  uint64_t hash = 14695981039346656037ull;
+  for (size_t i = 0; i < KEY_SIZE; i++)
+  {
+    hash = (hash ^ key[i]) * 1099511628211ull;
+  }
+  g_sink += hash;
+}
+
+// same mixing on 8 bytes at a time, roughly 8x fewer multiplies
+static void hash_words(void* data)
+{
+  const uint8_t* key = data;
+  uint64_t hash = 14695981039346656037ull;
+  for (size_t i = 0; i < KEY_SIZE; i += 8)
+  {
+    uint64_t word;
+    memcpy(&word, key + i, sizeof(word));
+    hash = (hash ^ word) * 1099511628211ull;
+  }
+  g_sink += hash;
+}
+
+int main(void)
+{
+  profiler_init();
+
+  for (uint32_t i = 0; i < KEY_SIZE; i++)
+  {
+    g_key[i] = (uint8_t)(i * 2654435761u >> 24);
+  }
+
+  // the macro form, order picked per round
+  for (uint32_t round = 0; round < 400; round++)
+  {
+    uint32_t first = PROFILE_AB_FIRST(hash);
+    for (uint32_t k = 0; k < 2; k++)
+    {
+      uint32_t variant = first ^ k;
+      PROFILE_AB(hash, variant)
+      {
+        if (variant)
+        {
+          hash_words(g_key);
+        }
+        else
+        {
+          hash_bytes(g_key);
+        }
+      }
+    }
+  }
+
+  // the same implementation on both sides
+  profiler_ab_compare("same", hash_bytes, hash_bytes, g_key, 400);
+
+  profiler_end();
+  profiler_print_all();
+
+  prof_ab_result_t hash;
+  prof_ab_result_t same;
+  if (!profiler_ab_result("hash", &hash) || !profiler_ab_result("same", &same))
+  {
+    log_println("missing comparison");
+    return 1;
+  }
+
+  if (hash._pairs != 400 || hash._speedup < 2.0 || hash._speedup_low > hash._speedup ||
+      hash._speedup_high < hash._speedup || !hash._significant)
+  {
+    log_println("hash comparison mismatch, speedup {f64} p {f64}", hash._speedup, hash._p_value);
+    return 1;
+  }
+
+  if (same._pairs != 400 || same._speedup < 0.5 || same._speedup > 2.0)
+  {
+    log_println("identical variants differ, speedup {f64}", same._speedup);
+    return 1;
+  }
+
+  _index variant = profiler_find_site("hash[1]", pk_function);
+  if (variant == (_index)-1 || profiler_get_call_stat(variant)->_total_calls != 400)
+  {
+    log_println("variant site stats mismatch");
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,112 @@
+#include <tier_0.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct node_t
+{
+  struct node_t* next;
+  uint64_t       value;
+} node_t;
+
+node_t* build_list(uint32_t count)
+{
+  PROFILE_FUNCTION_START;
+
+  node_t* head = NULL;
+  for (uint32_t i = 0; i < count; i++)
+  {
+    node_t* node = malloc(sizeof(node_t));
+    if (!node)
+    {
+      break;
+    }
+    node->value = i;
+    node->next  = head;
+    head = node;
+  }
+
+  PROFILE_FUNCTION_END;
+  PROFILE_HINT_SUCCESSFUL_RETURN;
+  return head;
+}
+
+uint64_t free_list(node_t* head)
+{
+  PROFILE_FUNCTION_START;
+
+  uint64_t sum = 0;
+  while (head)
+  {
+    node_t* next = head->next;
+    sum += head->value;
+    free(head);
+    head = next;
+  }
+
+  PROFILE_FUNCTION_END;
+  PROFILE_HINT_SUCCESSFUL_RETURN;
+  return sum;
+}
+
+char* grow_string(uint32_t steps)
+{
+  PROFILE_FUNCTION_START;
+
+  size_t size = 16;
+  char*  text = calloc(1, size);
+  for (uint32_t i = 0; text && i < steps; i++)
+  {
+    size *= 2;
+    char* bigger = realloc(text, size);
+    if (!bigger)
+    {
+      break;
+    }
+    text = bigger;
+    memset(text, 'a', size - 1);
+  }
+
+  PROFILE_FUNCTION_END;
+  PROFILE_HINT_SUCCESSFUL_RETURN;
+  return text;
+}
+
+int main(void)
+{
+  profiler_init();
+
+  uint64_t sum = 0;
+  for (uint32_t i = 0; i < 32; i++)
+  {
+    sum += free_list(build_list(1000));
+  }
+
+  // not attributed to any profiled function
+  free(grow_string(12));
+
+  log_println("checksum {u64}", sum);
+
+  profiler_end();
+  profiler_print_all();
+
+  // allocations restart with every other stat
+  prof_alloc_stat_t attributed, unattributed;
+  profiler_alloc_stat(profiler_find_site("build_list", pk_function), &attributed);
+  profiler_alloc_stat(PROFILER_UNATTRIBUTED, &unattributed);
+  if (attributed._allocs < 32 * 1000 || unattributed._allocs == 0)
+  {
+    log_println("allocations weren't tracked");
+    return 1;
+  }
+
+  profiler_reset();
+  profiler_alloc_stat(profiler_find_site("build_list", pk_function), &attributed);
+  profiler_alloc_stat(PROFILER_UNATTRIBUTED, &unattributed);
+  if (attributed._allocs != 0 || attributed._bytes_allocated != 0 || unattributed._allocs != 0)
+  {
+    log_println("profiler_reset() kept the allocation stats");
+    return 1;
+  }
+  return 0;
+}
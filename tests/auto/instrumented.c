@@ -0,0 +1,134 @@
+// built with tier_0_instrument_functions(): no PROFILE_* macros anywhere in this file
+
+#include <tier_0.h>
+
+#include <string.h>
+
+static volatile uint64_t g_sink = 0;
+
+static NO_INLINE void leaf_work(uint32_t n)
+{
+  for (uint32_t i = 0; i < n; i++)
+  {
+    g_sink += i;
+  }
+}
+
+static NO_INLINE void outer_work(void)
+{
+  for (uint32_t i = 0; i < 4; i++)
+  {
+    leaf_work(1000);
+  }
+}
+
+static NO_INLINE uint32_t fib(uint32_t n)
+{
+  return n < 2 ? n : fib(n - 1) + fib(n - 2);
+}
+
+static NO_INLINE void noisy_helper(void)
+{
+  g_sink++;
+}
+
+static NO_INLINE void skip_logging(void)
+{
+  g_sink++;
+}
+
+static const char* site_name(const void* function)
+{
+  _index index = profiler_auto_site(function);
+  return index == PROFILER_NO_INDEX ? "" : profiler_get_stat_head(index)->_func_name;
+}
+
+static uint64_t site_calls(const void* function)
+{
+  _index index = profiler_auto_site(function);
+  return index == PROFILER_NO_INDEX ? 0 : profiler_get_call_stat(index)->_total_calls;
+}
+
+int main(void)
+{
+  profiler_init();
+  profiler_auto_exclude_function((const void*)noisy_helper);
+  profiler_auto_exclude("skip_");
+
+  for (uint32_t i = 0; i < 10; i++)
+  {
+    outer_work();
+    noisy_helper();
+  }
+  g_sink += fib(10);
+  skip_logging();
+
+  // entered before profiler_init(), never recorded
+  if (profiler_auto_site((const void*)main) != PROFILER_NO_INDEX)
+  {
+    log_println("main was recorded before profiler_init");
+    return 1;
+  }
+  if (profiler_auto_site((const void*)noisy_helper) != PROFILER_NO_INDEX)
+  {
+    log_println("excluded function was recorded");
+    return 1;
+  }
+
+  // excluded by name from its first call, before any report resolved it
+  if (profiler_auto_site((const void*)skip_logging) != PROFILER_NO_INDEX)
+  {
+    log_println("name exclusion not applied on first sight");
+    return 1;
+  }
+
+  // nothing is named until the report asks for it
+  if (strncmp(site_name((const void*)leaf_work), "fn@", 3) != 0)
+  {
+    log_println("resolved in the hot path: {str}", site_name((const void*)leaf_work));
+    return 1;
+  }
+
+  profiler_end();
+  profiler_print_all();
+
+  if (strcmp(site_name((const void*)leaf_work), "leaf_work") != 0 ||
+      strcmp(site_name((const void*)outer_work), "outer_work") != 0 ||
+      strcmp(site_name((const void*)fib), "fib") != 0)
+  {
+    log_println("names not resolved: {str} {str} {str}", site_name((const void*)leaf_work),
+                site_name((const void*)outer_work), site_name((const void*)fib));
+    return 1;
+  }
+
+  if (site_calls((const void*)leaf_work) != 40 || site_calls((const void*)outer_work) != 10 ||
+      site_calls((const void*)fib) != 177)
+  {
+    log_println("call counts: leaf {u64} outer {u64} fib {u64}", site_calls((const void*)leaf_work),
+                site_calls((const void*)outer_work), site_calls((const void*)fib));
+    return 1;
+  }
+
+  // children are subtracted from the caller like with the macros
+  _index outer = profiler_auto_site((const void*)outer_work);
+  if (profiler_get_self_stat(outer)->_cycles >= profiler_get_cpu_stat(outer)->_total_cycles)
+  {
+    log_println("outer_work self time includes its callees");
+    return 1;
+  }
+
+  // the report never saw it either
+  if (profiler_find_site("skip_logging", pk_function) != PROFILER_NO_INDEX)
+  {
+    log_println("excluded function has a site");
+    return 1;
+  }
+
+  // the three workers plus site_name / site_calls
+  if (profiler_auto_count() != 5)
+  {
+    log_println("expected 5 instrumented functions, saw {u32}", profiler_auto_count());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,85 @@
+#include <tier_0.h>
+
+#define BENCH_READS      1000000
+#define BENCH_CALIBRATE  20000000ull  // ns spent measuring the tick rate
+
+static volatile u64 g_sink = 0;
+
+// ticks per nanosecond of `reader`, busy waits BENCH_CALIBRATE ns
+static f64 ticks_per_ns(prof_clock_fn reader)
+{
+  u64 ns_begin    = get_nanoseconds();
+  u64 ticks_begin = reader();
+  u64 ns_end;
+  do
+  {
+    ns_end = get_nanoseconds();
+  } while (ns_end - ns_begin < BENCH_CALIBRATE);
+  u64 ticks_end = reader();
+
+  return (f64)(ticks_end - ticks_begin) / (f64)(ns_end - ns_begin);
+}
+
+static void bench_clock(enum prof_clock clock)
+{
+  prof_clock_fn reader = profiler_clock_reader(clock);
+  if (!reader)
+  {
+    log_println("{str}: unavailable", profiler_clock_name(clock));
+    return;
+  }
+
+  // per read cost
+  u64 sum   = 0;
+  u64 begin = get_nanoseconds();
+  for (u32 i = 0; i < BENCH_READS; i++)
+  {
+    sum += reader();
+  }
+  u64 elapsed = get_nanoseconds() - begin;
+  g_sink = sum;
+
+  // resolution and monotonicity over back to back reads
+  u64 smallest  = UINT64_MAX;
+  u64 backwards = 0;
+  u64 repeats   = 0;
+  u64 previous  = reader();
+  for (u32 i = 0; i < BENCH_READS; i++)
+  {
+    u64 now = reader();
+    if (now < previous)
+    {
+      backwards++;
+    }
+    else if (now == previous)
+    {
+      repeats++;
+    }
+    else if (now - previous < smallest)
+    {
+      smallest = now - previous;
+    }
+    previous = now;
+  }
+
+  f64 rate = ticks_per_ns(reader);
+  log_println("{str}: {f64} ns/read, resolution {u64} ticks ({f64} ns), {f64} ticks/ns, "
+              "{u64} backwards, {f64}% repeated",
+              profiler_clock_name(clock),
+              (f64)elapsed / BENCH_READS,
+              smallest == UINT64_MAX ? 0 : smallest,
+              smallest == UINT64_MAX || rate <= 0.0 ? 0.0 : (f64)smallest / rate,
+              rate,
+              backwards,
+              100.0 * (f64)repeats / BENCH_READS);
+}
+
+int main(void)
+{
+  log_println("clock backends (current: {str})", profiler_clock_name(profiler_clock_current()));
+  for (u32 clock = 0; clock < pc_clock_count; clock++)
+  {
+    bench_clock((enum prof_clock)clock);
+  }
+  return 0;
+}
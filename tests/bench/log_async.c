@@ -0,0 +1,100 @@
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <tier_0.h>
+
+#if !PLATFORM_WINDOWS
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#define BENCH_CALLS   100000
+#define BENCH_BURST   1000
+#define BENCH_ROUNDS  200
+#define BENCH_THREADS 32
+
+#if !PLATFORM_WINDOWS
+static void* short_lived(void* arg)
+{
+  LOG_ASYNC("short lived thread {u32}", (u32)(uintptr_t)arg);
+  return NULL;
+}
+#endif
+
+int main(void)
+{
+#if !PLATFORM_WINDOWS
+  fflush(stdout);
+  int saved_stdout = dup(LOG_FD_STDOUT);
+  int null_fd      = open("/dev/null", O_WRONLY);
+  dup2(null_fd, LOG_FD_STDOUT);
+#endif
+
+  log_async_init(8 * 1024 * 1024);
+
+  u64 best_cycles = (u64)-1;
+  u64 best_ns     = (u64)-1;
+
+  // short bursts right after a flush, so the formatting thread is asleep and
+  // only the call site cost is measured even on a single core
+  for (u32 round = 0; round < BENCH_ROUNDS; round++)
+  {
+    u64 start_ns     = get_nanoseconds();
+    u64 start_cycles = get_cycle_count_enhanced();
+
+    for (u64 i = 0; i < BENCH_BURST; i++)
+    {
+      LOG_ASYNC("order {u64} filled at {f64} qty {u32}", i, 101.25 + (f64)i, (u32)(i & 0xffff));
+    }
+
+    u64 cycles = get_cycle_count_enhanced() - start_cycles;
+    u64 ns     = get_nanoseconds() - start_ns;
+
+    if (cycles < best_cycles) best_cycles = cycles;
+    if (ns < best_ns)         best_ns = ns;
+
+    log_async_flush();
+  }
+
+  u64 start_ns = get_nanoseconds();
+  for (u64 i = 0; i < BENCH_CALLS; i++)
+  {
+    log_println("order {u64} filled at {f64} qty {u32}", i, 101.25 + (f64)i, (u32)(i & 0xffff));
+  }
+  u64 sync_ns = get_nanoseconds() - start_ns;
+
+  // threads that log once and exit, one after the other, take turns on the same ring
+  u32 rings = 0;
+#if !PLATFORM_WINDOWS
+  for (u32 t = 0; t < BENCH_THREADS; t++)
+  {
+    pthread_t handle;
+    pthread_create(&handle, NULL, short_lived, (void*)(uintptr_t)t);
+    pthread_join(handle, NULL);
+    log_async_flush();
+  }
+  rings = log_async_rings();
+#endif
+
+  log_async_shutdown();
+
+#if !PLATFORM_WINDOWS
+  dup2(saved_stdout, LOG_FD_STDOUT);
+  close(saved_stdout);
+  close(null_fd);
+#endif
+
+  log_println("async log call: {f64} cycles, {f64} ns", (f64)best_cycles / BENCH_BURST, (f64)best_ns / BENCH_BURST);
+  log_println("sync log_println: {f64} ns", (f64)sync_ns / BENCH_CALLS);
+  log_println("dropped records: {u64}", log_async_dropped());
+  log_println("rings for {u32} short lived threads: {u32}", BENCH_THREADS, rings);
+  if (rings > 2)
+  {
+    return 1;
+  }
+
+  LOG_ASYNC("after shutdown falls back to sync: {str} {s32} {}", "ok", -5, 7);
+  return 0;
+}
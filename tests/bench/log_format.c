@@ -0,0 +1,168 @@
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <tier_0.h>
+
+#include <inttypes.h>
+#include <string.h>
+
+#if !PLATFORM_WINDOWS
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define BENCH_LINES 200000
+
+// the previous putchar/printf formatter, kept verbatim as the baseline
+static void legacy_parse_and_print(const char* fmt, va_list args)
+{
+    const char* p = fmt;
+
+    while (*p) {
+        if (*p == '{' && *(p + 1) != '\0') {
+            p++;
+            if (*p == 'u')
+            {
+                p++;
+                if (*p == '8' && *(p + 1) == '}') { log_u8(va_arg(args, int)); p += 2; }
+                else if (*p == '1' && *(p + 1) == '6' && *(p + 2) == '}') { log_u16(va_arg(args, int)); p += 3; }
+                else if (*p == '3' && *(p + 1) == '2' && *(p + 2) == '}') { log_u32(va_arg(args, u32)); p += 3; }
+                else if (*p == '6' && *(p + 1) == '4' && *(p + 2) == '}') { log_u64(va_arg(args, u64)); p += 3; }
+                else { putchar('{'); putchar('u'); }
+            }
+            else if (*p == 's')
+            {
+                p++;
+                if (*p == '8' && *(p + 1) == '}') { log_s8(va_arg(args, int)); p += 2; }
+                else if (*p == '1' && *(p + 1) == '6' && *(p + 2) == '}') { log_s16(va_arg(args, int)); p += 3; }
+                else if (*p == '3' && *(p + 1) == '2' && *(p + 2) == '}') { log_s32(va_arg(args, s32)); p += 3; }
+                else if (*p == '6' && *(p + 1) == '4' && *(p + 2) == '}') { log_s64(va_arg(args, s64)); p += 3; }
+                else if (strncmp(p, "tr}", 3) == 0) { log_str(va_arg(args, const char*)); p += 3; }
+                else { putchar('{'); putchar('s'); }
+            }
+            else if (*p == 'f')
+            {
+                p++;
+                if (*p == '3' && *(p + 1) == '2' && *(p + 2) == '}') { log_f32(va_arg(args, double)); p += 3; }
+                else if (*p == '6' && *(p + 1) == '4' && *(p + 2) == '}') { log_f64(va_arg(args, double)); p += 3; }
+                else { putchar('{'); putchar('f'); }
+            }
+            else if (*p == '}') { printf("%d", va_arg(args, int)); p++; }
+            else { putchar('{'); }
+        }
+        else
+        {
+            putchar(*p);
+            p++;
+        }
+    }
+}
+
+static void legacy_println(const char* fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    legacy_parse_and_print(fmt, args);
+    va_end(args);
+    putchar('\n');
+}
+
+static void emit_legacy(u64 i)
+{
+  legacy_println("Function Name: {str}", "uint64_t parse_message(const char*, size_t)");
+  legacy_println("Total Cycles: {u64} ", 1234567890123ull + i);
+  legacy_println("Average Cycles: {f64}", 1234.5678 + (f64)i);
+  legacy_println("Line number: {u16}", (u16)i);
+}
+
+static void emit_line(u64 i)
+{
+  log_println("Function Name: {str}", "uint64_t parse_message(const char*, size_t)");
+  log_println("Total Cycles: {u64} ", 1234567890123ull + i);
+  log_println("Average Cycles: {f64}", 1234.5678 + (f64)i);
+  log_println("Line number: {u16}", (u16)i);
+}
+
+static void emit_report(log_buffer_t* out, u64 i)
+{
+  log_buffer_println(out, "Function Name: {str}", "uint64_t parse_message(const char*, size_t)");
+  log_buffer_println(out, "Total Cycles: {u64} ", 1234567890123ull + i);
+  log_buffer_println(out, "Average Cycles: {f64}", 1234.5678 + (f64)i);
+  log_buffer_println(out, "Line number: {u16}", (u16)i);
+}
+
+static bool check_conversions(void)
+{
+  static const f64 samples[] = { 0.0, 0.5, 1.25, 3.14159265, 99.99995, 123456.789, 1e14 + 0.25, -42.125 };
+  bool ok = true;
+
+  for (u32 i = 0; i < sizeof(samples) / sizeof(samples[0]); i++)
+  {
+    char fast[64];
+    char reference[64];
+
+    log_format(fast, sizeof(fast), "{f64}|{f32}|{s64}|{u64}", samples[i], (f32)samples[i], (s64)samples[i] * -7, (u64)(samples[i] * 1000.0));
+    snprintf(reference, sizeof(reference), "%.4f|%.2f|%" PRId64 "|%" PRIu64, samples[i], (f32)samples[i], (s64)samples[i] * -7, (u64)(samples[i] * 1000.0));
+
+    if (strcmp(fast, reference) != 0)
+    {
+      printf("mismatch: fast \"%s\" printf \"%s\"\n", fast, reference);
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+int main(void)
+{
+  if (!check_conversions())
+  {
+    return 1;
+  }
+
+#if !PLATFORM_WINDOWS
+  // measure the formatting and syscalls, not the terminal
+  fflush(stdout);
+  int saved_stdout = dup(LOG_FD_STDOUT);
+  int null_fd      = open("/dev/null", O_WRONLY);
+  dup2(null_fd, LOG_FD_STDOUT);
+#endif
+
+  u64 start = get_nanoseconds();
+  for (u64 i = 0; i < BENCH_LINES / 4; i++)
+  {
+    emit_legacy(i);
+  }
+  fflush(stdout);
+  u64 legacy_ns = get_nanoseconds() - start;
+
+  start = get_nanoseconds();
+  for (u64 i = 0; i < BENCH_LINES / 4; i++)
+  {
+    emit_line(i);
+  }
+  fflush(stdout);
+  u64 line_ns = get_nanoseconds() - start;
+
+  start = get_nanoseconds();
+  log_buffer_t* out = log_report_buffer();
+  for (u64 i = 0; i < BENCH_LINES / 4; i++)
+  {
+    emit_report(out, i);
+  }
+  log_buffer_flush(out);
+  u64 report_ns = get_nanoseconds() - start;
+
+#if !PLATFORM_WINDOWS
+  dup2(saved_stdout, LOG_FD_STDOUT);
+  close(saved_stdout);
+  close(null_fd);
+#endif
+
+  log_println("lines: {u32}", (u32)BENCH_LINES);
+  log_println("legacy putchar/printf: {f64} ns/line", (f64)legacy_ns / BENCH_LINES);
+  log_println("buffered, stdio per line: {f64} ns/line ({f64}x)", (f64)line_ns / BENCH_LINES, (f64)legacy_ns / (f64)line_ns);
+  log_println("buffered, write per report: {f64} ns/line ({f64}x)", (f64)report_ns / BENCH_LINES, (f64)legacy_ns / (f64)report_ns);
+  return 0;
+}
@@ -0,0 +1,256 @@
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <tier_0.h>
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// profiler self overhead. prints one csv row per probe and fails (exit 1) when a probe
+// costs more than its threshold. the single threaded start / end pair is the reference:
+// it has the only absolute threshold, nanoseconds scaled by TIER0_OVERHEAD_SCALE (e.g. 2.0
+// on slow or virtualized hosts). every other probe may cost a small multiple of the
+// reference measured in the same run, so a regression shows up on fast and slow hosts
+// alike. threaded rows are wall time per call, their multiple grows with the threads per
+// online core.
+
+#define BENCH_REFERENCE_NS 300.0
+
+#define BENCH_ITERATIONS 200000
+#define BENCH_REPEATS    5
+#define BENCH_MAX_THREADS 4
+#define BENCH_REGISTRATIONS 32
+
+static volatile u64 g_sink = 0;
+static f64          g_scale = 1.0;
+static f64          g_reference_ns = 0.0;
+static u32          g_failures = 0;
+
+typedef void (*probe_fn)(u32 iterations);
+
+// probes, each profiled call is one operation
+
+static void empty_pair(void)
+{
+  PROFILE_FUNCTION_START;
+  PROFILE_FUNCTION_END;
+}
+
+static void cache_pair(void)
+{
+  PROFILE_FUNCTION_START;
+  PROFILE_CACHE_START(probe);
+  g_sink++;
+  PROFILE_CACHE_END(probe);
+  PROFILE_FUNCTION_END;
+}
+
+// one site per thread for the uncontended runs
+#define PROBE_SITE(n)                 \
+  static void site_##n(void)          \
+  {                                   \
+    PROFILE_FUNCTION_START;           \
+    PROFILE_FUNCTION_END;             \
+  }
+PROBE_SITE(0)
+PROBE_SITE(1)
+PROBE_SITE(2)
+PROBE_SITE(3)
+
+static void (*const g_sites[BENCH_MAX_THREADS])(void) = { site_0, site_1, site_2, site_3 };
+
+static void run_empty_pair(u32 iterations)
+{
+  for (u32 i = 0; i < iterations; i++)
+  {
+    empty_pair();
+  }
+}
+
+static void run_cache_pair(u32 iterations)
+{
+  for (u32 i = 0; i < iterations; i++)
+  {
+    cache_pair();
+  }
+}
+
+static void run_report(u32 iterations)
+{
+  // rendered and dropped, the cost is formatting the whole registry
+  log_buffer_t* out = log_report_buffer();
+  s32 fd = out->_fd;
+  out->_fd = LOG_FD_NONE;
+  for (u32 i = 0; i < iterations; i++)
+  {
+    profiler_print_all();
+  }
+  out->_fd = fd;
+}
+
+typedef struct bench_result_t
+{
+  f64 _cycles;
+  f64 _ns;
+} bench_result_t;
+
+// best of BENCH_REPEATS, per operation
+static bench_result_t measure(probe_fn probe, u32 iterations)
+{
+  bench_result_t best = { 1e300, 1e300 };
+  probe(iterations / 10 + 1); // warm up, registers the sites
+
+  for (u32 r = 0; r < BENCH_REPEATS; r++)
+  {
+    u64 ns     = get_nanoseconds();
+    u64 cycles = get_cycle_count();
+    probe(iterations);
+    cycles = get_cycle_count() - cycles;
+    ns     = get_nanoseconds() - ns;
+
+    if ((f64)ns / iterations < best._ns)
+    {
+      best._cycles = (f64)cycles / iterations;
+      best._ns     = (f64)ns / iterations;
+    }
+  }
+  return best;
+}
+
+static void report_limit(const char* probe, u32 threads, const char* mode, bench_result_t result, f64 limit)
+{
+  bool ok = result._ns <= limit;
+  g_failures += !ok;
+
+  printf("bench_overhead,%s,%u,%s,%.1f,%.1f,%.1f,%s\n",
+         probe, threads, mode, result._cycles, result._ns, limit, ok ? "ok" : "FAIL");
+}
+
+// `multiple` times the reference
+static void report(const char* probe, u32 threads, const char* mode, bench_result_t result, f64 multiple)
+{
+  report_limit(probe, threads, mode, result, multiple * g_reference_ns);
+}
+
+// threaded runs
+
+typedef struct thread_arg_t
+{
+  u32               _id;
+  bool              _shared;
+  pthread_barrier_t* _barrier;
+  bench_result_t    _result;
+} thread_arg_t;
+
+static void* thread_main(void* arg)
+{
+  thread_arg_t* self = arg;
+  void (*site)(void) = self->_shared ? empty_pair : g_sites[self->_id];
+
+  site();
+  pthread_barrier_wait(self->_barrier);
+
+  u64 ns     = get_nanoseconds();
+  u64 cycles = get_cycle_count();
+  for (u32 i = 0; i < BENCH_ITERATIONS; i++)
+  {
+    site();
+  }
+  self->_result._cycles = (f64)(get_cycle_count() - cycles) / BENCH_ITERATIONS;
+  self->_result._ns     = (f64)(get_nanoseconds() - ns) / BENCH_ITERATIONS;
+  return NULL;
+}
+
+static bench_result_t measure_threads(u32 threads, bool shared)
+{
+  pthread_t         handles[BENCH_MAX_THREADS];
+  thread_arg_t      args[BENCH_MAX_THREADS];
+  pthread_barrier_t barrier;
+  pthread_barrier_init(&barrier, NULL, threads);
+
+  for (u32 t = 0; t < threads; t++)
+  {
+    args[t] = (thread_arg_t){ t, shared, &barrier, {0, 0} };
+    pthread_create(&handles[t], NULL, thread_main, &args[t]);
+  }
+
+  bench_result_t average = {0, 0};
+  for (u32 t = 0; t < threads; t++)
+  {
+    pthread_join(handles[t], NULL);
+    average._cycles += args[t]._result._cycles / threads;
+    average._ns     += args[t]._result._ns / threads;
+  }
+
+  pthread_barrier_destroy(&barrier);
+  return average;
+}
+
+int main(void)
+{
+  const char* scale = getenv("TIER0_OVERHEAD_SCALE");
+  if (scale)
+  {
+    g_scale = strtod(scale, NULL);
+  }
+
+  profiler_init();
+
+  printf("suite,probe,threads,mode,cycles_per_op,ns_per_op,threshold_ns,status\n");
+
+  bench_result_t reference = measure(run_empty_pair, BENCH_ITERATIONS);
+  g_reference_ns = reference._ns;
+  report_limit("start_end", 1, "single", reference, BENCH_REFERENCE_NS * g_scale);
+
+  // the same calls streamed to a trace file (perf/trace.h)
+  if (profiler_trace_start("overhead.t0trace"))
+  {
+    report("start_end", 1, "traced", measure(run_empty_pair, BENCH_ITERATIONS), 2.0);
+    profiler_trace_stop();
+    remove("overhead.t0trace");
+  }
+
+  profiler_hw_counters_set_enabled(false);
+  report("cache_pair", 1, "estimated", measure(run_cache_pair, BENCH_ITERATIONS), 2.5);
+  profiler_hw_counters_set_enabled(true);
+  if (profiler_hw_counters_available())
+  {
+    report("cache_pair", 1, "hw_counters", measure(run_cache_pair, BENCH_ITERATIONS), 8.0);
+  }
+  else
+  {
+    printf("bench_overhead,cache_pair,1,hw_counters,,,,skipped\n");
+  }
+
+  // threads sharing a core take turns, more than that is contention
+  long cores = sysconf(_SC_NPROCESSORS_ONLN);
+  cores = cores > 0 ? cores : 1;
+  for (u32 threads = 1; threads <= BENCH_MAX_THREADS; threads *= 2)
+  {
+    f64 per_core = threads > cores ? (f64)threads / (f64)cores : 1.0;
+    report("start_end", threads, "shared_site", measure_threads(threads, true), 2.0 * per_core);
+    report("start_end", threads, "own_site", measure_threads(threads, false), 2.0 * per_core);
+  }
+
+  // registration, each call takes a fresh registry slot
+  char name[32];
+  u64  ns     = get_nanoseconds();
+  u64  cycles = get_cycle_count();
+  for (u32 i = 0; i < BENCH_REGISTRATIONS; i++)
+  {
+    snprintf(name, sizeof(name), "registered_%u", i);
+    g_sink += profiler_add_function(__FILE__, name, (u16)__LINE__);
+  }
+  bench_result_t registration = { (f64)(get_cycle_count() - cycles) / BENCH_REGISTRATIONS,
+                                  (f64)(get_nanoseconds() - ns) / BENCH_REGISTRATIONS };
+  report("registration", 1, "single", registration, 12.0);
+
+  report("report", 1, "all_sites", measure(run_report, 20), 1000.0);
+
+  profiler_end();
+  return g_failures ? 1 : 0;
+}
@@ -0,0 +1,11 @@
+group "tests"
+
+project "ab_1"
+  kind "ConsoleApp"
+  language "C"
+
+  files {"../ab/hash_variants.c"}
+  includedirs {"%{wks.location}/include"}
+  links {"tier_0"}
+
+  increment_project_counter()
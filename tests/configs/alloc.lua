@@ -0,0 +1,13 @@
+group "tests"
+
+project "alloc_1"
+  kind "ConsoleApp"
+  language "C"
+
+  files {"../alloc/alloc_tracking.c"}
+  includedirs {"%{wks.location}/include"}
+  links {"tier_0"}
+
+  tier_0_alloc_tracking()
+
+  increment_project_counter()
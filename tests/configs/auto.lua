@@ -0,0 +1,13 @@
+group "tests"
+
+project "auto_1"
+  kind "ConsoleApp"
+  language "C"
+
+  files {"../auto/instrumented.c"}
+  includedirs {"%{wks.location}/include"}
+  links {"tier_0"}
+
+  tier_0_instrument_functions()
+
+  increment_project_counter()
@@ -0,0 +1,50 @@
+group "bench"
+
+project "bench_log"
+  kind "ConsoleApp"
+  language "C"
+
+  files {"../bench/log_format.c"}
+  includedirs {"%{wks.location}/include"}
+  links {"tier_0"}
+
+  increment_project_counter()
+
+project "bench_log_async"
+  kind "ConsoleApp"
+  language "C"
+
+  files {"../bench/log_async.c"}
+  includedirs {"%{wks.location}/include"}
+  links {"tier_0"}
+
+  filter "system:linux"
+    links {"pthread"}
+  filter {}
+
+  increment_project_counter()
+
+project "bench_clock"
+  kind "ConsoleApp"
+  language "C"
+
+  files {"../bench/clock_backends.c"}
+  includedirs {"%{wks.location}/include"}
+  links {"tier_0"}
+
+  increment_project_counter()
+
+-- profiler self overhead, csv on stdout, exits non zero when a probe exceeds its threshold
+project "bench_overhead"
+  kind "ConsoleApp"
+  language "C"
+
+  files {"../bench/overhead.c"}
+  includedirs {"%{wks.location}/include"}
+  links {"tier_0"}
+
+  filter "system:linux"
+    links {"pthread"}
+  filter {}
+
+  increment_project_counter()
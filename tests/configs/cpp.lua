@@ -0,0 +1,11 @@
+group "tests"
+
+project "cpp_1"
+  kind "ConsoleApp"
+  language "C++"
+
+  files {"../cpp/scope_guard.cpp"}
+  includedirs {"%{wks.location}/include"}
+  links {"tier_0"}
+
+  increment_project_counter()
@@ -0,0 +1,11 @@
+group "tests"
+
+project "env_1"
+  kind "ConsoleApp"
+  language "C"
+
+  files {"../env/bench_env.c"}
+  includedirs {"%{wks.location}/include"}
+  links {"tier_0"}
+
+  increment_project_counter()
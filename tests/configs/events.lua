@@ -0,0 +1,11 @@
+group "tests"
+
+project "events_1"
+  kind "ConsoleApp"
+  language "C"
+
+  files {"../events/page_faults.c"}
+  includedirs {"%{wks.location}/include"}
+  links {"tier_0"}
+
+  increment_project_counter()
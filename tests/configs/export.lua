@@ -0,0 +1,11 @@
+group "tests"
+
+project "export_1"
+  kind "ConsoleApp"
+  language "C"
+
+  files {"../export/export_profile.c"}
+  includedirs {"%{wks.location}/include"}
+  links {"tier_0"}
+
+  increment_project_counter()
@@ -0,0 +1,11 @@
+group "tests"
+
+project "frames_1"
+  kind "ConsoleApp"
+  language "C"
+
+  files {"../frames/frame_budget.c"}
+  includedirs {"%{wks.location}/include"}
+  links {"tier_0"}
+
+  increment_project_counter()
@@ -0,0 +1,17 @@
+group "tests"
+
+project "lock_1"
+  kind "ConsoleApp"
+  language "C"
+
+  files {"../lock/lock_contention.c"}
+  includedirs {"%{wks.location}/include"}
+  links {"tier_0"}
+
+  filter "system:linux"
+    links {"pthread"}
+  filter {}
+
+  tier_0_lock_tracking()
+
+  increment_project_counter()
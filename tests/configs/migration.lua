@@ -0,0 +1,11 @@
+group "tests"
+
+project "migration_1"
+  kind "ConsoleApp"
+  language "C"
+
+  files {"../migration/migration_modes.c"}
+  includedirs {"%{wks.location}/include"}
+  links {"tier_0"}
+
+  increment_project_counter()
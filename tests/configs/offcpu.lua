@@ -0,0 +1,11 @@
+group "tests"
+
+project "offcpu_1"
+  kind "ConsoleApp"
+  language "C"
+
+  files {"../offcpu/blocking.c"}
+  includedirs {"%{wks.location}/include"}
+  links {"tier_0"}
+
+  increment_project_counter()
@@ -0,0 +1,15 @@
+group "tests"
+
+project "outliers_1"
+  kind "ConsoleApp"
+  language "C"
+
+  files {"../outliers/budget.c"}
+  includedirs {"%{wks.location}/include"}
+  links {"tier_0"}
+
+  filter "system:linux"
+    links {"pthread"}
+  filter {}
+
+  increment_project_counter()
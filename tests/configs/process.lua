@@ -0,0 +1,14 @@
+group "tests"
+
+project "process_1"
+  kind "ConsoleApp"
+  language "C"
+
+  files {"../process/fork_workers.c"}
+  includedirs {"%{wks.location}/include"}
+  links {"tier_0"}
+
+  tier_0_process_tracking()
+  tier_0_alloc_tracking()
+
+  increment_project_counter()
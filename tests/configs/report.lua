@@ -0,0 +1,11 @@
+group "tests"
+
+project "report_1"
+  kind "ConsoleApp"
+  language "C"
+
+  files {"../report/top_n.c"}
+  includedirs {"%{wks.location}/include"}
+  links {"tier_0"}
+
+  increment_project_counter()
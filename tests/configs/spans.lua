@@ -0,0 +1,15 @@
+group "tests"
+
+project "spans_1"
+  kind "ConsoleApp"
+  language "C"
+
+  files {"../spans/task_queue.c"}
+  includedirs {"%{wks.location}/include"}
+  links {"tier_0"}
+
+  filter "system:linux"
+    links {"pthread"}
+  filter {}
+
+  increment_project_counter()
@@ -0,0 +1,15 @@
+group "tests"
+
+project "threads_1"
+  kind "ConsoleApp"
+  language "C"
+
+  files {"../threads/imbalance.c"}
+  includedirs {"%{wks.location}/include"}
+  links {"tier_0"}
+
+  filter "system:linux"
+    links {"pthread"}
+  filter {}
+
+  increment_project_counter()
@@ -0,0 +1,11 @@
+group "tests"
+
+project "topdown_1"
+  kind "ConsoleApp"
+  language "C"
+
+  files {"../topdown/topdown_breakdown.c"}
+  includedirs {"%{wks.location}/include"}
+  links {"tier_0"}
+
+  increment_project_counter()
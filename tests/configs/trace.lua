@@ -0,0 +1,15 @@
+group "tests"
+
+project "trace_1"
+  kind "ConsoleApp"
+  language "C"
+
+  files {"../trace/stream.c"}
+  includedirs {"%{wks.location}/include"}
+  links {"tier_0"}
+
+  filter "system:linux"
+    links {"pthread"}
+  filter {}
+
+  increment_project_counter()
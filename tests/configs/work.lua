@@ -0,0 +1,11 @@
+group "tests"
+
+project "work_1"
+  kind "ConsoleApp"
+  language "C"
+
+  files {"../work/throughput.c"}
+  includedirs {"%{wks.location}/include"}
+  links {"tier_0"}
+
+  increment_project_counter()
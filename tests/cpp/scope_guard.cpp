@@ -0,0 +1,105 @@
+#include <tier_0.h>
+#include <perf/instr.hpp>
+
+#include <cstring>
+#include <stdexcept>
+
+static volatile uint64_t g_sink = 0;
+
+static_assert(tier_0::hash("tokenize") == 0xf0895dff89f6182cull, "FNV-1a of a literal is folded at compile time");
+
+static NO_INLINE void tokenize(uint32_t n)
+{
+  PROFILE_SCOPE(tokenize);
+  static_assert(decltype(_prof_scope_tokenize_)::id() == tier_0::hash("tokenize"), "site id is a constant");
+  for (uint32_t i = 0; i < n; i++)
+  {
+    g_sink += i;
+  }
+}
+
+static NO_INLINE void parse(uint32_t n)
+{
+  PROFILE_FUNCTION_SCOPE;
+  tokenize(n);
+  tokenize(n);
+  if (n == 0)
+  {
+    throw std::runtime_error("empty input");
+  }
+  _prof_scope_.work(n, 1);
+}
+
+int main()
+{
+  // descriptors registered before main, the site exists before its first call
+  _index tokenize_index = profiler_find_site("tokenize", pk_function);
+  if (tokenize_index == (_index)-1)
+  {
+    log_println("tokenize was not registered during static initialization");
+    return 1;
+  }
+
+  profiler_init();
+  if (profiler_find_site("tokenize", pk_function) != tokenize_index)
+  {
+    log_println("profiler_init dropped a registered site");
+    return 1;
+  }
+
+  uint32_t thrown = 0;
+  for (uint32_t i = 0; i < 10; i++)
+  {
+    try
+    {
+      parse(i % 5 == 0 ? 0 : 1000);
+    }
+    catch (const std::runtime_error&)
+    {
+      thrown++;
+    }
+  }
+
+  // the guards unwound with the exception, nothing is left on the thread's stack
+  if (thrown != 2 || profiler_active_index() != PROFILER_NO_INDEX)
+  {
+    log_println("scope left active after an exception");
+    return 1;
+  }
+
+  profiler_end();
+  profiler_print_all();
+
+  _index parse_index = PROFILER_NO_INDEX;
+  for (_index i = 0; i < profiler_get_function_count(); i++)
+  {
+    if (strstr(profiler_get_stat_head(i)->_func_name, "parse"))
+    {
+      parse_index = i;
+    }
+  }
+  if (parse_index == PROFILER_NO_INDEX || profiler_get_call_stat(parse_index)->_total_calls != 10 ||
+      profiler_get_call_stat(tokenize_index)->_total_calls != 20)
+  {
+    log_println("every exit path should be recorded");
+    return 1;
+  }
+
+  // tokenize's cycles are not parse's own
+  if (profiler_get_self_stat(parse_index)->_cycles >= profiler_get_cpu_stat(parse_index)->_total_cycles ||
+      profiler_get_work_stat(parse_index)->_items != 8)
+  {
+    log_println("self time or work of the function scope is off");
+    return 1;
+  }
+
+  tier_0::cycles      average = tier_0::output<pa_cycles_avg>(tokenize_index);
+  tier_0::cycles      p99     = tier_0::output<pa_cycles_p99>(tokenize_index);
+  tier_0::nanoseconds time    = tier_0::output<pa_time_avg>(tokenize_index);
+  if (average.count == 0 || p99.count == 0 || time.count == 0)
+  {
+    log_println("typed outputs: avg {u64} cycles, p99 {u64} cycles, {u64} ns", average.count, p99.count, time.count);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,54 @@
+#include <tier_0.h>
+
+int main(void)
+{
+  // the controlled calibration is opt in, profiler_init() keeps its score
+  if (profiler_bench_env_calibration())
+  {
+    log_println("calibration must not pin the thread unless asked to");
+    return 1;
+  }
+  profiler_bench_env_set_calibration(true);
+  profiler_init();
+
+  const prof_bench_env_t* calibration = profiler_bench_env_last();
+  if (!calibration)
+  {
+    log_println("calibration did not measure the environment");
+    return 1;
+  }
+
+  prof_bench_env_t env;
+  profiler_bench_env_enter(pe_ignore, &env);
+
+  log_buffer_t* out = log_report_buffer();
+  profiler_bench_env_print(out, &env);
+  log_buffer_flush(out);
+
+#if defined(__linux__)
+  if (!env._known || !env._pinned || impl_thread_current_cpu() != env._platform.cpu)
+  {
+    log_println("expected a pinned, measured environment on linux");
+    return 1;
+  }
+#endif
+
+  profiler_bench_env_leave();
+
+  // refusing only fails on hosts at or above the threshold
+  prof_bench_env_t refused;
+  bool accepted = profiler_bench_env_enter(pe_refuse, &refused);
+  if (accepted != (refused._noise_score < PROFILER_NOISE_UNFIT))
+  {
+    log_println("refuse policy mismatch");
+    return 1;
+  }
+  if (accepted)
+  {
+    profiler_bench_env_leave();
+  }
+
+  profiler_end();
+  profiler_print_all();
+  return 0;
+}
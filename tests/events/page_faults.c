@@ -0,0 +1,89 @@
+#include <tier_0.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#define TOUCH_SIZE (16u << 20)
+#define PAGE_SIZE  4096u
+
+static volatile uint64_t g_sink = 0;
+
+// every page of a fresh allocation faults in once
+void touch_fresh_memory(void)
+{
+  PROFILE_FUNCTION_START;
+
+  uint8_t* memory = malloc(TOUCH_SIZE);
+  if (memory)
+  {
+    for (uint32_t i = 0; i < TOUCH_SIZE; i += PAGE_SIZE)
+    {
+      memory[i] = (uint8_t)i;
+    }
+    g_sink += memory[PAGE_SIZE];
+    free(memory);
+  }
+
+  PROFILE_FUNCTION_END;
+}
+
+void arithmetic(void)
+{
+  PROFILE_FUNCTION_START;
+
+  uint64_t x = 1;
+  for (uint32_t i = 0; i < 1000000; i++)
+  {
+    x = x * 6364136223846793005ull + 1442695040888963407ull;
+  }
+  g_sink += x;
+
+  PROFILE_FUNCTION_END;
+}
+
+int main(void)
+{
+  profiler_init();
+
+  if (profiler_events_select_names("page_faults,bogus_event"))
+  {
+    log_println("unknown event names must be rejected");
+    return 1;
+  }
+  if (!profiler_events_select_names("page_faults,context_switches,dtlb_misses,raw:0x01b1"))
+  {
+    // no perf events on this platform
+    log_println("perf events unavailable, skipping");
+    return 0;
+  }
+  if (profiler_events_count() != 4 || profiler_events_spec(3)->_event != pv_raw || profiler_events_spec(3)->_config != 0x1b1)
+  {
+    log_println("event list mismatch");
+    return 1;
+  }
+
+  for (uint32_t i = 0; i < 4; i++)
+  {
+    touch_fresh_memory();
+    arithmetic();
+  }
+
+  profiler_end();
+  profiler_print_all();
+
+  if (!profiler_event_available(0))
+  {
+    log_println("page fault counter unavailable (perf_event_paranoid?), skipping");
+    return 0;
+  }
+
+  u64 touched = profiler_get_event_stat(profiler_find_site("touch_fresh_memory", pk_function), 0);
+  u64 computed = profiler_get_event_stat(profiler_find_site("arithmetic", pk_function), 0);
+  // transparent huge pages can fold many pages into one fault
+  if (touched < (TOUCH_SIZE / PAGE_SIZE) / 4 || computed > touched / 100)
+  {
+    log_println("page faults not attributed, touch {u64} arithmetic {u64}", touched, computed);
+    return 1;
+  }
+  return 0;
+}
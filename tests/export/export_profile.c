@@ -0,0 +1,346 @@
+#include <tier_0.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ROUNDS 512
+
+uint64_t fibonacci(uint32_t n)
+{
+  PROFILE_FUNCTION_START;
+
+  uint64_t a = 0;
+  uint64_t b = 1;
+  for (uint32_t i = 0; i < n; i++)
+  {
+    uint64_t next = a + b;
+    a = b;
+    b = next;
+  }
+
+  PROFILE_FUNCTION_END;
+  PROFILE_HINT_SUCCESSFUL_RETURN;
+  return a;
+}
+
+uint64_t sum_of_squares(uint32_t n)
+{
+  PROFILE_FUNCTION_START;
+
+  uint64_t sum = 0;
+  for (uint64_t i = 0; i < n; i++)
+  {
+    sum += i * i;
+  }
+
+  PROFILE_FUNCTION_END;
+  PROFILE_HINT_SUCCESSFUL_RETURN;
+  return sum;
+}
+
+uint64_t run_all(void)
+{
+  PROFILE_FUNCTION_START;
+
+  uint64_t checksum = 0;
+  for (uint32_t i = 0; i < ROUNDS; i++)
+  {
+    checksum += fibonacci(64 + (i & 31));
+    checksum += sum_of_squares(1024);
+    PROFILE_COUNTER_ADD(rounds, 1);
+  }
+
+  PROFILE_FUNCTION_END;
+  PROFILE_HINT_SUCCESSFUL_RETURN;
+  return checksum;
+}
+
+// exported frames, by name
+
+#define FRAMES_MAX 8
+
+typedef struct frame_t
+{
+  char     _name[96];
+  uint64_t _values[3];
+} frame_t;
+
+static frame_t  g_frames[FRAMES_MAX];
+static uint32_t g_frame_count = 0;
+
+static frame_t* find_frame(const char* name)
+{
+  for (uint32_t i = 0; i < g_frame_count; i++)
+  {
+    if (strcmp(g_frames[i]._name, name) == 0)
+    {
+      return &g_frames[i];
+    }
+  }
+  return NULL;
+}
+
+static frame_t* add_frame(const char* name, size_t length)
+{
+  if (g_frame_count == FRAMES_MAX || length >= sizeof(g_frames[0]._name))
+  {
+    return NULL;
+  }
+  frame_t* frame = &g_frames[g_frame_count++];
+  memset(frame, 0, sizeof(*frame));
+  memcpy(frame->_name, name, length);
+  return frame;
+}
+
+// "name weight" lines into column `column` of the frames
+static bool read_folded(const char* path, uint32_t column)
+{
+  FILE* file = fopen(path, "r");
+  if (!file)
+  {
+    return false;
+  }
+
+  bool ok = true;
+  char line[256];
+  while (ok && fgets(line, sizeof(line), file))
+  {
+    char* space = strrchr(line, ' ');
+    if (!space)
+    {
+      ok = false;
+      break;
+    }
+    *space = '\0';
+
+    frame_t* frame = find_frame(line);
+    frame = frame ? frame : add_frame(line, strlen(line));
+    ok = frame && frame->_values[column] == 0;
+    if (ok)
+    {
+      frame->_values[column] = strtoull(space + 1, NULL, 10);
+    }
+  }
+
+  fclose(file);
+  return ok;
+}
+
+// minimal profile.proto reader: the string table, functions and samples
+
+typedef struct pb_reader_t
+{
+  const uint8_t* _at;
+  const uint8_t* _stop;
+} pb_reader_t;
+
+static bool pb_varint(pb_reader_t* pb, uint64_t* out)
+{
+  uint64_t value = 0;
+  for (uint32_t shift = 0; shift < 64 && pb->_at < pb->_stop; shift += 7)
+  {
+    uint8_t byte = *pb->_at++;
+    value |= (uint64_t)(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0)
+    {
+      *out = value;
+      return true;
+    }
+  }
+  return false;
+}
+
+// next field, length delimited ones come back as a nested reader
+static bool pb_field(pb_reader_t* pb, uint32_t* field, uint64_t* value, pb_reader_t* nested)
+{
+  uint64_t key;
+  if (!pb_varint(pb, &key) || !pb_varint(pb, value))
+  {
+    return false;
+  }
+  *field = (uint32_t)(key >> 3);
+  if ((key & 7) == 2)
+  {
+    if (*value > (uint64_t)(pb->_stop - pb->_at))
+    {
+      return false;
+    }
+    nested->_at   = pb->_at;
+    nested->_stop = pb->_at + *value;
+    pb->_at      += *value;
+  }
+  return (key & 7) == 0 || (key & 7) == 2;
+}
+
+#define PB_MAX 64
+
+static bool read_pprof(const char* path)
+{
+  FILE* file = fopen(path, "rb");
+  if (!file)
+  {
+    return false;
+  }
+  static uint8_t data[64 * 1024];
+  size_t size = fread(data, 1, sizeof(data), file);
+  fclose(file);
+
+  pb_reader_t strings[PB_MAX];
+  uint64_t    string_count = 0;
+  uint64_t    function_names[PB_MAX] = {0};   // by function id
+  uint64_t    sample_ids[PB_MAX];
+  uint64_t    sample_values[PB_MAX][3];
+  uint64_t    sample_count = 0;
+
+  pb_reader_t profile = { data, data + size };
+  pb_reader_t nested, inner;
+  uint32_t    field;
+  uint64_t    value;
+  while (profile._at < profile._stop)
+  {
+    if (!pb_field(&profile, &field, &value, &nested))
+    {
+      return false;
+    }
+
+    if (field == 6 && string_count < PB_MAX)
+    {
+      strings[string_count++] = nested;
+    }
+    else if (field == 5)
+    {
+      uint64_t id = 0, name = 0;
+      while (nested._at < nested._stop && pb_field(&nested, &field, &value, &inner))
+      {
+        id   = field == 1 ? value : id;
+        name = field == 2 ? value : name;
+      }
+      if (id >= PB_MAX)
+      {
+        return false;
+      }
+      function_names[id] = name;
+    }
+    else if (field == 2 && sample_count < PB_MAX)
+    {
+      uint32_t values = 0;
+      while (nested._at < nested._stop && pb_field(&nested, &field, &value, &inner))
+      {
+        while (field == 1 && inner._at < inner._stop && pb_varint(&inner, &value))
+        {
+          sample_ids[sample_count] = value;
+        }
+        while (field == 2 && values < 3 && inner._at < inner._stop && pb_varint(&inner, &value))
+        {
+          sample_values[sample_count][values++] = value;
+        }
+      }
+      if (values != 3)
+      {
+        return false;
+      }
+      sample_count++;
+    }
+  }
+
+  // locations share the function ids, one sample per exported site
+  for (uint64_t s = 0; s < sample_count; s++)
+  {
+    uint64_t name = sample_ids[s] < PB_MAX ? function_names[sample_ids[s]] : 0;
+    if (name == 0 || name >= string_count)
+    {
+      return false;
+    }
+
+    pb_reader_t* text  = &strings[name];
+    size_t       length = (size_t)(text->_stop - text->_at);
+    char         buffer[96];
+    if (length >= sizeof(buffer))
+    {
+      return false;
+    }
+    memcpy(buffer, text->_at, length);
+    buffer[length] = '\0';
+
+    // sample types are cycles, wall and calls, the same as the folded exports
+    frame_t* frame = find_frame(buffer);
+    if (!frame || frame->_values[0] != sample_values[s][0] || frame->_values[2] != sample_values[s][2])
+    {
+      log_println("pprof sample {str} doesn't match the folded export", buffer);
+      return false;
+    }
+  }
+  return sample_count == g_frame_count;
+}
+
+static uint64_t site_cycles(const char* name)
+{
+  _index index = profiler_find_site(name, pk_function);
+  return index != PROFILER_NO_INDEX ? profiler_get_cpu_stat(index)->_total_cycles : 0;
+}
+
+int main(void)
+{
+  profiler_init();
+
+  uint64_t checksum = run_all();
+
+  PROFILE_SPAN_BEGIN(batch, "batch");
+  for (uint32_t i = 0; i < 64; i++)
+  {
+    checksum += (uint64_t)i * i;
+  }
+  PROFILE_SPAN_END(batch);
+  log_println("checksum {u64}", checksum);
+
+  profiler_end();
+
+  if (!profiler_export_folded("profile_cycles.folded", pw_cycles) ||
+      !profiler_export_folded("profile_calls.folded", pw_calls) ||
+      !profiler_export_pprof("profile.pb", pw_nanoseconds))
+  {
+    return 1;
+  }
+
+  if (!read_folded("profile_cycles.folded", 0) || !read_folded("profile_calls.folded", 2))
+  {
+    log_println("the folded exports don't parse");
+    return 1;
+  }
+
+  // functions and spans only, the counter isn't a frame
+  frame_t* run = find_frame("run_all");
+  frame_t* fib = find_frame("fibonacci");
+  frame_t* sos = find_frame("sum_of_squares");
+  frame_t* bat = find_frame("batch");
+  if (g_frame_count != 4 || !run || !fib || !sos || !bat || find_frame("rounds"))
+  {
+    log_println("expected run_all, fibonacci, sum_of_squares and batch, exported {u32} frames", g_frame_count);
+    return 1;
+  }
+
+  if (run->_values[2] != 1 || fib->_values[2] != ROUNDS || sos->_values[2] != ROUNDS || bat->_values[2] != 1)
+  {
+    log_println("call weights are off");
+    return 1;
+  }
+
+  // self weights: the three functions add up to run_all's inclusive cycles, not more
+  uint64_t self_sum = run->_values[0] + fib->_values[0] + sos->_values[0];
+  if (self_sum != site_cycles("run_all") || run->_values[0] >= site_cycles("run_all") ||
+      fib->_values[0] != site_cycles("fibonacci") || bat->_values[0] == 0)
+  {
+    log_println("cycle weights {u64} don't add up to run_all's {u64}", self_sum, site_cycles("run_all"));
+    return 1;
+  }
+
+  if (!read_pprof("profile.pb"))
+  {
+    log_println("profile.pb doesn't read back as the exported sites");
+    return 1;
+  }
+
+  log_println("wrote profile_cycles.folded, profile_calls.folded and profile.pb");
+  return 0;
+}
@@ -0,0 +1,97 @@
+#include <tier_0.h>
+
+#define FRAMES 240
+
+static volatile uint64_t g_state = 1;
+
+void simulate(uint32_t steps)
+{
+  PROFILE_FUNCTION_START;
+
+  uint64_t state = g_state;
+  for (uint32_t i = 0; i < steps; i++)
+  {
+    state = state * 6364136223846793005ull + 1442695040888963407ull;
+  }
+  g_state = state;
+
+  PROFILE_FUNCTION_END;
+  PROFILE_HINT_SUCCESSFUL_RETURN;
+}
+
+void render(void)
+{
+  PROFILE_FUNCTION_START;
+
+  uint64_t state = g_state;
+  for (uint32_t i = 0; i < 20000; i++)
+  {
+    state ^= state >> 7;
+    state ^= state << 9;
+  }
+  g_state = state;
+
+  PROFILE_FUNCTION_END;
+  PROFILE_HINT_SUCCESSFUL_RETURN;
+}
+
+// every 50th frame hitches in the simulation
+void tick(uint32_t frame)
+{
+  PROFILE_FUNCTION_START;
+
+  simulate(frame % 50 == 49 ? 2000000 : 20000);
+  render();
+  PROFILE_COUNTER_ADD(ticks, 1);
+
+  PROFILE_FUNCTION_END;
+  PROFILE_HINT_SUCCESSFUL_RETURN;
+}
+
+int main(void)
+{
+  profiler_init();
+  profiler_frame_set_budget(200000); // 0.2 ms
+
+  PROFILE_FRAME_MARK();
+  for (uint32_t frame = 0; frame < FRAMES; frame++)
+  {
+    tick(frame);
+    PROFILE_FRAME_MARK();
+  }
+
+  profiler_end();
+  profiler_print_frames();
+
+  const prof_frame_stat_t*      stat  = profiler_frame_stat();
+  const prof_frame_breakdown_t* worst = profiler_frame_worst(0);
+  if (stat->_frames != FRAMES || !worst || worst->_frame % 50 != 49)
+  {
+    log_println("frame profiling mismatch");
+    return 1;
+  }
+
+  // self cycles: tick doesn't count simulate and render again, the counter isn't broken down
+  _index tick_index     = profiler_find_site("tick", pk_function);
+  _index simulate_index = profiler_find_site("simulate", pk_function);
+  _index ticks_index    = profiler_find_site("ticks", pk_counter);
+  u64    sum            = 0;
+  for (_index i = 0; i < profiler_get_function_count(); i++)
+  {
+    sum += worst->_func_cycles[i];
+  }
+  if (worst->_func_cycles[tick_index] >= worst->_func_cycles[simulate_index] || sum > worst->_cycles ||
+      ticks_index == PROFILER_NO_INDEX || worst->_func_calls[ticks_index] != 0 || worst->_func_cycles[ticks_index] != 0)
+  {
+    log_println("the worst frame isn't broken down by self cycles of functions");
+    return 1;
+  }
+
+  profiler_reset();
+  if (profiler_frame_stat()->_frames != 0 || profiler_frame_worst(0) || profiler_frame_stat()->_budget != 200000)
+  {
+    log_println("profiler_reset() kept the frames");
+    return 1;
+  }
+  return 0;
+}
@@ -39,6 +39,16 @@ uint32_t multiply_2(void)
   return result;
 }
 
+// registers after the registry filled up
+uint32_t late(void)
+{
+  PROFILE_FUNCTION_START;
+  PROFILE_COUNTER_ADD(late_calls, 1);
+  uint32_t result = multiply_2();
+  PROFILE_FUNCTION_END;
+  return result;
+}
+
 int main(void)
 {
   profiler_init();
@@ -50,5 +60,39 @@ int main(void)
   }
   profiler_end();
   profiler_print_all();
+
+  // a full registry hands out no index instead of reusing a live slot
+  _index last = PROFILER_NO_INDEX;
+  for (uint32_t i = 0; i <= TOTAL_FUNCTIONS; i++)
+  {
+    _index index = profiler_add_function(__FILE__, "filler", __LINE__);
+    if (index == PROFILER_NO_INDEX)
+    {
+      break;
+    }
+    last = index;
+  }
+  if (last != TOTAL_FUNCTIONS - 1)
+  {
+    log_println("registry filled up at {u64}", last);
+    return 1;
+  }
+
+  _index inner = profiler_find_site("multiply_2", pk_function);
+  uint64_t inner_calls = profiler_get_call_stat(inner)->_total_calls;
+  for (uint32_t i = 0; i < 8; i++)
+  {
+    late();
+  }
+  profiler_collect();
+
+  // the untracked caller doesn't hide its tracked callee or touch the last slot
+  if (profiler_get_call_stat(last)->_total_calls != 0 ||
+      profiler_get_call_stat(inner)->_total_calls != inner_calls + 8 ||
+      profiler_find_site("late", pk_function) != PROFILER_NO_INDEX)
+  {
+    log_println("untracked sites recorded into the registry");
+    return 1;
+  }
   return 0;
 }
@@ -0,0 +1,168 @@
+// pthread rwlocks
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <tier_0.h>
+
+#include <pthread.h>
+#include <stdio.h>
+#include <time.h>
+
+#define THREADS    4
+#define ITERATIONS 20000
+
+static pthread_mutex_t  g_mutex  = PTHREAD_MUTEX_INITIALIZER;
+static pthread_rwlock_t g_rwlock = PTHREAD_RWLOCK_INITIALIZER;
+static pthread_mutex_t  g_plain  = PTHREAD_MUTEX_INITIALIZER;
+
+static volatile uint64_t g_counter = 0;
+static volatile uint64_t g_table[64];
+static volatile uint64_t g_plain_counter = 0;
+
+void* worker(void* arg)
+{
+  uint64_t seed = (uint64_t)(uintptr_t)arg;
+
+  for (uint32_t i = 0; i < ITERATIONS; i++)
+  {
+    PROFILE_LOCK(counter, &g_mutex);
+    for (uint32_t spin = 0; spin < 64; spin++)
+    {
+      g_counter++;
+    }
+    PROFILE_UNLOCK(counter, &g_mutex);
+
+    seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+    if ((seed >> 60) == 0)
+    {
+      PROFILE_WRLOCK(table_write, &g_rwlock);
+      g_table[seed & 63]++;
+      PROFILE_RWUNLOCK(table_write, &g_rwlock);
+    }
+    else
+    {
+      PROFILE_RDLOCK(table_read, &g_rwlock);
+      uint64_t value = g_table[seed & 63];
+      (void)value;
+      PROFILE_RWUNLOCK(table_read, &g_rwlock);
+    }
+
+    // not annotated, only visible when linked with tier_0_lock_tracking()
+    pthread_mutex_lock(&g_plain);
+    g_plain_counter++;
+    pthread_mutex_unlock(&g_plain);
+  }
+
+  return NULL;
+}
+
+static pthread_mutex_t g_queue_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  g_queue_ready = PTHREAD_COND_INITIALIZER;
+static bool            g_queue_item  = false;
+
+void* producer(void* arg)
+{
+  (void)arg;
+  struct timespec delay = { 0, 20 * 1000 * 1000 };
+  nanosleep(&delay, NULL);
+
+  pthread_mutex_lock(&g_queue_mutex);
+  g_queue_item = true;
+  pthread_cond_signal(&g_queue_ready);
+  pthread_mutex_unlock(&g_queue_mutex);
+  return NULL;
+}
+
+// the wrapped mutex isn't held while the consumer waits on the condition variable
+static bool check_cond_wait(void)
+{
+  u64       start = get_cycle_count();
+  pthread_t handle;
+  pthread_create(&handle, NULL, producer, NULL);
+
+  pthread_mutex_lock(&g_queue_mutex);
+  while (!g_queue_item)
+  {
+    pthread_cond_wait(&g_queue_ready, &g_queue_mutex);
+  }
+  pthread_mutex_unlock(&g_queue_mutex);
+  pthread_join(handle, NULL);
+  u64 elapsed = get_cycle_count() - start;
+
+  char name[64];
+  snprintf(name, sizeof(name), "pthread:pthread_mutex@%p", (void*)&g_queue_mutex);
+  const prof_lock_stat_t* stat = profiler_get_lock_stat(profiler_find_site(name, pk_lock));
+  return stat && stat->_acquires >= 3 && stat->_releases == stat->_acquires && stat->_hold_cycles_max < elapsed / 4;
+}
+
+int main(void)
+{
+  profiler_init();
+
+  pthread_t threads[THREADS];
+  for (uintptr_t i = 0; i < THREADS; i++)
+  {
+    pthread_create(&threads[i], NULL, worker, (void*)(i + 1));
+  }
+  for (uint32_t i = 0; i < THREADS; i++)
+  {
+    pthread_join(threads[i], NULL);
+  }
+
+  profiler_print_all();
+
+  uint64_t acquires = 0;
+  for (_index index = 0; index < TOTAL_FUNCTIONS; index++)
+  {
+    const prof_stat_head_t* head = profiler_get_stat_head(index);
+    if (head && head->_kind == pk_lock)
+    {
+      acquires += profiler_get_lock_stat(index)->_acquires;
+    }
+  }
+
+  // counter, table_read + table_write, and the wrapped plain mutex
+  uint64_t expected = (uint64_t)THREADS * ITERATIONS * 3;
+  log_println("Lock acquires recorded: {u64} (expected {u64})", acquires, expected);
+  if (g_counter != (uint64_t)THREADS * ITERATIONS * 64 || acquires != expected)
+  {
+    log_println("lock profiling mismatch");
+    return 1;
+  }
+
+  // locks show up in queries like any other site, by acquires and wait plus hold cycles
+  prof_query_t      query;
+  prof_report_row_t rows[TOTAL_FUNCTIONS];
+  profiler_query_init(&query);
+  query._kinds = PROFILER_KIND_MASK(pk_lock);
+  u32      count = profiler_query(&query, rows, TOTAL_FUNCTIONS);
+  uint64_t calls = 0;
+  for (u32 i = 0; i < count; i++)
+  {
+    calls += rows[i]._calls;
+  }
+  if (count < 4 || calls != expected || rows[0]._total_cycles == 0)
+  {
+    log_println("lock sites missing from queries: {u32} rows, {u64} acquires", count, calls);
+    return 1;
+  }
+
+  if (!check_cond_wait())
+  {
+    log_println("a condition variable wait counted as holding its mutex");
+    return 1;
+  }
+
+  profiler_reset();
+  _index counter = profiler_find_site("worker:counter", pk_lock);
+  if (counter == PROFILER_NO_INDEX || profiler_get_lock_stat(counter)->_acquires != 0 ||
+      profiler_hist_count(profiler_get_lock_wait_hist(counter)) != 0)
+  {
+    log_println("profiler_reset() kept the lock stats");
+    return 1;
+  }
+
+  profiler_end();
+  return 0;
+}
@@ -0,0 +1,68 @@
+#include <tier_0.h>
+
+#include <pthread.h>
+
+#define THREADS  4
+#define MESSAGES 10000
+
+void* parser(void* arg)
+{
+  uint64_t id = (uint64_t)(uintptr_t)arg;
+
+  for (uint64_t i = 0; i < MESSAGES; i++)
+  {
+    PROFILE_COUNTER_ADD(bytes_parsed, 64 + (i & 63));
+    PROFILE_GAUGE(queue_depth, (i + id * 7) % 100);
+
+    if (i % 100 == 0)
+    {
+      PROFILE_COUNTER_ADD(messages_dropped, 1);
+    }
+  }
+  return NULL;
+}
+
+int main(void)
+{
+  profiler_init();
+
+  pthread_t threads[THREADS];
+  for (uintptr_t i = 0; i < THREADS; i++)
+  {
+    pthread_create(&threads[i], NULL, parser, (void*)i);
+  }
+  for (uint32_t i = 0; i < THREADS; i++)
+  {
+    pthread_join(threads[i], NULL);
+  }
+
+  profiler_end();
+  profiler_print_all();
+
+  prof_metric_t bytes;
+  prof_metric_t dropped;
+  prof_metric_t depth;
+  profiler_metric_read(profiler_find_site("bytes_parsed", pk_counter), &bytes);
+  profiler_metric_read(profiler_find_site("messages_dropped", pk_counter), &dropped);
+  profiler_metric_read(profiler_find_site("queue_depth", pk_gauge), &depth);
+
+  uint64_t expected_bytes = (uint64_t)THREADS * (MESSAGES * 64 + (MESSAGES / 64) * (63 * 64 / 2) + (MESSAGES % 64) * (MESSAGES % 64 - 1) / 2);
+  if (bytes._sum != expected_bytes || dropped._sum != THREADS * MESSAGES / 100 ||
+      depth._count != THREADS * MESSAGES || depth._min != 0 || depth._max != 99)
+  {
+    log_println("metric mismatch: bytes {u64} (expected {u64}), dropped {u64}, depth samples {u64}",
+                bytes._sum, expected_bytes, dropped._sum, depth._count);
+    return 1;
+  }
+
+  // values stay out of the cycle stats, updates count as calls
+  _index bytes_index = profiler_find_site("bytes_parsed", pk_counter);
+  _index depth_index = profiler_find_site("queue_depth", pk_gauge);
+  if (profiler_get_cpu_stat(bytes_index)->_total_cycles != 0 || profiler_get_cpu_stat(depth_index)->_total_cycles != 0 ||
+      profiler_hist_percentile(profiler_get_hist_stat(depth_index), 99.0) != 0 || profiler_get_call_stat(depth_index)->_total_calls != depth._count)
+  {
+    log_println("counter and gauge values leaked into the cycle stats");
+    return 1;
+  }
+  return 0;
+}
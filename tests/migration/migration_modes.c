@@ -0,0 +1,102 @@
+#include <tier_0.h>
+
+static volatile uint64_t g_sink = 0;
+
+void work(void)
+{
+  PROFILE_FUNCTION_START;
+
+  uint64_t value = g_sink;
+  for (uint32_t i = 0; i < 1000; i++)
+  {
+    value = value * 6364136223846793005ull + 1;
+  }
+  g_sink = value;
+
+  PROFILE_FUNCTION_END;
+  PROFILE_HINT_SUCCESSFUL_RETURN;
+}
+
+// one migrated call of `index` as PROFILE_FUNCTION_START / END record it
+static bool replay(_index index, enum prof_migration_mode mode, uint64_t cycles)
+{
+  profiler_migration_set_mode(mode);
+  profiler_enter(index);
+  profiler_add(pa_total_calls, 1, index);
+  bool recorded = profiler_region_cpu(index, 0, 1, cycles);
+  if (recorded)
+  {
+    profiler_add(pa_cycles_total, cycles, index);
+    profiler_add(pa_time_total, cycles, index);
+  }
+  profiler_leave_work(index, cycles, cycles, 64, 1);
+  return recorded;
+}
+
+static bool check_site(_index index, uint64_t calls, uint64_t cycles, uint64_t migrated_cycles)
+{
+  const prof_migration_stat_t* stat = profiler_get_migration_stat(index);
+  return profiler_get_call_stat(index)->_total_calls == calls &&
+         profiler_get_cpu_stat(index)->_total_cycles == cycles &&
+         profiler_get_self_stat(index)->_cycles == cycles &&
+         profiler_get_work_stat(index)->_calls == calls &&
+         profiler_thread()->_site[index]._calls == calls &&
+         stat->_migrations == 1 && stat->_migrated_cycles == migrated_cycles;
+}
+
+int main(void)
+{
+  profiler_init();
+
+  for (uint32_t i = 0; i < 1000; i++)
+  {
+    work();
+  }
+
+  uint32_t cpu;
+  get_cycle_count_cpu(&cpu);
+  log_println("clock {str}, running on cpu {u32}", profiler_clock_name(profiler_clock_current()), cpu);
+
+  // one migrated call per mode, each on its own site
+  _index kept_site      = profiler_add_function(__FILE__, "kept", __LINE__);
+  _index discarded_site = profiler_add_function(__FILE__, "discarded", __LINE__);
+  _index separate_site  = profiler_add_function(__FILE__, "separate", __LINE__);
+  bool   kept      = replay(kept_site, pm_keep, 5000);
+  bool   discarded = replay(discarded_site, pm_discard, 7000);
+  bool   separate  = replay(separate_site, pm_separate, 6000);
+
+  _index index = profiler_find_site("work", pk_function);
+  bool   local = profiler_region_cpu(index, 3, 3, 100);
+
+  profiler_end();
+  profiler_print_all();
+
+  // keep records the call everywhere, discard nowhere, separate only in the migration stats
+  if (!kept || discarded || separate || !local ||
+      !check_site(kept_site, 1, 5000, 5000) ||
+      !check_site(discarded_site, 0, 0, 0) ||
+      !check_site(separate_site, 0, 0, 6000) ||
+      profiler_migrations_total() != 3 + profiler_get_migration_stat(index)->_migrations ||
+      profiler_get_cpu_breakdown(index, 3)->_calls != 1)
+  {
+    log_println("migration accounting mismatch");
+    return 1;
+  }
+
+  // with an rdtscp backend every real call landed in a per cpu bucket
+  const prof_migration_stat_t* stat = profiler_get_migration_stat(index);
+  if (cpu != PROFILER_CPU_UNKNOWN && cpu < PROFILER_MAX_CPUS)
+  {
+    uint64_t calls = 0;
+    for (uint32_t c = 0; c < PROFILER_MAX_CPUS; c++)
+    {
+      calls += profiler_get_cpu_breakdown(index, c)->_calls;
+    }
+    if (calls != 1000 + 1 - stat->_unknown - stat->_migrations)
+    {
+      log_println("per cpu breakdown mismatch: {u64}", calls);
+      return 1;
+    }
+  }
+  return 0;
+}
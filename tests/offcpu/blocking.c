@@ -0,0 +1,74 @@
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <tier_0.h>
+
+#include <time.h>
+
+static volatile uint64_t g_sink = 0;
+
+// waits, almost all of its wall time is off cpu
+void wait_for_io(void)
+{
+  PROFILE_FUNCTION_START;
+  struct timespec delay = { 0, 10 * 1000 * 1000 };
+  nanosleep(&delay, NULL);
+  PROFILE_FUNCTION_END;
+}
+
+// computes for about as long
+void compute(void)
+{
+  PROFILE_FUNCTION_START;
+  u64 until = get_nanoseconds() + 10 * 1000 * 1000;
+  while (get_nanoseconds() < until)
+  {
+    g_sink++;
+  }
+  PROFILE_FUNCTION_END;
+}
+
+int main(void)
+{
+  profiler_init();
+  if (!profiler_offcpu_enable(true))
+  {
+    log_println("thread cpu time unavailable, skipping");
+    return 0;
+  }
+
+  for (uint32_t i = 0; i < 5; i++)
+  {
+    wait_for_io();
+    compute();
+  }
+
+  profiler_end();
+  profiler_print_all();
+
+  const prof_offcpu_stat_t* waiting = profiler_get_offcpu_stat(profiler_find_site("wait_for_io", pk_function));
+  const prof_offcpu_stat_t* working = profiler_get_offcpu_stat(profiler_find_site("compute", pk_function));
+
+  if (waiting->_calls != 5 || waiting->_cpu_time * 4 > waiting->_wall_time || waiting->_voluntary < 5)
+  {
+    log_println("blocking site mismatch: wall {u64} cpu {u64} voluntary {u64}",
+                waiting->_wall_time, waiting->_cpu_time, waiting->_voluntary);
+    return 1;
+  }
+  // a busy host can preempt the loop, half on cpu is enough to tell the two apart
+  if (working->_calls != 5 || working->_cpu_time * 2 < working->_wall_time)
+  {
+    log_println("computing site mismatch: wall {u64} cpu {u64}", working->_wall_time, working->_cpu_time);
+    return 1;
+  }
+
+  profiler_offcpu_enable(false);
+  compute();
+  if (working->_calls != 5)
+  {
+    log_println("sampled while disabled");
+    return 1;
+  }
+  return 0;
+}
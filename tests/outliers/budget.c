@@ -0,0 +1,125 @@
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <tier_0.h>
+
+#include <pthread.h>
+#include <time.h>
+
+#define BUDGET_NS (1000 * 1000)
+
+static volatile uint64_t g_sink = 0;
+
+// every fifth call blocks for 3 ms, three times its budget
+NO_INLINE void handle_request(uint32_t i)
+{
+  PROFILE_FUNCTION_START;
+  PROFILE_FUNCTION_BUDGET_NS(BUDGET_NS);
+  if (i % 5 == 0)
+  {
+    struct timespec delay = { 0, 3 * 1000 * 1000 };
+    nanosleep(&delay, NULL);
+  }
+  g_sink += i;
+  PROFILE_FUNCTION_END;
+}
+
+// over any budget, fills the ring
+NO_INLINE void tiny(void)
+{
+  PROFILE_FUNCTION_START;
+  g_sink++;
+  PROFILE_FUNCTION_END;
+}
+
+static void* worker(void* arg)
+{
+  (void)arg;
+  profiler_thread_set_name("worker");
+  handle_request(0);
+  return NULL;
+}
+
+int main(void)
+{
+  profiler_init();
+
+  for (uint32_t i = 0; i < 20; i++)
+  {
+    handle_request(i);
+  }
+
+  _index request = profiler_find_site("handle_request", pk_function);
+  if (profiler_get_budget(request) != BUDGET_NS || profiler_budget_violations(request) != 4)
+  {
+    log_println("expected 4 violations of a {u64} ns budget, got {u64}", profiler_get_budget(request),
+                profiler_budget_violations(request));
+    return 1;
+  }
+
+  prof_outlier_t records[64];
+  u32 count = profiler_outliers(records, 64);
+  if (count != 4)
+  {
+    log_println("expected 4 outlier records, got {u32}", count);
+    return 1;
+  }
+  for (u32 i = 0; i < count; i++)
+  {
+    // the innermost frame is the profiled function itself
+    uintptr_t function = (uintptr_t)handle_request;
+    uintptr_t caller   = records[i]._frame_count ? (uintptr_t)records[i]._frames[0] : 0;
+    if (records[i]._index != request || records[i]._duration <= BUDGET_NS || records[i]._budget != BUDGET_NS ||
+        records[i]._timestamp < profiler_start_time() || caller <= function || caller - function > 4096)
+    {
+      log_println("bad outlier record {u32}: duration {u64} frames {u32}", i, records[i]._duration,
+                  records[i]._frame_count);
+      return 1;
+    }
+  }
+
+  pthread_t thread;
+  pthread_create(&thread, NULL, worker, NULL);
+  pthread_join(thread, NULL);
+  if (profiler_outliers(records, 64) != 5 || profiler_budget_violations(request) != 5)
+  {
+    log_println("worker outlier missing");
+    return 1;
+  }
+
+  // the ring keeps the newest PROFILER_OUTLIERS per thread, violations keep counting
+  tiny();
+  _index tiny_index = profiler_find_site("tiny", pk_function);
+  profiler_set_budget(tiny_index, 1);
+  for (uint32_t i = 0; i < PROFILER_OUTLIERS * 2; i++)
+  {
+    tiny();
+  }
+  if (profiler_budget_violations(tiny_index) != PROFILER_OUTLIERS * 2 || profiler_outliers(records, 64) != PROFILER_OUTLIERS + 1)
+  {
+    log_println("ring overflow: {u64} violations, {u32} records", profiler_budget_violations(tiny_index),
+                profiler_outliers(records, 64));
+    return 1;
+  }
+
+  profiler_outliers_dump();
+  profiler_print_all();
+
+  // removing the budget stops the capture
+  profiler_set_budget(request, 0);
+  handle_request(0);
+  if (profiler_budget_violations(request) != 5)
+  {
+    log_println("budget still enforced after removal");
+    return 1;
+  }
+
+  profiler_reset();
+  if (profiler_outliers(records, 64) != 0 || profiler_budget_violations(tiny_index) != 0 || profiler_get_budget(tiny_index) != 1)
+  {
+    log_println("reset should drop outliers and keep budgets");
+    return 1;
+  }
+  return 0;
+}
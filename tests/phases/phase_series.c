@@ -0,0 +1,184 @@
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <tier_0.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+#define BUFFER_SIZE (256 * 1024)
+
+uint64_t touch_buffer(uint8_t* buffer, size_t size)
+{
+  PROFILE_FUNCTION_START;
+
+  uint64_t sum = 0;
+  for (size_t i = 0; i < size; i += 64)
+  {
+    buffer[i]++;
+    sum += buffer[i];
+  }
+
+  PROFILE_FUNCTION_END;
+  PROFILE_HINT_SUCCESSFUL_RETURN;
+  return sum;
+}
+
+static prof_series_interval_t g_interval;
+
+static uint64_t interval_calls(uint32_t n, _index index)
+{
+  return profiler_series_get(n, &g_interval) ? g_interval._points[index]._calls : UINT64_MAX;
+}
+
+static int fail(const char* what)
+{
+  log_println("series mismatch: {str}", what);
+  return 1;
+}
+
+// interpolation inside a bucket stays within the recorded values
+static bool check_percentiles(void)
+{
+  prof_hist_stat_t hist;
+  memset(&hist, 0, sizeof(hist));
+  for (uint64_t value = 3590; value <= 3698; value++)
+  {
+    profiler_hist_record(&hist, value);
+  }
+
+  u64 p0  = profiler_hist_percentile(&hist, 0.0);
+  u64 p50 = profiler_hist_percentile(&hist, 50.0);
+  u64 p99 = profiler_hist_percentile(&hist, 99.0);
+  if (p0 != 3590 || p50 < 3590 || p50 > 3698 || p99 < p50 || p99 > 3698)
+  {
+    return false;
+  }
+
+  // zero is a value too
+  profiler_hist_record(&hist, 0);
+  return profiler_hist_percentile(&hist, 0.0) == 0 && profiler_hist_percentile(&hist, 100.0) == 3698;
+}
+
+int main(void)
+{
+  if (!check_percentiles())
+  {
+    return fail("percentiles outside the recorded values");
+  }
+
+  profiler_init();
+
+  uint8_t* buffer = malloc(BUFFER_SIZE);
+  if (!buffer)
+  {
+    return -1;
+  }
+  memset(buffer, 0, BUFFER_SIZE);
+
+  uint64_t sum = 0;
+
+  // the first interval reaches back to profiler_init()
+  for (uint32_t i = 0; i < 10; i++)
+  {
+    sum += touch_buffer(buffer, BUFFER_SIZE);
+  }
+  profiler_series_sample();
+  _index index = profiler_find_site("touch_buffer", pk_function);
+
+  for (uint32_t i = 0; i < 20; i++)
+  {
+    sum += touch_buffer(buffer, BUFFER_SIZE);
+  }
+  profiler_series_sample();
+
+  // counters restart at a reset, the interval holds what ran after it
+  profiler_reset();
+  for (uint32_t i = 0; i < 5; i++)
+  {
+    sum += touch_buffer(buffer, BUFFER_SIZE);
+  }
+  profiler_series_sample();
+
+  if (profiler_series_count() != 3 || interval_calls(0, index) != 10 || interval_calls(1, index) != 20 ||
+      interval_calls(2, index) != 5 || g_interval._points[index]._cycles != profiler_get_cpu_stat(index)->_total_cycles)
+  {
+    return fail("manual samples");
+  }
+
+  // a new capacity resizes the ring and keeps what was sampled
+  profiler_series_start(10, 64);
+
+  profiler_phase_begin("warmup");
+  for (uint32_t i = 0; i < 64; i++)
+  {
+    sum += touch_buffer(buffer, BUFFER_SIZE);
+  }
+
+  profiler_phase_begin("steady");
+  for (uint32_t i = 0; i < 1024; i++)
+  {
+    sum += touch_buffer(buffer, BUFFER_SIZE);
+  }
+  profiler_phase_end();
+
+  profiler_series_stop();
+  profiler_series_sample();
+
+  // every call since the collector started lands in exactly one interval
+  uint32_t count = profiler_series_count();
+  uint64_t calls = 0;
+  for (uint32_t n = 3; n < count; n++)
+  {
+    calls += interval_calls(n, index);
+  }
+  if (count < 4 || interval_calls(0, index) != 10 || interval_calls(2, index) != 5 ||
+      (count < 64 && calls != 64 + 1024))
+  {
+    return fail("collector intervals");
+  }
+
+  // interval percentiles come from the interval's buckets, within the extremes since the reset
+  const prof_cpu_stat_t* cpu = profiler_get_cpu_stat(index);
+  for (uint32_t n = 2; n < count; n++)
+  {
+    if (interval_calls(n, index) == 0)
+    {
+      continue;
+    }
+    const prof_series_point_t* point = &g_interval._points[index];
+    if (point->_cycles_p50 < cpu->_cycles_min || point->_cycles_p50 > point->_cycles_p99 ||
+        point->_cycles_p99 > cpu->_cycles_max)
+    {
+      return fail("interval percentiles");
+    }
+  }
+
+  free(buffer);
+  log_println("checksum {u64}", sum);
+
+  profiler_end();
+  profiler_print_all();
+  profiler_print_phases();
+
+  log_println("time series intervals: {u32}", count);
+  char dir[] = "/tmp/tier0_series_XXXXXX";
+  if (!mkdtemp(dir))
+  {
+    return 1;
+  }
+  char path[256];
+  snprintf(path, sizeof(path), "%s/phase_series.csv", dir);
+  bool exported = profiler_series_export_csv(path);
+  remove(path);
+  rmdir(dir);
+
+  profiler_phase_clear();
+  return exported ? 0 : fail("csv export");
+}
@@ -0,0 +1,228 @@
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <tier_0.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#define WORKERS 3
+
+static volatile uint64_t g_sink = 0;
+
+void shared_work(void)
+{
+  PROFILE_FUNCTION_START;
+  for (uint32_t i = 0; i < 10000; i++)
+  {
+    g_sink += i;
+  }
+  PROFILE_FUNCTION_END;
+}
+
+void worker_only(void)
+{
+  PROFILE_FUNCTION_START;
+  g_sink++;
+  PROFILE_FUNCTION_END;
+}
+
+void allocate(uint32_t count)
+{
+  PROFILE_FUNCTION_START;
+  for (uint32_t i = 0; i < count; i++)
+  {
+    char* buffer = malloc(64);
+    g_sink += buffer != NULL;
+    free(buffer);
+  }
+  PROFILE_FUNCTION_END;
+}
+
+// one of each kind of sample
+static void record(uint32_t count)
+{
+  for (uint32_t i = 0; i < count; i++)
+  {
+    PROFILE_COUNTER_ADD(jobs, 1);
+    PROFILE_GAUGE(depth, i);
+  }
+  allocate(count);
+}
+
+// only what the child recorded itself, pre fork metrics and allocations stay with the parent
+static bool child_clean(void)
+{
+  prof_metric_t     jobs, depth;
+  prof_alloc_stat_t allocs;
+  profiler_metric_read(profiler_find_site("jobs", pk_counter), &jobs);
+  profiler_metric_read(profiler_find_site("depth", pk_gauge), &depth);
+  profiler_alloc_stat(profiler_find_site("allocate", pk_function), &allocs);
+  return jobs._count == 1 && depth._count == 1 && depth._max == 0 && allocs._allocs == 1;
+}
+
+#ifdef __linux__
+static const prof_process_site_t* find(const prof_process_dump_t* dump, const char* name)
+{
+  for (u32 i = 0; i < dump->_header._sites; i++)
+  {
+    if (strcmp(dump->_sites[i]._head._func_name, name) == 0)
+    {
+      return &dump->_sites[i];
+    }
+  }
+  return NULL;
+}
+
+static void remove_dump(const char* path, void* user)
+{
+  (void)user;
+  remove(path);
+}
+
+static prof_process_dump_t g_merged;
+static prof_process_dump_t g_child;
+
+int main(void)
+{
+  char dir[] = "/tmp/tier0_fork_XXXXXX";
+  if (!mkdtemp(dir))
+  {
+    return 1;
+  }
+
+  profiler_init();
+  if (!profiler_process_enable(dir))
+  {
+    return 1;
+  }
+
+  // before the fork, must only show up in the parent
+  for (uint32_t i = 0; i < 10; i++)
+  {
+    shared_work();
+  }
+  record(100);
+
+  // a dump an earlier run left in the directory, not part of this run's merge
+  char stale[256];
+  char path[256];
+  snprintf(stale, sizeof(stale), "%s/" PROFILER_PROCESS_PREFIX "%08x.1.prof", dir, profiler_process_run() ^ 2);
+  profiler_process_path(dir, (u32)getpid(), path, sizeof(path));
+  if (!profiler_process_dump() || rename(path, stale) != 0)
+  {
+    return 1;
+  }
+
+  // the children end their copy of the trace, the parent's stays intact
+  char trace[256];
+  snprintf(trace, sizeof(trace), "%s/fork.t0trace", dir);
+  if (!profiler_trace_start(trace))
+  {
+    return 1;
+  }
+
+  pid_t children[WORKERS];
+  for (uint32_t w = 0; w < WORKERS; w++)
+  {
+    children[w] = fork();
+    if (children[w] == 0)
+    {
+      if (profiler_trace_active())
+      {
+        _exit(2);
+      }
+      for (uint32_t i = 0; i < 5; i++)
+      {
+        shared_work();
+      }
+      worker_only();
+      record(1);
+      if (!child_clean())
+      {
+        _exit(3);
+      }
+
+      // dumps at exit, or through the _exit wrap
+      if (w == 1)
+      {
+        _exit(0);
+      }
+      exit(0);
+    }
+  }
+
+  int failed = 0;
+  for (uint32_t w = 0; w < WORKERS; w++)
+  {
+    int status = 0;
+    waitpid(children[w], &status, 0);
+    failed |= !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+  }
+  profiler_process_dump();
+
+  prof_trace_file_t trace_file;
+  if (!profiler_trace_stop() || !profiler_trace_open(trace, &trace_file))
+  {
+    log_println("the parent's trace didn't survive the forks");
+    failed = 1;
+  }
+  else
+  {
+    failed |= !trace_file._complete;
+    profiler_trace_close(&trace_file);
+  }
+  remove(trace);
+
+  profiler_process_path(dir, (u32)children[0], path, sizeof(path));
+  const prof_process_site_t* child_work = NULL;
+  const prof_process_site_t* child_jobs = NULL;
+  if (profiler_process_load(path, &g_child))
+  {
+    child_work = find(&g_child, "shared_work");
+    child_jobs = find(&g_child, "jobs");
+  }
+
+  profiler_process_merge(dir, &g_merged);
+  const prof_process_site_t* merged_work   = find(&g_merged, "shared_work");
+  const prof_process_site_t* merged_worker = find(&g_merged, "worker_only");
+  const prof_process_site_t* merged_jobs   = find(&g_merged, "jobs");
+  const prof_process_site_t* merged_depth  = find(&g_merged, "depth");
+  const prof_process_site_t* merged_alloc  = find(&g_merged, "allocate");
+
+  profiler_process_print_dir(dir);
+
+  if (failed || !child_work || child_work->_call._total_calls != 5 || g_child._header._parent != (u32)getpid() ||
+      !child_jobs || child_jobs->_call._total_calls != 1)
+  {
+    log_println("child dump mismatch");
+    failed = 1;
+  }
+  if (g_merged._header._processes != WORKERS + 1 || !merged_work || !merged_worker ||
+      merged_work->_call._total_calls != 10 + 5 * WORKERS || merged_worker->_call._total_calls != WORKERS ||
+      profiler_hist_count(&merged_work->_hist) != 10 + 5 * WORKERS || !merged_jobs || !merged_depth || !merged_alloc ||
+      merged_jobs->_call._total_calls != 100 + WORKERS || merged_depth->_call._total_calls != 100 + WORKERS ||
+      merged_alloc->_call._total_calls != 1 + WORKERS)
+  {
+    log_println("merged dump mismatch");
+    failed = 1;
+  }
+
+  profiler_process_disable();
+  impl_dir_list(dir, PROFILER_PROCESS_PREFIX, remove_dump, NULL);
+  rmdir(dir);
+  return failed;
+}
+#else
+int main(void)
+{
+  return 0;
+}
+#endif
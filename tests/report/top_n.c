@@ -0,0 +1,158 @@
+#include <tier_0.h>
+
+#include <string.h>
+
+static volatile uint64_t g_sink = 0;
+
+static void spin(uint32_t n)
+{
+  for (uint32_t i = 0; i < n; i++)
+  {
+    g_sink += i;
+  }
+}
+
+void leaf_small(void)
+{
+  PROFILE_FUNCTION_START;
+  spin(1000);
+  PROFILE_FUNCTION_END;
+}
+
+void leaf_large(void)
+{
+  PROFILE_FUNCTION_START;
+  spin(20000);
+  PROFILE_FUNCTION_END;
+}
+
+// almost all of its time is in the two leaves
+void parent(void)
+{
+  PROFILE_FUNCTION_START;
+  leaf_small();
+  leaf_large();
+  spin(100);
+  PROFILE_FUNCTION_END;
+}
+
+static int fail(const char* what)
+{
+  log_println("report mismatch: {str}", what);
+  return 1;
+}
+
+int main(void)
+{
+  profiler_init();
+
+  for (uint32_t i = 0; i < 200; i++)
+  {
+    parent();
+  }
+  for (uint32_t i = 0; i < 300; i++)
+  {
+    leaf_small();
+  }
+  PROFILE_COUNTER_ADD(reports, 1);
+
+  prof_query_t query;
+  prof_report_row_t rows[TOTAL_FUNCTIONS];
+
+  // parent is inclusive of both leaves
+  profiler_query_init(&query);
+  u32 count = profiler_query(&query, rows, TOTAL_FUNCTIONS);
+  if (count != 3 || strcmp(rows[0]._name, "parent") != 0)
+  {
+    return fail("total cycles order");
+  }
+
+  // by self cycles the big leaf wins and the shares add up to the whole
+  query._sort = ps_self_cycles;
+  count = profiler_query(&query, rows, TOTAL_FUNCTIONS);
+  f64 self_share = 0.0;
+  for (u32 i = 0; i < count; i++)
+  {
+    self_share += rows[i]._self_share;
+  }
+  if (strcmp(rows[0]._name, "leaf_large") != 0 || (self_share < 99.5 || self_share > 100.5))
+  {
+    return fail("self cycles order or self share");
+  }
+  if (rows[0]._share <= 0.0 || rows[0]._share > 100.0)
+  {
+    return fail("share");
+  }
+
+  query._sort  = ps_calls;
+  query._limit = 1;
+  count = profiler_query(&query, rows, TOTAL_FUNCTIONS);
+  if (count != 1 || strcmp(rows[0]._name, "leaf_small") != 0 || rows[0]._calls != 500)
+  {
+    return fail("calls / limit");
+  }
+
+  // a short buffer still gets the best rows, not the first registered ones
+  prof_report_row_t top[2];
+  count = profiler_query(&query, top, 1);
+  if (count != 1 || strcmp(top[0]._name, "leaf_small") != 0)
+  {
+    return fail("top row with capacity 1");
+  }
+
+  query._sort  = ps_total_cycles;
+  query._limit = 0;
+  count = profiler_query(&query, top, 2);
+  if (count != 2 || strcmp(top[0]._name, "parent") != 0 || strcmp(top[1]._name, "leaf_large") != 0)
+  {
+    return fail("top rows with capacity 2");
+  }
+
+  profiler_query_init(&query);
+  query._function = "leaf";
+  count = profiler_query(&query, rows, TOTAL_FUNCTIONS);
+  if (count != 2)
+  {
+    return fail("function filter");
+  }
+
+  query._function = NULL;
+  query._file     = "no_such_file";
+  if (profiler_query(&query, rows, TOTAL_FUNCTIONS) != 0)
+  {
+    return fail("file filter");
+  }
+
+  // other categories only show up when asked for
+  query._file  = NULL;
+  query._kinds = PROFILER_KIND_MASK(pk_counter);
+  count = profiler_query(&query, rows, TOTAL_FUNCTIONS);
+  if (count != 1 || strcmp(rows[0]._name, "reports") != 0)
+  {
+    return fail("category filter");
+  }
+
+  profiler_query_init(&query);
+  query._rollup = pr_file;
+  count = profiler_query(&query, rows, TOTAL_FUNCTIONS);
+  if (count != 1 || rows[0]._sites != 3 || rows[0]._calls != 200 + 200 + 200 + 300)
+  {
+    return fail("file rollup");
+  }
+
+  query._rollup = pr_module;
+  count = profiler_query(&query, rows, TOTAL_FUNCTIONS);
+  if (count != 1 || rows[0]._sites != 3)
+  {
+    return fail("module rollup");
+  }
+
+  profiler_end();
+
+  profiler_query_init(&query);
+  query._sort = ps_self_cycles;
+  profiler_print_report(&query);
+  query._rollup = pr_module;
+  profiler_print_report(&query);
+  return 0;
+}
@@ -0,0 +1,146 @@
+#include <tier_0.h>
+
+#include <pthread.h>
+
+#define WORKERS  3
+#define REQUESTS 2000
+#define QUEUE    64
+
+typedef struct task_t
+{
+  prof_span_t request;
+  uint64_t    payload;
+} task_t;
+
+static task_t          g_queue[QUEUE];
+static uint32_t        g_head = 0;
+static uint32_t        g_tail = 0;
+static bool            g_done = false;
+static pthread_mutex_t g_mutex     = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  g_not_empty = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t  g_not_full  = PTHREAD_COND_INITIALIZER;
+
+static volatile uint64_t g_checksum = 0;
+
+void push(task_t task)
+{
+  pthread_mutex_lock(&g_mutex);
+  while (g_tail - g_head == QUEUE)
+  {
+    pthread_cond_wait(&g_not_full, &g_mutex);
+  }
+  g_queue[g_tail++ % QUEUE] = task;
+  pthread_cond_signal(&g_not_empty);
+  pthread_mutex_unlock(&g_mutex);
+}
+
+bool pop(task_t* task)
+{
+  pthread_mutex_lock(&g_mutex);
+  while (g_tail == g_head && !g_done)
+  {
+    pthread_cond_wait(&g_not_empty, &g_mutex);
+  }
+  bool ok = g_tail != g_head;
+  if (ok)
+  {
+    *task = g_queue[g_head++ % QUEUE];
+    pthread_cond_signal(&g_not_full);
+  }
+  pthread_mutex_unlock(&g_mutex);
+  return ok;
+}
+
+void* worker(void* arg)
+{
+  (void)arg;
+
+  task_t task;
+  while (pop(&task))
+  {
+    // child span begins and ends here, the request span began on the producer
+    PROFILE_SPAN_BEGIN_CHILD(handle, "handle_request", task.request);
+    uint64_t value = task.payload;
+    for (uint32_t i = 0; i < 256; i++)
+    {
+      value = value * 6364136223846793005ull + 1442695040888963407ull;
+    }
+    g_checksum += value;
+    PROFILE_SPAN_END(handle);
+
+    PROFILE_SPAN_END(task.request);
+  }
+  return NULL;
+}
+
+int main(void)
+{
+  profiler_init();
+
+  pthread_t threads[WORKERS];
+  for (uint32_t i = 0; i < WORKERS; i++)
+  {
+    pthread_create(&threads[i], NULL, worker, NULL);
+  }
+
+  for (uint64_t i = 0; i < REQUESTS; i++)
+  {
+    PROFILE_SPAN_BEGIN(request, "request");
+    push((task_t){request, i});
+  }
+
+  pthread_mutex_lock(&g_mutex);
+  g_done = true;
+  pthread_cond_broadcast(&g_not_empty);
+  pthread_mutex_unlock(&g_mutex);
+
+  for (uint32_t i = 0; i < WORKERS; i++)
+  {
+    pthread_join(threads[i], NULL);
+  }
+
+  profiler_end();
+  profiler_print_all();
+
+  uint64_t ended    = 0;
+  uint64_t children = 0;
+  for (_index index = 0; index < profiler_get_function_count(); index++)
+  {
+    if (profiler_get_stat_head(index)->_kind == pk_span)
+    {
+      ended    += profiler_get_span_stat(index)->_ended;
+      children += profiler_get_span_stat(index)->_children;
+    }
+  }
+
+  profiler_export_trace("spans.trace.json");
+  log_println("wrote spans.trace.json");
+
+  if (ended != REQUESTS * 2 || children != REQUESTS)
+  {
+    log_println("span mismatch: {u64} ended, {u64} children", ended, children);
+    return 1;
+  }
+
+  // the registry holds what the worker threads' shards recorded
+  _index request = profiler_find_site("request", pk_span);
+  if (profiler_get_call_stat(request)->_total_calls != REQUESTS ||
+      profiler_hist_count(profiler_get_hist_stat(request)) != REQUESTS ||
+      profiler_get_self_stat(request)->_cycles != profiler_get_cpu_stat(request)->_total_cycles)
+  {
+    log_println("request site: {u64} calls", profiler_get_call_stat(request)->_total_calls);
+    return 1;
+  }
+
+  // a reset clears the span stats and records along with everything else
+  prof_span_record_t record;
+  profiler_reset();
+  profiler_collect();
+  if (profiler_get_span_stat(request)->_ended != 0 || profiler_get_call_stat(request)->_total_calls != 0 ||
+      profiler_span_records(&record, 1) != 0)
+  {
+    log_println("spans survived profiler_reset");
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,103 @@
+#include <tier_0.h>
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#define WORKERS      4
+#define SHORT_LIVED 40
+
+static volatile uint64_t g_sink = 0;
+
+// one chunk of a parallel loop, the first worker gets four times the work
+void process_chunk(uint32_t size)
+{
+  PROFILE_FUNCTION_START;
+  for (uint32_t i = 0; i < size; i++)
+  {
+    g_sink += i;
+  }
+  PROFILE_FUNCTION_END;
+}
+
+void tiny_task(void)
+{
+  PROFILE_FUNCTION_START;
+  g_sink++;
+  PROFILE_FUNCTION_END;
+}
+
+static void* worker(void* arg)
+{
+  uint32_t id = (uint32_t)(uintptr_t)arg;
+
+  char name[PROFILER_THREAD_NAME];
+  snprintf(name, sizeof(name), "worker-%u", id);
+  profiler_thread_set_name(name);
+
+  uint32_t size = id == 0 ? 400000 : 100000;
+  for (uint32_t i = 0; i < 10; i++)
+  {
+    process_chunk(size);
+  }
+  return NULL;
+}
+
+static void* short_lived(void* arg)
+{
+  (void)arg;
+  tiny_task();
+  return NULL;
+}
+
+int main(void)
+{
+  profiler_init();
+
+  // one after the other so time slicing on small machines doesn't blur the shares,
+  // every thread has exited before the report
+  for (uint32_t id = 0; id < WORKERS; id++)
+  {
+    pthread_t thread;
+    pthread_create(&thread, NULL, worker, (void*)(uintptr_t)id);
+    pthread_join(thread, NULL);
+  }
+  for (uint32_t i = 0; i < SHORT_LIVED; i++)
+  {
+    pthread_t thread;
+    pthread_create(&thread, NULL, short_lived, NULL);
+    pthread_join(thread, NULL);
+  }
+
+  profiler_end();
+  profiler_print_all();
+  profiler_print_threads();
+
+  prof_imbalance_t chunk;
+  if (!profiler_thread_imbalance(profiler_find_site("process_chunk", pk_function), &chunk) ||
+      chunk._threads != WORKERS || chunk._max_over_mean < 1.5 || chunk._slowest_share < 0.4 || chunk._cv < 0.3)
+  {
+    log_println("chunk imbalance mismatch, max/mean {f64} share {f64}", chunk._max_over_mean, chunk._slowest_share);
+    return 1;
+  }
+
+  prof_imbalance_t tiny;
+  if (!profiler_thread_imbalance(profiler_find_site("tiny_task", pk_function), &tiny) || tiny._threads != SHORT_LIVED)
+  {
+    log_println("short lived threads lost");
+    return 1;
+  }
+
+  // the slowest thread is the named first worker, with all of its calls
+  for (prof_thread_t* thread = profiler_thread_first(); thread; thread = thread->_next)
+  {
+    if (thread->_tid == chunk._slowest_tid &&
+        (strcmp(thread->_name, "worker-0") != 0 ||
+         thread->_site[profiler_find_site("process_chunk", pk_function)]._calls != 10))
+    {
+      log_println("slowest thread mismatch");
+      return 1;
+    }
+  }
+  return 0;
+}
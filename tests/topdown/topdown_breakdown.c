@@ -0,0 +1,161 @@
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <tier_0.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static volatile uint64_t g_sink = 0;
+
+void mixed_work(void)
+{
+  PROFILE_FUNCTION_START;
+  uint64_t x = 1;
+  for (uint32_t i = 0; i < 1000000; i++)
+  {
+    x = x * 6364136223846793005ull + (x >> 7);
+  }
+  g_sink += x;
+  PROFILE_FUNCTION_END;
+}
+
+static bool near(f64 value, f64 expected)
+{
+  return value > expected - 1e-9 && value < expected + 1e-9;
+}
+
+#ifdef __linux__
+static void write_file(const char* dir, const char* name, const char* text)
+{
+  char path[512];
+  snprintf(path, sizeof(path), "%s/%s", dir, name);
+  FILE* file = fopen(path, "w");
+  if (file)
+  {
+    fputs(text, file);
+    fclose(file);
+  }
+}
+
+static void remove_file(const char* dir, const char* name)
+{
+  char path[512];
+  snprintf(path, sizeof(path), "%s/%s", dir, name);
+  remove(path);
+}
+
+// a pmu directory with the classic slot events, laid out like sysfs
+static bool fake_pmu(void)
+{
+  static const char* files[][2] =
+  {
+    { "type", "4\n" },
+    { "format/event", "config:0-7\n" },
+    { "format/umask", "config:8-15\n" },
+    { "events/topdown-total-slots", "event=0x3c,umask=0x00\n" },
+    { "events/topdown-total-slots.scale", "2\n" },
+    { "events/topdown-slots-issued", "event=0x0e,umask=0x01\n" },
+    { "events/topdown-slots-retired", "event=0xc2,umask=0x02\n" },
+    { "events/topdown-fetch-bubbles", "event=0x9c,umask=0x01\n" },
+    { "events/topdown-recovery-bubbles", "event=0x0d,umask=0x03\n" },
+  };
+
+  char dir[] = "/tmp/tier0_pmu_XXXXXX";
+  if (!mkdtemp(dir))
+  {
+    return true;
+  }
+
+  char sub[512];
+  snprintf(sub, sizeof(sub), "%s/format", dir);
+  mkdir(sub, 0700);
+  snprintf(sub, sizeof(sub), "%s/events", dir);
+  mkdir(sub, 0700);
+  for (uint32_t i = 0; i < sizeof(files) / sizeof(files[0]); i++)
+  {
+    write_file(dir, files[i][0], files[i][1]);
+  }
+
+  prof_topdown_events_t events;
+  enum prof_topdown_method method = profiler_topdown_resolve(dir, &events);
+  bool ok = method == pt_classic &&
+            events._events[0]._pmu == 4 && events._events[0]._config == 0x3c && events._scale[0] == 2.0 &&
+            events._events[1]._config == 0x10e && events._events[4]._config == 0x30d && events._scale[1] == 1.0;
+
+  // without one of the events there is nothing to resolve
+  remove_file(dir, "events/topdown-fetch-bubbles");
+  ok = ok && profiler_topdown_resolve(dir, &events) == pt_unavailable;
+
+  for (uint32_t i = 0; i < sizeof(files) / sizeof(files[0]); i++)
+  {
+    remove_file(dir, files[i][0]);
+  }
+  snprintf(sub, sizeof(sub), "%s/format", dir);
+  rmdir(sub);
+  snprintf(sub, sizeof(sub), "%s/events", dir);
+  rmdir(sub);
+  rmdir(dir);
+  return ok;
+}
+#endif
+
+int main(void)
+{
+  profiler_init();
+
+  prof_topdown_t topdown;
+  const f64 classic[PROFILER_TOPDOWN_EVENTS] = { 1000.0, 600.0, 500.0, 200.0, 50.0 };
+  if (!profiler_topdown_compute(pt_classic, classic, &topdown) ||
+      !near(topdown._frontend_bound, 0.2) || !near(topdown._bad_speculation, 0.15) ||
+      !near(topdown._retiring, 0.5) || !near(topdown._backend_bound, 0.15))
+  {
+    log_println("classic formula mismatch");
+    return 1;
+  }
+
+  const f64 metrics[PROFILER_TOPDOWN_EVENTS] = { 1000.0, 400.0, 100.0, 200.0, 300.0 };
+  if (!profiler_topdown_compute(pt_metrics, metrics, &topdown) ||
+      !near(topdown._retiring, 0.4) || !near(topdown._bad_speculation, 0.1) ||
+      !near(topdown._frontend_bound, 0.2) || !near(topdown._backend_bound, 0.3))
+  {
+    log_println("perf metrics mismatch");
+    return 1;
+  }
+
+  const f64 empty[PROFILER_TOPDOWN_EVENTS] = { 0 };
+  if (profiler_topdown_compute(pt_classic, empty, &topdown))
+  {
+    log_println("no slots must not give a breakdown");
+    return 1;
+  }
+
+#ifdef __linux__
+  if (!fake_pmu())
+  {
+    log_println("sysfs event resolution mismatch");
+    return 1;
+  }
+#endif
+
+  // on the real pmu, or unavailable with a reason in the report
+  enum prof_topdown_method method = profiler_topdown_enable();
+  mixed_work();
+  profiler_end();
+  profiler_print_all();
+
+  _index site = profiler_find_site("mixed_work", pk_function);
+  if (method == pt_unavailable && profiler_topdown_site(site, &topdown))
+  {
+    log_println("breakdown without topdown events");
+    return 1;
+  }
+  return 0;
+}
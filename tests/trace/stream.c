@@ -0,0 +1,246 @@
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <tier_0.h>
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define THREADS    2
+#define ITERATIONS 20000
+#define EVENTS     (THREADS * ITERATIONS * 6ull)  // outer and two inner calls, a begin and an end each
+
+static volatile uint64_t g_sink = 0;
+
+NO_INLINE void inner(void)
+{
+  PROFILE_FUNCTION_START;
+  g_sink++;
+  PROFILE_FUNCTION_END;
+}
+
+NO_INLINE void outer(void)
+{
+  PROFILE_FUNCTION_START;
+  inner();
+  inner();
+  PROFILE_FUNCTION_END;
+}
+
+static void* worker(void* arg)
+{
+  profiler_thread_set_name((const char*)arg);
+  for (uint32_t i = 0; i < ITERATIONS; i++)
+  {
+    outer();
+  }
+  return NULL;
+}
+
+// threads that keep tracing while traces start and stop under them
+static volatile bool g_cycling = true;
+
+static void* spinner(void* arg)
+{
+  (void)arg;
+  while (g_cycling)
+  {
+    inner();
+  }
+  return NULL;
+}
+
+static bool check_cycles(void)
+{
+  pthread_t handles[THREADS * 2];
+  for (u32 t = 0; t < THREADS * 2; t++)
+  {
+    pthread_create(&handles[t], NULL, spinner, NULL);
+  }
+
+  bool ok = true;
+  for (u32 cycle = 0; cycle < 50 && ok; cycle++)
+  {
+    ok = profiler_trace_start("cycles.t0trace");
+    struct timespec delay = { 0, 500 * 1000 };
+    nanosleep(&delay, NULL);
+    ok = ok && profiler_trace_stop();
+
+    // every trace holds exactly the events written during it
+    prof_trace_file_t trace;
+    ok = ok && profiler_trace_open("cycles.t0trace", &trace);
+    if (ok)
+    {
+      u64 events = 0;
+      prof_trace_cursor_t cursor;
+      prof_trace_event_t  event;
+      profiler_trace_cursor(&trace, &cursor);
+      while (profiler_trace_next(&cursor, &event))
+      {
+        events++;
+      }
+      ok = trace._complete && events == trace._end._events && events == profiler_trace_events();
+      profiler_trace_close(&trace);
+    }
+  }
+
+  g_cycling = false;
+  for (u32 t = 0; t < THREADS * 2; t++)
+  {
+    pthread_join(handles[t], NULL);
+  }
+  return ok;
+}
+
+static bool check_trace(const char* path)
+{
+  prof_trace_file_t trace;
+  if (!profiler_trace_open(path, &trace))
+  {
+    return false;
+  }
+
+  u64  tids[THREADS]   = {0};
+  s64  depth[THREADS]  = {0};
+  u64  last[THREADS]   = {0};
+  u64  begins          = 0;
+  u64  ends            = 0;
+  u64  outer_begins    = 0;
+  bool ok              = trace._complete && trace._end._events == EVENTS && trace._end._dropped == 0;
+
+  prof_trace_cursor_t cursor;
+  prof_trace_event_t  event;
+  profiler_trace_cursor(&trace, &cursor);
+  while (ok && profiler_trace_next(&cursor, &event))
+  {
+    u32 t = 0;
+    while (t < THREADS && tids[t] != 0 && tids[t] != event._tid)
+    {
+      t++;
+    }
+    if (t == THREADS)
+    {
+      log_println("events of an unexpected thread {u64}", event._tid);
+      ok = false;
+      break;
+    }
+    tids[t] = event._tid;
+
+    // per thread the events are in order and nested
+    ok = event._time >= last[t];
+    last[t] = event._time;
+    if (event._end)
+    {
+      ends++;
+      ok = ok && --depth[t] >= 0;
+    }
+    else
+    {
+      begins++;
+      depth[t]++;
+      const char* name = profiler_trace_site_name(&trace, event._index);
+      outer_begins += strcmp(name, "outer") == 0;
+      ok = ok && (strcmp(name, "outer") == 0 || strcmp(name, "inner") == 0);
+    }
+  }
+
+  for (u32 t = 0; t < THREADS; t++)
+  {
+    const char* name = profiler_trace_thread_name(&trace, tids[t]);
+    ok = ok && depth[t] == 0 && (strcmp(name, "producer_a") == 0 || strcmp(name, "producer_b") == 0);
+  }
+  ok = ok && begins == EVENTS / 2 && ends == EVENTS / 2 && outer_begins == THREADS * ITERATIONS;
+
+  f64 per_event = (f64)trace._size / (f64)EVENTS;
+  log_println("read {u64} begins and {u64} ends, {f64} bytes per event", begins, ends, per_event);
+  ok = ok && per_event < 4.0;
+
+  profiler_trace_close(&trace);
+  return ok;
+}
+
+static bool check_chrome(const char* path)
+{
+  FILE* file = fopen(path, "r");
+  if (!file)
+  {
+    return false;
+  }
+
+  static char text[64 * 1024];
+  size_t size = fread(text, 1, sizeof(text) - 1, file);
+  fclose(file);
+  text[size] = '\0';
+
+  return strncmp(text, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", 38) == 0 &&
+         strstr(text, "\"args\":{\"name\":\"producer_a\"}") && strstr(text, "\"name\":\"outer\"") &&
+         strstr(text, "\"ph\":\"E\"");
+}
+
+int main(void)
+{
+  profiler_init();
+
+  if (!profiler_trace_start("stream.t0trace"))
+  {
+    return 1;
+  }
+
+  u64 begin = get_nanoseconds();
+  pthread_t   handles[THREADS];
+  const char* names[THREADS] = { "producer_a", "producer_b" };
+  for (u32 t = 0; t < THREADS; t++)
+  {
+    pthread_create(&handles[t], NULL, worker, (void*)names[t]);
+  }
+  for (u32 t = 0; t < THREADS; t++)
+  {
+    pthread_join(handles[t], NULL);
+  }
+  u64 elapsed = get_nanoseconds() - begin;
+
+  if (!profiler_trace_stop())
+  {
+    return 1;
+  }
+
+  if (profiler_trace_events() != EVENTS || profiler_trace_dropped() != 0)
+  {
+    log_println("expected {u64} events, wrote {u64} and dropped {u64}", EVENTS, profiler_trace_events(),
+                profiler_trace_dropped());
+    return 1;
+  }
+  log_println("traced {u64} events at {f64} M events/s", EVENTS, (f64)EVENTS * 1e3 / (f64)elapsed);
+
+  if (!check_trace("stream.t0trace"))
+  {
+    log_println("stream.t0trace doesn't read back as traced");
+    return 1;
+  }
+
+  if (!profiler_trace_to_chrome("stream.t0trace", "stream.trace.json") || !check_chrome("stream.trace.json"))
+  {
+    log_println("stream.trace.json is not the expected chrome trace");
+    return 1;
+  }
+
+  // nothing is recorded between traces
+  outer();
+  if (profiler_trace_active() || profiler_trace_events() != EVENTS)
+  {
+    return 1;
+  }
+
+  if (!check_cycles())
+  {
+    log_println("traces started and stopped under running threads don't read back");
+    return 1;
+  }
+
+  log_println("wrote stream.t0trace, stream.trace.json and cycles.t0trace");
+  profiler_end();
+  return 0;
+}
@@ -0,0 +1,85 @@
+#include <tier_0.h>
+
+#include <stdlib.h>
+
+#define BUFFER_SIZE (1u << 22)
+
+// fnv-1a over a variable sized input, cost scales with the byte count
+uint64_t checksum(const uint8_t* data, size_t size)
+{
+  PROFILE_FUNCTION_START;
+
+  uint64_t hash = 14695981039346656037ull;
+  for (size_t i = 0; i < size; i++)
+  {
+    hash = (hash ^ data[i]) * 1099511628211ull;
+  }
+
+  PROFILE_FUNCTION_END_WORK(size, 0);
+  PROFILE_HINT_SUCCESSFUL_RETURN;
+  return hash;
+}
+
+// counts records with a loop level annotation instead of passing the count at the end
+uint64_t parse_records(const uint8_t* data, size_t size)
+{
+  PROFILE_FUNCTION_START;
+
+  uint64_t sum = 0;
+  size_t   offset = 0;
+  while (offset + 8 <= size)
+  {
+    size_t length = 8 + (data[offset] & 56);
+    for (size_t i = offset; i < offset + 8; i++)
+    {
+      sum += data[i];
+    }
+    offset += length;
+    PROFILE_LOOP(1);
+  }
+  PROFILE_WORK(offset < size ? offset : size, 0);
+
+  PROFILE_FUNCTION_END;
+  PROFILE_HINT_SUCCESSFUL_RETURN;
+  return sum;
+}
+
+int main(void)
+{
+  profiler_init();
+
+  uint8_t* buffer = malloc(BUFFER_SIZE);
+  if (!buffer)
+  {
+    return 1;
+  }
+  for (uint32_t i = 0; i < BUFFER_SIZE; i++)
+  {
+    buffer[i] = (uint8_t)(i * 2654435761u >> 24);
+  }
+
+  uint64_t result = 0;
+  uint64_t bytes  = 0;
+  for (uint32_t shift = 8; shift <= 22; shift++)
+  {
+    result += checksum(buffer, (size_t)1 << shift);
+    bytes  += (uint64_t)1 << shift;
+  }
+  result += parse_records(buffer, BUFFER_SIZE);
+
+  profiler_end();
+  profiler_print_all();
+  log_println("checksum {u64}", result);
+
+  _index index = profiler_find_site("checksum", pk_function);
+  const prof_work_stat_t* work = profiler_get_work_stat(index);
+  if (!work || work->_bytes != bytes || work->_calls != 15)
+  {
+    log_println("work accounting mismatch");
+    free(buffer);
+    return 1;
+  }
+
+  free(buffer);
+  return 0;
+}